@@ -4,28 +4,79 @@
 
 #include <sys/types.h>    
 #include <sys/socket.h>
+#include <sys/stat.h>
 #include <errno.h>
 #include <unistd.h>
 
 // 创建非阻塞 socket
-static int createNonblocking()
+static int createNonblocking(sa_family_t family)
 {
-    int sockfd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
     if (sockfd < 0) 
     {
         LOG_FATAL("%s:%s:%d listen socket create err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
     }
+    return sockfd;
+}
+
+// 探测路径上的 socket 文件是否还有进程在监听：非阻塞 connect 返回 ECONNREFUSED 说明是残留文件，
+// 成功或者 EAGAIN（监听队列满）说明另一个进程正在使用
+static bool unixPathInUse(const InetAddress &addr)
+{
+    int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd < 0)
+    {
+        LOG_FATAL("%s:%s:%d probe socket create err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
+    }
+    bool inUse = true;
+    if (::connect(fd, addr.sockAddr(), addr.sockAddrLength()) < 0)
+    {
+        int savedErrno = errno;
+        inUse = savedErrno != ECONNREFUSED && savedErrno != ENOENT;
+    }
+    ::close(fd);
+    return inUse;
 }
 
 // 构造函数
 Acceptor::Acceptor(EventLoop *loop, const InetAddress &listenAddr, bool reuseport)
     : loop_(loop)
-    , acceptSocket_(createNonblocking())
+    , acceptSocket_(createNonblocking(listenAddr.family()))
     , acceptChannel_(loop, acceptSocket_.fd())
     , listenning_(false)
+    , isUnix_(listenAddr.isUnix())
 {
-    acceptSocket_.setReuseAddr(true);
-    acceptSocket_.setReusePort(true);
+    if (listenAddr.isUnix())
+    {
+        // 路径上残留的 socket 文件（例如进程上次异常退出）会让 bind 失败，先删除。抽象命名空间没有文件。
+        // 只删除没有进程在监听的 socket 文件：路径配置错误时不能误删普通文件，
+        // 也不能抢走另一个正在运行的实例的监听地址
+        std::string path = listenAddr.unixPath();
+        if (!path.empty() && path[0] != '@')
+        {
+            struct stat st;
+            if (::lstat(path.c_str(), &st) == 0)
+            {
+                if (!S_ISSOCK(st.st_mode))
+                {
+                    LOG_FATAL("%s:%s:%d listen path %s exists and is not a socket \n",
+                        __FILE__, __FUNCTION__, __LINE__, path.c_str());
+                }
+                if (unixPathInUse(listenAddr))
+                {
+                    LOG_FATAL("%s:%s:%d listen path %s: address in use \n",
+                        __FILE__, __FUNCTION__, __LINE__, path.c_str());
+                }
+                ::unlink(path.c_str());
+            }
+            unixPath_ = path;
+        }
+    }
+    else
+    {
+        acceptSocket_.setReuseAddr(true);
+        acceptSocket_.setReusePort(reuseport);
+    }
     acceptSocket_.bindAddress(listenAddr);
     acceptChannel_.setReadCallback(std::bind(&Acceptor::handleRead, this));
 }
@@ -35,13 +86,34 @@ Acceptor::~Acceptor()
 {
     acceptChannel_.disableAll();
     acceptChannel_.remove();
+    if (!unixPath_.empty())
+    {
+        ::unlink(unixPath_.c_str());
+    }
 }
 
 // 监听连接套接字，并将可读事件注册到 main EventLoop 的事件监听器上。
 void Acceptor::listen()
 {
     listenning_ = true;
-    acceptSocket_.listen(); 
+    if (options_.recvBufferSize > 0)
+    {
+        acceptSocket_.setRecvBufferSize(options_.recvBufferSize);
+    }
+    if (options_.sendBufferSize > 0)
+    {
+        acceptSocket_.setSendBufferSize(options_.sendBufferSize);
+    }
+    // TCP_DEFER_ACCEPT / TCP_FASTOPEN 只对 TCP 有意义，AF_UNIX 监听 socket 上会设置失败
+    if (!isUnix_ && options_.deferAcceptSeconds > 0)
+    {
+        acceptSocket_.setDeferAccept(options_.deferAcceptSeconds);
+    }
+    if (!isUnix_ && options_.fastOpenQueue > 0)
+    {
+        acceptSocket_.setFastOpen(options_.fastOpenQueue);
+    }
+    acceptSocket_.listen(options_.backlog); 
     acceptChannel_.enableReading(); 
 }
 
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <functional>
+#include <string>
 
 #include "noncopyable.h"
 #include "Socket.h"
 #include "Channel.h"
+#include "SocketOptions.h"
 
 class EventLoop;
 class InetAddress;
@@ -20,6 +22,9 @@ public:
     // 设置新连接的回调函数
     void setNewConnectionCallback(const NewConnectionCallback &cb) { newConnectionCallback_ = cb; }
 
+    // 监听 socket 的选项，在 listen 时生效
+    void setSocketOptions(const SocketOptions &options) { options_ = options; }
+
     bool listenning() const { return listenning_; }
     void listen();
     
@@ -30,5 +35,8 @@ private:
     Socket acceptSocket_;                            // 监听连接的文件描述符
     Channel acceptChannel_;                          // 封装监听套接字的 Channel
     NewConnectionCallback newConnectionCallback_;    // 新连接处理回调函数对象
+    SocketOptions options_;
     bool listenning_;
+    bool isUnix_;
+    std::string unixPath_;                           // 文件系统中的 AF_UNIX 监听路径，析构时删除
 };
\ No newline at end of file
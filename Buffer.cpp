@@ -1,6 +1,7 @@
 #include "Buffer.h"
 
 #include <errno.h>
+#include <sys/socket.h>
 #include <sys/uio.h>
 #include <unistd.h>
 
@@ -40,6 +41,60 @@ ssize_t Buffer::readFd(int fd, int* saveErrno)
     return n;
 }
 
+ssize_t Buffer::readFd(int fd, int* saveErrno, std::vector<int> *fds)
+{
+    char extrabuf[65536];
+    // 一次最多接收的描述符个数，和内核的 SCM_MAX_FD 一致，超过的部分被内核关闭
+    const size_t kMaxFds = 253;
+    char control[CMSG_SPACE(kMaxFds * sizeof(int))];
+
+    struct iovec vec[2];
+    const size_t writable = writableBytes();
+    vec[0].iov_base = begin() + writerIndex_;
+    vec[0].iov_len = writable;
+    vec[1].iov_base = extrabuf;
+    vec[1].iov_len = sizeof extrabuf;
+
+    struct msghdr msg;
+    ::memset(&msg, 0, sizeof msg);
+    msg.msg_iov = vec;
+    msg.msg_iovlen = (writable < sizeof extrabuf) ? 2 : 1;
+    msg.msg_control = control;
+    msg.msg_controllen = sizeof control;
+    const ssize_t n = ::recvmsg(fd, &msg, MSG_CMSG_CLOEXEC);
+    if (n < 0)
+    {
+        *saveErrno = errno;
+        return n;
+    }
+
+    for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm))
+    {
+        if (cm->cmsg_level == SOL_SOCKET && cm->cmsg_type == SCM_RIGHTS)
+        {
+            const size_t count = (cm->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            const char *data = reinterpret_cast<const char*>(CMSG_DATA(cm));
+            for (size_t i = 0; i < count; ++i)
+            {
+                int received;
+                ::memcpy(&received, data + i * sizeof(int), sizeof received);
+                fds->push_back(received);
+            }
+        }
+    }
+
+    if (static_cast<size_t>(n) <= writable)
+    {
+        writerIndex_ += n;
+    }
+    else
+    {
+        writerIndex_ = buffer_.size();
+        append(extrabuf, n - writable);
+    }
+    return n;
+}
+
 ssize_t Buffer::writeFd(int fd, int* saveErrno)
 {
     ssize_t n = ::write(fd, peek(), readableBytes());
@@ -3,6 +3,12 @@
 #include <vector>
 #include <string>
 #include <algorithm>
+#include <assert.h>
+#include <endian.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "BufferSearch.h"
 
 
 //    +-----------------------+-------------------------------+---------------------------+
@@ -19,6 +25,7 @@ class Buffer
 public:
     static const size_t kCheapPrepend = 8;
     static const size_t kInitialSize = 1024;    // 缓冲区初始大小
+    static const size_t kMaxIncomingReserve = 64 * 1024;   // reserveIncoming 一次最多预留的字节数
 
     explicit Buffer(size_t initialSize = kInitialSize)
         : buffer_(kCheapPrepend + initialSize)
@@ -48,6 +55,36 @@ public:
     {
         return begin() + readerIndex_;
     }
+    // 可写的 peek()，用于原地修改已收到的数据，例如 WebSocket 负载解掩码
+    char* mutablePeek()
+    {
+        return begin() + readerIndex_;
+    }
+
+    // 以下查找函数从 peek() + offset 处开始扫描可读数据，找不到返回 nullptr。
+    // 对于尚未收全的消息，调用方可以记住已扫描的长度，下次从该处继续，避免重复扫描。
+    // findCRLF 例外：上次扫描的最后一个字节可能是 '\r'，它的 '\n' 在下次读取时才到达，
+    // 因此要从 已扫描长度 - 1 处继续（已扫描长度为 0 时从 0 开始），见 HttpContext。
+    const char* findCRLF(size_t offset = 0) const
+    {
+        return offset < readableBytes() ? BufferSearch::findCRLF(peek() + offset, beginWrite()) : nullptr;
+    }
+
+    const char* findEOL(size_t offset = 0) const
+    {
+        return findByte('\n', offset);
+    }
+
+    const char* findByte(char c, size_t offset = 0) const
+    {
+        return offset < readableBytes() ? BufferSearch::findByte(peek() + offset, beginWrite(), c) : nullptr;
+    }
+
+    // set 为 '\0' 结尾的字符集合
+    const char* findAny(const char *set, size_t offset = 0) const
+    {
+        return offset < readableBytes() ? BufferSearch::findAny(peek() + offset, beginWrite(), set) : nullptr;
+    }
 
     // onMessage string <- Buffer
     void retrieve(size_t len)
@@ -63,6 +100,12 @@ public:
         }
     }
 
+    // 取走 [peek(), end) 之间的数据，end 通常是 findCRLF 等函数的返回值
+    void retrieveUntil(const char *end)
+    {
+        retrieve(end - peek());
+    }
+
     void retrieveAll()
     {
         readerIndex_ = writerIndex_ = kCheapPrepend;
@@ -91,6 +134,14 @@ public:
         }
     }
 
+    // 为还没有收全的消息预留空间，减少后续扩容。remaining 来自对端声明的长度，
+    // 最多预留 kMaxIncomingReserve 字节：几个字节的头部不能迫使连接分配大块内存，
+    // 预留的空间也不在内存预算的统计之内（预算只统计可读数据）
+    void reserveIncoming(size_t remaining)
+    {
+        ensureWriteableBytes(std::min(remaining, kMaxIncomingReserve));
+    }
+
     // 把[data, data+len]内存上的数据，添加到writable缓冲区当中
     void append(const char *data, size_t len)
     {
@@ -99,6 +150,23 @@ public:
         writerIndex_ += len;
     }
 
+    void append(const void *data, size_t len)
+    {
+        append(static_cast<const char*>(data), len);
+    }
+
+    // 调用方直接写入 beginWrite() 之后，移动写下标
+    void hasWritten(size_t len)
+    {
+        writerIndex_ += len;
+    }
+
+    // 撤销最后写入的 len 字节
+    void unwrite(size_t len)
+    {
+        writerIndex_ -= len;
+    }
+
     char* beginWrite()
     {
         return begin() + writerIndex_;
@@ -109,8 +177,129 @@ public:
         return begin() + writerIndex_;
     }
 
+    /**
+     * 整数的读写均使用网络字节序（大端）。
+     * appendInt* 写到可读数据末尾，prependInt* 写到可读数据前面（占用 prependable 区域），
+     * peekInt* 只读取不移动读下标，readInt* 读取后移动读下标。
+     */
+    void appendInt64(int64_t x)
+    {
+        int64_t be64 = htobe64(x);
+        append(&be64, sizeof be64);
+    }
+
+    void appendInt32(int32_t x)
+    {
+        int32_t be32 = htobe32(x);
+        append(&be32, sizeof be32);
+    }
+
+    void appendInt16(int16_t x)
+    {
+        int16_t be16 = htobe16(x);
+        append(&be16, sizeof be16);
+    }
+
+    void appendInt8(int8_t x)
+    {
+        append(&x, sizeof x);
+    }
+
+    int64_t peekInt64() const
+    {
+        assert(readableBytes() >= sizeof(int64_t));
+        int64_t be64 = 0;
+        ::memcpy(&be64, peek(), sizeof be64);
+        return be64toh(be64);
+    }
+
+    int32_t peekInt32() const
+    {
+        assert(readableBytes() >= sizeof(int32_t));
+        int32_t be32 = 0;
+        ::memcpy(&be32, peek(), sizeof be32);
+        return be32toh(be32);
+    }
+
+    int16_t peekInt16() const
+    {
+        assert(readableBytes() >= sizeof(int16_t));
+        int16_t be16 = 0;
+        ::memcpy(&be16, peek(), sizeof be16);
+        return be16toh(be16);
+    }
+
+    int8_t peekInt8() const
+    {
+        assert(readableBytes() >= sizeof(int8_t));
+        return *peek();
+    }
+
+    int64_t readInt64()
+    {
+        int64_t result = peekInt64();
+        retrieve(sizeof result);
+        return result;
+    }
+
+    int32_t readInt32()
+    {
+        int32_t result = peekInt32();
+        retrieve(sizeof result);
+        return result;
+    }
+
+    int16_t readInt16()
+    {
+        int16_t result = peekInt16();
+        retrieve(sizeof result);
+        return result;
+    }
+
+    int8_t readInt8()
+    {
+        int8_t result = peekInt8();
+        retrieve(sizeof result);
+        return result;
+    }
+
+    // 把数据放到可读数据的前面，不移动已有数据。长度不能超过 prependableBytes()，
+    // 编码器可以先序列化消息体，再把长度头 prepend 到前面，省去一次拷贝。
+    void prepend(const void *data, size_t len)
+    {
+        assert(len <= prependableBytes());
+        readerIndex_ -= len;
+        const char *d = static_cast<const char*>(data);
+        std::copy(d, d+len, begin() + readerIndex_);
+    }
+
+    void prependInt64(int64_t x)
+    {
+        int64_t be64 = htobe64(x);
+        prepend(&be64, sizeof be64);
+    }
+
+    void prependInt32(int32_t x)
+    {
+        int32_t be32 = htobe32(x);
+        prepend(&be32, sizeof be32);
+    }
+
+    void prependInt16(int16_t x)
+    {
+        int16_t be16 = htobe16(x);
+        prepend(&be16, sizeof be16);
+    }
+
+    void prependInt8(int8_t x)
+    {
+        prepend(&x, sizeof x);
+    }
+
     // 从 fd 上读取数据
     ssize_t readFd(int fd, int* saveErrno);
+    // 用 recvmsg 读取 AF_UNIX socket，同时接收 SCM_RIGHTS 传来的文件描述符，追加到 fds（调用方负责关闭）
+    ssize_t readFd(int fd, int* saveErrno, std::vector<int> *fds);
     // 通过 fd 发送数据
     ssize_t writeFd(int fd, int* saveErrno);
 private:
@@ -0,0 +1,328 @@
+#include "BufferSearch.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MYMUDUO_SEARCH_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+using FindByteFunc = const char* (*)(const char*, const char*, char);
+using FindCRLFFunc = const char* (*)(const char*, const char*);
+using FindAnyFunc = const char* (*)(const char*, const char*, const char*);
+
+struct Kernels
+{
+    FindByteFunc findByte;
+    FindCRLFFunc findCRLF;
+    FindAnyFunc findAny;
+};
+
+// 向量化实现一次最多比较的集合字符个数，超过的集合走标量的位图查找
+const size_t kMaxVectorSet = 16;
+
+/********************************** 标量实现 **********************************/
+
+const char* findByteScalar(const char *begin, const char *end, char c)
+{
+    for (const char *p = begin; p < end; ++p)
+    {
+        if (*p == c)
+        {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+const char* findCRLFScalar(const char *begin, const char *end)
+{
+    for (const char *p = begin; p + 1 < end; ++p)
+    {
+        if (p[0] == '\r' && p[1] == '\n')
+        {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+const char* findAnyScalar(const char *begin, const char *end, const char *set)
+{
+    bool table[256] = {false};
+    for (const unsigned char *s = reinterpret_cast<const unsigned char*>(set); *s; ++s)
+    {
+        table[*s] = true;
+    }
+    for (const char *p = begin; p < end; ++p)
+    {
+        if (table[static_cast<unsigned char>(*p)])
+        {
+            return p;
+        }
+    }
+    return nullptr;
+}
+
+#ifdef MYMUDUO_SEARCH_X86
+
+/********************************** SSE2 实现 **********************************/
+
+const char* findByteSse2(const char *begin, const char *end, char c)
+{
+    const __m128i needle = _mm_set1_epi8(c);
+    const char *p = begin;
+    for (; p + 16 <= end; p += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, needle));
+        if (mask)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findByteScalar(p, end, c);
+}
+
+const char* findCRLFSse2(const char *begin, const char *end)
+{
+    const __m128i cr = _mm_set1_epi8('\r');
+    const __m128i lf = _mm_set1_epi8('\n');
+    const char *p = begin;
+    // 同时加载 p 和 p+1，'\r' 的掩码与下一个字节的 '\n' 掩码相与
+    for (; p + 17 <= end; p += 16)
+    {
+        __m128i v0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+        __m128i hit = _mm_and_si128(_mm_cmpeq_epi8(v0, cr), _mm_cmpeq_epi8(v1, lf));
+        int mask = _mm_movemask_epi8(hit);
+        if (mask)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findCRLFScalar(p, end);
+}
+
+const char* findAnySse2(const char *begin, const char *end, const char *set)
+{
+    size_t n = ::strlen(set);
+    if (n == 0 || n > kMaxVectorSet)
+    {
+        return findAnyScalar(begin, end, set);
+    }
+
+    __m128i needles[kMaxVectorSet];
+    for (size_t i = 0; i < n; ++i)
+    {
+        needles[i] = _mm_set1_epi8(set[i]);
+    }
+
+    const char *p = begin;
+    for (; p + 16 <= end; p += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+        __m128i hit = _mm_cmpeq_epi8(v, needles[0]);
+        for (size_t i = 1; i < n; ++i)
+        {
+            hit = _mm_or_si128(hit, _mm_cmpeq_epi8(v, needles[i]));
+        }
+        int mask = _mm_movemask_epi8(hit);
+        if (mask)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findAnyScalar(p, end, set);
+}
+
+/********************************** AVX2 实现 **********************************/
+
+__attribute__((target("avx2")))
+const char* findByteAvx2(const char *begin, const char *end, char c)
+{
+    const __m256i needle = _mm256_set1_epi8(c);
+    const char *p = begin;
+    for (; p + 32 <= end; p += 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, needle)));
+        if (mask)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findByteSse2(p, end, c);
+}
+
+__attribute__((target("avx2")))
+const char* findCRLFAvx2(const char *begin, const char *end)
+{
+    const __m256i cr = _mm256_set1_epi8('\r');
+    const __m256i lf = _mm256_set1_epi8('\n');
+    const char *p = begin;
+    for (; p + 33 <= end; p += 32)
+    {
+        __m256i v0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i v1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+        __m256i hit = _mm256_and_si256(_mm256_cmpeq_epi8(v0, cr), _mm256_cmpeq_epi8(v1, lf));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        if (mask)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findCRLFSse2(p, end);
+}
+
+__attribute__((target("avx2")))
+const char* findAnyAvx2(const char *begin, const char *end, const char *set)
+{
+    size_t n = ::strlen(set);
+    if (n == 0 || n > kMaxVectorSet)
+    {
+        return findAnyScalar(begin, end, set);
+    }
+
+    __m256i needles[kMaxVectorSet];
+    for (size_t i = 0; i < n; ++i)
+    {
+        needles[i] = _mm256_set1_epi8(set[i]);
+    }
+
+    const char *p = begin;
+    for (; p + 32 <= end; p += 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+        __m256i hit = _mm256_cmpeq_epi8(v, needles[0]);
+        for (size_t i = 1; i < n; ++i)
+        {
+            hit = _mm256_or_si256(hit, _mm256_cmpeq_epi8(v, needles[i]));
+        }
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(hit));
+        if (mask)
+        {
+            return p + __builtin_ctz(mask);
+        }
+    }
+    return findAnySse2(p, end, set);
+}
+
+#endif // MYMUDUO_SEARCH_X86
+
+const Kernels kScalarKernels = { findByteScalar, findCRLFScalar, findAnyScalar };
+#ifdef MYMUDUO_SEARCH_X86
+const Kernels kSse2Kernels = { findByteSse2, findCRLFSse2, findAnySse2 };
+const Kernels kAvx2Kernels = { findByteAvx2, findCRLFAvx2, findAnyAvx2 };
+#endif
+
+const Kernels& kernelsFor(BufferSearch::Impl impl)
+{
+#ifdef MYMUDUO_SEARCH_X86
+    if (impl == BufferSearch::kAvx2 && BufferSearch::supported(BufferSearch::kAvx2))
+    {
+        return kAvx2Kernels;
+    }
+    if (impl != BufferSearch::kScalar && BufferSearch::supported(BufferSearch::kSse2))
+    {
+        return kSse2Kernels;
+    }
+#endif
+    return kScalarKernels;
+}
+
+BufferSearch::Impl detectImpl()
+{
+    if (BufferSearch::supported(BufferSearch::kAvx2))
+    {
+        return BufferSearch::kAvx2;
+    }
+    if (BufferSearch::supported(BufferSearch::kSse2))
+    {
+        return BufferSearch::kSse2;
+    }
+    return BufferSearch::kScalar;
+}
+
+// 进程内只检测一次 CPU 特性
+const Kernels& activeKernels()
+{
+    static const Kernels &kernels = kernelsFor(BufferSearch::currentImpl());
+    return kernels;
+}
+
+} // namespace
+
+namespace BufferSearch
+{
+
+bool supported(Impl impl)
+{
+    switch (impl)
+    {
+    case kScalar:
+        return true;
+#ifdef MYMUDUO_SEARCH_X86
+    case kSse2:
+        return __builtin_cpu_supports("sse2");
+    case kAvx2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+Impl currentImpl()
+{
+    static const Impl impl = detectImpl();
+    return impl;
+}
+
+const char* implName(Impl impl)
+{
+    switch (impl)
+    {
+    case kSse2:
+        return "sse2";
+    case kAvx2:
+        return "avx2";
+    default:
+        return "scalar";
+    }
+}
+
+const char* findByte(const char *begin, const char *end, char c)
+{
+    return activeKernels().findByte(begin, end, c);
+}
+
+const char* findCRLF(const char *begin, const char *end)
+{
+    return activeKernels().findCRLF(begin, end);
+}
+
+const char* findAny(const char *begin, const char *end, const char *set)
+{
+    return activeKernels().findAny(begin, end, set);
+}
+
+const char* findByte(Impl impl, const char *begin, const char *end, char c)
+{
+    return kernelsFor(impl).findByte(begin, end, c);
+}
+
+const char* findCRLF(Impl impl, const char *begin, const char *end)
+{
+    return kernelsFor(impl).findCRLF(begin, end);
+}
+
+const char* findAny(Impl impl, const char *begin, const char *end, const char *set)
+{
+    return kernelsFor(impl).findAny(begin, end, set);
+}
+
+} // namespace BufferSearch
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <stddef.h>
+
+/**
+ * Buffer 使用的字节查找内核。
+ * 每个函数在 [begin, end) 范围内查找，找到返回匹配位置，找不到返回 nullptr。
+ * x86 平台在运行时根据 CPU 特性选择 AVX2 / SSE2 实现，其它平台使用标量实现。
+ */
+namespace BufferSearch
+{
+    enum Impl
+    {
+        kScalar,
+        kSse2,
+        kAvx2,
+    };
+
+    const char* findByte(const char *begin, const char *end, char c);
+    const char* findCRLF(const char *begin, const char *end);
+    // set 为 '\0' 结尾的字符集合，返回第一个属于集合的字符位置
+    const char* findAny(const char *begin, const char *end, const char *set);
+
+    // 当前进程实际使用的实现
+    Impl currentImpl();
+    const char* implName(Impl impl);
+    // 判断 CPU 是否支持该实现
+    bool supported(Impl impl);
+
+    // 指定实现的版本，供基准测试对比各个内核使用
+    const char* findByte(Impl impl, const char *begin, const char *end, char c);
+    const char* findCRLF(Impl impl, const char *begin, const char *end);
+    const char* findAny(Impl impl, const char *begin, const char *end, const char *set);
+}
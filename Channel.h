@@ -40,7 +40,7 @@ public:
 
     int fd() const { return fd_; }
     int events() const { return events_; }
-    int set_revents(int revt) { revents_ = revt; }
+    void set_revents(int revt) { revents_ = revt; }
 
     int index() { return index_; }
     void set_index(int idx) { index_ = idx; }
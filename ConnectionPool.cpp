@@ -0,0 +1,385 @@
+#include "ConnectionPool.h"
+#include "TcpClient.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+#include "Logger.h"
+
+namespace
+{
+
+// 连接断开的回调中还在使用 TcpClient，由 loop 稍后释放
+void releaseConnection(const std::shared_ptr<void> &)
+{
+}
+
+} // namespace
+
+bool ConnectionPool::PooledConnection::usable() const
+{
+    return conn && conn->connected();
+}
+
+ConnectionPool::ConnectionPool(EventLoop *loop, const std::string &name, double checkInterval)
+    : loop_(loop)
+    , name_(name)
+{
+    checkTimer_ = loop_->runEvery(checkInterval, std::bind(&ConnectionPool::checkHealth, this));
+}
+
+// 连接的回调只持有 weak_ptr，PooledConnection 随 backends_ 释放以后不会再回调本对象
+ConnectionPool::~ConnectionPool()
+{
+    loop_->cancel(checkTimer_);
+}
+
+uint64_t ConnectionPool::backendKey(const InetAddress &addr)
+{
+    if (addr.isUnix())
+    {
+        // IPv4 地址只占用低 48 位，AF_UNIX 路径的哈希置最高位，两者不会冲突
+        return std::hash<std::string>()(addr.unixPath()) | (1ULL << 63);
+    }
+    const sockaddr_in *sa = addr.getSockAddr();
+    return (static_cast<uint64_t>(sa->sin_addr.s_addr) << 16) | sa->sin_port;
+}
+
+ConnectionPool::Backend* ConnectionPool::findBackend(const InetAddress &addr) const
+{
+    auto it = backends_.find(backendKey(addr));
+    return it == backends_.end() ? nullptr : it->second.get();
+}
+
+void ConnectionPool::addBackend(const InetAddress &addr, const FrameFunction &frame, const Options &options)
+{
+    std::unique_ptr<Backend> &backend = backends_[backendKey(addr)];
+    if (backend)
+    {
+        LOG_ERROR("ConnectionPool::addBackend [%s] %s already added \n", name_.c_str(), addr.toIpPort().c_str());
+        return;
+    }
+    backend.reset(new Backend{addr, frame, options, {}, {}, Stats()});
+    ensureMinIdle(backend.get());
+}
+
+void ConnectionPool::request(const InetAddress &addr, std::string &&message, const ResponseCallback &cb)
+{
+    Backend *backend = findBackend(addr);
+    if (backend == nullptr)
+    {
+        LOG_ERROR("ConnectionPool::request [%s] unknown backend %s \n", name_.c_str(), addr.toIpPort().c_str());
+        cb(false, nullptr, 0);
+        return;
+    }
+    ++backend->stats.requests;
+
+    // 前面还有等待的请求时不能插队
+    PooledConnectionPtr pc = backend->pending.empty() ? chooseConnection(backend) : PooledConnectionPtr();
+    if (pc)
+    {
+        sendOn(pc, std::move(message), cb);
+        return;
+    }
+    if (backend->pending.size() >= backend->options.maxPending)
+    {
+        failRequest(backend, cb);
+        return;
+    }
+    backend->pending.push_back(Pending{std::move(message), cb, Timestamp::now()});
+
+    // 正在建立的连接不够处理等待的请求时，再新建连接
+    size_t connecting = 0;
+    for (const PooledConnectionPtr &c : backend->connections)
+    {
+        if (!c->conn)
+        {
+            ++connecting;
+        }
+    }
+    if (connecting < backend->pending.size() && backend->connections.size() < backend->options.maxConnections)
+    {
+        openConnection(backend);
+    }
+}
+
+// 优先返回空闲连接，其次是未完成请求最少的连接；都已经满了返回空
+ConnectionPool::PooledConnectionPtr ConnectionPool::chooseConnection(Backend *backend)
+{
+    PooledConnectionPtr best;
+    bool connecting = false;
+    for (const PooledConnectionPtr &pc : backend->connections)
+    {
+        if (!pc->usable())
+        {
+            connecting = connecting || !pc->conn;
+            continue;
+        }
+        if (pc->inFlight.empty())
+        {
+            return pc;
+        }
+        if (pc->inFlight.size() < backend->options.maxInFlight
+            && (!best || pc->inFlight.size() < best->inFlight.size()))
+        {
+            best = pc;
+        }
+    }
+    // 流水线到已有连接上，同时补充一个连接供之后的请求使用
+    if (best && !connecting && backend->connections.size() < backend->options.maxConnections)
+    {
+        openConnection(backend);
+    }
+    return best;
+}
+
+void ConnectionPool::sendOn(const PooledConnectionPtr &pc, std::string &&message, const ResponseCallback &cb)
+{
+    pc->inFlight.push_back(InFlight{cb, Timestamp::now()});
+    pc->conn->send(std::move(message));
+}
+
+void ConnectionPool::failRequest(Backend *backend, const ResponseCallback &cb)
+{
+    ++backend->stats.failed;
+    cb(false, nullptr, 0);
+}
+
+void ConnectionPool::openConnection(Backend *backend)
+{
+    PooledConnectionPtr pc = std::make_shared<PooledConnection>();
+    pc->backend = backend;
+    pc->client.reset(new TcpClient(loop_, backend->addr, name_));
+    std::weak_ptr<PooledConnection> weak(pc);
+    pc->client->setConnectionCallback(
+        std::bind(&ConnectionPool::onConnection, this, weak, std::placeholders::_1));
+    pc->client->setMessageCallback(
+        std::bind(&ConnectionPool::onMessage, this, weak, std::placeholders::_1, std::placeholders::_2));
+    pc->client->setSocketOptions(backend->options.socketOptions);
+    pc->client->setConnectTimeout(backend->options.connectTimeout);
+    backend->connections.push_back(pc);
+    ++backend->stats.opened;
+    pc->client->connect();
+}
+
+// 关闭连接：已经建立的连接由断开回调清理，正在建立的连接直接移除
+void ConnectionPool::closeConnection(const PooledConnectionPtr &pc)
+{
+    if (pc->conn)
+    {
+        pc->conn->forceClose();
+    }
+    else
+    {
+        pc->client->stop();
+        removeConnection(pc);
+    }
+}
+
+void ConnectionPool::removeConnection(const PooledConnectionPtr &pc)
+{
+    Backend *backend = pc->backend;
+    std::vector<PooledConnectionPtr> &conns = backend->connections;
+    for (size_t i = 0; i < conns.size(); ++i)
+    {
+        if (conns[i] == pc)
+        {
+            conns[i] = conns.back();
+            conns.pop_back();
+            break;
+        }
+    }
+    loop_->queueInLoop(std::bind(&releaseConnection, std::shared_ptr<void>(pc)));
+}
+
+void ConnectionPool::onConnection(const std::weak_ptr<PooledConnection> &weak, const TcpConnectionPtr &conn)
+{
+    PooledConnectionPtr pc = weak.lock();
+    if (!pc)
+    {
+        return;
+    }
+    Backend *backend = pc->backend;
+    if (conn->connected())
+    {
+        pc->conn = conn;
+        pc->idleSince = Timestamp::now();
+        dispatchPending(backend);
+        return;
+    }
+
+    // 连接断开：未完成的请求全部失败
+    std::deque<InFlight> inFlight;
+    inFlight.swap(pc->inFlight);
+    removeConnection(pc);
+    for (const InFlight &request : inFlight)
+    {
+        failRequest(backend, request.callback);
+    }
+    ensureMinIdle(backend);
+    if (!backend->pending.empty() && backend->connections.size() < backend->options.maxConnections)
+    {
+        openConnection(backend);
+    }
+}
+
+void ConnectionPool::onMessage(const std::weak_ptr<PooledConnection> &weak, const TcpConnectionPtr &conn, Buffer *buf)
+{
+    PooledConnectionPtr pc = weak.lock();
+    if (!pc)
+    {
+        buf->retrieveAll();
+        return;
+    }
+    Backend *backend = pc->backend;
+    while (buf->readableBytes() > 0)
+    {
+        if (pc->inFlight.empty())
+        {
+            // 没有请求却收到了数据，协议已经错位
+            unsigned long unexpected = static_cast<unsigned long>(buf->readableBytes());
+            LOG_ERROR("ConnectionPool::onMessage [%s] unexpected %lu bytes from %s \n", name_.c_str(),
+                unexpected, backend->addr.toIpPort().c_str());
+            ++backend->stats.evicted;
+            buf->retrieveAll();
+            conn->forceClose();
+            return;
+        }
+        size_t len = backend->frame(buf->peek(), buf->readableBytes());
+        if (len == 0)
+        {
+            break;
+        }
+        // 先出队再回调，回调中可以在同一个连接上发出新的请求
+        InFlight request(std::move(pc->inFlight.front()));
+        pc->inFlight.pop_front();
+        request.callback(true, buf->peek(), len);
+        buf->retrieve(len);
+    }
+
+    if (pc->inFlight.empty())
+    {
+        pc->idleSince = Timestamp::now();
+        if (backend->pending.empty() && idleCount(backend) > backend->options.maxIdle)
+        {
+            conn->forceClose();
+            return;
+        }
+    }
+    dispatchPending(backend);
+}
+
+// 把等待队列中的请求按顺序交给可用的连接
+void ConnectionPool::dispatchPending(Backend *backend)
+{
+    while (!backend->pending.empty())
+    {
+        PooledConnectionPtr pc = chooseConnection(backend);
+        if (!pc)
+        {
+            break;
+        }
+        Pending request(std::move(backend->pending.front()));
+        backend->pending.pop_front();
+        sendOn(pc, std::move(request.message), request.callback);
+    }
+}
+
+size_t ConnectionPool::idleCount(const Backend *backend) const
+{
+    size_t idle = 0;
+    for (const PooledConnectionPtr &pc : backend->connections)
+    {
+        if (pc->usable() && pc->inFlight.empty())
+        {
+            ++idle;
+        }
+    }
+    return idle;
+}
+
+// 空闲和正在建立的连接不足 minIdle 时补充
+void ConnectionPool::ensureMinIdle(Backend *backend)
+{
+    size_t available = 0;
+    for (const PooledConnectionPtr &pc : backend->connections)
+    {
+        if (!pc->conn || (pc->usable() && pc->inFlight.empty()))
+        {
+            ++available;
+        }
+    }
+    while (available < backend->options.minIdle && backend->connections.size() < backend->options.maxConnections)
+    {
+        openConnection(backend);
+        ++available;
+    }
+}
+
+void ConnectionPool::checkHealth()
+{
+    Timestamp now = Timestamp::now();
+    for (auto &entry : backends_)
+    {
+        Backend *backend = entry.second.get();
+        const Options &options = backend->options;
+
+        while (!backend->pending.empty()
+            && timeDifference(now, backend->pending.front().queued) > options.requestTimeout)
+        {
+            ResponseCallback cb = std::move(backend->pending.front().callback);
+            backend->pending.pop_front();
+            failRequest(backend, cb);
+        }
+
+        // 关闭连接会修改 connections，先挑出来再关闭
+        std::vector<PooledConnectionPtr> unhealthy;
+        std::vector<PooledConnectionPtr> expired;
+        size_t idle = idleCount(backend);
+        for (const PooledConnectionPtr &pc : backend->connections)
+        {
+            if (!pc->inFlight.empty())
+            {
+                if (timeDifference(now, pc->inFlight.front().sent) > options.requestTimeout)
+                {
+                    unhealthy.push_back(pc);
+                }
+            }
+            else if (pc->usable() && idle > options.minIdle
+                && timeDifference(now, pc->idleSince) > options.idleTimeout)
+            {
+                expired.push_back(pc);
+                --idle;
+            }
+        }
+        for (const PooledConnectionPtr &pc : unhealthy)
+        {
+            LOG_ERROR("ConnectionPool::checkHealth [%s] %s request timeout, evict connection \n",
+                name_.c_str(), backend->addr.toIpPort().c_str());
+            ++backend->stats.evicted;
+            closeConnection(pc);
+        }
+        for (const PooledConnectionPtr &pc : expired)
+        {
+            closeConnection(pc);
+        }
+        ensureMinIdle(backend);
+    }
+}
+
+ConnectionPool::Stats ConnectionPool::stats(const InetAddress &addr) const
+{
+    Stats stats = Stats();
+    Backend *backend = findBackend(addr);
+    if (backend == nullptr)
+    {
+        return stats;
+    }
+    stats = backend->stats;
+    stats.connections = backend->connections.size();
+    stats.idle = idleCount(backend);
+    stats.pending = backend->pending.size();
+    for (const PooledConnectionPtr &pc : backend->connections)
+    {
+        stats.inFlight += pc->inFlight.size();
+    }
+    return stats;
+}
@@ -0,0 +1,152 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "Callbacks.h"
+#include "SocketOptions.h"
+#include "Timestamp.h"
+#include "TimerId.h"
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+class Buffer;
+class EventLoop;
+class TcpClient;
+
+/**
+ * 一个 EventLoop 自己的上游连接池，按后端地址分组。所有函数只能在 loop 线程调用，不加锁，
+ * 请求和响应都不跨线程。通常在 TcpServer 的 ThreadInitCallback 中为每个 subLoop 创建一个，
+ * 并且必须在所属的 loop 线程中销毁。
+ *
+ * 每个连接上可以同时有多个请求（流水线），响应按发送顺序返回：FrameFunction 从接收缓冲区开头
+ * 切出一个完整的响应，连接依次把它交给最早的一个未完成请求的回调。
+ * 选择连接时优先使用空闲连接，其次是未完成请求最少、且不超过 maxInFlight 的连接，并在总数
+ * 不超过 maxConnections 时新建连接；都不可用时请求进入等待队列，有连接可用时按顺序发出。
+ * 健康检查：请求超过 requestTimeout 没有响应、收到多余数据或者连接出错的连接会被关闭，
+ * 其上未完成的请求以失败回调；空闲超过 idleTimeout 的连接在不少于 minIdle 的前提下关闭。
+ */
+class ConnectionPool : noncopyable
+{
+public:
+    struct Options
+    {
+        Options()
+            : minIdle(0)
+            , maxIdle(8)
+            , maxConnections(64)
+            , maxInFlight(1)
+            , maxPending(1024)
+            , requestTimeout(5.0)
+            , idleTimeout(60.0)
+            , connectTimeout(3.0)
+        {
+            socketOptions.tcpNoDelay = true;
+        }
+
+        size_t minIdle;             // 至少保持的空闲连接数，addBackend 时预先建立（预热）
+        size_t maxIdle;             // 请求完成后空闲连接超过这个数目就关闭
+        size_t maxConnections;      // 连接总数的上限，包括正在建立的连接
+        size_t maxInFlight;         // 每个连接上同时未完成的请求数，大于 1 时开启流水线
+        size_t maxPending;          // 等待队列的长度上限，超过时请求直接失败
+        double requestTimeout;      // 单位秒，请求发出（或者开始等待）以后多久没有响应算失败
+        double idleTimeout;         // 单位秒
+        double connectTimeout;      // 单位秒
+        SocketOptions socketOptions;
+    };
+
+    // 返回 data 开头一个完整响应的长度，数据不完整时返回 0
+    using FrameFunction = std::function<size_t (const char *data, size_t len)>;
+    // ok 为 false 表示请求失败（超时、连接断开或者队列已满），此时 data 为空。
+    // data 只在回调期间有效
+    using ResponseCallback = std::function<void (bool ok, const char *data, size_t len)>;
+
+    struct Stats
+    {
+        size_t connections;     // 当前连接数，包括正在建立的
+        size_t idle;            // 其中空闲的连接数
+        size_t inFlight;        // 已经发出、等待响应的请求数
+        size_t pending;         // 等待连接的请求数
+        uint64_t opened;        // 累计建立的连接数
+        uint64_t evicted;       // 累计因为不健康被关闭的连接数
+        uint64_t requests;      // 累计请求数
+        uint64_t failed;        // 累计失败的请求数
+    };
+
+    // checkInterval：健康检查的间隔，单位秒
+    ConnectionPool(EventLoop *loop, const std::string &name, double checkInterval = 0.5);
+    ~ConnectionPool();
+
+    EventLoop* getLoop() const { return loop_; }
+
+    // 登记后端，并建立 minIdle 个连接
+    void addBackend(const InetAddress &addr, const FrameFunction &frame, const Options &options = Options());
+    // 向 addr 发送一个请求，响应或者失败时回调 cb
+    void request(const InetAddress &addr, std::string &&message, const ResponseCallback &cb);
+    Stats stats(const InetAddress &addr) const;
+
+private:
+    struct InFlight
+    {
+        ResponseCallback callback;
+        Timestamp sent;
+    };
+
+    struct Pending
+    {
+        std::string message;
+        ResponseCallback callback;
+        Timestamp queued;
+    };
+
+    struct Backend;
+
+    struct PooledConnection
+    {
+        Backend *backend;
+        std::unique_ptr<TcpClient> client;
+        TcpConnectionPtr conn;          // 连接建立以后才有；先于 client 析构，由 TcpClient 关闭连接
+        std::deque<InFlight> inFlight;
+        Timestamp idleSince;
+
+        bool usable() const;
+    };
+    using PooledConnectionPtr = std::shared_ptr<PooledConnection>;
+
+    struct Backend
+    {
+        InetAddress addr;
+        FrameFunction frame;
+        Options options;
+        std::vector<PooledConnectionPtr> connections;
+        std::deque<Pending> pending;
+        Stats stats;
+    };
+
+    static uint64_t backendKey(const InetAddress &addr);
+    Backend* findBackend(const InetAddress &addr) const;
+
+    void openConnection(Backend *backend);
+    void closeConnection(const PooledConnectionPtr &pc);
+    void removeConnection(const PooledConnectionPtr &pc);
+    PooledConnectionPtr chooseConnection(Backend *backend);
+    void sendOn(const PooledConnectionPtr &pc, std::string &&message, const ResponseCallback &cb);
+    void dispatchPending(Backend *backend);
+    void ensureMinIdle(Backend *backend);
+    size_t idleCount(const Backend *backend) const;
+    void failRequest(Backend *backend, const ResponseCallback &cb);
+
+    void onConnection(const std::weak_ptr<PooledConnection> &weak, const TcpConnectionPtr &conn);
+    void onMessage(const std::weak_ptr<PooledConnection> &weak, const TcpConnectionPtr &conn, Buffer *buf);
+    void checkHealth();
+
+    EventLoop *loop_;
+    const std::string name_;
+    std::unordered_map<uint64_t, std::unique_ptr<Backend>> backends_;
+    TimerId checkTimer_;
+};
@@ -0,0 +1,246 @@
+#include "Connector.h"
+#include "Channel.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+const double Connector::kDefaultInitialRetryDelay = 0.5;
+const double Connector::kDefaultMaxRetryDelay = 30.0;
+
+static int createNonblocking(sa_family_t family)
+{
+    int sockfd = ::socket(family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sockfd < 0)
+    {
+        LOG_FATAL("%s:%s:%d connect socket create err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
+    }
+    return sockfd;
+}
+
+static int getSocketError(int sockfd)
+{
+    int optval;
+    socklen_t optlen = sizeof optval;
+    if (::getsockopt(sockfd, SOL_SOCKET, SO_ERROR, &optval, &optlen) < 0)
+    {
+        return errno;
+    }
+    return optval;
+}
+
+// 连接本机上没有监听的端口时，内核可能选中同一个端口作为源端口，形成自连接
+static bool isSelfConnect(int sockfd)
+{
+    sockaddr_in local;
+    sockaddr_in peer;
+    socklen_t len = sizeof local;
+    ::memset(&local, 0, sizeof local);
+    ::memset(&peer, 0, sizeof peer);
+    if (::getsockname(sockfd, (sockaddr*)&local, &len) < 0 || local.sin_family != AF_INET)
+    {
+        return false;
+    }
+    len = sizeof peer;
+    if (::getpeername(sockfd, (sockaddr*)&peer, &len) < 0)
+    {
+        return false;
+    }
+    return local.sin_port == peer.sin_port && local.sin_addr.s_addr == peer.sin_addr.s_addr;
+}
+
+Connector::Connector(EventLoop *loop, const InetAddress &serverAddr)
+    : loop_(loop)
+    , serverAddr_(serverAddr)
+    , connect_(false)
+    , state_(kDisconnected)
+    , initialRetryDelay_(kDefaultInitialRetryDelay)
+    , maxRetryDelay_(kDefaultMaxRetryDelay)
+    , retryDelay_(kDefaultInitialRetryDelay)
+    , connectTimeout_(0.0)
+{
+    LOG_DEBUG("Connector ctor[%p] \n", this);
+}
+
+Connector::~Connector()
+{
+    LOG_DEBUG("Connector dtor[%p] \n", this);
+}
+
+void Connector::start()
+{
+    connect_ = true;
+    loop_->runInLoop(std::bind(&Connector::startInLoop, shared_from_this()));
+}
+
+void Connector::startInLoop()
+{
+    if (connect_)
+    {
+        connect();
+    }
+    else
+    {
+        LOG_DEBUG("Connector::startInLoop do not connect \n");
+    }
+}
+
+void Connector::stop()
+{
+    connect_ = false;
+    loop_->queueInLoop(std::bind(&Connector::stopInLoop, shared_from_this()));
+}
+
+void Connector::stopInLoop()
+{
+    loop_->cancel(retryTimer_);
+    if (state_ == kConnecting)
+    {
+        loop_->cancel(timeoutTimer_);
+        setState(kDisconnected);
+        int sockfd = removeAndResetChannel();
+        ::close(sockfd);
+    }
+}
+
+void Connector::restart()
+{
+    setState(kDisconnected);
+    retryDelay_ = initialRetryDelay_;
+    connect_ = true;
+    startInLoop();
+}
+
+void Connector::connect()
+{
+    int sockfd = createNonblocking(serverAddr_.family());
+    int ret = ::connect(sockfd, serverAddr_.sockAddr(), serverAddr_.sockAddrLength());
+    int savedErrno = (ret == 0) ? 0 : errno;
+    switch (savedErrno)
+    {
+    case 0:
+    case EINPROGRESS:
+    case EINTR:
+    case EISCONN:
+        connecting(sockfd);
+        break;
+
+    // 暂时性的错误，稍后重试
+    case EAGAIN:
+    case EADDRINUSE:
+    case EADDRNOTAVAIL:
+    case ECONNREFUSED:
+    case ENETUNREACH:
+    case ETIMEDOUT:
+        retry(sockfd);
+        break;
+
+    default:
+        LOG_ERROR("Connector::connect %s error:%d \n", serverAddr_.toIpPort().c_str(), savedErrno);
+        ::close(sockfd);
+        break;
+    }
+}
+
+// 等待 EPOLLOUT 得到连接结果
+void Connector::connecting(int sockfd)
+{
+    setState(kConnecting);
+    channel_.reset(new Channel(loop_, sockfd));
+    channel_->setWriteCallback(std::bind(&Connector::handleWrite, this));
+    channel_->setErrorCallback(std::bind(&Connector::handleError, this));
+    channel_->enableWriting();
+    if (connectTimeout_ > 0)
+    {
+        timeoutTimer_ = loop_->runAfter(connectTimeout_, std::bind(&Connector::handleTimeout, shared_from_this()));
+    }
+}
+
+// 连接结束（成功或者失败），把 Channel 从 poller 中移除，fd 交给调用方
+int Connector::removeAndResetChannel()
+{
+    channel_->disableAll();
+    channel_->remove();
+    int sockfd = channel_->fd();
+    // 可能正处于 Channel::handleEvent 中，不能在这里删除 Channel，交给 loop 稍后释放。
+    // 先转移所有权：连接回调中可能立即 restart，为新的连接创建 channel_
+    std::shared_ptr<Channel> channel(channel_.release());
+    loop_->queueInLoop(std::bind(&Connector::releaseChannel, channel));
+    return sockfd;
+}
+
+void Connector::releaseChannel(const std::shared_ptr<Channel> &)
+{
+}
+
+void Connector::handleWrite()
+{
+    if (state_ != kConnecting)
+    {
+        return;
+    }
+    loop_->cancel(timeoutTimer_);
+    int sockfd = removeAndResetChannel();
+    int err = getSocketError(sockfd);
+    if (err)
+    {
+        LOG_ERROR("Connector::handleWrite %s SO_ERROR:%d \n", serverAddr_.toIpPort().c_str(), err);
+        retry(sockfd);
+    }
+    else if (isSelfConnect(sockfd))
+    {
+        LOG_ERROR("Connector::handleWrite self connect \n");
+        retry(sockfd);
+    }
+    else
+    {
+        setState(kConnected);
+        if (connect_)
+        {
+            newConnectionCallback_(sockfd);
+        }
+        else
+        {
+            ::close(sockfd);
+        }
+    }
+}
+
+void Connector::handleError()
+{
+    if (state_ == kConnecting)
+    {
+        loop_->cancel(timeoutTimer_);
+        int sockfd = removeAndResetChannel();
+        LOG_ERROR("Connector::handleError %s SO_ERROR:%d \n", serverAddr_.toIpPort().c_str(), getSocketError(sockfd));
+        retry(sockfd);
+    }
+}
+
+void Connector::handleTimeout()
+{
+    if (state_ == kConnecting)
+    {
+        LOG_ERROR("Connector::handleTimeout %s connect timeout after %.3f seconds \n",
+            serverAddr_.toIpPort().c_str(), connectTimeout_);
+        int sockfd = removeAndResetChannel();
+        retry(sockfd);
+    }
+}
+
+// 关闭失败的 socket，等待 retryDelay_ 以后重新连接，等待时间每次翻倍
+void Connector::retry(int sockfd)
+{
+    ::close(sockfd);
+    setState(kDisconnected);
+    if (connect_)
+    {
+        LOG_INFO("Connector::retry connecting to %s in %.3f seconds \n",
+            serverAddr_.toIpPort().c_str(), retryDelay_);
+        retryTimer_ = loop_->runAfter(retryDelay_, std::bind(&Connector::startInLoop, shared_from_this()));
+        retryDelay_ = retryDelay_ * 2 < maxRetryDelay_ ? retryDelay_ * 2 : maxRetryDelay_;
+    }
+}
@@ -0,0 +1,73 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "InetAddress.h"
+#include "TimerId.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+
+class Channel;
+class EventLoop;
+
+/**
+ * 主动发起连接：非阻塞 connect，由 Channel 的 EPOLLOUT 通知连接结果。
+ * 连接失败或者超时以后按指数退避重试（initialRetryDelay, 2 倍递增，不超过 maxRetryDelay），
+ * 直到 stop。连接成功时把 sockfd 交给 NewConnectionCallback，之后 Connector 不再管理这个 fd。
+ * 由 TcpClient 使用，重试期间由定时器持有，所以用 shared_ptr 管理。
+ */
+class Connector : noncopyable, public std::enable_shared_from_this<Connector>
+{
+public:
+    using NewConnectionCallback = std::function<void (int sockfd)>;
+
+    Connector(EventLoop *loop, const InetAddress &serverAddr);
+    ~Connector();
+
+    void setNewConnectionCallback(const NewConnectionCallback &cb) { newConnectionCallback_ = cb; }
+
+    // 重试间隔，单位秒，必须在 start 之前设置
+    void setRetryDelay(double initialSeconds, double maxSeconds)
+    { initialRetryDelay_ = initialSeconds; maxRetryDelay_ = maxSeconds; retryDelay_ = initialSeconds; }
+    // 单次 connect 的超时时间，单位秒，超时后按连接失败重试；0 表示只依赖内核的超时
+    void setConnectTimeout(double seconds) { connectTimeout_ = seconds; }
+
+    const InetAddress& serverAddress() const { return serverAddr_; }
+
+    void start();     // 可以在任意线程调用
+    void restart();   // 必须在 loop 线程调用，重置重试间隔以后重新连接
+    void stop();      // 可以在任意线程调用
+
+    static const double kDefaultInitialRetryDelay;
+    static const double kDefaultMaxRetryDelay;
+
+private:
+    enum StateE { kDisconnected, kConnecting, kConnected };
+    void setState(StateE state) { state_ = state; }
+
+    void startInLoop();
+    void stopInLoop();
+    void connect();
+    void connecting(int sockfd);
+    void handleWrite();
+    void handleError();
+    void handleTimeout();
+    void retry(int sockfd);
+    int removeAndResetChannel();
+    static void releaseChannel(const std::shared_ptr<Channel> &channel);
+
+    EventLoop *loop_;
+    InetAddress serverAddr_;
+    std::atomic_bool connect_;          // 用户是否希望连接
+    std::atomic_int state_;
+    std::unique_ptr<Channel> channel_;  // 正在连接的 socket，连接结束以后删除
+    NewConnectionCallback newConnectionCallback_;
+
+    double initialRetryDelay_;
+    double maxRetryDelay_;
+    double retryDelay_;                 // 下一次重试前等待的秒数
+    double connectTimeout_;
+    TimerId retryTimer_;
+    TimerId timeoutTimer_;
+};
@@ -2,16 +2,87 @@
 #include <unistd.h>
 #include <fcntl.h>
 #include <errno.h>
+#include <signal.h>
+#include <algorithm>
+#include <iterator>
 #include <memory>
+#include <unordered_map>
 
 #include "EventLoop.h"
 #include "Logger.h"
 #include "Poller.h"
 #include "Channel.h"
+#include "TimerQueue.h"
 
 // 防止一个线程创建多个 EventLoop。
 __thread EventLoop *t_loopInThisThread = nullptr;
 
+// 为每个 EventLoop 分配唯一编号，loop 销毁后地址可能被复用，编号不会
+static std::atomic<uint64_t> g_loopCount(0);
+
+namespace
+{
+
+// 对端已经关闭的连接上 write 会产生 SIGPIPE，默认处理是终止进程；忽略它，改由 write 返回 EPIPE 处理
+class IgnoreSigPipe
+{
+public:
+    IgnoreSigPipe()
+    {
+        ::signal(SIGPIPE, SIG_IGN);
+    }
+};
+
+IgnoreSigPipe initObj;
+
+// 一个生产者线程提交给某个 loop、还没有被 loop 取走的一批函数
+struct FunctorBatch
+{
+    FunctorBatch() : taken(false) {}
+
+    std::mutex mutex;
+    bool taken;
+    std::vector<EventLoop::Functor> functors;
+};
+
+// 当前线程发往各个 loop 的最新批次，以 loop 的编号为键
+thread_local std::unordered_map<uint64_t, std::shared_ptr<FunctorBatch>> t_batches;
+// t_batches 超过这个大小时清理已经被取走的批次，见 runInLoopBatched
+thread_local size_t t_batchesSweepSize = 16;
+
+// 删除已经被 loop 取走的批次。生产者线程可能比它提交过的很多短命 loop 活得长，
+// 不清理的话每个 loop 编号都会留下一项
+void sweepTakenBatches()
+{
+    for (auto it = t_batches.begin(); it != t_batches.end(); )
+    {
+        bool taken;
+        {
+            std::unique_lock<std::mutex> lock(it->second->mutex);
+            taken = it->second->taken;
+        }
+        it = taken ? t_batches.erase(it) : std::next(it);
+    }
+    // 按清理后的大小加倍，清理的开销分摊到新建批次上
+    t_batchesSweepSize = std::max<size_t>(16, 2 * t_batches.size());
+}
+
+void runBatch(const std::shared_ptr<FunctorBatch> &batch)
+{
+    std::vector<EventLoop::Functor> functors;
+    {
+        std::unique_lock<std::mutex> lock(batch->mutex);
+        batch->taken = true;
+        functors.swap(batch->functors);
+    }
+    for (const EventLoop::Functor &functor : functors)
+    {
+        functor();
+    }
+}
+
+} // namespace
+
 // 定义默认的 Poller IO 复用接口的超时时间
 const int kPollTimeMs = 10000;
 
@@ -32,9 +103,12 @@ EventLoop::EventLoop()
     , quit_(false)
     , callingPendingFunctors_(false)
     , threadId_(CurrentThread::tid())
+    , id_(++g_loopCount)
     , poller_(Poller::newDefaultPoller(this))
     , wakeupFd_(createEventfd())
     , wakeupChannel_(new Channel(this, wakeupFd_))
+    , timerQueue_(new TimerQueue(this))
+    , callingIterationEndFunctors_(false)
 {
     LOG_DEBUG("EventLoop created %p in thread %d \n", this, threadId_);
     if (t_loopInThisThread)
@@ -55,12 +129,27 @@ EventLoop::EventLoop()
 // 析构函数
 EventLoop::~EventLoop()
 {
+    // 先释放还没有执行的函数：它们持有的对象（例如 TcpClient）析构时可能再向本 loop 提交函数，
+    // 必须在锁和函数队列析构之前处理完
+    std::vector<Functor> functors;
+    do
+    {
+        functors.clear();
+        std::unique_lock<std::mutex> lock(mutex_);
+        functors.swap(pendingFunctors_);
+    } while (!functors.empty());
+
     wakeupChannel_->disableAll();
     wakeupChannel_->remove();
     ::close(wakeupFd_);
     t_loopInThisThread = nullptr;
 }
 
+EventLoop* EventLoop::getEventLoopOfCurrentThread()
+{
+    return t_loopInThisThread;
+}
+
 // 开启事件循环
 void EventLoop::loop()
 {
@@ -82,6 +171,9 @@ void EventLoop::loop()
         
         // 执行当前 EventLoop 事件循环需要处理的回调操作
         doPendingFunctors();
+
+        // 执行本轮循环中延迟到末尾的操作，例如合并后的发送
+        doIterationEndFunctors();
     }
 
     LOG_INFO("EventLoop %p stop looping. \n", this);
@@ -124,12 +216,67 @@ void EventLoop::queueInLoop(Functor cb)
     }
 
     // 唤醒运行 EventLoop 的线程。callingPendingFunctors_ 的意思是：当前 loop 正在执行回调，但是 loop 又有了新的回调
-    if (!isInLoopThread() || callingPendingFunctors_) 
+    if (!isInLoopThread() || callingPendingFunctors_ || callingIterationEndFunctors_) 
     {
         wakeup(); 
     }
 }
 
+// 批量提交回调函数
+void EventLoop::runInLoopBatched(Functor cb)
+{
+    if (isInLoopThread())
+    {
+        cb();
+        return;
+    }
+    auto it = t_batches.find(id_);
+    if (it != t_batches.end())
+    {
+        std::unique_lock<std::mutex> lock(it->second->mutex);
+        if (!it->second->taken)
+        {
+            // 上一个批次还在函数队列中，追加进去，不需要再唤醒 loop
+            it->second->functors.emplace_back(std::move(cb));
+            return;
+        }
+    }
+    else if (t_batches.size() >= t_batchesSweepSize)
+    {
+        sweepTakenBatches();
+    }
+    std::shared_ptr<FunctorBatch> &batch = t_batches[id_];
+    batch = std::make_shared<FunctorBatch>();
+    batch->functors.emplace_back(std::move(cb));
+    queueInLoop(std::bind(&runBatch, batch));
+}
+
+TimerId EventLoop::runAt(Timestamp time, TimerCallback cb)
+{
+    return timerQueue_->addTimer(std::move(cb), time, 0.0);
+}
+
+TimerId EventLoop::runAfter(double delay, TimerCallback cb)
+{
+    return runAt(addTime(Timestamp::now(), delay), std::move(cb));
+}
+
+TimerId EventLoop::runEvery(double interval, TimerCallback cb)
+{
+    return timerQueue_->addTimer(std::move(cb), addTime(Timestamp::now(), interval), interval);
+}
+
+void EventLoop::cancel(TimerId timerId)
+{
+    timerQueue_->cancel(timerId);
+}
+
+// 在本轮循环的末尾执行 cb
+void EventLoop::runAtIterationEnd(Functor cb)
+{
+    iterationEndFunctors_.emplace_back(std::move(cb));
+}
+
 // wakeupfd 接收到唤醒数据后的回调处理函数。
 void EventLoop::handleRead()
 {
@@ -188,4 +335,20 @@ void EventLoop::doPendingFunctors()
     }
 
     callingPendingFunctors_ = false;
-}
\ No newline at end of file
+}
+
+// 执行本轮循环末尾的函数，执行过程中新加入的函数也在本轮执行
+void EventLoop::doIterationEndFunctors()
+{
+    callingIterationEndFunctors_ = true;
+    while (!iterationEndFunctors_.empty())
+    {
+        std::vector<Functor> functors;
+        functors.swap(iterationEndFunctors_);
+        for (const Functor &functor : functors)
+        {
+            functor();
+        }
+    }
+    callingIterationEndFunctors_ = false;
+}
@@ -3,6 +3,8 @@
 #include "noncopyable.h"
 #include "Timestamp.h"
 #include "CurrentThread.h"
+#include "Callbacks.h"
+#include "TimerId.h"
 
 #include <functional>
 #include <vector>
@@ -12,6 +14,7 @@
 
 class Channel;
 class Poller;
+class TimerQueue;
 
 // 时间循环类  主要包含了两个大模块 Channel   Poller（epoll的抽象）
 class EventLoop : noncopyable
@@ -30,6 +33,23 @@ public:
     
     void runInLoop(Functor cb);
     void queueInLoop(Functor cb);
+    // 只能在 loop 线程调用：cb 在本轮循环处理完所有事件和函数队列以后执行，
+    // 用于把本轮产生的多次发送合并成一次系统调用。
+    void runAtIterationEnd(Functor cb);
+    // 跨线程提交时，同一个生产者线程连续提交给本 loop 的函数追加到同一个批次中，
+    // 在 loop 取走批次之前只占用一个函数队列项、只唤醒一次。同一线程内按提交顺序执行，
+    // 但与通过 queueInLoop 提交的函数之间不保证顺序。在 loop 线程中调用时直接执行。
+    void runInLoopBatched(Functor cb);
+
+    // 定时器，可以在任意线程调用，回调在 loop 线程执行
+    // 在 time 时刻执行 cb
+    TimerId runAt(Timestamp time, TimerCallback cb);
+    // delay 秒以后执行 cb
+    TimerId runAfter(double delay, TimerCallback cb);
+    // 每隔 interval 秒执行一次 cb
+    TimerId runEvery(double interval, TimerCallback cb);
+    // 取消定时器，已经执行过或者已经取消的定时器也可以安全地取消
+    void cancel(TimerId timerId);
 
     void wakeup();
 
@@ -40,14 +60,19 @@ public:
     // 判断 EventLoop 对象是否在自己的线程里面
     bool isInLoopThread() const { return threadId_ ==  CurrentThread::tid(); }
 
+    // 当前线程的 EventLoop，当前线程没有 EventLoop 时返回 nullptr
+    static EventLoop* getEventLoopOfCurrentThread();
+
 private:
     void handleRead();         
     void doPendingFunctors(); 
+    void doIterationEndFunctors();
 
     std::atomic_bool looping_;                  // 标志处于循环中
     std::atomic_bool quit_;                     // 标志退出循环
     
     const pid_t threadId_;                      // 记录当前 loop 所在线程的 id
+    const uint64_t id_;                         // 进程内唯一的编号，用于区分生产者线程中各个 loop 的批次
 
     Timestamp pollReturnTime_;                  // poller 返回发生事件的 channels 的时间点
 
@@ -56,8 +81,12 @@ private:
 
     int wakeupFd_;                              // 用户唤醒处于阻塞状态的 EventLoop
     std::unique_ptr<Channel> wakeupChannel_;    // 封装 wakeupfd 的 channel 对象。
+    std::unique_ptr<TimerQueue> timerQueue_;    // 定时器队列，必须在 poller_ 之后构造、之前析构
 
     std::atomic_bool callingPendingFunctors_;   // 标识当前 EventLoop 是否正在执行函数队列中的函数。
     std::vector<Functor> pendingFunctors_;      // 存储 EventLoop 需要执行的函数队列。
     std::mutex mutex_;                          // 互斥锁，用来保护上面 vector 容器的线程安全操作
+
+    bool callingIterationEndFunctors_;          // 只在 loop 线程访问
+    std::vector<Functor> iterationEndFunctors_; // 本轮循环末尾执行的函数，只在 loop 线程访问，不需要加锁
 };
\ No newline at end of file
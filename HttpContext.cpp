@@ -0,0 +1,427 @@
+#include "HttpContext.h"
+#include "BufferSearch.h"
+
+#include <string.h>
+
+namespace
+{
+
+// reset 以后 chunked 请求体缓冲区最多保留的容量，避免一个大请求让连接长期占用内存
+const size_t kMaxRetainedBodyCapacity = 64 * 1024;
+
+struct MethodName
+{
+    const char *name;
+    size_t len;
+    HttpRequest::Method method;
+};
+
+const MethodName kMethods[] = {
+    { "GET", 3, HttpRequest::kGet },
+    { "POST", 4, HttpRequest::kPost },
+    { "HEAD", 4, HttpRequest::kHead },
+    { "PUT", 3, HttpRequest::kPut },
+    { "DELETE", 6, HttpRequest::kDelete },
+    { "OPTIONS", 7, HttpRequest::kOptions },
+    { "PATCH", 5, HttpRequest::kPatch },
+};
+
+HttpRequest::Method parseMethod(const char *begin, size_t len)
+{
+    for (const MethodName &m : kMethods)
+    {
+        if (m.len == len && ::memcmp(m.name, begin, len) == 0)
+        {
+            return m.method;
+        }
+    }
+    return HttpRequest::kInvalid;
+}
+
+int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 分块长度行：十六进制长度，后面可以跟 ';' 开头的扩展，扩展被忽略
+bool parseChunkSize(const char *begin, const char *end, size_t *size)
+{
+    const int kMaxDigits = 15;
+    size_t value = 0;
+    int digits = 0;
+    const char *p = begin;
+    for (; p < end; ++p)
+    {
+        int v = hexValue(*p);
+        if (v < 0)
+        {
+            break;
+        }
+        if (++digits > kMaxDigits)
+        {
+            return false;
+        }
+        value = value * 16 + v;
+    }
+    while (p < end && (*p == ' ' || *p == '\t'))
+    {
+        ++p;
+    }
+    if (digits == 0 || (p < end && *p != ';'))
+    {
+        return false;
+    }
+    *size = value;
+    return true;
+}
+
+bool parseContentLength(StringPiece value, size_t *length)
+{
+    const int kMaxDigits = 18;
+    if (value.empty() || value.size() > static_cast<size_t>(kMaxDigits))
+    {
+        return false;
+    }
+    size_t n = 0;
+    for (char c : value)
+    {
+        if (c < '0' || c > '9')
+        {
+            return false;
+        }
+        n = n * 10 + (c - '0');
+    }
+    *length = n;
+    return true;
+}
+
+} // namespace
+
+HttpContext::HttpContext(size_t maxHeaderBytes, size_t maxBodyBytes)
+    : maxHeaderBytes_(maxHeaderBytes)
+    , maxBodyBytes_(maxBodyBytes)
+{
+    reset();
+}
+
+void HttpContext::reset()
+{
+    state_ = kExpectRequestLine;
+    pos_ = 0;
+    searchFrom_ = 0;
+    method_ = HttpRequest::kInvalid;
+    version_ = HttpRequest::kUnknown;
+    methodRange_ = Range{0, 0};
+    pathRange_ = Range{0, 0};
+    queryRange_ = Range{0, 0};
+    headerRanges_.clear();
+    chunked_ = false;
+    contentLength_ = 0;
+    bodyOffset_ = 0;
+    trailerOffset_ = 0;
+    if (chunkedBody_.capacity() > kMaxRetainedBodyCapacity)
+    {
+        std::string().swap(chunkedBody_);
+    }
+    chunkedBody_.clear();
+    requestLength_ = 0;
+    request_.headers_.clear();
+}
+
+HttpContext::ParseResult HttpContext::parse(const char *data, size_t len, Timestamp receiveTime)
+{
+    while (state_ == kExpectRequestLine || state_ == kExpectHeaders)
+    {
+        const char *crlf = BufferSearch::findCRLF(data + searchFrom_, data + len);
+        if (crlf == nullptr)
+        {
+            if (len > maxHeaderBytes_)
+            {
+                return kHeaderTooLarge;
+            }
+            // 末尾的 '\r' 可能和下次收到的 '\n' 组成行尾，从它开始继续查找
+            searchFrom_ = len > pos_ ? len - 1 : pos_;
+            return kNeedMore;
+        }
+
+        const size_t lineBegin = pos_;
+        const size_t lineEnd = crlf - data;
+        pos_ = lineEnd + 2;
+        searchFrom_ = pos_;
+        if (pos_ > maxHeaderBytes_)
+        {
+            return kHeaderTooLarge;
+        }
+
+        if (state_ == kExpectRequestLine)
+        {
+            // 忽略请求之前多余的空行
+            if (lineEnd == lineBegin)
+            {
+                continue;
+            }
+            if (!parseRequestLine(data, lineBegin, lineEnd))
+            {
+                return kBadRequest;
+            }
+            state_ = kExpectHeaders;
+        }
+        else if (lineEnd == lineBegin)
+        {
+            ParseResult result = finishHeaders(data);
+            if (result != kNeedMore)
+            {
+                return result;
+            }
+        }
+        else if (!parseHeader(data, lineBegin, lineEnd))
+        {
+            return kBadRequest;
+        }
+    }
+
+    if (state_ == kExpectBody)
+    {
+        if (len - bodyOffset_ < contentLength_)
+        {
+            return kNeedMore;
+        }
+        requestLength_ = bodyOffset_ + contentLength_;
+    }
+    else
+    {
+        ParseResult result = parseChunks(data, len);
+        if (result != kGotRequest)
+        {
+            return result;
+        }
+    }
+    buildRequest(data, receiveTime);
+    return kGotRequest;
+}
+
+// METHOD SP request-target SP HTTP-version
+bool HttpContext::parseRequestLine(const char *data, size_t begin, size_t end)
+{
+    const char *start = data + begin;
+    const char *lineEnd = data + end;
+    const char *space = static_cast<const char*>(::memchr(start, ' ', lineEnd - start));
+    if (space == nullptr)
+    {
+        return false;
+    }
+    method_ = parseMethod(start, space - start);
+    if (method_ == HttpRequest::kInvalid)
+    {
+        return false;
+    }
+    methodRange_ = Range{begin, static_cast<size_t>(space - start)};
+
+    const char *target = space + 1;
+    space = static_cast<const char*>(::memchr(target, ' ', lineEnd - target));
+    if (space == nullptr || space == target)
+    {
+        return false;
+    }
+    const char *question = static_cast<const char*>(::memchr(target, '?', space - target));
+    const char *pathEnd = question != nullptr ? question : space;
+    pathRange_ = Range{static_cast<size_t>(target - data), static_cast<size_t>(pathEnd - target)};
+    if (question != nullptr)
+    {
+        queryRange_ = Range{static_cast<size_t>(question + 1 - data), static_cast<size_t>(space - question - 1)};
+    }
+
+    StringPiece version(space + 1, lineEnd - space - 1);
+    if (version == "HTTP/1.1")
+    {
+        version_ = HttpRequest::kHttp11;
+    }
+    else if (version == "HTTP/1.0")
+    {
+        version_ = HttpRequest::kHttp10;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+// field-name ":" OWS field-value OWS，不支持已经废弃的折行
+bool HttpContext::parseHeader(const char *data, size_t begin, size_t end)
+{
+    const char *start = data + begin;
+    const char *lineEnd = data + end;
+    if (*start == ' ' || *start == '\t')
+    {
+        return false;
+    }
+    const char *colon = static_cast<const char*>(::memchr(start, ':', lineEnd - start));
+    if (colon == nullptr || colon == start)
+    {
+        return false;
+    }
+    // 字段名中不能有空白和控制字符，和冒号之间也不能有空白
+    for (const char *p = start; p < colon; ++p)
+    {
+        if (static_cast<unsigned char>(*p) <= ' ' || *p == 0x7f)
+        {
+            return false;
+        }
+    }
+    const char *value = colon + 1;
+    while (value < lineEnd && (*value == ' ' || *value == '\t'))
+    {
+        ++value;
+    }
+    const char *valueEnd = lineEnd;
+    while (valueEnd > value && (valueEnd[-1] == ' ' || valueEnd[-1] == '\t'))
+    {
+        --valueEnd;
+    }
+    headerRanges_.push_back(HeaderRange{
+        Range{begin, static_cast<size_t>(colon - start)},
+        Range{static_cast<size_t>(value - data), static_cast<size_t>(valueEnd - value)}});
+    return true;
+}
+
+// 头部结束，确定请求体的长度。返回 kNeedMore 表示继续解析请求体，否则是错误
+HttpContext::ParseResult HttpContext::finishHeaders(const char *data)
+{
+    bool hasLength = false;
+    for (const HeaderRange &header : headerRanges_)
+    {
+        StringPiece field = view(data, header.field);
+        StringPiece value = view(data, header.value);
+        if (field.equalsIgnoreCase("Transfer-Encoding"))
+        {
+            // 只支持 chunked 一种传输编码
+            if (!value.equalsIgnoreCase("chunked"))
+            {
+                return kBadRequest;
+            }
+            chunked_ = true;
+        }
+        else if (field.equalsIgnoreCase("Content-Length"))
+        {
+            size_t length = 0;
+            if (!parseContentLength(value, &length) || (hasLength && length != contentLength_))
+            {
+                return kBadRequest;
+            }
+            hasLength = true;
+            contentLength_ = length;
+        }
+    }
+    // 同时出现两者时，前后两个解析器可能对请求边界的理解不同（请求走私），直接拒绝
+    if (chunked_ && hasLength)
+    {
+        return kBadRequest;
+    }
+    if (contentLength_ > maxBodyBytes_)
+    {
+        return kBodyTooLarge;
+    }
+    bodyOffset_ = pos_;
+    state_ = chunked_ ? kExpectChunkSize : kExpectBody;
+    return kNeedMore;
+}
+
+// chunk-size [chunk-ext] CRLF chunk-data CRLF ... 0 CRLF *(trailer CRLF) CRLF
+HttpContext::ParseResult HttpContext::parseChunks(const char *data, size_t len)
+{
+    while (true)
+    {
+        const char *crlf = BufferSearch::findCRLF(data + searchFrom_, data + len);
+        if (crlf == nullptr)
+        {
+            if (len - pos_ > maxHeaderBytes_
+                || (state_ == kExpectTrailers && len - trailerOffset_ > maxHeaderBytes_))
+            {
+                return kHeaderTooLarge;
+            }
+            searchFrom_ = len > pos_ ? len - 1 : pos_;
+            return kNeedMore;
+        }
+        const size_t lineBegin = pos_;
+        const size_t lineEnd = crlf - data;
+
+        if (state_ == kExpectTrailers)
+        {
+            // 所有 trailer 加起来和头部一样受 maxHeaderBytes 限制
+            if (lineEnd + 2 - trailerOffset_ > maxHeaderBytes_)
+            {
+                return kHeaderTooLarge;
+            }
+            pos_ = lineEnd + 2;
+            searchFrom_ = pos_;
+            if (lineEnd == lineBegin)
+            {
+                requestLength_ = pos_;
+                return kGotRequest;
+            }
+            // trailer 字段被忽略
+            continue;
+        }
+
+        // 分块头（长度行、扩展、数据后的 CRLF）不计入请求体，大量很小的分块或者很长的扩展会让
+        // 缓冲的数据远超 maxBodyBytes。分块头的总长度不能超过已经收到的数据加上 maxHeaderBytes
+        const size_t framingBytes = lineEnd + 2 - bodyOffset_ - chunkedBody_.size();
+        if (framingBytes > maxHeaderBytes_ + chunkedBody_.size())
+        {
+            return kBodyTooLarge;
+        }
+
+        size_t size = 0;
+        if (!parseChunkSize(data + lineBegin, crlf, &size))
+        {
+            return kBadRequest;
+        }
+        if (size == 0)
+        {
+            pos_ = lineEnd + 2;
+            searchFrom_ = pos_;
+            trailerOffset_ = pos_;
+            state_ = kExpectTrailers;
+            continue;
+        }
+        if (size > maxBodyBytes_ - chunkedBody_.size())
+        {
+            return kBodyTooLarge;
+        }
+        const size_t chunkBegin = lineEnd + 2;
+        if (len - chunkBegin < size + 2)
+        {
+            // 分块数据还没有收全，下次从长度行重新解析
+            searchFrom_ = pos_;
+            return kNeedMore;
+        }
+        if (data[chunkBegin + size] != '\r' || data[chunkBegin + size + 1] != '\n')
+        {
+            return kBadRequest;
+        }
+        chunkedBody_.append(data + chunkBegin, size);
+        pos_ = chunkBegin + size + 2;
+        searchFrom_ = pos_;
+    }
+}
+
+void HttpContext::buildRequest(const char *data, Timestamp receiveTime)
+{
+    request_.method_ = method_;
+    request_.methodString_ = view(data, methodRange_);
+    request_.version_ = version_;
+    request_.path_ = view(data, pathRange_);
+    request_.query_ = view(data, queryRange_);
+    request_.headers_.clear();
+    for (const HeaderRange &header : headerRanges_)
+    {
+        request_.headers_.push_back(HttpRequest::Header{view(data, header.field), view(data, header.value)});
+    }
+    request_.chunked_ = chunked_;
+    request_.body_ = chunked_ ? StringPiece(chunkedBody_) : view(data, Range{bodyOffset_, contentLength_});
+    request_.receiveTime_ = receiveTime;
+}
@@ -0,0 +1,100 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "HttpRequest.h"
+#include "Timestamp.h"
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+
+/**
+ * 一个连接的 HTTP/1.1 请求增量解析器。
+ * 每次调用 parse 时传入当前请求开头的地址（通常是 inputBuffer 的 peek() 加上本轮已经处理的长度），
+ * 解析器只保存相对请求开头的偏移，因此两次调用之间 Buffer 扩容或者前移数据都不影响；
+ * 已经解析过的行不会重复扫描。解析完成时在 request() 中生成指向 data 的视图，不拷贝数据。
+ * 支持 Content-Length 和 chunked 请求体，chunked 请求体去掉分块头以后拼接到解析器内部的缓冲区。
+ * 流水线请求由调用方在同一块数据上循环调用 parse，每个请求处理完以后 reset。
+ */
+class HttpContext : noncopyable
+{
+public:
+    enum ParseResult
+    {
+        kNeedMore,          // 请求还不完整
+        kGotRequest,        // 解析出一个完整的请求，长度为 requestLength()
+        kBadRequest,        // 格式错误，应当回复 400 并关闭连接
+        kHeaderTooLarge,    // 请求行加头部（或者 chunked 的 trailer）超过上限，回复 431
+        kBodyTooLarge,      // 请求体（或者 chunked 的分块头）超过上限，回复 413
+    };
+
+    static const size_t kDefaultMaxHeaderBytes = 8 * 1024;
+    static const size_t kDefaultMaxBodyBytes = 8 * 1024 * 1024;
+
+    explicit HttpContext(size_t maxHeaderBytes = kDefaultMaxHeaderBytes,
+                        size_t maxBodyBytes = kDefaultMaxBodyBytes);
+
+    // data 指向当前请求的第一个字节，len 为已经收到的字节数。
+    // 返回 kNeedMore 以后，下一次调用必须传入同一个请求的开头和不更短的数据。
+    ParseResult parse(const char *data, size_t len, Timestamp receiveTime);
+
+    // 以下两个函数在 parse 返回 kGotRequest 以后有效，request() 中的视图在 reset 之前有效
+    const HttpRequest& request() const { return request_; }
+    size_t requestLength() const { return requestLength_; }
+
+    // 准备解析下一个请求，保留内部容器的容量
+    void reset();
+
+private:
+    enum State
+    {
+        kExpectRequestLine,
+        kExpectHeaders,
+        kExpectBody,
+        kExpectChunkSize,
+        kExpectTrailers,
+    };
+
+    struct Range
+    {
+        size_t offset;
+        size_t len;
+    };
+    struct HeaderRange
+    {
+        Range field;
+        Range value;
+    };
+
+    bool parseRequestLine(const char *data, size_t begin, size_t end);
+    bool parseHeader(const char *data, size_t begin, size_t end);
+    ParseResult finishHeaders(const char *data);
+    ParseResult parseChunks(const char *data, size_t len);
+    void buildRequest(const char *data, Timestamp receiveTime);
+
+    static StringPiece view(const char *data, const Range &range)
+    {
+        return StringPiece(data + range.offset, range.len);
+    }
+
+    const size_t maxHeaderBytes_;
+    const size_t maxBodyBytes_;
+
+    State state_;
+    size_t pos_;                // 下一个待解析的位置，相对请求开头
+    size_t searchFrom_;         // 查找行尾的起点，不重复扫描已经查找过的数据
+    HttpRequest::Method method_;
+    HttpRequest::Version version_;
+    Range methodRange_;
+    Range pathRange_;
+    Range queryRange_;
+    std::vector<HeaderRange> headerRanges_;
+    bool chunked_;
+    size_t contentLength_;
+    size_t bodyOffset_;
+    size_t trailerOffset_;      // chunked 请求第一个 trailer 的位置
+    std::string chunkedBody_;
+
+    size_t requestLength_;
+    HttpRequest request_;
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "StringPiece.h"
+#include "Timestamp.h"
+
+#include <vector>
+
+class HttpContext;
+
+/**
+ * 一个解析完成的 HTTP 请求。请求行、头部和 Content-Length 请求体都是指向 inputBuffer 的视图，
+ * chunked 请求体拼接在 HttpContext 自己的缓冲区中，所有视图只在 HttpServer 的请求回调期间有效，
+ * 需要保留的数据由用户自行拷贝。
+ */
+class HttpRequest
+{
+public:
+    enum Method
+    {
+        kInvalid, kGet, kPost, kHead, kPut, kDelete, kOptions, kPatch,
+    };
+    enum Version
+    {
+        kUnknown, kHttp10, kHttp11,
+    };
+
+    struct Header
+    {
+        StringPiece field;
+        StringPiece value;
+    };
+
+    HttpRequest()
+        : method_(kInvalid)
+        , version_(kUnknown)
+        , chunked_(false)
+    {}
+
+    Method method() const { return method_; }
+    StringPiece methodString() const { return methodString_; }
+    Version version() const { return version_; }
+    // 不含查询字符串
+    StringPiece path() const { return path_; }
+    // '?' 之后的部分，没有时为空
+    StringPiece query() const { return query_; }
+    const std::vector<Header>& headers() const { return headers_; }
+    StringPiece body() const { return body_; }
+    bool chunked() const { return chunked_; }
+    Timestamp receiveTime() const { return receiveTime_; }
+
+    // 字段名大小写不敏感，没有该字段时返回空视图
+    StringPiece getHeader(const StringPiece &field) const
+    {
+        for (const Header &header : headers_)
+        {
+            if (header.field.equalsIgnoreCase(field))
+            {
+                return header.value;
+            }
+        }
+        return StringPiece();
+    }
+
+    // HTTP/1.1 默认保持连接，除非 "Connection: close"；HTTP/1.0 需要 "Connection: Keep-Alive"
+    bool keepAlive() const
+    {
+        StringPiece connection = getHeader("Connection");
+        if (version_ == kHttp11)
+        {
+            return !connection.equalsIgnoreCase("close");
+        }
+        return connection.equalsIgnoreCase("keep-alive");
+    }
+
+private:
+    friend class HttpContext;
+
+    Method method_;
+    StringPiece methodString_;
+    Version version_;
+    StringPiece path_;
+    StringPiece query_;
+    std::vector<Header> headers_;
+    StringPiece body_;
+    bool chunked_;
+    Timestamp receiveTime_;
+};
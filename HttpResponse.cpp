@@ -0,0 +1,102 @@
+#include "HttpResponse.h"
+#include "Buffer.h"
+
+#include <string.h>
+
+namespace
+{
+
+// 无符号整数转十进制，返回写入的长度，buf 至少 20 字节
+size_t formatDecimal(char *buf, size_t value)
+{
+    char tmp[20];
+    size_t n = 0;
+    do
+    {
+        tmp[n++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value != 0);
+    for (size_t i = 0; i < n; ++i)
+    {
+        buf[i] = tmp[n - 1 - i];
+    }
+    return n;
+}
+
+void appendLiteral(Buffer *output, const char *str)
+{
+    output->append(str, ::strlen(str));
+}
+
+} // namespace
+
+const char* HttpResponse::reasonPhrase(int code)
+{
+    switch (code)
+    {
+    case 100: return "Continue";
+    case 101: return "Switching Protocols";
+    case 200: return "OK";
+    case 201: return "Created";
+    case 204: return "No Content";
+    case 301: return "Moved Permanently";
+    case 302: return "Found";
+    case 304: return "Not Modified";
+    case 400: return "Bad Request";
+    case 403: return "Forbidden";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 408: return "Request Timeout";
+    case 413: return "Payload Too Large";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    default: return "Unknown";
+    }
+}
+
+void HttpResponse::appendToBuffer(Buffer *output, bool headOnly, StringPiece date) const
+{
+    char num[32];
+    appendLiteral(output, "HTTP/1.1 ");
+    output->append(num, formatDecimal(num, static_cast<size_t>(statusCode_)));
+    output->append(" ", 1);
+    if (statusMessage_.empty())
+    {
+        appendLiteral(output, reasonPhrase(statusCode_));
+    }
+    else
+    {
+        output->append(statusMessage_.data(), statusMessage_.size());
+    }
+    if (!date.empty())
+    {
+        appendLiteral(output, "\r\nDate: ");
+        output->append(date.data(), date.size());
+    }
+
+    // 1xx、204 和 304 响应没有响应体，也不输出 Content-Length
+    const bool hasBody = statusCode_ >= 200 && statusCode_ != 204 && statusCode_ != 304;
+    if (hasBody)
+    {
+        appendLiteral(output, "\r\nContent-Length: ");
+        output->append(num, formatDecimal(num, body_.size()));
+    }
+    if (closeConnection_)
+    {
+        appendLiteral(output, "\r\nConnection: close");
+    }
+    for (const auto &header : headers_)
+    {
+        output->append("\r\n", 2);
+        output->append(header.first.data(), header.first.size());
+        output->append(": ", 2);
+        output->append(header.second.data(), header.second.size());
+    }
+    output->append("\r\n\r\n", 4);
+    if (hasBody && !headOnly)
+    {
+        output->append(body_.data(), body_.size());
+    }
+}
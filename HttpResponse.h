@@ -0,0 +1,82 @@
+#pragma once
+
+#include "StringPiece.h"
+
+#include <string>
+#include <utility>
+#include <vector>
+
+class Buffer;
+
+/**
+ * HTTP 响应，由 HttpServer 的请求回调填写，再直接序列化进连接的 outputBuffer，不经过临时字符串。
+ * Content-Length 总是根据响应体自动生成；closeConnection 为 true 时生成 "Connection: close"，
+ * HttpServer 在响应发出以后关闭连接。
+ */
+class HttpResponse
+{
+public:
+    enum HttpStatusCode
+    {
+        kUnknown = 0,
+        k101SwitchingProtocols = 101,
+        k200Ok = 200,
+        k204NoContent = 204,
+        k301MovedPermanently = 301,
+        k304NotModified = 304,
+        k400BadRequest = 400,
+        k403Forbidden = 403,
+        k404NotFound = 404,
+        k405MethodNotAllowed = 405,
+        k413PayloadTooLarge = 413,
+        k431RequestHeaderFieldsTooLarge = 431,
+        k500InternalServerError = 500,
+        k501NotImplemented = 501,
+        k503ServiceUnavailable = 503,
+    };
+
+    explicit HttpResponse(bool close)
+        : statusCode_(k200Ok)
+        , closeConnection_(close)
+        , cacheable_(false)
+        , cacheTtl_(0)
+    {}
+
+    void setStatusCode(int code) { statusCode_ = code; }
+    int statusCode() const { return statusCode_; }
+    // 不设置时使用状态码对应的标准描述
+    void setStatusMessage(const std::string &message) { statusMessage_ = message; }
+
+    void setCloseConnection(bool on) { closeConnection_ = on; }
+    bool closeConnection() const { return closeConnection_; }
+
+    void setContentType(const std::string &contentType) { addHeader("Content-Type", contentType); }
+    // 不检查重复，按添加的顺序输出。不要添加 Content-Length，它由响应体决定
+    void addHeader(const std::string &field, const std::string &value) { headers_.emplace_back(field, value); }
+
+    void setBody(const std::string &body) { body_ = body; }
+    void setBody(std::string &&body) { body_ = std::move(body); }
+    const std::string& body() const { return body_; }
+
+    // 允许 HttpServer 按请求路径缓存序列化后的响应，之后同一路径的 GET 请求不再回调，
+    // 直接发送缓存的字节。ttlSeconds 秒后过期，0 表示一直有效直到被 invalidate
+    void setCacheable(double ttlSeconds) { cacheable_ = true; cacheTtl_ = ttlSeconds; }
+    bool cacheable() const { return cacheable_; }
+    double cacheTtl() const { return cacheTtl_; }
+
+    // 把状态行、头部和响应体追加到 output。headOnly 用于 HEAD 请求：不写响应体，Content-Length 不变。
+    // date 不为空时紧跟状态行输出 Date 头部
+    void appendToBuffer(Buffer *output, bool headOnly = false, StringPiece date = StringPiece()) const;
+
+    // 常见状态码的标准描述，未知的状态码返回 "Unknown"
+    static const char* reasonPhrase(int code);
+
+private:
+    int statusCode_;
+    std::string statusMessage_;
+    bool closeConnection_;
+    std::vector<std::pair<std::string, std::string>> headers_;
+    std::string body_;
+    bool cacheable_;
+    double cacheTtl_;
+};
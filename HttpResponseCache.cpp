@@ -0,0 +1,84 @@
+#include "HttpResponseCache.h"
+#include "HttpResponse.h"
+#include "Buffer.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+namespace
+{
+
+const char kDatePrefix[] = "\r\nDate: ";
+
+// 不使用 strftime，星期和月份的名称不能受 locale 影响
+const char *const kWeekdays[] = { "Sun", "Mon", "Tue", "Wed", "Thu", "Fri", "Sat" };
+const char *const kMonths[] = { "Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                "Jul", "Aug", "Sep", "Oct", "Nov", "Dec" };
+
+} // namespace
+
+HttpResponseCache::HttpResponseCache()
+    : dateSecond_(-1)
+{
+}
+
+StringPiece HttpResponseCache::date(Timestamp now)
+{
+    const int64_t second = now.microSecondsSinceEpoch() / Timestamp::kMicroSecondsPerSecond;
+    if (second != dateSecond_)
+    {
+        time_t seconds = static_cast<time_t>(second);
+        struct tm tm_time;
+        ::gmtime_r(&seconds, &tm_time);
+        // 按各个字段的最大宽度留出空间，正常的日期只用到前 kDateLength 个字符
+        char text[80];
+        snprintf(text, sizeof text, "%s, %02d %s %04d %02d:%02d:%02d GMT",
+            kWeekdays[tm_time.tm_wday], tm_time.tm_mday, kMonths[tm_time.tm_mon], tm_time.tm_year + 1900,
+            tm_time.tm_hour, tm_time.tm_min, tm_time.tm_sec);
+        ::memcpy(date_, text, kDateLength);
+        dateSecond_ = second;
+    }
+    return StringPiece(date_, kDateLength);
+}
+
+SharedString HttpResponseCache::get(StringPiece path, Timestamp now)
+{
+    key_.assign(path.data(), path.size());
+    auto it = entries_.find(key_);
+    if (it == entries_.end())
+    {
+        return SharedString();
+    }
+    Entry &entry = it->second;
+    if (entry.expiration.valid() && !(now < entry.expiration))
+    {
+        entries_.erase(it);
+        return SharedString();
+    }
+    StringPiece today = date(now);
+    if (entry.dateSecond != dateSecond_)
+    {
+        // 旧的字节可能还在某些连接的发送队列里，不能原地修改
+        std::shared_ptr<std::string> wire = std::make_shared<std::string>(*entry.wire);
+        ::memcpy(&(*wire)[entry.dateOffset], today.data(), today.size());
+        entry.wire = wire;
+        entry.dateSecond = dateSecond_;
+    }
+    return entry.wire;
+}
+
+void HttpResponseCache::put(const std::string &path, const HttpResponse &response, Timestamp now)
+{
+    Buffer buffer;
+    response.appendToBuffer(&buffer, false, date(now));
+    std::string wire = buffer.retrieveAllAsString();
+
+    Entry entry;
+    // Date 紧跟在状态行之后，第一个 "\r\nDate: " 就是它
+    entry.dateOffset = wire.find(kDatePrefix) + sizeof kDatePrefix - 1;
+    entry.wire = std::make_shared<const std::string>(std::move(wire));
+    entry.dateSecond = dateSecond_;
+    entry.expiration = response.cacheTtl() > 0 ? addTime(now, response.cacheTtl()) : Timestamp();
+    entries_[path] = std::move(entry);
+}
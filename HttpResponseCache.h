@@ -0,0 +1,56 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+#include "StringPiece.h"
+#include "Timestamp.h"
+
+#include <string>
+#include <unordered_map>
+
+class HttpResponse;
+
+/**
+ * 按请求路径缓存完整序列化的 HTTP 响应（状态行、头部、Date 和响应体），用于健康检查、静态配置这类
+ * 每次内容都相同的接口。缓存的字节是不可变的 SharedString，命中时把同一份数据以引用段的形式排进
+ * 各个连接的发送队列，不拷贝。
+ *
+ * Date 的值每秒只格式化一次。条目在跨过一秒以后第一次命中时，复制一份新的字节并覆盖其中的日期，
+ * 仍在发送中的旧字节由引用计数保持有效。过期的条目在下一次查找时删除。
+ *
+ * 不是线程安全的：HttpServer 为每个 loop 创建一个，只在该 loop 线程中使用。
+ */
+class HttpResponseCache : noncopyable
+{
+public:
+    // IMF-fixdate 的固定长度，例如 "Sun, 06 Nov 1994 08:49:37 GMT"
+    static const size_t kDateLength = 29;
+
+    HttpResponseCache();
+
+    // now 所在秒的 HTTP 日期，同一秒内返回同一份已格式化的字符串
+    StringPiece date(Timestamp now);
+
+    // 命中时返回完整的响应字节，没有缓存或者已经过期时返回空
+    SharedString get(StringPiece path, Timestamp now);
+    // 序列化 response 并缓存在 path 下，替换已有的条目，有效期取 response.cacheTtl()
+    void put(const std::string &path, const HttpResponse &response, Timestamp now);
+    void invalidate(const std::string &path) { entries_.erase(path); }
+    void clear() { entries_.clear(); }
+
+    size_t size() const { return entries_.size(); }
+
+private:
+    struct Entry
+    {
+        SharedString wire;
+        size_t dateOffset;      // Date 的值在 wire 中的位置
+        int64_t dateSecond;     // wire 中的日期对应的秒
+        Timestamp expiration;   // 无效的时间戳表示不过期
+    };
+
+    std::unordered_map<std::string, Entry> entries_;
+    std::string key_;           // 查找用的临时键，复用内存避免每次分配
+    int64_t dateSecond_;
+    char date_[kDateLength];
+};
@@ -0,0 +1,212 @@
+#include "HttpServer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+namespace
+{
+
+// 小于它的缓存响应直接拷贝
+const size_t kCopyCachedBytes = 1024;
+
+void defaultHttpCallback(const HttpRequest &, HttpResponse *response)
+{
+    response->setStatusCode(HttpResponse::k404NotFound);
+}
+
+} // namespace
+
+HttpServer::HttpServer(EventLoop *loop,
+                    const InetAddress &listenAddr,
+                    const std::string &name,
+                    TcpServer::Option option)
+    : loop_(loop)
+    , server_(loop, listenAddr, name, option)
+    , httpCallback_(defaultHttpCallback)
+    , idleTimeout_(kDefaultIdleTimeoutSeconds)
+    , maxHeaderBytes_(HttpContext::kDefaultMaxHeaderBytes)
+    , maxBodyBytes_(HttpContext::kDefaultMaxBodyBytes)
+{
+    server_.setConnectionCallback(std::bind(&HttpServer::onConnection, this, std::placeholders::_1));
+    server_.setMessageCallback(std::bind(&HttpServer::onMessage, this,
+        std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    server_.setThreadInitcallback(std::bind(&HttpServer::initLoop, this, std::placeholders::_1));
+}
+
+void HttpServer::initLoop(EventLoop *loop)
+{
+    {
+        std::lock_guard<std::mutex> lock(cachesMutex_);
+        caches_[loop].reset(new HttpResponseCache);
+    }
+    if (threadInitCallback_)
+    {
+        threadInitCallback_(loop);
+    }
+}
+
+void HttpServer::invalidateCache(const std::string &path)
+{
+    std::lock_guard<std::mutex> lock(cachesMutex_);
+    for (const auto &item : caches_)
+    {
+        item.first->runInLoop(std::bind(&HttpResponseCache::invalidate, item.second.get(), path));
+    }
+}
+
+void HttpServer::clearCache()
+{
+    std::lock_guard<std::mutex> lock(cachesMutex_);
+    for (const auto &item : caches_)
+    {
+        item.first->runInLoop(std::bind(&HttpResponseCache::clear, item.second.get()));
+    }
+}
+
+void HttpServer::onConnection(const TcpConnectionPtr &conn)
+{
+    if (!conn->connected())
+    {
+        return;
+    }
+    HttpResponseCache *cache = nullptr;
+    {
+        std::lock_guard<std::mutex> lock(cachesMutex_);
+        cache = caches_.find(conn->getLoop())->second.get();
+    }
+    std::shared_ptr<Session> session = std::make_shared<Session>(maxHeaderBytes_, maxBodyBytes_, cache);
+    session->lastActive = Timestamp::now();
+    conn->setContext(session);
+    if (idleTimeout_ > 0)
+    {
+        conn->getLoop()->runAfter(idleTimeout_,
+            std::bind(&HttpServer::checkIdle, std::weak_ptr<TcpConnection>(conn), idleTimeout_));
+    }
+}
+
+// 每个连接只有一个定时器，到期时检查最后活跃的时间，还没有超时就按剩余的时间重新设置，
+// 收到数据时不需要调整定时器
+void HttpServer::checkIdle(const std::weak_ptr<TcpConnection> &weakConn, double idleTimeout)
+{
+    TcpConnectionPtr conn = weakConn.lock();
+    if (!conn || !conn->connected())
+    {
+        return;
+    }
+    Session *session = static_cast<Session*>(conn->getContext().get());
+    Timestamp now = Timestamp::now();
+    // 还有数据没有发送完的连接不算空闲
+    if (conn->outputBytes() > 0)
+    {
+        session->lastActive = now;
+    }
+    double idle = timeDifference(now, session->lastActive);
+    if (idle >= idleTimeout)
+    {
+        LOG_INFO("HttpServer::checkIdle [%s] idle for %.1f seconds, closing \n", conn->name().c_str(), idle);
+        conn->forceClose();
+        return;
+    }
+    conn->getLoop()->runAfter(idleTimeout - idle, std::bind(&HttpServer::checkIdle, weakConn, idleTimeout));
+}
+
+// 一次遍历解析 buf 中所有完整的请求，响应都写进 outputBuffer，最后统一移动读下标并发送
+void HttpServer::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime)
+{
+    Session *session = static_cast<Session*>(conn->getContext().get());
+    session->lastActive = receiveTime;
+    if (session->closing)
+    {
+        buf->retrieveAll();
+        return;
+    }
+
+    const char *data = buf->peek();
+    const size_t readable = buf->readableBytes();
+    size_t consumed = 0;
+    while (consumed < readable && !session->closing)
+    {
+        HttpContext::ParseResult result = session->context.parse(data + consumed, readable - consumed, receiveTime);
+        if (result == HttpContext::kNeedMore)
+        {
+            break;
+        }
+        if (result == HttpContext::kGotRequest)
+        {
+            session->closing = onRequest(conn, session, session->context.request());
+            consumed += session->context.requestLength();
+            session->context.reset();
+            continue;
+        }
+
+        int statusCode = HttpResponse::k400BadRequest;
+        if (result == HttpContext::kHeaderTooLarge)
+        {
+            statusCode = HttpResponse::k431RequestHeaderFieldsTooLarge;
+        }
+        else if (result == HttpContext::kBodyTooLarge)
+        {
+            statusCode = HttpResponse::k413PayloadTooLarge;
+        }
+        LOG_ERROR("HttpServer::onMessage [%s] invalid request, reply %d \n", conn->name().c_str(), statusCode);
+        sendError(conn, session, statusCode);
+        session->closing = true;
+    }
+
+    if (session->closing)
+    {
+        buf->retrieveAll();
+        conn->flushOutputBuffer();
+        conn->shutdown();
+        return;
+    }
+    buf->retrieve(consumed);
+    conn->flushOutputBuffer();
+}
+
+bool HttpServer::onRequest(const TcpConnectionPtr &conn, Session *session, const HttpRequest &request)
+{
+    const bool keepAlive = request.keepAlive();
+    const Timestamp now = request.receiveTime();
+    // 缓存的字节里没有 Connection 头部，只服务于默认保持连接的 HTTP/1.1 请求
+    const bool cacheable = request.method() == HttpRequest::kGet && keepAlive
+        && request.version() == HttpRequest::kHttp11 && request.query().empty();
+    if (cacheable)
+    {
+        SharedString wire = session->cache->get(request.path(), now);
+        if (wire)
+        {
+            // 小响应拷贝进 outputBuffer 和相邻的响应合并成一段，比单独占一个引用段更便宜
+            if (wire->size() < kCopyCachedBytes)
+            {
+                conn->outputBuffer()->append(wire->data(), wire->size());
+            }
+            else
+            {
+                conn->appendOutput(wire);
+            }
+            return false;
+        }
+    }
+
+    HttpResponse response(!keepAlive);
+    httpCallback_(request, &response);
+    // HTTP/1.0 的客户端只有看到这个字段才会复用连接
+    if (!response.closeConnection() && request.version() == HttpRequest::kHttp10)
+    {
+        response.addHeader("Connection", "Keep-Alive");
+    }
+    response.appendToBuffer(conn->outputBuffer(), request.method() == HttpRequest::kHead,
+        session->cache->date(now));
+    if (cacheable && response.cacheable() && !response.closeConnection())
+    {
+        session->cache->put(request.path().toString(), response, now);
+    }
+    return response.closeConnection();
+}
+
+void HttpServer::sendError(const TcpConnectionPtr &conn, Session *session, int statusCode)
+{
+    HttpResponse response(true);
+    response.setStatusCode(statusCode);
+    response.appendToBuffer(conn->outputBuffer(), false, session->cache->date(Timestamp::now()));
+}
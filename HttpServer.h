@@ -0,0 +1,97 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "TcpServer.h"
+#include "HttpContext.h"
+#include "HttpRequest.h"
+#include "HttpResponse.h"
+#include "HttpResponseCache.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+
+/**
+ * 基于 TcpServer 的 HTTP/1.1 服务器。
+ * 每个连接有一个 HttpContext 增量解析 inputBuffer，一次 onMessage 中解析出的所有流水线请求依次回调
+ * HttpCallback，响应直接序列化进连接的 outputBuffer，全部处理完以后统一发送一次。
+ * 请求回调必须同步填好响应。默认保持连接（keep-alive），客户端要求关闭、请求格式错误或者
+ * 响应设置了 closeConnection 时，发送完响应后关闭连接；空闲超过 idleTimeout 的连接被关闭。
+ *
+ * 每个 loop 有一个 HttpResponseCache，提供每秒格式化一次的 Date 头部。回调对响应调用 setCacheable 后，
+ * 完整的响应字节按路径缓存在该 loop 中，之后同一路径、不带查询参数的 HTTP/1.1 keep-alive GET 请求
+ * 直接发送缓存的字节，不再回调。
+ */
+class HttpServer : noncopyable
+{
+public:
+    using HttpCallback = std::function<void (const HttpRequest&, HttpResponse*)>;
+
+    static const int kDefaultIdleTimeoutSeconds = 60;
+
+    HttpServer(EventLoop *loop,
+            const InetAddress &listenAddr,
+            const std::string &name,
+            TcpServer::Option option = TcpServer::kNoReusePort);
+
+    EventLoop* getLoop() const { return loop_; }
+    // 用于设置 socket 选项、TLS、内存预算等，必须在 start 之前。
+    // 不要通过它设置线程初始化回调，使用 setThreadInitCallback
+    TcpServer* tcpServer() { return &server_; }
+
+    // 在连接所在的 loop 线程中回调，request 中的视图只在回调期间有效
+    void setHttpCallback(const HttpCallback &cb) { httpCallback_ = cb; }
+    void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+    void setThreadInitCallback(const TcpServer::ThreadInitCallback &cb) { threadInitCallback_ = cb; }
+    // 单位秒，连接上没有收到数据、也没有待发送数据的时间超过它就关闭连接，0 表示不限制
+    void setIdleTimeout(double seconds) { idleTimeout_ = seconds; }
+    // 请求行加头部、请求体的长度上限，超过时分别回复 431、413 并关闭连接
+    void setRequestLimits(size_t maxHeaderBytes, size_t maxBodyBytes)
+    { maxHeaderBytes_ = maxHeaderBytes; maxBodyBytes_ = maxBodyBytes; }
+
+    void start() { server_.start(); }
+
+    // 可以在任意线程调用，在每个 loop 中删除 path 的缓存或者全部缓存
+    void invalidateCache(const std::string &path);
+    void clearCache();
+
+private:
+    struct Session
+    {
+        Session(size_t maxHeaderBytes, size_t maxBodyBytes, HttpResponseCache *responseCache)
+            : context(maxHeaderBytes, maxBodyBytes)
+            , closing(false)
+            , cache(responseCache)
+        {}
+
+        HttpContext context;
+        Timestamp lastActive;
+        bool closing;           // 已经决定关闭连接，之后收到的数据都丢弃
+        HttpResponseCache *cache;   // 连接所在 loop 的缓存
+    };
+
+    using CacheMap = std::unordered_map<EventLoop*, std::unique_ptr<HttpResponseCache>>;
+
+    void initLoop(EventLoop *loop);
+
+    void onConnection(const TcpConnectionPtr &conn);
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+    // 处理一个请求，返回是否需要关闭连接
+    bool onRequest(const TcpConnectionPtr &conn, Session *session, const HttpRequest &request);
+    static void sendError(const TcpConnectionPtr &conn, Session *session, int statusCode);
+    static void checkIdle(const std::weak_ptr<TcpConnection> &weakConn, double idleTimeout);
+
+    EventLoop *loop_;
+    // 在 loop 线程初始化时创建，start 以后不再修改。声明在 server_ 之前，
+    // 保证 loop 线程全部退出以后才销毁
+    std::mutex cachesMutex_;
+    CacheMap caches_;
+    TcpServer server_;
+    TcpServer::ThreadInitCallback threadInitCallback_;
+    HttpCallback httpCallback_;
+    double idleTimeout_;
+    size_t maxHeaderBytes_;
+    size_t maxBodyBytes_;
+};
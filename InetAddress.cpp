@@ -1,18 +1,102 @@
 #include "InetAddress.h"
+#include "Logger.h"
 
+#include <errno.h>
+#include <stddef.h>
 #include <strings.h>
 #include <string.h>
+#include <sys/socket.h>
 
 InetAddress::InetAddress(uint16_t port, std::string ip)
 {
-    bzero(&addr_, sizeof addr_);
+    bzero(&unixAddr_, sizeof unixAddr_);
     addr_.sin_family = AF_INET;
     addr_.sin_port = htons(port);
     addr_.sin_addr.s_addr = inet_addr(ip.c_str());
+    length_ = sizeof addr_;
+}
+
+InetAddress::InetAddress(const sockaddr *addr, socklen_t len)
+{
+    bzero(&unixAddr_, sizeof unixAddr_);
+    if (len > sizeof unixAddr_)
+    {
+        len = sizeof unixAddr_;
+    }
+    ::memcpy(&unixAddr_, addr, len);
+    length_ = len;
+}
+
+InetAddress InetAddress::fromUnixPath(const std::string &path)
+{
+    sockaddr_un addr;
+    bzero(&addr, sizeof addr);
+    addr.sun_family = AF_UNIX;
+    size_t len = path.size();
+    if (len >= sizeof addr.sun_path)
+    {
+        LOG_ERROR("InetAddress::fromUnixPath path too long:%s \n", path.c_str());
+        len = sizeof addr.sun_path - 1;
+    }
+    ::memcpy(addr.sun_path, path.data(), len);
+    socklen_t length = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + len);
+    if (len > 0 && path[0] == '@')
+    {
+        // 抽象命名空间：第一个字节为 0，地址长度不包含结尾的 0
+        addr.sun_path[0] = '\0';
+    }
+    else
+    {
+        length += 1;
+    }
+    return InetAddress(reinterpret_cast<const sockaddr*>(&addr), length);
+}
+
+InetAddress InetAddress::localAddressOf(int sockfd)
+{
+    sockaddr_un addr;
+    bzero(&addr, sizeof addr);
+    socklen_t len = sizeof addr;
+    if (::getsockname(sockfd, reinterpret_cast<sockaddr*>(&addr), &len) < 0)
+    {
+        LOG_ERROR("sockets::getLocalAddr error:%d \n", errno);
+    }
+    return InetAddress(reinterpret_cast<const sockaddr*>(&addr), len);
+}
+
+InetAddress InetAddress::peerAddressOf(int sockfd)
+{
+    sockaddr_un addr;
+    bzero(&addr, sizeof addr);
+    socklen_t len = sizeof addr;
+    if (::getpeername(sockfd, reinterpret_cast<sockaddr*>(&addr), &len) < 0)
+    {
+        LOG_ERROR("sockets::getPeerAddr error:%d \n", errno);
+    }
+    return InetAddress(reinterpret_cast<const sockaddr*>(&addr), len);
+}
+
+std::string InetAddress::unixPath() const
+{
+    const size_t offset = offsetof(sockaddr_un, sun_path);
+    if (length_ <= offset)
+    {
+        return std::string();
+    }
+    size_t len = length_ - offset;
+    if (unixAddr_.sun_path[0] == '\0')
+    {
+        return "@" + std::string(unixAddr_.sun_path + 1, len - 1);
+    }
+    return std::string(unixAddr_.sun_path, ::strnlen(unixAddr_.sun_path, len));
 }
 
 std::string InetAddress::toIp() const
 {
+    if (isUnix())
+    {
+        return unixPath();
+    }
     // addr_
     char buf[64] = {0};
     ::inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof buf);
@@ -21,6 +105,10 @@ std::string InetAddress::toIp() const
 
 std::string InetAddress::toIpPort() const
 {
+    if (isUnix())
+    {
+        return "unix:" + unixPath();
+    }
     // ip:port
     char buf[64] = {0};
     ::inet_ntop(AF_INET, &addr_.sin_addr, buf, sizeof buf);
@@ -32,5 +120,5 @@ std::string InetAddress::toIpPort() const
 
 uint16_t InetAddress::toPort() const
 {
-    return ntohs(addr_.sin_port);
-}
\ No newline at end of file
+    return isUnix() ? 0 : ntohs(addr_.sin_port);
+}
@@ -2,23 +2,50 @@
 
 #include <arpa/inet.h>
 #include <netinet/in.h>
+#include <sys/un.h>
 #include <string>
 
-// 封装 socket 地址类型
+// 封装 socket 地址类型：IPv4 地址，或者 AF_UNIX 流式 socket 的路径
 class InetAddress
 {
 public:
     explicit InetAddress(uint16_t port = 0, std::string ip = "127.0.0.1");
     explicit InetAddress(const sockaddr_in &addr)
         : addr_(addr)
+        , length_(sizeof addr)
     {}
+    // 从 accept / getsockname / getpeername 返回的地址构造
+    InetAddress(const sockaddr *addr, socklen_t len);
 
+    // AF_UNIX 地址。path 以 '@' 开头时使用 Linux 的抽象命名空间，不在文件系统中创建文件
+    static InetAddress fromUnixPath(const std::string &path);
+    // sockfd 绑定的本端地址和连接的对端地址
+    static InetAddress localAddressOf(int sockfd);
+    static InetAddress peerAddressOf(int sockfd);
+
+    sa_family_t family() const { return addr_.sin_family; }
+    bool isUnix() const { return family() == AF_UNIX; }
+    // 抽象命名空间的地址以 '@' 开头，未命名的地址（例如客户端一侧）为空
+    std::string unixPath() const;
+
+    // AF_UNIX 地址返回路径，toIpPort 返回 "unix:路径"，toPort 返回 0
     std::string toIp() const;
     std::string toIpPort() const;
     uint16_t toPort() const;
 
+    // 只对 IPv4 地址有意义
     const sockaddr_in* getSockAddr() const {return &addr_;}
-    void setSockAddr(const sockaddr_in &addr) { addr_ = addr; }
+    void setSockAddr(const sockaddr_in &addr) { addr_ = addr; length_ = sizeof addr; }
+
+    // 传给 bind / connect 的通用地址和长度
+    const sockaddr* sockAddr() const { return reinterpret_cast<const sockaddr*>(&addr_); }
+    socklen_t sockAddrLength() const { return length_; }
+
 private:
-    sockaddr_in addr_;
-};
\ No newline at end of file
+    union
+    {
+        sockaddr_in addr_;
+        sockaddr_un unixAddr_;
+    };
+    socklen_t length_;
+};
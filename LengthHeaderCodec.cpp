@@ -0,0 +1,72 @@
+#include "LengthHeaderCodec.h"
+#include "OutputBatch.h"
+#include "TcpConnection.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+#include "Logger.h"
+
+LengthHeaderCodec::LengthHeaderCodec(const FrameCallback &cb, size_t maxFrameLength)
+    : frameCallback_(cb)
+    , maxFrameLength_(maxFrameLength)
+{
+}
+
+// 解析 buf 中所有完整的帧，逐个交给帧回调，回调返回以后取走这一帧
+void LengthHeaderCodec::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime)
+{
+    // 帧回调里发送的回复先编码进 outputBuffer，这一批帧全部分发完以后统一发送
+    OutputBatch batch(conn);
+
+    while (buf->readableBytes() >= kHeaderLen)
+    {
+        const size_t len = static_cast<uint32_t>(buf->peekInt32());
+
+        // 只要读到长度头就检查，超长的帧不必等到数据收全
+        if (len > maxFrameLength_)
+        {
+            LOG_ERROR("LengthHeaderCodec::onMessage [%s] invalid frame length %lu \n", conn->name().c_str(), len);
+            buf->retrieveAll();
+            conn->shutdown();
+            return;
+        }
+
+        if (buf->readableBytes() < kHeaderLen + len)
+        {
+            // 帧还没有收全，为剩余部分预留空间（有上限），避免后续多次扩容
+            buf->reserveIncoming(kHeaderLen + len - buf->readableBytes());
+            break;
+        }
+
+        buf->retrieve(kHeaderLen);
+        frameCallback_(conn, buf->peek(), len, receiveTime);
+        buf->retrieve(len);
+    }
+}
+
+void LengthHeaderCodec::send(const TcpConnectionPtr &conn, const char *data, size_t len) const
+{
+    if (conn->getLoop()->isInLoopThread())
+    {
+        if (!conn->connected())
+        {
+            return;
+        }
+        Buffer *out = conn->outputBuffer();
+        out->appendInt32(static_cast<int32_t>(len));
+        out->append(data, len);
+        OutputBatch::flush(conn);
+    }
+    else
+    {
+        Buffer buf;
+        buf.append(data, len);
+        buf.prependInt32(static_cast<int32_t>(len));
+        conn->send(&buf);
+    }
+}
+
+void LengthHeaderCodec::send(const TcpConnectionPtr &conn, Buffer *body) const
+{
+    body->prependInt32(static_cast<int32_t>(body->readableBytes()));
+    conn->send(body);
+}
@@ -0,0 +1,46 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+#include "Timestamp.h"
+
+#include <functional>
+#include <stdint.h>
+#include <stddef.h>
+
+class Buffer;
+
+/**
+ * "4 字节长度头（网络字节序） + 消息体" 的分帧编解码器，位于 TcpConnection 和用户代码之间。
+ * 用法：conn->setMessageCallback(std::bind(&LengthHeaderCodec::onMessage, &codec, _1, _2, _3))
+ * 收到数据后一次性解析出 inputBuffer 中所有完整的帧，以 (data, len) 的形式交给用户，
+ * data 直接指向 inputBuffer 内部，只在回调期间有效，不发生拷贝。
+ */
+class LengthHeaderCodec : noncopyable
+{
+public:
+    using FrameCallback = std::function<void (const TcpConnectionPtr&,
+                                            const char *data,
+                                            size_t len,
+                                            Timestamp)>;
+
+    static const size_t kHeaderLen = sizeof(int32_t);
+    static const size_t kDefaultMaxFrameLength = 64*1024*1024;    // 64M
+
+    explicit LengthHeaderCodec(const FrameCallback &cb,
+                            size_t maxFrameLength = kDefaultMaxFrameLength);
+
+    // 注册为 TcpConnection 的 MessageCallback
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+
+    // 编码并发送一帧。在 loop 线程中直接编码进连接的 outputBuffer，不经过临时缓冲区。
+    void send(const TcpConnectionPtr &conn, const char *data, size_t len) const;
+    // body 中是已经序列化好的消息体，长度头写入 body 的 prependable 区域后直接发送，发送后 body 被清空。
+    void send(const TcpConnectionPtr &conn, Buffer *body) const;
+
+    size_t maxFrameLength() const { return maxFrameLength_; }
+
+private:
+    FrameCallback frameCallback_;
+    const size_t maxFrameLength_;
+};
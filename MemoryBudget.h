@@ -0,0 +1,62 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <atomic>
+#include <functional>
+#include <sys/types.h>
+
+/**
+ * 内存预算：统计一组连接的输入、输出缓冲区中的字节数，并给出软限制和硬限制（0 表示不限制）。
+ * 每个 loop 一个预算，parent 是整个 TcpServer 的预算，charge 会同时计入 parent。
+ * charge 位于收发的热路径上，只做原子加法；用量越过软/硬限制（任一方向）时才调用 CrossCallback，
+ * 由回调负责暂停读取或者断开连接。
+ */
+class MemoryBudget : noncopyable
+{
+public:
+    using CrossCallback = std::function<void()>;
+
+    explicit MemoryBudget(MemoryBudget *parent = nullptr)
+        : parent_(parent)
+        , used_(0)
+        , softLimit_(0)
+        , hardLimit_(0)
+    {}
+
+    void setLimits(size_t softLimit, size_t hardLimit)
+    { softLimit_ = softLimit; hardLimit_ = hardLimit; }
+    void setCrossCallback(const CrossCallback &cb) { crossCallback_ = cb; }
+
+    void charge(ssize_t delta)
+    {
+        size_t old = used_.fetch_add(static_cast<size_t>(delta), std::memory_order_relaxed);
+        if (crossed(old, old + static_cast<size_t>(delta)) && crossCallback_)
+        {
+            crossCallback_();
+        }
+        if (parent_ != nullptr)
+        {
+            parent_->charge(delta);
+        }
+    }
+
+    size_t used() const { return used_.load(std::memory_order_relaxed); }
+    size_t softLimit() const { return softLimit_; }
+    size_t hardLimit() const { return hardLimit_; }
+    bool overSoftLimit() const { return softLimit_ > 0 && used() >= softLimit_; }
+    bool overHardLimit() const { return hardLimit_ > 0 && used() >= hardLimit_; }
+
+private:
+    bool crossed(size_t oldUsed, size_t newUsed) const
+    {
+        return (softLimit_ > 0 && (oldUsed < softLimit_) != (newUsed < softLimit_))
+            || (hardLimit_ > 0 && (oldUsed < hardLimit_) != (newUsed < hardLimit_));
+    }
+
+    MemoryBudget *parent_;
+    std::atomic<size_t> used_;
+    size_t softLimit_;
+    size_t hardLimit_;
+    CrossCallback crossCallback_;
+};
@@ -0,0 +1,30 @@
+#include "OutputBatch.h"
+#include "TcpConnection.h"
+
+// 当前线程正在分发消息的连接
+static __thread TcpConnection *t_dispatchingConn = nullptr;
+
+OutputBatch::OutputBatch(const TcpConnectionPtr &conn)
+    : conn_(conn.get())
+    , prevConn_(t_dispatchingConn)
+{
+    t_dispatchingConn = conn_;
+}
+
+OutputBatch::~OutputBatch()
+{
+    t_dispatchingConn = prevConn_;
+    // 分发期间可能已经 forceClose，连接断开以后不再发送
+    if (!conn_->disconnected())
+    {
+        conn_->flushOutputBuffer();
+    }
+}
+
+void OutputBatch::flush(const TcpConnectionPtr &conn)
+{
+    if (conn.get() != t_dispatchingConn)
+    {
+        conn->flushOutputBuffer();
+    }
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+
+class TcpConnection;
+
+/**
+ * 在 MessageCallback 中一次分发多条消息时，把分发期间对同一连接的回复合并成一次发送。
+ * 用法：onMessage 中先构造 OutputBatch batch(conn)，再逐条分发；回复在 loop 线程中编码进
+ * conn->outputBuffer() 以后调用 OutputBatch::flush(conn)，正在分发这个连接时不立即发送，
+ * 等 batch 析构时统一 flushOutputBuffer，流水线请求的多个回复合并成一次 write。
+ * 分发中途可以 shutdown，写端在这批回复发送以后才关闭。
+ */
+class OutputBatch : noncopyable
+{
+public:
+    explicit OutputBatch(const TcpConnectionPtr &conn);
+    ~OutputBatch();
+
+    // 必须在 conn 的 loop 线程调用：conn 不在分发期间时立即 flushOutputBuffer，否则留给批次结束时发送
+    static void flush(const TcpConnectionPtr &conn);
+
+private:
+    TcpConnection *conn_;
+    TcpConnection *prevConn_;       // 嵌套分发（例如回复回调里又收到消息）时外层的连接
+};
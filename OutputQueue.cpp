@@ -0,0 +1,502 @@
+#include "OutputQueue.h"
+#include "Buffer.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <string.h>
+#include <netinet/in.h>
+#include <linux/errqueue.h>
+#include <sys/socket.h>
+#include <sys/sendfile.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// 一次 writev 最多提交的数据段个数
+static const int kMaxIovecs = IOV_MAX;
+
+OutputQueue::OutputQueue(Buffer *buffer)
+    : buffer_(buffer)
+    , bytes_(0)
+    , bufferBytes_(0)
+    , fileBytes_(0)
+    , ownedBytes_(0)
+    , copiedBytes_(0)
+    , zeroCopy_(false)
+    , zeroCopyThreshold_(0)
+    , nextZeroCopyId_(0)
+    , pinnedBytes_(0)
+    , zeroCopyBytes_(0)
+    , zeroCopyFallbacks_(0)
+{
+}
+
+OutputQueue::~OutputQueue()
+{
+    for (Segment &seg : segments_)
+    {
+        if (seg.kind == kFile)
+        {
+            ::close(seg.fd);
+        }
+        closeFds(&seg);
+    }
+}
+
+// 拷贝段：数据写入 buffer_，如果队尾也是拷贝段就直接延长它
+void OutputQueue::appendCopy(const void *data, size_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+    syncBuffer();
+    buffer_->append(data, len);
+    copiedBytes_ += len;
+    bufferBytes_ += len;
+    bytes_ += len;
+    if (!segments_.empty() && segments_.back().kind == kCopy)
+    {
+        segments_.back().len += len;
+    }
+    else
+    {
+        segments_.push_back(Segment(kCopy, len));
+    }
+}
+
+void OutputQueue::appendOwned(std::string &&data)
+{
+    if (data.empty())
+    {
+        return;
+    }
+    syncBuffer();
+    Segment seg(kOwned, data.size());
+    seg.owned = std::move(data);
+    bytes_ += seg.len;
+    ownedBytes_ += seg.len;
+    segments_.push_back(std::move(seg));
+}
+
+void OutputQueue::appendShared(const std::shared_ptr<const void> &holder, const char *data, size_t len)
+{
+    if (len == 0)
+    {
+        return;
+    }
+    syncBuffer();
+    Segment seg(kShared, len);
+    seg.data = data;
+    seg.holder = holder;
+    bytes_ += len;
+    segments_.push_back(std::move(seg));
+}
+
+void OutputQueue::appendFile(int fd, off_t offset, size_t len)
+{
+    if (len == 0)
+    {
+        ::close(fd);
+        return;
+    }
+    syncBuffer();
+    Segment seg(kFile, len);
+    seg.fd = fd;
+    seg.offset = offset;
+    bytes_ += len;
+    fileBytes_ += len;
+    segments_.push_back(std::move(seg));
+}
+
+void OutputQueue::appendWithFds(std::string &&data, std::vector<int> &&fds)
+{
+    syncBuffer();
+    Segment seg(kOwned, data.size());
+    seg.owned = std::move(data);
+    seg.fds = std::move(fds);
+    bytes_ += seg.len;
+    ownedBytes_ += seg.len;
+    segments_.push_back(std::move(seg));
+}
+
+void OutputQueue::closeFds(Segment *seg)
+{
+    for (int fd : seg->fds)
+    {
+        ::close(fd);
+    }
+    seg->fds.clear();
+}
+
+void OutputQueue::syncBuffer()
+{
+    size_t readable = buffer_->readableBytes();
+    if (readable > bufferBytes_)
+    {
+        size_t extra = readable - bufferBytes_;
+        copiedBytes_ += extra;
+        bufferBytes_ += extra;
+        bytes_ += extra;
+        if (!segments_.empty() && segments_.back().kind == kCopy)
+        {
+            segments_.back().len += extra;
+        }
+        else
+        {
+            segments_.push_back(Segment(kCopy, extra));
+        }
+    }
+}
+
+const char* OutputQueue::segmentData(const Segment &seg) const
+{
+    switch (seg.kind)
+    {
+    case kOwned:
+        return seg.owned.data() + (seg.owned.size() - seg.len);
+    case kShared:
+        return seg.data;
+    default:
+        return nullptr;  // 拷贝段的地址由调用方根据在 buffer_ 中的位置计算
+    }
+}
+
+ssize_t OutputQueue::writeFd(int fd, int *saveErrno)
+{
+    syncBuffer();
+
+    if (!segments_.empty() && segments_.front().kind == kFile)
+    {
+        ssize_t n = writeFile(fd, &segments_.front(), saveErrno);
+        if (n > 0)
+        {
+            retrieve(static_cast<size_t>(n));
+        }
+        return n;
+    }
+
+    if (!segments_.empty() && !segments_.front().fds.empty())
+    {
+        ssize_t n = writeWithFds(fd, &segments_.front(), saveErrno);
+        if (n > 0)
+        {
+            retrieve(static_cast<size_t>(n));
+        }
+        return n;
+    }
+
+    if (zeroCopy_ && !segments_.empty() && zeroCopyEligible(segments_.front()))
+    {
+        ssize_t n = writeZeroCopy(fd, saveErrno);
+        // 超出 optmem 限制时内核拒绝零拷贝，这一次退化为普通的 writev
+        if (n >= 0 || *saveErrno != ENOBUFS)
+        {
+            return n;
+        }
+        ++zeroCopyFallbacks_;
+    }
+
+    struct iovec vec[kMaxIovecs];
+    int iovcnt = 0;
+    // 拷贝段在 buffer_ 中首尾相接，按顺序累加偏移即可得到每一段的地址
+    const char *copyPos = buffer_->peek();
+    for (auto it = segments_.begin(); it != segments_.end() && iovcnt < kMaxIovecs; ++it)
+    {
+        if (it->kind == kFile || !it->fds.empty())
+        {
+            break;  // 文件段和附带描述符的段之前的内存段先发送，它们留给下一次调用
+        }
+        if (iovcnt > 0 && zeroCopy_ && zeroCopyEligible(*it))
+        {
+            break;  // 大的数据段留给下一次调用用零拷贝发送
+        }
+        if (it->kind == kCopy)
+        {
+            vec[iovcnt].iov_base = const_cast<char*>(copyPos);
+            copyPos += it->len;
+        }
+        else
+        {
+            vec[iovcnt].iov_base = const_cast<char*>(segmentData(*it));
+        }
+        vec[iovcnt].iov_len = it->len;
+        ++iovcnt;
+    }
+
+    ssize_t n = ::writev(fd, vec, iovcnt);
+    if (n < 0)
+    {
+        *saveErrno = errno;
+    }
+    else
+    {
+        retrieve(static_cast<size_t>(n));
+    }
+    return n;
+}
+
+ssize_t OutputQueue::writeWith(const WriteFunction &write, int *saveErrno)
+{
+    syncBuffer();
+
+    ssize_t total = 0;
+    char buf[16384];   // 文件段每次读取一个 TLS 记录的大小，重试时读到的内容和长度不变
+    while (!segments_.empty())
+    {
+        Segment &seg = segments_.front();
+        const char *data = nullptr;
+        size_t len = seg.len;
+        if (seg.kind == kCopy)
+        {
+            data = buffer_->peek();
+        }
+        else if (seg.kind == kFile)
+        {
+            size_t want = seg.len < sizeof buf ? seg.len : sizeof buf;
+            ssize_t nread = ::pread(seg.fd, buf, want, seg.offset);
+            if (nread <= 0)
+            {
+                *saveErrno = nread < 0 ? errno : EIO;   // 文件比声明的长度短
+                return total > 0 ? total : -1;
+            }
+            data = buf;
+            len = static_cast<size_t>(nread);
+        }
+        else
+        {
+            data = segmentData(seg);
+        }
+
+        ssize_t n = write(data, len, saveErrno);
+        if (n <= 0)
+        {
+            return total > 0 ? total : -1;
+        }
+        retrieve(static_cast<size_t>(n));
+        total += n;
+    }
+    return total;
+}
+
+bool OutputQueue::zeroCopyEligible(const Segment &seg) const
+{
+    return (seg.kind == kOwned || seg.kind == kShared) && seg.len >= zeroCopyThreshold_ && seg.fds.empty();
+}
+
+// 用一次 sendmsg(MSG_ZEROCOPY) 发送队首连续的大数据段，并钉住它们的内存直到内核通知完成
+ssize_t OutputQueue::writeZeroCopy(int fd, int *saveErrno)
+{
+    struct iovec vec[kMaxIovecs];
+    int iovcnt = 0;
+    for (auto it = segments_.begin();
+        it != segments_.end() && iovcnt < kMaxIovecs && zeroCopyEligible(*it);
+        ++it)
+    {
+        if (it->kind == kOwned)
+        {
+            // 转成引用计数的共享段，发送完成前由 Pinned 持有，不拷贝数据
+            std::shared_ptr<std::string> str = std::make_shared<std::string>(std::move(it->owned));
+            it->data = str->data() + (str->size() - it->len);
+            it->holder = str;
+            it->kind = kShared;
+            ownedBytes_ -= it->len;
+        }
+        vec[iovcnt].iov_base = const_cast<char*>(it->data);
+        vec[iovcnt].iov_len = it->len;
+        ++iovcnt;
+    }
+
+    struct msghdr msg;
+    ::memset(&msg, 0, sizeof msg);
+    msg.msg_iov = vec;
+    msg.msg_iovlen = iovcnt;
+    ssize_t n = ::sendmsg(fd, &msg, MSG_ZEROCOPY | MSG_NOSIGNAL);
+    if (n < 0)
+    {
+        *saveErrno = errno;
+        return n;
+    }
+
+    Pinned pin;
+    pin.id = nextZeroCopyId_++;
+    pin.done = false;
+    pin.bytes = static_cast<size_t>(n);
+    size_t left = static_cast<size_t>(n);
+    for (auto it = segments_.begin(); left > 0 && it != segments_.end(); ++it)
+    {
+        pin.holders.push_back(it->holder);
+        left -= left < it->len ? left : it->len;
+    }
+    pinnedBytes_ += pin.bytes;
+    zeroCopyBytes_ += pin.bytes;
+    pinned_.push_back(std::move(pin));
+
+    retrieve(static_cast<size_t>(n));
+    return n;
+}
+
+int OutputQueue::readZeroCopyCompletions(int fd)
+{
+    int count = 0;
+    while (true)
+    {
+        char control[128];
+        struct msghdr msg;
+        ::memset(&msg, 0, sizeof msg);
+        msg.msg_control = control;
+        msg.msg_controllen = sizeof control;
+        if (::recvmsg(fd, &msg, MSG_ERRQUEUE) < 0)
+        {
+            break;  // EAGAIN: 错误队列已经读空
+        }
+
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm != nullptr; cm = CMSG_NXTHDR(&msg, cm))
+        {
+            if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR)
+                || (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)))
+            {
+                continue;
+            }
+            const struct sock_extended_err *serr =
+                reinterpret_cast<const struct sock_extended_err*>(CMSG_DATA(cm));
+            if (serr->ee_errno != 0 || serr->ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+            {
+                continue;
+            }
+            // 内核没能零拷贝（例如 loopback），数据实际上被拷贝了
+            if (serr->ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+            {
+                ++zeroCopyFallbacks_;
+            }
+            completeZeroCopy(serr->ee_info, serr->ee_data);
+            ++count;
+        }
+    }
+    return count;
+}
+
+// 标记序号在 [lo, hi] 范围内的发送已经完成，按顺序释放队首已完成的数据
+void OutputQueue::completeZeroCopy(uint32_t lo, uint32_t hi)
+{
+    for (Pinned &pin : pinned_)
+    {
+        // 序号是 32 位递增的，用无符号减法处理回绕
+        if (pin.id - lo <= hi - lo)
+        {
+            pin.done = true;
+        }
+    }
+    while (!pinned_.empty() && pinned_.front().done)
+    {
+        pinnedBytes_ -= pinned_.front().bytes;
+        pinned_.pop_front();
+    }
+}
+
+// 用 sendfile 发送文件段，文件不支持 sendfile 时退化为 pread + write
+ssize_t OutputQueue::writeFile(int fd, Segment *seg, int *saveErrno)
+{
+    off_t offset = seg->offset;
+    ssize_t n = ::sendfile(fd, seg->fd, &offset, seg->len);
+    if (n < 0 && (errno == EINVAL || errno == ENOSYS))
+    {
+        // 没有写出去的数据下次从文件中重新读取，不需要额外保存
+        char buf[65536];
+        size_t want = seg->len < sizeof buf ? seg->len : sizeof buf;
+        ssize_t nread = ::pread(seg->fd, buf, want, seg->offset);
+        if (nread <= 0)
+        {
+            *saveErrno = nread < 0 ? errno : EIO;   // 文件比声明的长度短
+            return -1;
+        }
+        n = ::write(fd, buf, nread);
+    }
+    if (n < 0)
+    {
+        *saveErrno = errno;
+    }
+    else if (n == 0)
+    {
+        *saveErrno = EIO;   // 文件比声明的长度短，无法继续发送
+        return -1;
+    }
+    return n;
+}
+
+// 用 sendmsg 发送段中的数据并附带 SCM_RIGHTS 描述符。内核在发送成功（哪怕只发送了一部分数据）时
+// 复制描述符，之后本地的副本可以关闭，剩余的数据按普通的段发送
+ssize_t OutputQueue::writeWithFds(int fd, Segment *seg, int *saveErrno)
+{
+    struct iovec vec;
+    vec.iov_base = const_cast<char*>(segmentData(*seg));
+    vec.iov_len = seg->len;
+
+    const size_t fdBytes = seg->fds.size() * sizeof(int);
+    std::vector<char> control(CMSG_SPACE(fdBytes));
+    struct msghdr msg;
+    ::memset(&msg, 0, sizeof msg);
+    msg.msg_iov = &vec;
+    msg.msg_iovlen = 1;
+    msg.msg_control = control.data();
+    msg.msg_controllen = control.size();
+    struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_SOCKET;
+    cm->cmsg_type = SCM_RIGHTS;
+    cm->cmsg_len = CMSG_LEN(fdBytes);
+    ::memcpy(CMSG_DATA(cm), seg->fds.data(), fdBytes);
+
+    ssize_t n = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+    if (n < 0)
+    {
+        *saveErrno = errno;
+        return n;
+    }
+    closeFds(seg);
+    return n;
+}
+
+void OutputQueue::popFront()
+{
+    if (segments_.front().kind == kFile)
+    {
+        ::close(segments_.front().fd);
+    }
+    // 经由 writeWith 发送的段无法附带描述符，这里关闭
+    closeFds(&segments_.front());
+    segments_.pop_front();
+}
+
+// 移除已经发送的 len 字节，发送了一部分的段只移动它的起始位置
+void OutputQueue::retrieve(size_t len)
+{
+    bytes_ -= len;
+    while (len > 0 && !segments_.empty())
+    {
+        Segment &seg = segments_.front();
+        size_t n = len < seg.len ? len : seg.len;
+        if (seg.kind == kCopy)
+        {
+            buffer_->retrieve(n);
+            bufferBytes_ -= n;
+        }
+        else if (seg.kind == kOwned)
+        {
+            ownedBytes_ -= n;
+        }
+        else if (seg.kind == kShared)
+        {
+            seg.data += n;
+        }
+        else if (seg.kind == kFile)
+        {
+            seg.offset += n;
+            fileBytes_ -= n;
+        }
+        seg.len -= n;
+        len -= n;
+        if (seg.len == 0)
+        {
+            popFront();
+        }
+    }
+}
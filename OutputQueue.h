@@ -0,0 +1,138 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <sys/types.h>
+
+class Buffer;
+
+/**
+ * TcpConnection 的发送队列，由若干按顺序发送的数据段组成：
+ *   kCopy   拷贝进 Buffer（即 TcpConnection::outputBuffer_）里的数据，相邻的拷贝段会合并
+ *   kOwned  队列接管所有权的 std::string，入队时不拷贝
+ *   kShared 由引用计数 holder 保持有效的只读内存，入队时不拷贝，发送完成后释放引用
+ *   kFile   文件中的一段数据，使用 sendfile 直接从页缓存发送，不经过用户态
+ * 发送时把队首的若干内存段组成 iovec 数组，一次 writev 最多发送 IOV_MAX 段；
+ * 队首是文件段时，单独用 sendfile 发送。
+ * kOwned 段可以附带文件描述符（AF_UNIX 的 SCM_RIGHTS），这样的段单独用 sendmsg 发送，
+ * 描述符随段的第一次发送交给内核，保证对端在收到这段数据的第一个字节时一起收到描述符。
+ *
+ * 开启零拷贝后，不小于阈值的 kOwned / kShared 段使用 sendmsg(MSG_ZEROCOPY) 发送，
+ * 内核直接引用用户内存。这些内存在内核通过错误队列报告发送完成之前一直被钉住（持有引用），
+ * 完成通知由 readZeroCopyCompletions 处理。小于阈值的段和拷贝段仍然走普通的 writev。
+ */
+class OutputQueue : noncopyable
+{
+public:
+    explicit OutputQueue(Buffer *buffer);
+    ~OutputQueue();
+
+    // 队列中待发送的总字节数，包括文件段
+    size_t readableBytes() const { return bytes_; }
+    // 其中文件段的字节数，这部分数据不占用内存
+    size_t fileBytes() const { return fileBytes_; }
+    bool empty() const { return bytes_ == 0; }
+    // 队列自己持有的内存：拷贝段和 kOwned 段，不包括共享的数据和文件段
+    size_t memoryBytes() const { return bufferBytes_ + ownedBytes_; }
+    size_t segments() const { return segments_.size(); }
+
+    void appendCopy(const void *data, size_t len);
+    void appendOwned(std::string &&data);
+    void appendShared(const std::shared_ptr<const void> &holder, const char *data, size_t len);
+    // 队列接管 fd，发送完成或者队列销毁时关闭
+    void appendFile(int fd, off_t offset, size_t len);
+    // 队列接管 fds，随 data 的第一个字节一起发送，发送以后或者队列销毁时关闭。data 不能为空
+    void appendWithFds(std::string &&data, std::vector<int> &&fds);
+
+    // 调用方绕过队列直接写入 Buffer 的数据，在这里补记为队尾的拷贝段
+    void syncBuffer();
+
+    // 用 writev 发送队首的数据，并移除已经发送的部分
+    ssize_t writeFd(int fd, int *saveErrno);
+
+    // 用调用方提供的函数逐段发送，用于不能直接写 socket 的场景（例如用户态 TLS 的 SSL_write）。
+    // 文件段先 pread 到临时缓冲区。一次调用最多发送到函数返回 EAGAIN 为止，返回发送的总字节数。
+    // 函数返回 EAGAIN 以后，下一次调用会从同一个位置、以不更短的长度重新提交，满足 SSL_write 的重试要求。
+    typedef std::function<ssize_t(const void *data, size_t len, int *saveErrno)> WriteFunction;
+    ssize_t writeWith(const WriteFunction &write, int *saveErrno);
+
+    // 累计拷贝进 Buffer 的字节数
+    uint64_t copiedBytes() const { return copiedBytes_; }
+
+    // 调用方负责在 socket 上开启 SO_ZEROCOPY
+    void setZeroCopy(bool on, size_t threshold) { zeroCopy_ = on; zeroCopyThreshold_ = threshold; }
+    bool zeroCopy() const { return zeroCopy_; }
+    // 读取 fd 错误队列中的零拷贝完成通知，释放已完成的数据，返回处理的通知个数
+    int readZeroCopyCompletions(int fd);
+    // 已经交给内核、等待完成通知的字节数
+    size_t pinnedBytes() const { return pinnedBytes_; }
+    // 累计通过零拷贝发送的字节数，以及内核退化为拷贝的发送次数
+    uint64_t zeroCopyBytes() const { return zeroCopyBytes_; }
+    uint64_t zeroCopyFallbacks() const { return zeroCopyFallbacks_; }
+
+private:
+    enum Kind
+    {
+        kCopy,
+        kOwned,
+        kShared,
+        kFile,
+    };
+
+    struct Segment
+    {
+        Segment(Kind k, size_t n)
+            : kind(k), data(nullptr), len(n), fd(-1), offset(0)
+        {}
+
+        Kind kind;
+        const char *data;                    // kShared 的数据地址
+        size_t len;                          // 剩余未发送的长度
+        std::string owned;                   // kOwned 的数据
+        std::shared_ptr<const void> holder;  // kShared 的引用计数
+        int fd;                              // kFile 的文件描述符
+        off_t offset;                        // kFile 下一次发送的文件偏移
+        std::vector<int> fds;                // kOwned 附带的还没有发送的文件描述符
+    };
+
+    // 一次 MSG_ZEROCOPY 发送所引用的数据，收到完成通知以后释放
+    struct Pinned
+    {
+        uint32_t id;
+        bool done;
+        size_t bytes;
+        std::vector<std::shared_ptr<const void>> holders;
+    };
+
+    bool zeroCopyEligible(const Segment &seg) const;
+    ssize_t writeZeroCopy(int fd, int *saveErrno);
+    void completeZeroCopy(uint32_t lo, uint32_t hi);
+    const char* segmentData(const Segment &seg) const;
+    void retrieve(size_t len);
+    ssize_t writeFile(int fd, Segment *seg, int *saveErrno);
+    ssize_t writeWithFds(int fd, Segment *seg, int *saveErrno);
+    static void closeFds(Segment *seg);
+    void popFront();
+
+    Buffer *buffer_;
+    std::deque<Segment> segments_;
+    size_t bytes_;              // 所有段的剩余字节数
+    size_t bufferBytes_;        // 其中位于 buffer_ 里的字节数
+    size_t fileBytes_;          // 其中文件段的字节数
+    size_t ownedBytes_;         // 其中 kOwned 段的字节数
+    uint64_t copiedBytes_;
+
+    bool zeroCopy_;
+    size_t zeroCopyThreshold_;
+    uint32_t nextZeroCopyId_;       // 内核为每次成功的 MSG_ZEROCOPY 发送分配的递增序号
+    std::deque<Pinned> pinned_;
+    size_t pinnedBytes_;
+    uint64_t zeroCopyBytes_;
+    uint64_t zeroCopyFallbacks_;
+};
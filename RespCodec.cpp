@@ -0,0 +1,307 @@
+#include "RespCodec.h"
+#include "Buffer.h"
+#include "BufferSearch.h"
+
+#include <string.h>
+
+namespace
+{
+
+// 长度行（"*3"、"$5" 等）最多的字符数，超过时不再等待 CRLF，直接认为格式错误
+const size_t kMaxLengthLine = 32;
+// 内联命令一行的长度上限
+const size_t kMaxInlineLength = 64 * 1024;
+// 回复中数组嵌套的最大深度
+const int kMaxReplyDepth = 64;
+
+bool parseInteger(const char *begin, const char *end, int64_t *value)
+{
+    const char *p = begin;
+    bool negative = false;
+    if (p < end && *p == '-')
+    {
+        negative = true;
+        ++p;
+    }
+    if (p == end || end - p > 18)
+    {
+        return false;
+    }
+    int64_t n = 0;
+    for (; p < end; ++p)
+    {
+        if (*p < '0' || *p > '9')
+        {
+            return false;
+        }
+        n = n * 10 + (*p - '0');
+    }
+    *value = negative ? -n : n;
+    return true;
+}
+
+// 解析 data 开头的长度行（第一个字节是类型前缀），成功时 *next 指向下一行
+RespCodec::ParseResult parseLengthLine(const char *data, size_t len, int64_t *value, size_t *next)
+{
+    const char *crlf = BufferSearch::findCRLF(data + 1, data + len);
+    if (crlf == nullptr)
+    {
+        return len > kMaxLengthLine ? RespCodec::kProtocolError : RespCodec::kNeedMore;
+    }
+    if (!parseInteger(data + 1, crlf, value))
+    {
+        return RespCodec::kProtocolError;
+    }
+    *next = crlf + 2 - data;
+    return RespCodec::kGotMessage;
+}
+
+RespCodec::ParseResult parseInline(const char *data, size_t len, std::vector<StringPiece> *args, size_t *length)
+{
+    const char *end = data + len;
+    const char *newline = BufferSearch::findByte(data, end, '\n');
+    if (newline == nullptr)
+    {
+        return len > kMaxInlineLength ? RespCodec::kProtocolError : RespCodec::kNeedMore;
+    }
+    const char *lineEnd = newline > data && newline[-1] == '\r' ? newline - 1 : newline;
+    const char *p = data;
+    while (p < lineEnd)
+    {
+        while (p < lineEnd && (*p == ' ' || *p == '\t'))
+        {
+            ++p;
+        }
+        const char *wordBegin = p;
+        while (p < lineEnd && *p != ' ' && *p != '\t')
+        {
+            ++p;
+        }
+        if (p > wordBegin)
+        {
+            args->push_back(StringPiece(wordBegin, p - wordBegin));
+        }
+    }
+    *length = newline + 1 - data;
+    return RespCodec::kGotMessage;
+}
+
+RespCodec::ParseResult parseReplyAt(const char *data, size_t len, RespCodec::Reply *reply, int depth)
+{
+    if (len == 0)
+    {
+        return RespCodec::kNeedMore;
+    }
+    const char type = data[0];
+    if (type == '+' || type == '-' || type == ':')
+    {
+        const char *crlf = BufferSearch::findCRLF(data + 1, data + len);
+        if (crlf == nullptr)
+        {
+            return RespCodec::kNeedMore;
+        }
+        reply->length = crlf + 2 - data;
+        reply->str = StringPiece(data + 1, crlf - data - 1);
+        reply->integer = 0;
+        if (type == ':')
+        {
+            reply->type = RespCodec::kInteger;
+            return parseInteger(data + 1, crlf, &reply->integer) ? RespCodec::kGotMessage : RespCodec::kProtocolError;
+        }
+        reply->type = type == '+' ? RespCodec::kSimpleString : RespCodec::kError;
+        return RespCodec::kGotMessage;
+    }
+    if (type != '$' && type != '*')
+    {
+        return RespCodec::kProtocolError;
+    }
+
+    int64_t n = 0;
+    size_t pos = 0;
+    RespCodec::ParseResult result = parseLengthLine(data, len, &n, &pos);
+    if (result != RespCodec::kGotMessage)
+    {
+        return result;
+    }
+    reply->str = StringPiece();
+    reply->integer = n;
+    if (n < 0)
+    {
+        reply->type = type == '$' ? RespCodec::kNullBulkString : RespCodec::kNullArray;
+        reply->length = pos;
+        return RespCodec::kGotMessage;
+    }
+
+    if (type == '$')
+    {
+        if (static_cast<uint64_t>(n) > RespCodec::kMaxBulkLength)
+        {
+            return RespCodec::kProtocolError;
+        }
+        if (len - pos < static_cast<size_t>(n) + 2)
+        {
+            return RespCodec::kNeedMore;
+        }
+        if (data[pos + n] != '\r' || data[pos + n + 1] != '\n')
+        {
+            return RespCodec::kProtocolError;
+        }
+        reply->type = RespCodec::kBulkString;
+        reply->str = StringPiece(data + pos, static_cast<size_t>(n));
+        reply->length = pos + n + 2;
+        return RespCodec::kGotMessage;
+    }
+
+    if (static_cast<uint64_t>(n) > RespCodec::kMaxArgs || depth >= kMaxReplyDepth)
+    {
+        return RespCodec::kProtocolError;
+    }
+    for (int64_t i = 0; i < n; ++i)
+    {
+        RespCodec::Reply element;
+        result = parseReplyAt(data + pos, len - pos, &element, depth + 1);
+        if (result != RespCodec::kGotMessage)
+        {
+            return result;
+        }
+        pos += element.length;
+    }
+    reply->type = RespCodec::kArray;
+    reply->length = pos;
+    return RespCodec::kGotMessage;
+}
+
+// 追加 "<prefix><value>\r\n"
+void appendLine(Buffer *output, char prefix, int64_t value)
+{
+    char buf[32];
+    char *end = buf + sizeof buf;
+    char *p = end;
+    *--p = '\n';
+    *--p = '\r';
+    uint64_t n = value < 0 ? 0 - static_cast<uint64_t>(value) : static_cast<uint64_t>(value);
+    do
+    {
+        *--p = static_cast<char>('0' + n % 10);
+        n /= 10;
+    } while (n != 0);
+    if (value < 0)
+    {
+        *--p = '-';
+    }
+    *--p = prefix;
+    output->append(p, end - p);
+}
+
+} // namespace
+
+RespCodec::ParseResult RespCodec::parseCommand(const char *data, size_t len,
+                                               std::vector<StringPiece> *args, size_t *length)
+{
+    args->clear();
+    if (len == 0)
+    {
+        return kNeedMore;
+    }
+    if (data[0] != '*')
+    {
+        return parseInline(data, len, args, length);
+    }
+
+    int64_t count = 0;
+    size_t pos = 0;
+    ParseResult result = parseLengthLine(data, len, &count, &pos);
+    if (result != kGotMessage)
+    {
+        return result;
+    }
+    if (count > static_cast<int64_t>(kMaxArgs))
+    {
+        return kProtocolError;
+    }
+    for (int64_t i = 0; i < count; ++i)
+    {
+        if (pos >= len)
+        {
+            return kNeedMore;
+        }
+        if (data[pos] != '$')
+        {
+            return kProtocolError;
+        }
+        int64_t n = 0;
+        size_t start = 0;
+        result = parseLengthLine(data + pos, len - pos, &n, &start);
+        if (result != kGotMessage)
+        {
+            return result;
+        }
+        if (n < 0 || static_cast<uint64_t>(n) > kMaxBulkLength)
+        {
+            return kProtocolError;
+        }
+        start += pos;
+        if (len - start < static_cast<size_t>(n) + 2)
+        {
+            return kNeedMore;
+        }
+        if (data[start + n] != '\r' || data[start + n + 1] != '\n')
+        {
+            return kProtocolError;
+        }
+        args->push_back(StringPiece(data + start, static_cast<size_t>(n)));
+        pos = start + n + 2;
+    }
+    *length = pos;
+    return kGotMessage;
+}
+
+RespCodec::ParseResult RespCodec::parseReply(const char *data, size_t len, Reply *reply)
+{
+    return parseReplyAt(data, len, reply, 0);
+}
+
+void RespCodec::appendSimpleString(Buffer *output, StringPiece str)
+{
+    output->append("+", 1);
+    output->append(str.data(), str.size());
+    output->append("\r\n", 2);
+}
+
+void RespCodec::appendError(Buffer *output, StringPiece message)
+{
+    output->append("-", 1);
+    output->append(message.data(), message.size());
+    output->append("\r\n", 2);
+}
+
+void RespCodec::appendInteger(Buffer *output, int64_t value)
+{
+    appendLine(output, ':', value);
+}
+
+void RespCodec::appendBulkString(Buffer *output, StringPiece str)
+{
+    appendLine(output, '$', static_cast<int64_t>(str.size()));
+    output->append(str.data(), str.size());
+    output->append("\r\n", 2);
+}
+
+void RespCodec::appendNullBulkString(Buffer *output)
+{
+    output->append("$-1\r\n", 5);
+}
+
+void RespCodec::appendArrayHeader(Buffer *output, size_t count)
+{
+    appendLine(output, '*', static_cast<int64_t>(count));
+}
+
+void RespCodec::appendCommand(Buffer *output, const std::vector<StringPiece> &args)
+{
+    appendArrayHeader(output, args.size());
+    for (const StringPiece &arg : args)
+    {
+        appendBulkString(output, arg);
+    }
+}
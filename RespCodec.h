@@ -0,0 +1,66 @@
+#pragma once
+
+#include "StringPiece.h"
+
+#include <string>
+#include <vector>
+#include <stddef.h>
+#include <stdint.h>
+
+class Buffer;
+
+/**
+ * Redis 协议（RESP2）的解析和编码。
+ * 解析不保存状态：每次从数据开头解析一个完整的命令或回复，参数是指向输入数据的视图，不拷贝；
+ * 数据不完整时返回 kNeedMore，收到更多数据后从头再解析。批量字符串带长度，重新解析只需要逐个跳过参数，
+ * 不会重新扫描参数内容。一次 onMessage 中循环调用即可处理所有流水线命令。
+ * 编码函数直接追加到 Buffer（通常是连接的 outputBuffer），不经过临时字符串。
+ */
+class RespCodec
+{
+public:
+    enum ParseResult
+    {
+        kNeedMore,
+        kGotMessage,
+        kProtocolError,
+    };
+
+    enum ReplyType
+    {
+        kSimpleString,      // +OK
+        kError,             // -ERR ...
+        kInteger,           // :1
+        kBulkString,        // $3\r\nfoo
+        kNullBulkString,    // $-1
+        kArray,             // *2 ...，元素不单独返回
+        kNullArray,         // *-1
+    };
+
+    struct Reply
+    {
+        ReplyType type;
+        StringPiece str;    // kSimpleString / kError / kBulkString 的内容
+        int64_t integer;    // kInteger 的值，kArray 的元素个数
+        size_t length;      // 整个回复（包括嵌套的元素）的编码长度
+    };
+
+    // 单个批量字符串和数组元素个数的上限，和 Redis 的默认值一致
+    static const size_t kMaxBulkLength = 512 * 1024 * 1024;
+    static const size_t kMaxArgs = 1024 * 1024;
+
+    // 服务端解析一个命令：批量字符串数组，或者以空白分隔的内联命令（telnet）。
+    // args 被清空后填入参数视图，length 是命令的编码长度
+    static ParseResult parseCommand(const char *data, size_t len, std::vector<StringPiece> *args, size_t *length);
+    // 客户端解析一个回复
+    static ParseResult parseReply(const char *data, size_t len, Reply *reply);
+
+    static void appendSimpleString(Buffer *output, StringPiece str);
+    static void appendError(Buffer *output, StringPiece message);
+    static void appendInteger(Buffer *output, int64_t value);
+    static void appendBulkString(Buffer *output, StringPiece str);
+    static void appendNullBulkString(Buffer *output);
+    static void appendArrayHeader(Buffer *output, size_t count);
+    // 客户端编码一个命令：批量字符串数组
+    static void appendCommand(Buffer *output, const std::vector<StringPiece> &args);
+};
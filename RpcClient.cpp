@@ -0,0 +1,211 @@
+#include "RpcClient.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+#include "OutputBatch.h"
+#include "Logger.h"
+
+#include <memory>
+
+RpcClient::RpcClient(EventLoop *loop, const InetAddress &serverAddr, const std::string &name,
+                     double checkInterval)
+    : loop_(loop)
+    , client_(loop, serverAddr, name)
+    , maxPayload_(RpcCodec::kDefaultMaxPayload)
+    , nextRequestId_(1)
+{
+    client_.setConnectionCallback(std::bind(&RpcClient::onConnection, this, std::placeholders::_1));
+    client_.setMessageCallback(std::bind(&RpcClient::onMessage, this,
+        std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    timer_ = loop_->runEvery(checkInterval, std::bind(&RpcClient::checkTimeouts, this));
+}
+
+RpcClient::~RpcClient()
+{
+    loop_->cancel(timer_);
+    if (conn_)
+    {
+        // 连接比 RpcClient 活得长，之后的回调不能再指向 this
+        conn_->setConnectionCallback([](const TcpConnectionPtr&) {});
+        conn_->setMessageCallback([](const TcpConnectionPtr&, Buffer *buf, Timestamp) { buf->retrieveAll(); });
+    }
+    failAll(RpcCodec::kDisconnected);
+}
+
+bool RpcClient::connected() const
+{
+    TcpConnectionPtr conn = client_.connection();
+    return conn && conn->connected();
+}
+
+void RpcClient::call(uint16_t method, StringPiece request, double timeout, const ResponseCallback &cb)
+{
+    EventLoop *callerLoop = EventLoop::getEventLoopOfCurrentThread();
+    if (callerLoop && callerLoop != loop_)
+    {
+        startCall(method, request, timeout, std::bind(&RpcClient::completeIn, callerLoop, cb,
+            std::placeholders::_1, std::placeholders::_2));
+    }
+    else
+    {
+        startCall(method, request, timeout, cb);
+    }
+}
+
+std::future<RpcClient::Result> RpcClient::call(uint16_t method, StringPiece request, double timeout)
+{
+    std::shared_ptr<std::promise<Result>> promise = std::make_shared<std::promise<Result>>();
+    std::future<Result> future = promise->get_future();
+    // promise 可以在任意线程设置，不必转回调用方的 loop；调用方可能正阻塞在自己的 loop 线程中等待
+    startCall(method, request, timeout, [promise](RpcCodec::Status status, StringPiece payload) {
+        promise->set_value(Result{status, payload.toString()});
+    });
+    return future;
+}
+
+void RpcClient::completeIn(EventLoop *callerLoop, const ResponseCallback &cb,
+                           RpcCodec::Status status, StringPiece payload)
+{
+    // 同一个客户端 loop 连续转给同一个调用方 loop 的结果合并成一次唤醒
+    callerLoop->runInLoopBatched(std::bind(&RpcClient::runCallback, cb, status, payload.toString()));
+}
+
+void RpcClient::runCallback(const ResponseCallback &cb, RpcCodec::Status status, const std::string &payload)
+{
+    cb(status, payload);
+}
+
+void RpcClient::startCall(uint16_t method, StringPiece request, double timeout, const ResponseCallback &cb)
+{
+    int64_t deadline = 0;
+    if (timeout > 0)
+    {
+        deadline = addTime(Timestamp::now(), timeout).microSecondsSinceEpoch();
+    }
+    if (loop_->isInLoopThread())
+    {
+        callInLoop(method, request, deadline, cb);
+    }
+    else
+    {
+        loop_->runInLoopBatched(std::bind(&RpcClient::callQueued, this, method, request.toString(), deadline, cb));
+    }
+}
+
+void RpcClient::callQueued(uint16_t method, const std::string &request, int64_t deadline,
+                           const ResponseCallback &cb)
+{
+    callInLoop(method, request, deadline, cb);
+}
+
+void RpcClient::callInLoop(uint16_t method, StringPiece request, int64_t deadline, const ResponseCallback &cb)
+{
+    if (!conn_ || !conn_->connected())
+    {
+        cb(RpcCodec::kDisconnected, StringPiece());
+        return;
+    }
+
+    const uint64_t requestId = nextRequestId_++;
+    Call &call = calls_[requestId];
+    call.callback = cb;
+    call.deadline = deadline > 0 ? deadlines_.insert(Deadline(deadline, requestId)).first : deadlines_.end();
+
+    RpcCodec::append(conn_->outputBuffer(), method, RpcCodec::kRequest, RpcCodec::kOk, requestId, request);
+    OutputBatch::flush(conn_);
+}
+
+void RpcClient::onConnection(const TcpConnectionPtr &conn)
+{
+    LOG_INFO("RpcClient - %s -> %s is %s \n", conn->localAddress().toIpPort().c_str(),
+        conn->peerAddress().toIpPort().c_str(), conn->connected() ? "UP" : "DOWN");
+    if (conn->connected())
+    {
+        conn_ = conn;
+    }
+    else
+    {
+        if (conn_ == conn)
+        {
+            conn_.reset();
+        }
+        failAll(RpcCodec::kDisconnected);
+    }
+    if (connectionCallback_)
+    {
+        connectionCallback_(conn);
+    }
+}
+
+void RpcClient::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    // 响应回调里发起的调用先编码进 outputBuffer，这一批响应全部处理完以后统一发送
+    OutputBatch batch(conn);
+    while (true)
+    {
+        RpcCodec::Header header;
+        StringPiece payload;
+        RpcCodec::ParseResult result = RpcCodec::parse(buf, maxPayload_, &header, &payload);
+        if (result == RpcCodec::kNeedMore)
+        {
+            if (buf->readableBytes() >= RpcCodec::kHeaderLength)
+            {
+                buf->reserveIncoming(RpcCodec::kHeaderLength + header.length - buf->readableBytes());
+            }
+            break;
+        }
+        if (result == RpcCodec::kProtocolError || header.type != RpcCodec::kResponse)
+        {
+            LOG_ERROR("RpcClient::onMessage [%s] invalid frame type=%d length=%u \n",
+                conn->name().c_str(), (int)header.type, header.length);
+            buf->retrieveAll();
+            conn->forceClose();
+            return;
+        }
+
+        auto it = calls_.find(header.requestId);
+        // 找不到的是已经超时的调用
+        if (it != calls_.end())
+        {
+            ResponseCallback cb;
+            cb.swap(it->second.callback);
+            if (it->second.deadline != deadlines_.end())
+            {
+                deadlines_.erase(it->second.deadline);
+            }
+            calls_.erase(it);
+            cb(static_cast<RpcCodec::Status>(header.status), payload);
+        }
+        buf->retrieve(payload.size());
+    }
+}
+
+void RpcClient::checkTimeouts()
+{
+    const int64_t now = Timestamp::now().microSecondsSinceEpoch();
+    while (!deadlines_.empty() && deadlines_.begin()->first <= now)
+    {
+        const uint64_t requestId = deadlines_.begin()->second;
+        deadlines_.erase(deadlines_.begin());
+        auto it = calls_.find(requestId);
+        if (it == calls_.end())
+        {
+            continue;
+        }
+        ResponseCallback cb;
+        cb.swap(it->second.callback);
+        calls_.erase(it);
+        cb(RpcCodec::kTimeout, StringPiece());
+    }
+}
+
+void RpcClient::failAll(RpcCodec::Status status)
+{
+    // 回调中可能发起新的调用，先把未完成的调用取出来
+    std::unordered_map<uint64_t, Call> calls;
+    calls.swap(calls_);
+    deadlines_.clear();
+    for (auto &item : calls)
+    {
+        item.second.callback(status, StringPiece());
+    }
+}
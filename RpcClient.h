@@ -0,0 +1,94 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "TcpClient.h"
+#include "RpcCodec.h"
+#include "StringPiece.h"
+#include "TimerId.h"
+
+#include <functional>
+#include <future>
+#include <set>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+/**
+ * 多路复用 RPC 客户端，和 RpcServer 配对使用。一条连接上可以同时有任意多个未完成的调用，
+ * 每个调用分配一个 requestId，响应按服务端的完成顺序返回，按 requestId 找到对应的调用。
+ * call 可以在任意线程调用，回调回到发起调用的线程的 EventLoop 中执行，调用方不必自己转线程；
+ * 发起调用的线程没有 EventLoop 时，回调在客户端所在的 loop 线程执行。
+ * 每个调用可以指定超时时间，截止时间在调用时计算，由周期性的定时器检查，精度为 checkInterval；
+ * 超时以后到达的响应被丢弃。连接断开时所有未完成的调用以 kDisconnected 结束。
+ */
+class RpcClient : noncopyable
+{
+public:
+    struct Result
+    {
+        RpcCodec::Status status;
+        std::string payload;
+    };
+
+    // status 不是 kOk 时 payload 是错误信息或者为空；payload 只在回调期间有效
+    using ResponseCallback = std::function<void (RpcCodec::Status status, StringPiece payload)>;
+
+    RpcClient(EventLoop *loop, const InetAddress &serverAddr, const std::string &name,
+              double checkInterval = 0.01);
+    // 必须在 loop 线程析构，未完成的调用以 kDisconnected 结束
+    ~RpcClient();
+
+    EventLoop* getLoop() const { return loop_; }
+    // 用于设置 socket 选项、重连等，必须在 connect 之前
+    TcpClient* tcpClient() { return &client_; }
+    void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
+    void setMaxPayload(size_t bytes) { maxPayload_ = bytes; }
+
+    void connect() { client_.connect(); }
+    void disconnect() { client_.disconnect(); }
+    bool connected() const;
+
+    // 发起一次调用，timeout 秒以内没有收到响应时以 kTimeout 结束，timeout <= 0 表示不超时。
+    // 在其他线程调用时拷贝请求数据，转到 loop 线程发送。cb 在发起调用的线程的 EventLoop 中执行
+    // （不是客户端的 loop 时拷贝一份响应负载转过去），这个 EventLoop 要比调用活得长
+    void call(uint16_t method, StringPiece request, double timeout, const ResponseCallback &cb);
+    // 同上，通过 future 取得结果，结果在客户端的 loop 线程中设置。不要在客户端的 loop 线程中等待这个 future
+    std::future<Result> call(uint16_t method, StringPiece request, double timeout);
+
+    // 未完成的调用数，只能在 loop 线程调用
+    size_t inFlight() const { return calls_.size(); }
+
+private:
+    using Deadline = std::pair<int64_t, uint64_t>;    // (截止时间，微秒；requestId)
+
+    struct Call
+    {
+        ResponseCallback callback;
+        std::set<Deadline>::iterator deadline;      // 不超时的调用为 deadlines_.end()
+    };
+
+    // 计算截止时间，转到 loop 线程发送，cb 在客户端的 loop 线程中执行
+    void startCall(uint16_t method, StringPiece request, double timeout, const ResponseCallback &cb);
+    void callInLoop(uint16_t method, StringPiece request, int64_t deadline, const ResponseCallback &cb);
+    void callQueued(uint16_t method, const std::string &request, int64_t deadline, const ResponseCallback &cb);
+    // 在客户端的 loop 线程中收到结果，转到发起调用的 loop 执行 cb
+    static void completeIn(EventLoop *callerLoop, const ResponseCallback &cb,
+                           RpcCodec::Status status, StringPiece payload);
+    static void runCallback(const ResponseCallback &cb, RpcCodec::Status status, const std::string &payload);
+    void onConnection(const TcpConnectionPtr &conn);
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+    void checkTimeouts();
+    // 结束所有未完成的调用
+    void failAll(RpcCodec::Status status);
+
+    EventLoop *loop_;
+    TcpClient client_;
+    ConnectionCallback connectionCallback_;
+    size_t maxPayload_;
+    TimerId timer_;
+    // 以下只在 loop 线程访问
+    TcpConnectionPtr conn_;
+    uint64_t nextRequestId_;
+    std::unordered_map<uint64_t, Call> calls_;
+    std::set<Deadline> deadlines_;
+};
@@ -0,0 +1,57 @@
+#include "RpcCodec.h"
+#include "Buffer.h"
+
+RpcCodec::ParseResult RpcCodec::parse(Buffer *buf, size_t maxPayload, Header *header, StringPiece *payload)
+{
+    if (buf->readableBytes() < kHeaderLength)
+    {
+        return kNeedMore;
+    }
+    *header = Header();
+    header->length = static_cast<uint32_t>(buf->peekInt32());
+    if (header->length > maxPayload)
+    {
+        return kProtocolError;
+    }
+    if (buf->readableBytes() - kHeaderLength < header->length)
+    {
+        return kNeedMore;
+    }
+
+    buf->retrieve(sizeof(int32_t));
+    header->method = static_cast<uint16_t>(buf->readInt16());
+    header->type = static_cast<uint8_t>(buf->readInt8());
+    header->status = static_cast<uint8_t>(buf->readInt8());
+    header->requestId = static_cast<uint64_t>(buf->readInt64());
+    *payload = StringPiece(buf->peek(), header->length);
+    if (header->type != kRequest && header->type != kResponse)
+    {
+        return kProtocolError;
+    }
+    return kGotMessage;
+}
+
+void RpcCodec::append(Buffer *output, uint16_t method, Type type, Status status, uint64_t requestId,
+                      StringPiece payload)
+{
+    output->ensureWriteableBytes(kHeaderLength + payload.size());
+    output->appendInt32(static_cast<int32_t>(payload.size()));
+    output->appendInt16(static_cast<int16_t>(method));
+    output->appendInt8(static_cast<int8_t>(type));
+    output->appendInt8(static_cast<int8_t>(status));
+    output->appendInt64(static_cast<int64_t>(requestId));
+    output->append(payload.data(), payload.size());
+}
+
+const char* RpcCodec::statusName(Status status)
+{
+    switch (status)
+    {
+    case kOk: return "ok";
+    case kNoSuchMethod: return "no such method";
+    case kApplicationError: return "application error";
+    case kTimeout: return "timeout";
+    case kDisconnected: return "disconnected";
+    default: return "unknown";
+    }
+}
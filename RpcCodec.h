@@ -0,0 +1,66 @@
+#pragma once
+
+#include "StringPiece.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+class Buffer;
+
+/**
+ * 多路复用 RPC 的帧格式：16 字节定长头（网络字节序） + 负载
+ *   uint32 length     负载长度
+ *   uint16 method     方法号
+ *   uint8  type       kRequest / kResponse
+ *   uint8  status     响应的状态，请求中为 0
+ *   uint64 requestId  客户端分配，响应原样带回。一条连接上可以同时有多个请求，响应按完成顺序返回
+ * 解析不保存状态，每次从 Buffer 的可读数据开头解析一帧，负载是指向 Buffer 内部的视图，不拷贝。
+ */
+class RpcCodec
+{
+public:
+    enum ParseResult
+    {
+        kNeedMore,
+        kGotMessage,
+        kProtocolError,
+    };
+
+    enum Type
+    {
+        kRequest = 0,
+        kResponse = 1,
+    };
+
+    enum Status
+    {
+        kOk = 0,
+        kNoSuchMethod = 1,          // 服务端没有注册这个方法
+        kApplicationError = 2,      // 处理函数返回了错误，负载是错误信息
+        // 以下只在客户端本地产生，不出现在线路上
+        kTimeout = 100,             // 超过调用的截止时间没有收到响应
+        kDisconnected = 101,        // 连接断开，或者调用时还没有连接
+    };
+
+    struct Header
+    {
+        uint32_t length;
+        uint16_t method;
+        uint8_t type;
+        uint8_t status;
+        uint64_t requestId;
+    };
+
+    static const size_t kHeaderLength = 16;
+    static const size_t kDefaultMaxPayload = 64 * 1024 * 1024;
+
+    // 成功时从 buf 中取走帧头，填入 header 和指向 buf 中负载的 payload，调用方处理完负载以后
+    // buf->retrieve(payload->size())。帧还没有收全时返回 kNeedMore，不取走数据，收到了帧头的话
+    // header->length 是负载长度。负载超过 maxPayload 时返回 kProtocolError，不必等到数据收全
+    static ParseResult parse(Buffer *buf, size_t maxPayload, Header *header, StringPiece *payload);
+    // 编码一帧追加到 output
+    static void append(Buffer *output, uint16_t method, Type type, Status status, uint64_t requestId,
+                       StringPiece payload);
+
+    static const char* statusName(Status status);
+};
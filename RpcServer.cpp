@@ -0,0 +1,137 @@
+#include "RpcServer.h"
+#include "EventLoop.h"
+#include "EventLoopThreadPool.h"
+#include "Buffer.h"
+#include "OutputBatch.h"
+#include "Logger.h"
+
+void RpcServer::Reply::send(RpcCodec::Status status, StringPiece payload) const
+{
+    TcpConnectionPtr conn = conn_.lock();
+    if (!conn)
+    {
+        return;
+    }
+    if (conn->getLoop()->isInLoopThread())
+    {
+        if (!conn->connected())
+        {
+            return;
+        }
+        RpcCodec::append(conn->outputBuffer(), method_, RpcCodec::kResponse, status, requestId_, payload);
+        OutputBatch::flush(conn);
+    }
+    else
+    {
+        Buffer buf;
+        RpcCodec::append(&buf, method_, RpcCodec::kResponse, status, requestId_, payload);
+        conn->send(&buf);
+    }
+}
+
+RpcServer::RpcServer(EventLoop *loop,
+                    const InetAddress &listenAddr,
+                    const std::string &name,
+                    TcpServer::Option option)
+    : loop_(loop)
+    , name_(name)
+    , server_(loop, listenAddr, name, option)
+    , maxPayload_(RpcCodec::kDefaultMaxPayload)
+    , computeThreads_(0)
+    , nextCompute_(0)
+{
+    server_.setConnectionCallback(std::bind(&RpcServer::onConnection, this, std::placeholders::_1));
+    server_.setMessageCallback(std::bind(&RpcServer::onMessage, this,
+        std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+}
+
+RpcServer::~RpcServer()
+{
+}
+
+void RpcServer::registerMethod(uint16_t method, const Handler &handler, ExecutionMode mode)
+{
+    Method &m = methods_[method];
+    m.handler = handler;
+    m.mode = mode;
+}
+
+void RpcServer::start()
+{
+    if (computeThreads_ > 0 && !computePool_)
+    {
+        computePool_.reset(new EventLoopThreadPool(loop_, name_ + "-compute"));
+        computePool_->setThreadNum(computeThreads_);
+        computePool_->start();
+        computeLoops_ = computePool_->getAllLoops();
+    }
+    server_.start();
+}
+
+void RpcServer::onConnection(const TcpConnectionPtr &conn)
+{
+    LOG_INFO("RpcServer - %s -> %s is %s \n", conn->peerAddress().toIpPort().c_str(),
+        conn->localAddress().toIpPort().c_str(), conn->connected() ? "UP" : "DOWN");
+    if (conn->connected() && !computeLoops_.empty())
+    {
+        // 计算线程的回复逐个转到 IO loop，合并到循环末尾一次发送
+        conn->setAutoCork(true);
+    }
+}
+
+void RpcServer::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    // 处理函数里直接回复的响应先编码进 outputBuffer，这一批请求全部分发完以后统一发送
+    OutputBatch batch(conn);
+    while (true)
+    {
+        RpcCodec::Header header;
+        StringPiece payload;
+        RpcCodec::ParseResult result = RpcCodec::parse(buf, maxPayload_, &header, &payload);
+        if (result == RpcCodec::kNeedMore)
+        {
+            if (buf->readableBytes() >= RpcCodec::kHeaderLength)
+            {
+                // 帧还没有收全，为剩余部分预留空间（有上限），避免后续多次扩容
+                buf->reserveIncoming(RpcCodec::kHeaderLength + header.length - buf->readableBytes());
+            }
+            break;
+        }
+        if (result == RpcCodec::kProtocolError || header.type != RpcCodec::kRequest)
+        {
+            LOG_ERROR("RpcServer::onMessage [%s] invalid frame type=%d length=%u \n",
+                conn->name().c_str(), (int)header.type, header.length);
+            buf->retrieveAll();
+            conn->shutdown();
+            return;
+        }
+        dispatch(conn, header, payload);
+        buf->retrieve(payload.size());
+    }
+}
+
+void RpcServer::dispatch(const TcpConnectionPtr &conn, const RpcCodec::Header &header, StringPiece payload)
+{
+    Reply reply(conn, header.method, header.requestId);
+    auto it = methods_.find(header.method);
+    if (it == methods_.end())
+    {
+        reply.send(RpcCodec::kNoSuchMethod, StringPiece());
+        return;
+    }
+    const Method &method = it->second;
+    if (method.mode == kCompute && !computeLoops_.empty())
+    {
+        EventLoop *loop = computeLoops_[nextCompute_++ % computeLoops_.size()];
+        loop->runInLoopBatched(std::bind(&RpcServer::runHandler, method.handler, payload.toString(), reply));
+    }
+    else
+    {
+        method.handler(payload, reply);
+    }
+}
+
+void RpcServer::runHandler(const Handler &handler, const std::string &request, const Reply &reply)
+{
+    handler(request, reply);
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "TcpServer.h"
+#include "RpcCodec.h"
+#include "StringPiece.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class EventLoopThreadPool;
+
+/**
+ * 基于 TcpServer 的多路复用 RPC 服务器，帧格式见 RpcCodec。
+ * 一次 onMessage 解析出所有完整的请求帧，按方法号找到处理函数：
+ *   kInline   在连接所在的 IO loop 中直接调用，适合不阻塞的短小处理
+ *   kCompute  拷贝请求负载，投递到计算线程池中的一个 loop 执行，不占用 IO loop
+ * 处理函数通过 Reply 回复，可以立即回复，也可以保存 Reply 以后在任意线程回复，因此同一条连接上
+ * 的响应按完成顺序返回，客户端按 requestId 对应。分发期间在 IO loop 中产生的回复只编码进
+ * outputBuffer，这一批请求处理完以后统一发送一次；其他线程的回复经 TcpConnection::send 发送。
+ */
+class RpcServer : noncopyable
+{
+public:
+    enum ExecutionMode
+    {
+        kInline,
+        kCompute,
+    };
+
+    // 一个请求的回复句柄，可以拷贝，可以在任意线程使用，每个请求只应回复一次。
+    // 连接已经断开时回复被丢弃
+    class Reply
+    {
+    public:
+        Reply(const std::weak_ptr<TcpConnection> &conn, uint16_t method, uint64_t requestId)
+            : conn_(conn), method_(method), requestId_(requestId)
+        {}
+
+        void ok(StringPiece payload) const { send(RpcCodec::kOk, payload); }
+        void error(StringPiece message) const { send(RpcCodec::kApplicationError, message); }
+        void send(RpcCodec::Status status, StringPiece payload) const;
+
+        uint16_t method() const { return method_; }
+        uint64_t requestId() const { return requestId_; }
+
+    private:
+        std::weak_ptr<TcpConnection> conn_;
+        uint16_t method_;
+        uint64_t requestId_;
+    };
+
+    // request 只在调用期间有效；kCompute 的处理函数在计算线程中调用
+    using Handler = std::function<void (StringPiece request, const Reply &reply)>;
+
+    RpcServer(EventLoop *loop,
+            const InetAddress &listenAddr,
+            const std::string &name,
+            TcpServer::Option option = TcpServer::kNoReusePort);
+    ~RpcServer();
+
+    EventLoop* getLoop() const { return loop_; }
+    const std::string& name() const { return name_; }
+    // 用于设置 socket 选项、内存预算等，必须在 start 之前
+    TcpServer* tcpServer() { return &server_; }
+
+    // 以下设置必须在 start 之前完成
+    void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+    // 计算线程数，为 0 时 kCompute 的处理函数也在 IO loop 中直接调用
+    void setComputeThreadNum(int numThreads) { computeThreads_ = numThreads; }
+    void setMaxPayload(size_t bytes) { maxPayload_ = bytes; }
+    void registerMethod(uint16_t method, const Handler &handler, ExecutionMode mode = kInline);
+
+    void start();
+
+private:
+    struct Method
+    {
+        Handler handler;
+        ExecutionMode mode;
+    };
+
+    void onConnection(const TcpConnectionPtr &conn);
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+    void dispatch(const TcpConnectionPtr &conn, const RpcCodec::Header &header, StringPiece payload);
+    static void runHandler(const Handler &handler, const std::string &request, const Reply &reply);
+
+    EventLoop *loop_;
+    const std::string name_;
+    TcpServer server_;
+    // 方法表在 start 以后只读，IO 线程并发查找不加锁
+    std::unordered_map<uint16_t, Method> methods_;
+    size_t maxPayload_;
+    int computeThreads_;
+    // 声明在 server_ 之后，先于 IO loop 析构：计算线程退出之前投递的回复还能交给 IO loop
+    std::unique_ptr<EventLoopThreadPool> computePool_;
+    std::vector<EventLoop*> computeLoops_;
+    std::atomic<unsigned> nextCompute_;
+};
@@ -3,6 +3,7 @@
 #include <sys/socket.h>
 #include <strings.h>
 #include <netinet/tcp.h>
+#include <netinet/udp.h>
 #include <sys/socket.h>
 
 #include "Socket.h"
@@ -18,16 +19,16 @@ Socket::~Socket()
 // 绑定 socket 地址
 void Socket::bindAddress(const InetAddress &localaddr)
 {
-    if (0 != ::bind(sockfd_, (sockaddr*)localaddr.getSockAddr(), sizeof(sockaddr_in)))
+    if (0 != ::bind(sockfd_, localaddr.sockAddr(), localaddr.sockAddrLength()))
     {
         LOG_FATAL("bind sockfd:%d fail \n", sockfd_);
     }
 }
 
 // 开启套接字监听
-void Socket::listen()
+void Socket::listen(int backlog)
 {
-    if (0 != ::listen(sockfd_, 1024))
+    if (0 != ::listen(sockfd_, backlog))
     {
         LOG_FATAL("listen sockfd:%d fail \n", sockfd_);
     }
@@ -36,13 +37,13 @@ void Socket::listen()
 // 封装 socket 的 accept 函数
 int Socket::accept(InetAddress *peeraddr)
 {
-    sockaddr_in addr;
+    sockaddr_un addr;   // 能容纳 sockaddr_in 和 sockaddr_un
     socklen_t len = sizeof addr;
     bzero(&addr, sizeof addr);
     int connfd = ::accept4(sockfd_, (sockaddr*)&addr, &len, SOCK_NONBLOCK | SOCK_CLOEXEC);
     if (connfd >= 0)
     {
-        peeraddr->setSockAddr(addr);
+        *peeraddr = InetAddress((sockaddr*)&addr, len);
     }
     return connfd;
 }
@@ -76,9 +77,87 @@ void Socket::setReusePort(bool on)
     ::setsockopt(sockfd_, SOL_SOCKET, SO_REUSEPORT, &optval, sizeof optval);
 }
 
+// 设置 socket 的 SO_ZEROCOPY 选项，之后才能使用 MSG_ZEROCOPY 发送
+bool Socket::setZeroCopy(bool on)
+{
+    int optval = on ? 1 : 0;
+    return ::setsockopt(sockfd_, SOL_SOCKET, SO_ZEROCOPY, &optval, sizeof optval) == 0;
+}
+
 // 设置 socket 的 KEEPALIVE 选项
 void Socket::setKeepAlive(bool on)
 {
     int optval = on ? 1 : 0;
     ::setsockopt(sockfd_, SOL_SOCKET, SO_KEEPALIVE, &optval, sizeof optval);
-}
\ No newline at end of file
+}
+
+// 设置 socket 的接收缓冲区大小 SO_RCVBUF
+void Socket::setRecvBufferSize(int bytes)
+{
+    if (::setsockopt(sockfd_, SOL_SOCKET, SO_RCVBUF, &bytes, sizeof bytes) < 0)
+    {
+        LOG_ERROR("setsockopt SO_RCVBUF sockfd:%d error \n", sockfd_);
+    }
+}
+
+// 设置 socket 的发送缓冲区大小 SO_SNDBUF
+void Socket::setSendBufferSize(int bytes)
+{
+    if (::setsockopt(sockfd_, SOL_SOCKET, SO_SNDBUF, &bytes, sizeof bytes) < 0)
+    {
+        LOG_ERROR("setsockopt SO_SNDBUF sockfd:%d error \n", sockfd_);
+    }
+}
+
+// 设置监听 socket 的 TCP_DEFER_ACCEPT 选项
+void Socket::setDeferAccept(int seconds)
+{
+    if (::setsockopt(sockfd_, IPPROTO_TCP, TCP_DEFER_ACCEPT, &seconds, sizeof seconds) < 0)
+    {
+        LOG_ERROR("setsockopt TCP_DEFER_ACCEPT sockfd:%d error \n", sockfd_);
+    }
+}
+
+// 设置监听 socket 的 TCP_FASTOPEN 选项
+void Socket::setFastOpen(int queueLength)
+{
+    if (::setsockopt(sockfd_, IPPROTO_TCP, TCP_FASTOPEN, &queueLength, sizeof queueLength) < 0)
+    {
+        LOG_ERROR("setsockopt TCP_FASTOPEN sockfd:%d error \n", sockfd_);
+    }
+}
+
+// 设置 socket 的 TCP_NOTSENT_LOWAT 选项
+void Socket::setNotSentLowat(int bytes)
+{
+    if (::setsockopt(sockfd_, IPPROTO_TCP, TCP_NOTSENT_LOWAT, &bytes, sizeof bytes) < 0)
+    {
+        LOG_ERROR("setsockopt TCP_NOTSENT_LOWAT sockfd:%d error \n", sockfd_);
+    }
+}
+
+// 设置 socket 的 TCP_QUICKACK 选项，只在下一次延迟确认之前有效
+void Socket::setQuickAck(bool on)
+{
+    int optval = on ? 1 : 0;
+    ::setsockopt(sockfd_, IPPROTO_TCP, TCP_QUICKACK, &optval, sizeof optval);
+}
+
+void Socket::setTcpCork(bool on)
+{
+    int optval = on ? 1 : 0;
+    ::setsockopt(sockfd_, IPPROTO_TCP, TCP_CORK, &optval, sizeof optval);
+}
+
+// 设置 UDP socket 的 UDP_SEGMENT 选项，作为没有单独指定分段大小的发送的默认值，0 表示不分段
+bool Socket::setUdpSegment(int segmentSize)
+{
+    return ::setsockopt(sockfd_, SOL_UDP, UDP_SEGMENT, &segmentSize, sizeof segmentSize) == 0;
+}
+
+// 设置 UDP socket 的 UDP_GRO 选项，之后一次读取可能包含多个数据报，分段大小由控制消息给出
+bool Socket::setUdpGro(bool on)
+{
+    int optval = on ? 1 : 0;
+    return ::setsockopt(sockfd_, SOL_UDP, UDP_GRO, &optval, sizeof optval) == 0;
+}
@@ -17,7 +17,7 @@ public:
     int fd() const { return sockfd_; }
     
     void bindAddress(const InetAddress &localaddr);
-    void listen();
+    void listen(int backlog = 1024);
     int accept(InetAddress *peeraddr);
 
     void shutdownWrite();
@@ -26,6 +26,19 @@ public:
     void setReuseAddr(bool on);
     void setReusePort(bool on);
     void setKeepAlive(bool on);
+    // 开启 SO_ZEROCOPY，内核不支持时返回 false
+    bool setZeroCopy(bool on);
+    void setRecvBufferSize(int bytes);
+    void setSendBufferSize(int bytes);
+    void setDeferAccept(int seconds);
+    void setFastOpen(int queueLength);
+    void setNotSentLowat(int bytes);
+    void setQuickAck(bool on);
+    // TCP_CORK：开启期间只发送满 MSS 的报文段，关闭时把剩余的数据一起发出
+    void setTcpCork(bool on);
+    // UDP socket 的 UDP_SEGMENT（GSO）和 UDP_GRO，内核不支持时返回 false
+    bool setUdpSegment(int segmentSize);
+    bool setUdpGro(bool on);
 
 private:
     const int sockfd_;    // 文件描述符
@@ -0,0 +1,58 @@
+#pragma once
+
+/**
+ * TcpServer 的 socket 选项，应用到监听 socket 以及每一个接受的连接。
+ * 缓冲区大小设置在监听 socket 上（必须在 listen 之前设置才能参与窗口扩大选项的协商），
+ * 接受的连接会继承；其余选项在连接建立时逐个设置。值为 0 表示不设置，使用系统默认值。
+ * SO_REUSEPORT 需要在 bind 之前设置，仍然由 TcpServer 构造函数的 Option 参数决定。
+ */
+struct SocketOptions
+{
+    SocketOptions()
+        : backlog(1024)
+        , deferAcceptSeconds(0)
+        , fastOpenQueue(0)
+        , recvBufferSize(0)
+        , sendBufferSize(0)
+        , tcpNoDelay(false)
+        , keepAlive(true)
+        , quickAck(false)
+        , notSentLowat(0)
+    {}
+
+    // 监听 socket
+    int backlog;                // listen 的 backlog
+    int deferAcceptSeconds;     // TCP_DEFER_ACCEPT：客户端发来数据后才完成 accept，只适合客户端先发言的协议
+    int fastOpenQueue;          // TCP_FASTOPEN 的队列长度，允许 SYN 中携带数据
+
+    // 监听 socket，接受的连接继承。显式设置以后内核不再自动调整缓冲区大小
+    int recvBufferSize;         // SO_RCVBUF
+    int sendBufferSize;         // SO_SNDBUF
+
+    // 接受的连接
+    bool tcpNoDelay;            // TCP_NODELAY，关闭 Nagle 算法
+    bool keepAlive;             // SO_KEEPALIVE
+    bool quickAck;              // TCP_QUICKACK，内核会自动恢复延迟确认，因此每次读取以后都要重新设置
+    int notSentLowat;           // TCP_NOTSENT_LOWAT，内核中未发送的数据少于该值时才报告可写
+
+    // 低延迟：关闭 Nagle 和延迟确认，限制内核中未发送的数据，避免请求排在大块数据后面
+    static SocketOptions lowLatency()
+    {
+        SocketOptions options;
+        options.tcpNoDelay = true;
+        options.quickAck = true;
+        options.notSentLowat = 16 * 1024;
+        options.fastOpenQueue = 256;
+        return options;
+    }
+
+    // 大块数据吞吐：保留 Nagle 合并小包，使用较大的收发缓冲区
+    static SocketOptions bulkThroughput()
+    {
+        SocketOptions options;
+        options.recvBufferSize = 4 * 1024 * 1024;
+        options.sendBufferSize = 4 * 1024 * 1024;
+        options.backlog = 4096;
+        return options;
+    }
+};
@@ -0,0 +1,82 @@
+#include "SplicePipe.h"
+#include "Logger.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// 管道默认容量，F_GETPIPE_SZ 不可用时使用
+static const size_t kDefaultPipeSize = 64*1024;
+
+SplicePipe::SplicePipe()
+    : readFd_(-1)
+    , writeFd_(-1)
+    , capacity_(kDefaultPipeSize)
+    , pending_(0)
+{
+    int fds[2];
+    if (::pipe2(fds, O_NONBLOCK | O_CLOEXEC) < 0)
+    {
+        LOG_ERROR("SplicePipe::SplicePipe pipe2 error:%d \n", errno);
+        return;
+    }
+    readFd_ = fds[0];
+    writeFd_ = fds[1];
+
+    int size = ::fcntl(writeFd_, F_GETPIPE_SZ);
+    if (size > 0)
+    {
+        capacity_ = static_cast<size_t>(size);
+    }
+}
+
+SplicePipe::~SplicePipe()
+{
+    if (valid())
+    {
+        ::close(readFd_);
+        ::close(writeFd_);
+    }
+}
+
+ssize_t SplicePipe::fill(int fd, int *saveErrno)
+{
+    if (pending_ >= capacity_)
+    {
+        *saveErrno = EAGAIN;
+        return -1;
+    }
+    ssize_t n = ::splice(fd, nullptr, writeFd_, nullptr, capacity_ - pending_,
+                        SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+    if (n < 0)
+    {
+        *saveErrno = errno;
+    }
+    else
+    {
+        pending_ += n;
+    }
+    return n;
+}
+
+ssize_t SplicePipe::drain(int fd, int *saveErrno)
+{
+    ssize_t total = 0;
+    while (pending_ > 0)
+    {
+        ssize_t n = ::splice(readFd_, nullptr, fd, nullptr, pending_,
+                            SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+        if (n <= 0)
+        {
+            if (n < 0 && errno != EAGAIN)
+            {
+                *saveErrno = errno;
+                return -1;
+            }
+            break;  // socket 发送缓冲区已满
+        }
+        pending_ -= n;
+        total += n;
+    }
+    return total;
+}
@@ -0,0 +1,32 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <sys/types.h>
+
+/**
+ * 用于 splice 转发的管道：socket => 管道写端 => 管道读端 => socket，数据不经过用户态。
+ * 管道和 socket 都是非阻塞的，pending() 记录管道中还没有转发出去的字节数。
+ */
+class SplicePipe : noncopyable
+{
+public:
+    SplicePipe();
+    ~SplicePipe();
+
+    // 管道创建失败时为 false，调用方需要退化为普通的拷贝转发
+    bool valid() const { return readFd_ >= 0; }
+    size_t pending() const { return pending_; }
+    size_t capacity() const { return capacity_; }
+
+    // 从 fd 读取数据放入管道，返回 splice 的结果：>0 读到的字节数，0 对端关闭，<0 出错
+    ssize_t fill(int fd, int *saveErrno);
+    // 把管道中的数据尽量发送到 fd，返回本次发送的字节数，<0 出错
+    ssize_t drain(int fd, int *saveErrno);
+
+private:
+    int readFd_;
+    int writeFd_;
+    size_t capacity_;
+    size_t pending_;
+};
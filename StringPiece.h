@@ -0,0 +1,51 @@
+#pragma once
+
+#include <string>
+#include <string.h>
+#include <strings.h>
+
+/**
+ * 指向一段不属于自己的内存的只读视图（不拷贝），调用方负责保证内存在使用期间有效。
+ * 协议解析器用它引用 inputBuffer 中的数据。
+ */
+class StringPiece
+{
+public:
+    StringPiece()
+        : data_(nullptr), size_(0)
+    {}
+    StringPiece(const char *data, size_t size)
+        : data_(data), size_(size)
+    {}
+    StringPiece(const char *str)
+        : data_(str), size_(::strlen(str))
+    {}
+    StringPiece(const std::string &str)
+        : data_(str.data()), size_(str.size())
+    {}
+
+    const char* data() const { return data_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    const char* begin() const { return data_; }
+    const char* end() const { return data_ + size_; }
+    char operator[](size_t i) const { return data_[i]; }
+
+    std::string toString() const { return std::string(data_, size_); }
+
+    bool operator==(const StringPiece &other) const
+    {
+        return size_ == other.size_ && ::memcmp(data_, other.data_, size_) == 0;
+    }
+    bool operator!=(const StringPiece &other) const { return !(*this == other); }
+
+    // 只比较 ASCII 字母的大小写，用于协议中大小写不敏感的字段名和取值
+    bool equalsIgnoreCase(const StringPiece &other) const
+    {
+        return size_ == other.size_ && ::strncasecmp(data_, other.data_, size_) == 0;
+    }
+
+private:
+    const char *data_;
+    size_t size_;
+};
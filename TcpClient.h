@@ -0,0 +1,79 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Callbacks.h"
+#include "TcpConnection.h"
+#include "SocketOptions.h"
+
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+
+class Connector;
+class EventLoop;
+class TlsContext;
+
+/**
+ * TCP 客户端：在指定的 EventLoop 上主动连接 serverAddr，连接成功以后得到一个普通的 TcpConnection，
+ * 回调和 TcpServer 的连接完全相同。连接失败时由 Connector 按指数退避重试；
+ * enableRetry 以后，建立的连接断开时也会重新连接。同时最多只有一个连接。
+ */
+class TcpClient : noncopyable
+{
+public:
+    TcpClient(EventLoop *loop, const InetAddress &serverAddr, const std::string &nameArg);
+    ~TcpClient();
+
+    void connect();
+    // 关闭写端，连接断开以后不再重连
+    void disconnect();
+    // 停止正在进行的连接和重试，已经建立的连接不受影响
+    void stop();
+
+    TcpConnectionPtr connection() const
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        return connection_;
+    }
+
+    EventLoop* getLoop() const { return loop_; }
+    const std::string& name() const { return name_; }
+    bool retry() const { return retry_; }
+    // 建立的连接断开以后自动重新连接
+    void enableRetry() { retry_ = true; }
+
+    // 以下设置必须在 connect 之前调用
+    // 连接失败以后的重试间隔，从 initialSeconds 开始每次翻倍，不超过 maxSeconds
+    void setRetryDelay(double initialSeconds, double maxSeconds);
+    // 单次 connect 的超时时间，0 表示不设置
+    void setConnectTimeout(double seconds);
+    void setSocketOptions(const SocketOptions &options) { socketOptions_ = options; }
+    // 设置以后，连接建立时先完成 TLS 握手，需要 TlsContext::newClientContext 创建的上下文。
+    // serverName 是期望的服务端域名或者 IP 地址，用于 SNI 和证书校验；上下文校验证书时不能为空
+    void setTlsContext(const std::shared_ptr<TlsContext> &context, const std::string &serverName = std::string())
+    { tlsContext_ = context; tlsServerName_ = serverName; }
+
+    void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
+    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
+    void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
+
+private:
+    void newConnection(int sockfd);
+    void removeConnection(const TcpConnectionPtr &conn);
+
+    EventLoop *loop_;
+    std::shared_ptr<Connector> connector_;
+    const std::string name_;
+    ConnectionCallback connectionCallback_;
+    MessageCallback messageCallback_;
+    WriteCompleteCallback writeCompleteCallback_;
+    SocketOptions socketOptions_;
+    std::shared_ptr<TlsContext> tlsContext_;
+    std::string tlsServerName_;
+    std::atomic_bool retry_;
+    std::atomic_bool connect_;
+    int nextConnId_;                    // 只在 loop 线程访问
+    mutable std::mutex mutex_;
+    TcpConnectionPtr connection_;       // 由 mutex_ 保护
+};
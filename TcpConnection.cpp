@@ -1,17 +1,28 @@
 #include <functional>
 #include <errno.h>
+#include <fcntl.h>
 #include <sys/types.h>         
 #include <sys/socket.h>
 #include <strings.h>
 #include <netinet/tcp.h>
 #include <sys/socket.h>
 #include <string>
+#include <unistd.h>
 
 #include "TcpConnection.h"
 #include "Logger.h"
 #include "Socket.h"
 #include "Channel.h"
 #include "EventLoop.h"
+#include "SplicePipe.h"
+#include "MemoryBudget.h"
+#include "TlsContext.h"
+#include "TlsSession.h"
+
+// 拷贝转发时，转发目标的发送队列超过这个长度就暂停读取转发源
+static const size_t kRelayBufferLimit = 256*1024;
+// 一个 TLS 记录最多携带的明文长度
+static const size_t kTlsRecordSize = 16*1024;
 
 static EventLoop* CheckLoopNotNull(EventLoop *loop)
 {
@@ -32,58 +43,676 @@ TcpConnection::TcpConnection(EventLoop *loop,
     , name_(nameArg)
     , state_(kConnecting)
     , reading_(true)
+    , quickAck_(false)
     , socket_(new Socket(sockfd))
     , channel_(new Channel(loop, sockfd))
     , localAddr_(localAddr)
     , peerAddr_(peerAddr)
     , highWaterMark_(64*1024*1024) // 64M
+    , lowWaterMark_(0)
+    , aboveHighWaterMark_(false)
+    , backpressurePaused_(false)
+    , backpressureHigh_(0)
+    , backpressureLow_(0)
+    , memoryBudget_(nullptr)
+    , chargedBytes_(0)
+    , memoryPaused_(false)
+    , outputQueue_(&outputBuffer_)
+    , sendStats_()
+    , autoCork_(false)
+    , flushScheduled_(false)
+    , relaying_(false)
+    , relayEof_(false)
+    , relayPaused_(false)
+{
+    // 给 channel 设置相应的回调函数，poller 给 channel 通知感兴趣的事件发生，channel 会回调相应的操作函数。
+    channel_->setReadCallback(
+        std::bind(&TcpConnection::handleRead, this, std::placeholders::_1)
+    );
+    channel_->setWriteCallback(
+        std::bind(&TcpConnection::handleWrite, this)
+    );
+    channel_->setCloseCallback(
+        std::bind(&TcpConnection::handleClose, this)
+    );
+    channel_->setErrorCallback(
+        std::bind(&TcpConnection::handleError, this)
+    );
+
+    LOG_INFO("TcpConnection::ctor[%s] at fd=%d\n", name_.c_str(), sockfd);
+}
+
+// 析构函数
+TcpConnection::~TcpConnection()
+{
+    LOG_INFO("TcpConnection::dtor[%s] at fd=%d state=%d \n", 
+        name_.c_str(), channel_->fd(), (int)state_);
+    for (int fd : receivedFds_)
+    {
+        ::close(fd);
+    }
+}
+
+bool TcpConnection::sendFds(const std::vector<int> &fds, std::string message)
+{
+    if (!localAddr_.isUnix() || tlsContext_ || message.empty() || fds.size() > kMaxSendFds)
+    {
+        LOG_ERROR("TcpConnection::sendFds [%s] unsupported: unix=%d tls=%d bytes=%zu fds=%zu \n",
+            name_.c_str(), (int)localAddr_.isUnix(), (int)(tlsContext_ != nullptr), message.size(), fds.size());
+        return false;
+    }
+    if (state_ != kConnected)
+    {
+        return false;
+    }
+    std::vector<int> dups;
+    dups.reserve(fds.size());
+    for (int fd : fds)
+    {
+        int dupfd = ::fcntl(fd, F_DUPFD_CLOEXEC, 0);
+        if (dupfd < 0)
+        {
+            LOG_ERROR("TcpConnection::sendFds dup fd=%d error:%d \n", fd, errno);
+            for (int d : dups)
+            {
+                ::close(d);
+            }
+            return false;
+        }
+        dups.push_back(dupfd);
+    }
+    if (loop_->isInLoopThread())
+    {
+        sendFdsInLoop(dups, message);
+    }
+    else
+    {
+        loop_->runInLoopBatched(std::bind(&TcpConnection::sendFdsInLoop, shared_from_this(),
+            std::move(dups), std::move(message)));
+    }
+    return true;
+}
+
+void TcpConnection::sendFdsInLoop(std::vector<int> &fds, std::string &message)
+{
+    if (state_ == kDisconnected)
+    {
+        LOG_ERROR("disconnected, give up writing!");
+        for (int fd : fds)
+        {
+            ::close(fd);
+        }
+        fds.clear();
+        return;
+    }
+    size_t oldLen = outputQueue_.readableBytes();
+    outputQueue_.appendWithFds(std::move(message), std::move(fds));
+    fds.clear();
+    checkHighWaterMark(oldLen);
+    flushOutputBuffer();
+}
+
+std::vector<int> TcpConnection::takeReceivedFds()
+{
+    std::vector<int> fds;
+    fds.swap(receivedFds_);
+    return fds;
+}
+
+// 发送数据
+void TcpConnection::send(const std::string &buf)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendInLoop(buf.c_str(), buf.size());
+        }
+        else
+        {
+            // 调用方的 buf 在 loop 线程执行时可能已经失效，拷贝一份交给 loop 线程
+            send(std::string(buf));
+        }
+    }
+}
+
+// 接管 message 的内容发送，loop 线程中没能立即写出的部分直接由发送队列接管
+void TcpConnection::send(std::string &&message)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendStringInLoop(message);
+        }
+        else
+        {
+            loop_->runInLoopBatched(std::bind(&TcpConnection::sendStringInLoop, shared_from_this(), std::move(message)));
+        }
+    }
+}
+
+// 发送 Buffer 中的数据。在 loop 线程中直接从 buf 发送，不产生额外拷贝。
+void TcpConnection::send(Buffer *buf)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendInLoop(buf->peek(), buf->readableBytes());
+            buf->retrieveAll();
+        }
+        else
+        {
+            // 跨线程时 buf 的内容需要拷贝一份，交给 loop 线程发送
+            send(buf->retrieveAllAsString());
+        }
+    }
+}
+
+// 发送引用计数持有的只读数据，排队期间只保存引用，不拷贝
+void TcpConnection::send(const SharedString &message)
+{
+    send(SharedStringList(1, message));
+}
+
+// 按顺序发送多段数据，例如 响应头 + 响应体 + 共享的结尾，能立即写出的部分只需一次 writev
+void TcpConnection::send(const SharedStringList &messages)
+{
+    if (state_ == kConnected)
+    {
+        if (loop_->isInLoopThread())
+        {
+            sendSharedInLoop(messages);
+        }
+        else
+        {
+            loop_->runInLoopBatched(std::bind(&TcpConnection::sendSharedInLoop, shared_from_this(), messages));
+        }
+    }
+}
+
+// 发送文件中的一段数据
+void TcpConnection::sendFile(int fd, off_t offset, size_t length)
+{
+    if (state_ == kConnected)
+    {
+        int dupfd = ::dup(fd);
+        if (dupfd < 0)
+        {
+            LOG_ERROR("TcpConnection::sendFile dup fd=%d error:%d \n", fd, errno);
+            return;
+        }
+        if (loop_->isInLoopThread())
+        {
+            sendFileInLoop(dupfd, offset, length);
+        }
+        else
+        {
+            loop_->runInLoopBatched(std::bind(&TcpConnection::sendFileInLoop, shared_from_this(), dupfd, offset, length));
+        }
+    }
+}
+
+void TcpConnection::sendFileInLoop(int fd, off_t offset, size_t length)
+{
+    if (state_ == kDisconnected)
+    {
+        LOG_ERROR("disconnected, give up writing!");
+        ::close(fd);
+        return;
+    }
+    size_t oldLen = outputQueue_.readableBytes();
+    outputQueue_.appendFile(fd, offset, length);
+    checkHighWaterMark(oldLen);
+    // 前面没有排队的数据时马上开始 sendfile，发不完的部分等待 EPOLLOUT
+    flushOutputBuffer();
+}
+
+void TcpConnection::setZeroCopy(bool on, size_t threshold)
+{
+    loop_->runInLoopBatched(std::bind(&TcpConnection::setZeroCopyInLoop, shared_from_this(), on, threshold));
+}
+
+void TcpConnection::setZeroCopyInLoop(bool on, size_t threshold)
+{
+    // 已经开启过的 socket 关闭零拷贝时不需要清除 SO_ZEROCOPY，只是不再使用 MSG_ZEROCOPY
+    if (on && !socket_->setZeroCopy(true))
+    {
+        LOG_ERROR("TcpConnection::setZeroCopy [%s] SO_ZEROCOPY not supported:%d \n", name_.c_str(), errno);
+        return;
+    }
+    outputQueue_.setZeroCopy(on, threshold);
+}
+
+void TcpConnection::setAutoCork(bool on)
+{
+    loop_->runInLoopBatched(std::bind(&TcpConnection::setAutoCorkInLoop, shared_from_this(), on));
+}
+
+void TcpConnection::setAutoCorkInLoop(bool on)
+{
+    autoCork_ = on;
+    // 关闭时已经登记的合并发送照常执行
+}
+
+// 发送队列中有数据等待发送：合并模式下登记到本轮循环末尾发送，否则等待 EPOLLOUT
+void TcpConnection::scheduleWrite()
+{
+    if (autoCork_)
+    {
+        if (!flushScheduled_)
+        {
+            flushScheduled_ = true;
+            loop_->runAtIterationEnd(std::bind(&TcpConnection::flushCorked, shared_from_this()));
+        }
+    }
+    else if (!channel_->isWriting())
+    {
+        channel_->enableWriting(); // 这里一定要注册channel的写事件，否则poller不会给channel通知epollout
+    }
+}
+
+// 本轮循环末尾，把合并的数据一次发送出去
+void TcpConnection::flushCorked()
+{
+    flushScheduled_ = false;
+    if (state_ == kDisconnected)
+    {
+        return;
+    }
+    outputQueue_.syncBuffer();
+    if (outputQueue_.empty())
+    {
+        // 合并期间调用的 shutdown 在等待这次发送，数据已经被其他路径发完
+        if (state_ == kDisconnecting)
+        {
+            shutdownInLoop();
+        }
+        return;
+    }
+    // 排空以后由 writeOutputQueue 执行等待中的 shutdown
+    writeOutputQueue();
+}
+
+// message 是 loop 线程 functor 中保存的副本，没有写完的部分可以直接由发送队列接管
+void TcpConnection::sendStringInLoop(std::string &message)
+{
+    if (state_ == kDisconnected)
+    {
+        LOG_ERROR("disconnected, give up writing!");
+        return;
+    }
+    bool faultError = false;
+    size_t nwrote = writeDirectly(message.data(), message.size(), &faultError);
+    size_t remaining = message.size() - nwrote;
+    if (!faultError && remaining > 0)
+    {
+        size_t oldLen = outputQueue_.readableBytes();
+        if (nwrote == 0)
+        {
+            outputQueue_.appendOwned(std::move(message));
+        }
+        else
+        {
+            outputQueue_.appendCopy(message.data() + nwrote, remaining);
+        }
+        checkHighWaterMark(oldLen);
+        scheduleWrite();
+    }
+}
+
+void TcpConnection::sendSharedInLoop(const SharedStringList &messages)
+{
+    if (state_ == kDisconnected)
+    {
+        LOG_ERROR("disconnected, give up writing!");
+        return;
+    }
+    size_t oldLen = outputQueue_.readableBytes();
+    for (const SharedString &message : messages)
+    {
+        if (message)
+        {
+            outputQueue_.appendShared(message, message->data(), message->size());
+        }
+    }
+    checkHighWaterMark(oldLen);
+    // 如果已经在等待 EPOLLOUT，由 handleWrite 发送；否则马上用一次 writev 发送
+    flushOutputBuffer();
+}
+
+// 用户已经把数据写入 outputBuffer_，如果 channel 还没有注册写事件，就先尝试直接发送，
+// 剩余的数据再注册 EPOLLOUT 由 handleWrite 发送。合并模式下推迟到本轮循环末尾发送。
+void TcpConnection::flushOutputBuffer()
+{
+    if (autoCork_)
+    {
+        outputQueue_.syncBuffer();
+        if (!outputQueue_.empty())
+        {
+            scheduleWrite();
+        }
+        return;
+    }
+    writeOutputQueue();
+}
+
+void TcpConnection::appendOutput(const SharedString &message)
+{
+    if (!message)
+    {
+        return;
+    }
+    size_t oldLen = outputQueue_.readableBytes();
+    outputQueue_.appendShared(message, message->data(), message->size());
+    checkHighWaterMark(oldLen);
+}
+
+void TcpConnection::writeOutputQueue()
+{
+    outputQueue_.syncBuffer();
+    // 已经在等待 EPOLLOUT 的话，数据会由 handleWrite 统一发送
+    if (channel_->isWriting() || outputQueue_.empty())
+    {
+        return;
+    }
+    if (state_ == kDisconnected)
+    {
+        LOG_ERROR("disconnected, give up writing!");
+        return;
+    }
+
+    int savedErrno = 0;
+    ssize_t n = writeQueue(&savedErrno);
+    ++sendStats_.writeCalls;
+    if (n > 0)
+    {
+        checkLowWaterMark();
+    }
+    if (n < 0 && savedErrno != EWOULDBLOCK)
+    {
+        errno = savedErrno;
+        LOG_ERROR("TcpConnection::writeOutputQueue");
+        if (savedErrno == EPIPE || savedErrno == ECONNRESET)
+        {
+            return;
+        }
+    }
+
+    if (outputQueue_.empty())
+    {
+        if (writeCompleteCallback_)
+        {
+            loop_->queueInLoop(
+                std::bind(writeCompleteCallback_, shared_from_this())
+            );
+        }
+        // 数据发送完以后再执行之前因为发送队列不空而推迟的 shutdown
+        if (state_ == kDisconnecting)
+        {
+            shutdownInLoop();
+        }
+    }
+    else
+    {
+        channel_->enableWriting();
+    }
+}
+
+// 发送队列中的数据写入 socket，用户态 TLS 经 SSL_write 加密
+ssize_t TcpConnection::writeQueue(int *saveErrno)
+{
+    if (tlsWrite_)
+    {
+        // 每个 TLS 记录都是一次单独的 write，产生一个不满 MSS 的报文段，受 Nagle 算法和对端延迟确认的影响
+        // 会停顿几十毫秒。多个记录在 TCP_CORK 期间写出，合并成满 MSS 的报文段，最后一起推送。
+        bool cork = outputQueue_.readableBytes() > kTlsRecordSize;
+        if (cork)
+        {
+            socket_->setTcpCork(true);
+        }
+        ssize_t n = outputQueue_.writeWith(tlsWrite_, saveErrno);
+        if (cork)
+        {
+            socket_->setTcpCork(false);
+        }
+        return n;
+    }
+    return outputQueue_.writeFd(channel_->fd(), saveErrno);
+}
+
+// 发送队列为空时，不经过队列直接 write，返回写出的字节数
+size_t TcpConnection::writeDirectly(const void *data, size_t len, bool *faultError)
+{
+    outputQueue_.syncBuffer();
+    // 表示channel_第一次开始写数据，而且缓冲区没有待发送数据；合并模式下一律先进入发送队列
+    if (autoCork_ || channel_->isWriting() || !outputQueue_.empty())
+    {
+        return 0;
+    }
+
+    ssize_t nwrote;
+    if (tlsWrite_)
+    {
+        // 没有写完的部分进入发送队列，下次 SSL_write 从同样的数据开始重试
+        int savedErrno = 0;
+        bool cork = len > kTlsRecordSize;   // 同 writeQueue
+        if (cork)
+        {
+            socket_->setTcpCork(true);
+        }
+        nwrote = tlsWrite_(data, len, &savedErrno);
+        if (cork)
+        {
+            socket_->setTcpCork(false);
+        }
+        errno = savedErrno;
+    }
+    else
+    {
+        nwrote = ::write(channel_->fd(), data, len);
+    }
+    ++sendStats_.writeCalls;
+    if (nwrote >= 0)
+    {
+        if (static_cast<size_t>(nwrote) == len && writeCompleteCallback_)
+        {
+            // 既然在这里数据全部发送完成，就不用再给channel设置epollout事件了
+            loop_->queueInLoop(
+                std::bind(writeCompleteCallback_, shared_from_this())
+            );
+        }
+        return nwrote;
+    }
+
+    if (errno != EWOULDBLOCK)
+    {
+        LOG_ERROR("TcpConnection::sendInLoop");
+        if (errno == EPIPE || errno == ECONNRESET) // SIGPIPE  RESET
+        {
+            *faultError = true;
+        }
+    }
+    return 0;
+}
+
+// 发送队列的长度从 oldLen 增长后，如果刚刚越过高水位线，就通知用户
+void TcpConnection::checkHighWaterMark(size_t oldLen)
+{
+    size_t newLen = outputQueue_.readableBytes();
+    if (newLen >= highWaterMark_ && oldLen < highWaterMark_)
+    {
+        aboveHighWaterMark_ = true;
+        if (highWaterMarkCallback_)
+        {
+            loop_->queueInLoop(
+                std::bind(highWaterMarkCallback_, shared_from_this(), newLen)
+            );
+        }
+    }
+    updateBackpressure();
+    updateMemory();
+}
+
+// 发送队列变短以后，检查低水位线和背压
+void TcpConnection::checkLowWaterMark()
+{
+    size_t len = outputQueue_.readableBytes();
+    if (aboveHighWaterMark_ && len <= lowWaterMark_)
+    {
+        aboveHighWaterMark_ = false;
+        if (lowWaterMarkCallback_)
+        {
+            loop_->queueInLoop(
+                std::bind(lowWaterMarkCallback_, shared_from_this(), len)
+            );
+        }
+    }
+    updateBackpressure();
+    updateMemory();
+}
+
+void TcpConnection::setMemoryBudget(MemoryBudget *budget)
+{
+    if (memoryBudget_ != nullptr)
+    {
+        memoryBudget_->charge(-static_cast<ssize_t>(chargedBytes_));
+        chargedBytes_ = 0;
+    }
+    memoryBudget_ = budget;
+    updateMemory();
+}
+
+// 把缓冲区用量的变化计入内存预算，用量没有变化时只有一次比较
+void TcpConnection::updateMemory()
+{
+    if (memoryBudget_ == nullptr)
+    {
+        return;
+    }
+    size_t bytes = state_ == kDisconnected ? 0 : memoryBytes();
+    if (bytes != chargedBytes_)
+    {
+        memoryBudget_->charge(static_cast<ssize_t>(bytes) - static_cast<ssize_t>(chargedBytes_));
+        chargedBytes_ = bytes;
+    }
+}
+
+void TcpConnection::setMemoryPaused(bool paused)
 {
-    // 给 channel 设置相应的回调函数，poller 给 channel 通知感兴趣的事件发生，channel 会回调相应的操作函数。
-    channel_->setReadCallback(
-        std::bind(&TcpConnection::handleRead, this, std::placeholders::_1)
-    );
-    channel_->setWriteCallback(
-        std::bind(&TcpConnection::handleWrite, this)
-    );
-    channel_->setCloseCallback(
-        std::bind(&TcpConnection::handleClose, this)
-    );
-    channel_->setErrorCallback(
-        std::bind(&TcpConnection::handleError, this)
-    );
+    memoryPaused_ = paused;
+    updateReading();
+}
 
-    LOG_INFO("TcpConnection::ctor[%s] at fd=%d\n", name_.c_str(), sockfd);
-    socket_->setKeepAlive(true);
+void TcpConnection::startRead()
+{
+    loop_->runInLoopBatched(std::bind(&TcpConnection::startReadInLoop, shared_from_this()));
 }
 
-// 析构函数
-TcpConnection::~TcpConnection()
+void TcpConnection::stopRead()
 {
-    LOG_INFO("TcpConnection::dtor[%s] at fd=%d state=%d \n", 
-        name_.c_str(), channel_->fd(), (int)state_);
+    loop_->runInLoopBatched(std::bind(&TcpConnection::stopReadInLoop, shared_from_this()));
 }
 
-// 发送数据
-void TcpConnection::send(const std::string &buf)
+void TcpConnection::startReadInLoop()
 {
-    if (state_ == kConnected)
+    reading_ = true;
+    updateReading();
+}
+
+void TcpConnection::stopReadInLoop()
+{
+    reading_ = false;
+    updateReading();
+}
+
+// 用户希望读取、并且没有因为背压或者转发暂停时，才监听 EPOLLIN
+void TcpConnection::updateReading()
+{
+    // 连接建立时由 connectEstablished 开始读取
+    if (state_ == kDisconnected || state_ == kConnecting)
     {
-        if (loop_->isInLoopThread())
+        return;
+    }
+    bool want = reading_ && !backpressurePaused_ && !relayPaused_ && !memoryPaused_;
+    if (want && !channel_->isReading())
+    {
+        channel_->enableReading();
+    }
+    else if (!want && channel_->isReading())
+    {
+        channel_->disableReading();
+    }
+}
+
+void TcpConnection::setReadBackpressure(size_t highMark, size_t lowMark, const TcpConnectionPtr &peer)
+{
+    backpressureHigh_ = highMark;
+    backpressureLow_ = lowMark < highMark ? lowMark : highMark;
+    backpressurePeer_.reset();
+    if (peer)
+    {
+        if (peer->getLoop() != loop_)
         {
-            sendInLoop(buf.c_str(), buf.size());
+            LOG_ERROR("TcpConnection::setReadBackpressure [%s] peer must be in the same loop \n", name_.c_str());
         }
         else
         {
-            loop_->runInLoop(std::bind(&TcpConnection::sendInLoop, this, buf.c_str(), buf.size()));
+            backpressurePeer_ = peer;
+            peer->backpressureSource_ = shared_from_this();
+        }
+    }
+    if (highMark == 0 && backpressurePaused_)
+    {
+        backpressurePaused_ = false;
+        updateReading();
+    }
+    updateBackpressure();
+}
+
+// 本连接的发送队列长度变化以后调用：重新判断本连接以及把本连接作为 peer 的连接是否需要暂停读取
+void TcpConnection::updateBackpressure()
+{
+    if (!backpressureSource_.expired())
+    {
+        TcpConnectionPtr source = backpressureSource_.lock();
+        if (source)
+        {
+            source->checkBackpressure();
         }
     }
+    checkBackpressure();
+}
+
+void TcpConnection::checkBackpressure()
+{
+    if (backpressureHigh_ == 0)
+    {
+        return;
+    }
+
+    size_t pending = outputQueue_.readableBytes();
+    TcpConnectionPtr peer = backpressurePeer_.lock();
+    if (peer && peer->outputQueue_.readableBytes() > pending)
+    {
+        pending = peer->outputQueue_.readableBytes();
+    }
+    if (!backpressurePaused_ && pending >= backpressureHigh_)
+    {
+        backpressurePaused_ = true;
+        updateReading();
+    }
+    else if (backpressurePaused_ && pending <= backpressureLow_)
+    {
+        backpressurePaused_ = false;
+        updateReading();
+    }
 }
 
 // 若在相同线程，调用此函数发送数据。
 void TcpConnection::sendInLoop(const void* data, size_t len)
 {
-    ssize_t nwrote = 0;
-    size_t remaining = len;
     bool faultError = false;
     // 之前调用过该connection的shutdown，不能再进行发送了
     if (state_ == kDisconnected)
@@ -91,73 +720,235 @@ void TcpConnection::sendInLoop(const void* data, size_t len)
         LOG_ERROR("disconnected, give up writing!");
         return;
     }
-    // 表示channel_第一次开始写数据，而且缓冲区没有待发送数据
-    if (!channel_->isWriting() && outputBuffer_.readableBytes() == 0)
+    size_t nwrote = writeDirectly(data, len, &faultError);
+    size_t remaining = len - nwrote;
+    // 说明当前这一次write，并没有把数据全部发送出去，剩余的数据需要保存到发送队列当中，然后给channel
+    // 注册epollout事件，poller发现tcp的发送缓冲区有空间，会通知相应的sock-channel，调用writeCallback_回调方法
+    // 也就是调用TcpConnection::handleWrite方法，把发送队列中的数据全部发送完成
+    if (!faultError && remaining > 0) 
     {
-        nwrote = ::write(channel_->fd(), data, len);
-        if (nwrote >= 0)
+        // 目前发送队列剩余的待发送数据的长度
+        size_t oldLen = outputQueue_.readableBytes();
+        outputQueue_.appendCopy(static_cast<const char*>(data) + nwrote, remaining);
+        checkHighWaterMark(oldLen);
+        scheduleWrite();
+    }
+}
+
+// 关闭连接
+void TcpConnection::shutdown()
+{
+    if (state_ == kConnected)
+    {
+        setState(kDisconnecting);
+        // 和跨线程的 send 走同一个批次，保证之前提交的数据先于关闭写端
+        loop_->runInLoopBatched(
+            std::bind(&TcpConnection::shutdownInLoop, shared_from_this())
+        );
+    }
+}
+
+void TcpConnection::forceClose()
+{
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        setState(kDisconnecting);
+        loop_->runInLoopBatched(std::bind(&TcpConnection::forceCloseInLoop, shared_from_this()));
+    }
+}
+
+void TcpConnection::forceCloseInLoop()
+{
+    if (state_ == kConnected || state_ == kDisconnecting)
+    {
+        handleClose();
+    }
+}
+
+// 设置连接的 TCP_NODELAY 选项，关闭 Nagle 算法
+void TcpConnection::setTcpNoDelay(bool on)
+{
+    socket_->setTcpNoDelay(on);
+}
+
+bool TcpConnection::relayTo(const TcpConnectionPtr &peer)
+{
+    if (!loop_->isInLoopThread() || peer->getLoop() != loop_ || peer.get() == this)
+    {
+        LOG_ERROR("TcpConnection::relayTo [%s] peer must be another connection in the same loop \n", name_.c_str());
+        return false;
+    }
+    // splice 转发的是 socket 上的原始字节，不能用于需要加解密的连接
+    if (tlsContext_ || peer->tlsContext_)
+    {
+        LOG_ERROR("TcpConnection::relayTo [%s] TLS connections can not relay \n", name_.c_str());
+        return false;
+    }
+    relaying_ = true;
+    relayEof_ = false;
+    relayTarget_ = peer;
+    peer->relaySource_ = shared_from_this();
+    relayPipe_.reset(new SplicePipe);
+    if (!relayPipe_->valid())
+    {
+        relayPipe_.reset();
+    }
+    // 开始转发之前已经收到的数据先拷贝转发，它们在发送队列中，一定先于管道中的数据发出
+    if (inputBuffer_.readableBytes() > 0)
+    {
+        peer->send(&inputBuffer_);
+    }
+    return true;
+}
+
+// 转发模式下的读事件：socket => 管道 => 目标 socket
+void TcpConnection::handleRelayRead(const TcpConnectionPtr &target)
+{
+    int savedErrno = 0;
+    ssize_t n = -1;
+    if (relayPipe_)
+    {
+        n = relayPipe_->fill(channel_->fd(), &savedErrno);
+        if (n < 0 && savedErrno == EINVAL && relayPipe_->pending() == 0)
         {
-            remaining = len - nwrote;
-            if (remaining == 0 && writeCompleteCallback_)
-            {
-                // 既然在这里数据全部发送完成，就不用再给channel设置epollout事件了
-                loop_->queueInLoop(
-                    std::bind(writeCompleteCallback_, shared_from_this())
-                );
-            }
+            // socket 不支持 splice，改为拷贝转发
+            relayPipe_.reset();
         }
-        else // nwrote < 0
+    }
+    if (!relayPipe_)
+    {
+        n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+        if (n > 0)
         {
-            nwrote = 0;
-            if (errno != EWOULDBLOCK)
-            {
-                LOG_ERROR("TcpConnection::sendInLoop");
-                if (errno == EPIPE || errno == ECONNRESET) // SIGPIPE  RESET
-                {
-                    faultError = true;
-                }
-            }
+            target->send(&inputBuffer_);
         }
     }
-    // 说明当前这一次write，并没有把数据全部发送出去，剩余的数据需要保存到缓冲区当中，然后给channel
-    // 注册epollout事件，poller发现tcp的发送缓冲区有空间，会通知相应的sock-channel，调用writeCallback_回调方法
-    // 也就是调用TcpConnection::handleWrite方法，把发送缓冲区中的数据全部发送完成
-    if (!faultError && remaining > 0) 
+
+    if (n > 0 || (n < 0 && savedErrno == EAGAIN))
     {
-        // 目前发送缓冲区剩余的待发送数据的长度
-        size_t oldLen = outputBuffer_.readableBytes();
-        if (oldLen + remaining >= highWaterMark_
-            && oldLen < highWaterMark_
-            && highWaterMarkCallback_)
+        // 目标来不及发送（管道已满时 fill 也返回 EAGAIN），暂停读取，等它排空以后由 resumeRelay 恢复
+        if (target->drainRelay() > 0)
         {
-            loop_->queueInLoop(
-                std::bind(highWaterMarkCallback_, shared_from_this(), oldLen+remaining)
-            );
+            relayPaused_ = true;
+            updateReading();
         }
-        outputBuffer_.append((char*)data + nwrote, remaining);
+    }
+    else if (n == 0)
+    {
+        // 转发源关闭，管道中剩余的数据发送完以后再关闭本连接
+        if (target->drainRelay() > 0)
+        {
+            relayEof_ = true;
+            relayPaused_ = true;
+            updateReading();
+        }
+        else
+        {
+            handleClose();
+        }
+    }
+    else
+    {
+        errno = savedErrno;
+        LOG_ERROR("TcpConnection::handleRelayRead");
+        handleError();
+    }
+}
+
+// 作为转发目标：在发送队列排空的前提下，把源连接管道中的数据 splice 出去，
+// 返回还没有发出的转发数据的字节数，为 0 时通知源连接恢复读取。
+size_t TcpConnection::drainRelay()
+{
+    TcpConnectionPtr source = relaySource_.lock();
+    if (!source)
+    {
+        return 0;
+    }
+    size_t left = 0;
+    SplicePipe *pipe = source->relayPipe_.get();
+    if (pipe)
+    {
+        outputQueue_.syncBuffer();
+        // 发送队列中的数据更早，必须先发送
+        if (pipe->pending() > 0 && outputQueue_.empty())
+        {
+            int savedErrno = 0;
+            if (pipe->drain(channel_->fd(), &savedErrno) < 0)
+            {
+                errno = savedErrno;
+                LOG_ERROR("TcpConnection::drainRelay");
+            }
+        }
+        left = pipe->pending();
+    }
+    else if (outputQueue_.readableBytes() >= kRelayBufferLimit)
+    {
+        left = outputQueue_.readableBytes();
+    }
+
+    if (left > 0)
+    {
         if (!channel_->isWriting())
         {
-            channel_->enableWriting(); // 这里一定要注册channel的写事件，否则poller不会给channel通知epollout
+            channel_->enableWriting();
         }
     }
+    else
+    {
+        source->resumeRelay();
+    }
+    return left;
 }
 
-// 关闭连接
-void TcpConnection::shutdown()
+// 作为转发源：转发目标已经排空或者断开，恢复读取
+void TcpConnection::resumeRelay()
 {
-    if (state_ == kConnected)
+    if (state_ == kDisconnected)
     {
-        setState(kDisconnecting);
-        loop_->runInLoop(
-            std::bind(&TcpConnection::shutdownInLoop, this)
-        );
+        return;
+    }
+    if (relayEof_)
+    {
+        relayEof_ = false;
+        handleClose();
+    }
+    else if (relayPaused_)
+    {
+        relayPaused_ = false;
+        updateReading();
+    }
+}
+
+void TcpConnection::setSocketOptions(const SocketOptions &options)
+{
+    if (localAddr_.isUnix())
+    {
+        return;   // 都是 TCP 的选项，AF_UNIX 连接没有对应的行为
+    }
+    socket_->setTcpNoDelay(options.tcpNoDelay);
+    socket_->setKeepAlive(options.keepAlive);
+    if (options.notSentLowat > 0)
+    {
+        socket_->setNotSentLowat(options.notSentLowat);
+    }
+    quickAck_ = options.quickAck;
+    if (quickAck_)
+    {
+        socket_->setQuickAck(true);
     }
 }
 
 void TcpConnection::shutdownInLoop()
 {
-    if (!channel_->isWriting()) // 说明outputBuffer中的数据已经全部发送完成
+    // 说明outputBuffer中的数据已经全部发送完成，并且没有等待在循环末尾合并发送的数据。
+    // 分发期间编码进 outputBuffer 还没有 flush 的回复也要等待，由 writeOutputQueue 排空以后再关闭写端
+    outputQueue_.syncBuffer();
+    if (!channel_->isWriting() && !flushScheduled_ && outputQueue_.empty())
     {
+        if (tls_)
+        {
+            tls_->shutdown();     // 先发送 close_notify
+        }
         socket_->shutdownWrite(); // 关闭写端
     }
 }
@@ -165,14 +956,67 @@ void TcpConnection::shutdownInLoop()
 // 连接建立
 void TcpConnection::connectEstablished()
 {
-    setState(kConnected);
     channel_->tie(shared_from_this());
-    channel_->enableReading();
+    if (tlsContext_)
+    {
+        // 握手期间保持 kConnecting，不能发送数据，也不回调用户
+        tls_.reset(new TlsSession(tlsContext_, channel_->fd(), tlsServerName_));
+        if (!tls_->valid())
+        {
+            handleClose();
+            return;
+        }
+        channel_->enableReading();
+        handleHandshake();
+        return;
+    }
+    setState(kConnected);
+    updateReading();
 
     // 新连接建立，执行回调
     connectionCallback_(shared_from_this());
 }
 
+// 推进 TLS 握手，按需要等待可读或者可写；完成以后连接才算建立
+void TcpConnection::handleHandshake()
+{
+    switch (tls_->handshake())
+    {
+    case TlsSession::kDone:
+        if (channel_->isWriting())
+        {
+            channel_->disableWriting();
+        }
+        if (!tls_->ktlsSend())
+        {
+            tlsWrite_ = std::bind(&TlsSession::write, tls_.get(),
+                std::placeholders::_1, std::placeholders::_2, std::placeholders::_3);
+        }
+        LOG_INFO("TcpConnection::handleHandshake [%s] %s %s ktls send=%d recv=%d \n",
+            name_.c_str(), tls_->protocol().c_str(), tls_->cipher().c_str(),
+            (int)tls_->ktlsSend(), (int)tls_->ktlsRecv());
+        setState(kConnected);
+        updateReading();
+        connectionCallback_(shared_from_this());
+        break;
+    case TlsSession::kWantRead:
+        if (channel_->isWriting())
+        {
+            channel_->disableWriting();
+        }
+        break;
+    case TlsSession::kWantWrite:
+        if (!channel_->isWriting())
+        {
+            channel_->enableWriting();
+        }
+        break;
+    default:
+        handleClose();
+        break;
+    }
+}
+
 // 连接销毁
 void TcpConnection::connectDestroyed()
 {
@@ -180,6 +1024,7 @@ void TcpConnection::connectDestroyed()
     {
         setState(kDisconnected);
         channel_->disableAll();                      // 把 channel 的所有感兴趣的事件，从 poller 中删除掉。
+        updateMemory();
         connectionCallback_(shared_from_this());
     }
     channel_->remove();                              // 把 channel 从 poller 中删除掉。
@@ -188,17 +1033,59 @@ void TcpConnection::connectDestroyed()
 // 处理 Tcp 连接的可读事件。
 void TcpConnection::handleRead(Timestamp receiveTime)
 {
+    if (relaying_)
+    {
+        TcpConnectionPtr target = relayTarget_.lock();
+        if (target && target->state_ != kDisconnected)
+        {
+            handleRelayRead(target);
+            return;
+        }
+        // 转发目标已经断开，恢复普通的读处理
+        relaying_ = false;
+        relayPaused_ = false;
+        relayTarget_.reset();
+        relayPipe_.reset();
+    }
+
+    if (state_ == kConnecting)
+    {
+        handleHandshake();
+        return;
+    }
+
     int savedErrno = 0;
-    ssize_t n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+    ssize_t n = 0;
+    if (tls_)
+    {
+        n = tls_->read(&inputBuffer_, &savedErrno);
+    }
+    else if (localAddr_.isUnix())
+    {
+        n = inputBuffer_.readFd(channel_->fd(), &savedErrno, &receivedFds_);
+    }
+    else
+    {
+        n = inputBuffer_.readFd(channel_->fd(), &savedErrno);
+    }
+    if (quickAck_)
+    {
+        socket_->setQuickAck(true);
+    }
     if (n > 0)
     {
         // 已建立连接的用户，有可读事件发生了，调用用户传入的回调操作onMessage
         messageCallback_(shared_from_this(), &inputBuffer_, receiveTime);
+        updateMemory();
     }
     else if (n == 0)
     {
         handleClose();
     }
+    else if (savedErrno == EAGAIN)
+    {
+        // TLS 记录还没有收完整，等待下一次可读
+    }
     else
     {
         errno = savedErrno;
@@ -210,32 +1097,54 @@ void TcpConnection::handleRead(Timestamp receiveTime)
 // 处理 Tcp 连接的可写事件。
 void TcpConnection::handleWrite()
 {
+    if (state_ == kConnecting && tls_)
+    {
+        handleHandshake();
+        return;
+    }
     if (channel_->isWriting())
     {
-        int savedErrno = 0;
-        ssize_t n = outputBuffer_.writeFd(channel_->fd(), &savedErrno);
-        if (n > 0)
+        outputQueue_.syncBuffer();
+        if (!outputQueue_.empty())
         {
-            outputBuffer_.retrieve(n);
-            if (outputBuffer_.readableBytes() == 0)
+            int savedErrno = 0;
+            ssize_t n = writeQueue(&savedErrno);
+            ++sendStats_.writeCalls;
+            if (n > 0)
             {
-                channel_->disableWriting();
-                if (writeCompleteCallback_)
-                {
-                    // 唤醒loop_对应的thread线程，执行回调
-                    loop_->queueInLoop(
-                        std::bind(writeCompleteCallback_, shared_from_this())
-                    );
-                }
-                if (state_ == kDisconnecting)
+                checkLowWaterMark();
+            }
+            else if (savedErrno == EAGAIN)
+            {
+                return;   // SSL_write 需要等待，保持 EPOLLOUT 重试
+            }
+            else
+            {
+                errno = savedErrno;
+                LOG_ERROR("TcpConnection::handleWrite");
+                if (savedErrno == EIO)
                 {
-                    shutdownInLoop();
+                    // 文件段无法继续读取，剩下的数据已经不可能发送完整，直接关闭连接
+                    handleClose();
                 }
+                return;
             }
         }
-        else
+        // 发送队列排空以后，再发送转发源通过管道转来的数据
+        if (outputQueue_.empty() && (relaySource_.expired() || drainRelay() == 0))
         {
-            LOG_ERROR("TcpConnection::handleWrite");
+            channel_->disableWriting();
+            if (writeCompleteCallback_)
+            {
+                // 唤醒loop_对应的thread线程，执行回调
+                loop_->queueInLoop(
+                    std::bind(writeCompleteCallback_, shared_from_this())
+                );
+            }
+            if (state_ == kDisconnecting)
+            {
+                shutdownInLoop();
+            }
         }
     }
     else
@@ -249,16 +1158,37 @@ void TcpConnection::handleWrite()
 void TcpConnection::handleClose()
 {
     LOG_INFO("TcpConnection::handleClose fd=%d state=%d \n", channel_->fd(), (int)state_);
+    // TLS 握手没有完成的连接，用户从来没有见过，关闭时也不回调
+    bool established = state_ != kConnecting;
     setState(kDisconnected);
     channel_->disableAll();
+    updateMemory();   // 断开的连接不再占用预算
 
     TcpConnectionPtr connPtr(shared_from_this());
-    connectionCallback_(connPtr);  // 执行连接关闭的回调
+    if (established)
+    {
+        connectionCallback_(connPtr);  // 执行连接关闭的回调
+    }
     closeCallback_(connPtr);       // 关闭连接的回调  执行的是TcpServer::removeConnection回调方法
+
+    // 转发源可能因为本连接来不及发送而暂停了读取，让它恢复读取并发现本连接已经断开
+    TcpConnectionPtr source = relaySource_.lock();
+    if (source)
+    {
+        relaySource_.reset();
+        source->resumeRelay();
+    }
 }
 
 void TcpConnection::handleError()
 {
+    // 零拷贝的完成通知也通过 EPOLLERR 上报，需要先读空错误队列
+    int completions = 0;
+    if (outputQueue_.zeroCopy() || outputQueue_.pinnedBytes() > 0)
+    {
+        completions = outputQueue_.readZeroCopyCompletions(channel_->fd());
+    }
+
     int optval;
     socklen_t optlen = sizeof optval;
     int err = 0;
@@ -270,5 +1200,9 @@ void TcpConnection::handleError()
     {
         err = optval;
     }
+    if (err == 0 && completions > 0)
+    {
+        return;
+    }
     LOG_ERROR("TcpConnection::handleError name:%s - SO_ERROR:%d \n", name_.c_str(), err);
 }
\ No newline at end of file
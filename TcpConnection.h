@@ -5,14 +5,21 @@
 #include "Callbacks.h"
 #include "Buffer.h"
 #include "Timestamp.h"
+#include "OutputQueue.h"
+#include "SocketOptions.h"
 
 #include <memory>
 #include <string>
+#include <vector>
 #include <atomic>
 
 class Channel;
 class EventLoop;
 class Socket;
+class SplicePipe;
+class MemoryBudget;
+class TlsContext;
+class TlsSession;
 
 /**
  * TcpServer => Acceptor => 有一个新用户连接，通过accept函数拿到connfd
@@ -34,9 +41,112 @@ public:
     const InetAddress& localAddress() const { return localAddr_; }
     const InetAddress& peerAddress() const { return peerAddr_; }
     bool connected() const { return state_ == kConnected; }
+    bool disconnected() const { return state_ == kDisconnected; }
 
+    // 以下 send 都可以在任意线程调用。跨线程调用时数据交给连接所在的 loop 发送，期间持有连接；
+    // 同一线程发往同一个 loop 的多次发送合并为一次唤醒，并且保持调用的先后顺序。
     void send(const std::string &buf);
+    // 接管 message 的内容，跨线程和排队时都不拷贝
+    void send(std::string &&message);
+    // 发送 buf 中的全部可读数据，并清空 buf
+    void send(Buffer *buf);
+    // 以引用的方式把数据放入发送队列，发送期间不拷贝，用 writev 和其它数据段一起发送
+    void send(const SharedString &message);
+    void send(const SharedStringList &messages);
+    // 用 sendfile 发送文件 fd 中 [offset, offset+length) 的数据，和其它 send 的数据保持先后顺序。
+    // 函数内部会 dup 一份 fd，调用返回后调用方可以关闭自己的 fd。全部发送完成后回调 WriteCompleteCallback。
+    void sendFile(int fd, off_t offset, size_t length);
+    // AF_UNIX 连接：把描述符随 message 一起发送（SCM_RIGHTS），和其它 send 的数据保持先后顺序，
+    // 对端读到 message 的第一个字节时同时收到描述符。函数内部 dup 每个 fd，调用返回后调用方可以关闭自己的 fd。
+    // message 不能为空，一次最多 kMaxSendFds 个描述符；不是 AF_UNIX 连接或者使用了 TLS 时返回 false。
+    static const size_t kMaxSendFds = 253;
+    bool sendFds(const std::vector<int> &fds, std::string message);
+    // AF_UNIX 连接：对端发来的描述符按到达顺序排队，通常在 MessageCallback 中取走，取走以后由调用方负责关闭，
+    // 连接销毁时关闭没有取走的描述符。必须在 loop 线程调用
+    std::vector<int> takeReceivedFds();
+
+    // 开启后，不小于 threshold 的引用数据段（SharedString 等）用 MSG_ZEROCOPY 发送，
+    // 内存在内核通知发送完成前一直被持有；小于 threshold 的数据仍然拷贝发送。
+    static const size_t kDefaultZeroCopyThreshold = 16*1024;
+    void setZeroCopy(bool on, size_t threshold = kDefaultZeroCopyThreshold);
     void shutdown();
+    // 不等待发送队列中的数据，直接关闭连接
+    void forceClose();
+    void setTcpNoDelay(bool on);
+    // 设置连接 socket 的选项（TCP_NODELAY、SO_KEEPALIVE、TCP_QUICKACK、TCP_NOTSENT_LOWAT），
+    // 在连接建立之前由 TcpServer 调用
+    void setSocketOptions(const SocketOptions &options);
+    // 开启后，本轮事件循环中的 send 只放入发送队列，在循环末尾统一用一次 writev 发出，
+    // 流水线请求的多个小响应因此只需要一次系统调用、合并成尽量少的 TCP 报文段。
+    void setAutoCork(bool on);
+
+    // 把本连接收到的数据直接转发给 peer，反方向需要再调用一次 peer->relayTo(本连接)。
+    // 必须在 loop 线程调用，并且两个连接属于同一个 EventLoop，一个连接同时只能有一个转发源。
+    // 数据经管道用 splice 转发，不经过用户态；peer 来不及发送时暂停读取本连接，排空以后再恢复。
+    // 管道不可用或者 socket 不支持 splice 时，退化为经过 inputBuffer 的拷贝转发。
+    // 转发期间不再回调 MessageCallback，peer 断开以后恢复普通的读处理。
+    // TLS 连接不能转发，返回 false。
+    bool relayTo(const TcpConnectionPtr &peer);
+
+    // 在连接建立之前设置，连接建立以后先完成 TLS 握手，成功以后才回调 ConnectionCallback，
+    // 握手失败的连接直接关闭、不回调。之后收发的都是明文：握手后内核接管了加密（kTLS）时，
+    // 发送仍然走 writev/sendfile，否则经 SSL_write 发送，文件段先读入用户态再加密。
+    // 客户端连接的 serverName 是期望的服务端名字，见 TlsSession
+    void setTlsContext(const std::shared_ptr<TlsContext> &context, const std::string &serverName = std::string())
+    { tlsContext_ = context; tlsServerName_ = serverName; }
+    // 没有使用 TLS 时为空
+    TlsSession* tls() const { return tls_.get(); }
+
+    // 开始 / 停止读取本连接（监听 / 取消 EPOLLIN），可以在任意线程调用
+    void startRead();
+    void stopRead();
+    bool isReading() const { return reading_; }
+
+    // 自动背压：本连接或者 peer 的待发送数据超过 highMark 时暂停读取本连接，两者都降到 lowMark
+    // 以下后恢复，和 stopRead 互不影响。peer 通常是代理中接收本连接数据的另一端，必须属于同一个 loop，
+    // 一个连接只能作为一个连接的 peer。highMark 为 0 时关闭。必须在 loop 线程调用。
+    void setReadBackpressure(size_t highMark, size_t lowMark, const TcpConnectionPtr &peer = TcpConnectionPtr());
+
+    // 待发送的字节数，包括文件段
+    size_t outputBytes() const { return outputQueue_.readableBytes(); }
+
+    // 连接缓冲区占用的内存：inputBuffer 中未处理的数据 + 发送队列自己持有的数据
+    size_t memoryBytes() const { return inputBuffer_.readableBytes() + outputQueue_.memoryBytes(); }
+    // 以下两个函数由 TcpServer 的内存预算使用，必须在 loop 线程调用。
+    // 连接缓冲区的用量变化计入 budget；budget 必须比连接活得长。
+    void setMemoryBudget(MemoryBudget *budget);
+    // 预算超过软限制时暂停读取，和 stopRead、自动背压互不影响
+    void setMemoryPaused(bool paused);
+
+    Buffer* inputBuffer() { return &inputBuffer_; }
+    Buffer* outputBuffer() { return &outputBuffer_; }
+    // 必须在 loop 线程调用。用户直接把数据编码进 outputBuffer() 以后，调用此函数把数据发送出去。
+    // outputBuffer() 只能追加数据，已有的数据由发送队列负责取走。
+    void flushOutputBuffer();
+    // 必须在 loop 线程调用。把引用数据排在 outputBuffer() 已有数据之后，不拷贝、不立即发送，
+    // 和 outputBuffer() 中的数据一起由 flushOutputBuffer 发送
+    void appendOutput(const SharedString &message);
+
+    // 用户附加在连接上的数据，例如协议解析器的状态，随连接一起释放。只应在 loop 线程中访问
+    void setContext(const std::shared_ptr<void> &context) { context_ = context; }
+    const std::shared_ptr<void>& getContext() const { return context_; }
+
+    // 发送路径的统计，用于衡量每个响应的系统调用次数和拷贝字节数
+    struct SendStats
+    {
+        uint64_t writeCalls;     // write/writev 系统调用次数
+        uint64_t copiedBytes;    // 拷贝进 outputBuffer_ 的字节数
+        uint64_t zeroCopyBytes;  // 通过 MSG_ZEROCOPY 交给内核的字节数
+        uint64_t zeroCopyFallbacks;  // 内核退化为拷贝的零拷贝发送次数
+    };
+    SendStats sendStats() const
+    {
+        SendStats stats = sendStats_;
+        stats.copiedBytes = outputQueue_.copiedBytes();
+        stats.zeroCopyBytes = outputQueue_.zeroCopyBytes();
+        stats.zeroCopyFallbacks = outputQueue_.zeroCopyFallbacks();
+        return stats;
+    }
 
     void setConnectionCallback(const ConnectionCallback& cb)
     { connectionCallback_ = cb; }
@@ -50,6 +160,10 @@ public:
     void setHighWaterMarkCallback(const HighWaterMarkCallback& cb, size_t highWaterMark)
     { highWaterMarkCallback_ = cb; highWaterMark_ = highWaterMark; }
 
+    // 越过高水位线以后，待发送数据降到 lowWaterMark 以下时回调一次
+    void setLowWaterMarkCallback(const LowWaterMarkCallback& cb, size_t lowWaterMark)
+    { lowWaterMarkCallback_ = cb; lowWaterMark_ = lowWaterMark; }
+
     void setCloseCallback(const CloseCallback& cb)
     { closeCallback_ = cb; }
 
@@ -64,14 +178,40 @@ private:
     void handleWrite();
     void handleClose();
     void handleError();
+    void handleHandshake();
+    ssize_t writeQueue(int *saveErrno);
 
     void sendInLoop(const void* message, size_t len);
+    void sendStringInLoop(std::string &message);
+    void sendSharedInLoop(const SharedStringList &messages);
+    void sendFileInLoop(int fd, off_t offset, size_t length);
+    void sendFdsInLoop(std::vector<int> &fds, std::string &message);
+    void setZeroCopyInLoop(bool on, size_t threshold);
+    void setAutoCorkInLoop(bool on);
+    void scheduleWrite();
+    void flushCorked();
+    void writeOutputQueue();
+    size_t writeDirectly(const void *data, size_t len, bool *faultError);
+    void checkHighWaterMark(size_t oldLen);
+    void checkLowWaterMark();
+    void startReadInLoop();
+    void stopReadInLoop();
+    void updateReading();
+    void updateBackpressure();
+    void checkBackpressure();
+    void updateMemory();
+    void forceCloseInLoop();
     void shutdownInLoop();
 
+    void handleRelayRead(const TcpConnectionPtr &target);
+    size_t drainRelay();
+    void resumeRelay();
+
     EventLoop *loop_;                               // TcpConnection 在 subLoop 里面管理。
     const std::string name_;
     std::atomic_int state_;                         // 标识 TCP 连接的状态。
-    bool reading_;
+    bool reading_;                                  // 用户是否希望读取，见 startRead/stopRead
+    bool quickAck_;                                 // 每次读取以后重新设置 TCP_QUICKACK
 
     std::unique_ptr<Socket> socket_;                // 连接套接字的文件描述符
     std::unique_ptr<Channel> channel_;              // 封装连接套接字的 Channel
@@ -83,9 +223,41 @@ private:
     MessageCallback messageCallback_;                // 有读写消息时的回调函数
     WriteCompleteCallback writeCompleteCallback_;    // 消息发送完成以后的回调函数
     HighWaterMarkCallback highWaterMarkCallback_;
+    LowWaterMarkCallback lowWaterMarkCallback_;
     CloseCallback closeCallback_;                    // 关闭事件的回调函数
     size_t highWaterMark_;
+    size_t lowWaterMark_;
+    bool aboveHighWaterMark_;                        // 越过了高水位线，还没有降到低水位线
+
+    bool backpressurePaused_;                        // 因为待发送数据过多暂停了读取
+    size_t backpressureHigh_;
+    size_t backpressureLow_;
+    std::weak_ptr<TcpConnection> backpressurePeer_;
+    std::weak_ptr<TcpConnection> backpressureSource_; // 把本连接作为 peer 的连接
+
+    MemoryBudget *memoryBudget_;
+    size_t chargedBytes_;                            // 已经计入 memoryBudget_ 的字节数
+    bool memoryPaused_;
 
     Buffer inputBuffer_;                             // 接收数据的缓冲区
-    Buffer outputBuffer_;                            // 发送数据的缓冲区，用于暂存待发送数据。
+    std::vector<int> receivedFds_;                   // AF_UNIX 连接收到、还没有被取走的描述符
+    Buffer outputBuffer_;                            // 发送数据的缓冲区，用于暂存拷贝的待发送数据。
+    OutputQueue outputQueue_;                        // 发送队列，按顺序管理 outputBuffer_ 中的数据和引用的数据段
+    SendStats sendStats_;
+    bool autoCork_;
+    bool flushScheduled_;                            // 已经登记了本轮循环末尾的发送
+
+    bool relaying_;                                  // 是否正在把收到的数据转发给 relayTarget_
+    bool relayEof_;                                  // 已经读到 EOF，等管道排空以后关闭
+    bool relayPaused_;                               // 转发目标来不及发送，暂停读取
+    std::weak_ptr<TcpConnection> relayTarget_;
+    std::weak_ptr<TcpConnection> relaySource_;       // 向本连接转发数据的连接
+    std::unique_ptr<SplicePipe> relayPipe_;          // 本连接 => relayTarget_ 的 splice 管道
+
+    std::shared_ptr<TlsContext> tlsContext_;
+    std::string tlsServerName_;
+    std::unique_ptr<TlsSession> tls_;
+    OutputQueue::WriteFunction tlsWrite_;            // 用户态加密发送，内核接管加密时为空
+
+    std::shared_ptr<void> context_;
 };
\ No newline at end of file
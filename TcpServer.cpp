@@ -3,6 +3,7 @@
 #include "TcpConnection.h"
 
 #include <strings.h>
+#include <algorithm>
 #include <functional>
 
 // 判断循环是否为空
@@ -24,6 +25,9 @@ TcpServer::TcpServer(EventLoop *loop,
                 , ipPort_(listenAddr.toIpPort())
                 , name_(nameArg)
                 , acceptor_(new Acceptor(loop, listenAddr, option == kReusePort))
+                , loopSoftLimit_(0)
+                , evictRound_(0)
+                , loopHardLimit_(0)
                 , threadPool_(new EventLoopThreadPool(loop, name_))
                 , connectionCallback_()
                 , messageCallback_()
@@ -51,6 +55,12 @@ TcpServer::~TcpServer()
     }
 }
 
+void TcpServer::setSocketOptions(const SocketOptions &options)
+{
+    socketOptions_ = options;
+    acceptor_->setSocketOptions(options);
+}
+
 // 设置 subloop 的个数
 void TcpServer::setThreadNum(int numThreads)
 {
@@ -65,6 +75,24 @@ void TcpServer::start()
     {
         // 启动 subloop 线程池
         threadPool_->start(threadInitCallback_); 
+        for (EventLoop *ioLoop : threadPool_->getAllLoops())
+        {
+            LoopConnections *lc = new LoopConnections(&serverBudget_);
+            lc->budget.setLimits(loopSoftLimit_, loopHardLimit_);
+            lc->budget.setCrossCallback(std::bind(&TcpServer::scheduleMemoryCheck, this, ioLoop));
+            loopConnections_[ioLoop].reset(lc);
+        }
+        // 整个服务器的用量越过限制时，每个 loop 都需要重新检查
+        serverBudget_.setCrossCallback([this]() {
+            if (serverBudget_.overHardLimit())
+            {
+                ++evictRound_;
+            }
+            for (auto &item : loopConnections_)
+            {
+                scheduleMemoryCheck(item.first);
+            }
+        });
         // 启动 mainloop 线程
         loop_->runInLoop(std::bind(&Acceptor::listen, acceptor_.get()));
     }
@@ -84,14 +112,7 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
         name_.c_str(), connName.c_str(), peerAddr.toIpPort().c_str());
 
     // 通过 sockfd 获取其绑定的本机的ip地址和端口信息
-    sockaddr_in local;
-    ::bzero(&local, sizeof local);
-    socklen_t addrlen = sizeof local;
-    if (::getsockname(sockfd, (sockaddr*)&local, &addrlen) < 0)
-    {
-        LOG_ERROR("sockets::getLocalAddr");
-    }
-    InetAddress localAddr(local);
+    InetAddress localAddr(InetAddress::localAddressOf(sockfd));
 
     // 根据连接成功的 sockfd，创建 TcpConnection 连接对象
     TcpConnectionPtr conn(new TcpConnection(
@@ -106,9 +127,14 @@ void TcpServer::newConnection(int sockfd, const InetAddress &peerAddr)
     conn->setMessageCallback(messageCallback_);
     conn->setWriteCompleteCallback(writeCompleteCallback_);
     conn->setCloseCallback(std::bind(&TcpServer::removeConnection, this, std::placeholders::_1));
+    conn->setSocketOptions(socketOptions_);
+    if (tlsContext_)
+    {
+        conn->setTlsContext(tlsContext_);
+    }
 
     // 在 subLoop 中运行
-    ioLoop->runInLoop(std::bind(&TcpConnection::connectEstablished, conn));
+    ioLoop->runInLoop(std::bind(&TcpServer::establishConnection, this, conn));
 }
 
 // 删除 TcpConnection 对象
@@ -123,5 +149,143 @@ void TcpServer::removeConnectionInLoop(const TcpConnectionPtr &conn)
 
     connections_.erase(conn->name());
     EventLoop *ioLoop = conn->getLoop(); 
-    ioLoop->queueInLoop(std::bind(&TcpConnection::connectDestroyed, conn));
-}
\ No newline at end of file
+    ioLoop->queueInLoop(std::bind(&TcpServer::destroyConnection, this, conn));
+}
+
+// 在 subLoop 中登记连接，然后建立连接
+void TcpServer::establishConnection(const TcpConnectionPtr &conn)
+{
+    LoopConnections &lc = *loopConnections_.at(conn->getLoop());
+    lc.connections.insert(conn);
+    conn->setMemoryBudget(&lc.budget);
+    conn->setMemoryPaused(lc.paused);
+    conn->connectEstablished();
+}
+
+void TcpServer::destroyConnection(const TcpConnectionPtr &conn)
+{
+    loopConnections_.at(conn->getLoop())->connections.erase(conn);
+    conn->connectDestroyed();
+}
+
+void TcpServer::broadcast(const SharedString &message)
+{
+    broadcast(SharedStringList(1, message));
+}
+
+// 向每个 loop 投递一次，而不是每个连接一次
+void TcpServer::broadcast(const SharedStringList &messages)
+{
+    for (auto &item : loopConnections_)
+    {
+        item.first->runInLoop(std::bind(&TcpServer::broadcastInLoop, this, item.first, messages));
+    }
+}
+
+void TcpServer::broadcastInLoop(EventLoop *loop, const SharedStringList &messages)
+{
+    for (const TcpConnectionPtr &conn : loopConnections_.at(loop)->connections)
+    {
+        conn->send(messages);
+    }
+}
+
+// 预算越过限制时在收发的调用栈中被调用，推迟到 loop 线程中检查，每个 loop 同时只投递一次
+void TcpServer::scheduleMemoryCheck(EventLoop *loop)
+{
+    LoopConnections &lc = *loopConnections_.at(loop);
+    if (!lc.checkScheduled.exchange(true))
+    {
+        loop->queueInLoop(std::bind(&TcpServer::checkMemoryInLoop, this, loop));
+    }
+}
+
+void TcpServer::checkMemoryInLoop(EventLoop *loop)
+{
+    LoopConnections &lc = *loopConnections_.at(loop);
+    lc.checkScheduled = false;
+
+    if (!lc.budget.overHardLimit() && !serverBudget_.overHardLimit())
+    {
+        checkPausedInLoop(loop);
+        return;
+    }
+    std::vector<TcpConnectionPtr> conns(lc.connections.begin(), lc.connections.end());
+    std::sort(conns.begin(), conns.end(), [](const TcpConnectionPtr &a, const TcpConnectionPtr &b) {
+        return a->memoryBytes() > b->memoryBytes();
+    });
+    size_t next = 0;
+
+    // 超过本 loop 的硬限制：从本 loop 占用内存最多的连接开始断开，直到降回硬限制以下
+    while (lc.budget.overHardLimit() && next < conns.size() && conns[next]->memoryBytes() > 0)
+    {
+        evictConnection(conns[next++], "loop");
+    }
+
+    // 超过整个服务器的硬限制：按全局从大到小断开。每次越过硬限制开始新的一轮，每个 loop 公布自己最大的连接，
+    // 所有 loop 都公布了本轮的值以后，只有持有全局最大连接的 loop 断开它，然后重新比较；
+    // 最大的连接在别的 loop 上时交给那个 loop 继续。断开在 loop 线程中同步完成，预算随即减少
+    const uint64_t round = evictRound_.load(std::memory_order_acquire);
+    while (serverBudget_.overHardLimit())
+    {
+        const size_t localMax = next < conns.size() ? conns[next]->memoryBytes() : 0;
+        lc.largestConnection.store(localMax, std::memory_order_relaxed);
+        lc.largestRound.store(round, std::memory_order_release);
+        EventLoop *holder = loop;
+        size_t globalMax = localMax;
+        for (auto &item : loopConnections_)
+        {
+            if (item.second->largestRound.load(std::memory_order_acquire) != round)
+            {
+                // 还有 loop 没有公布本轮的值，它的检查已经投递，由最后公布的 loop 做决定
+                holder = nullptr;
+                break;
+            }
+            size_t largest = item.second->largestConnection.load(std::memory_order_relaxed);
+            if (largest > globalMax)
+            {
+                holder = item.first;
+                globalMax = largest;
+            }
+        }
+        if (holder == nullptr || globalMax == 0)
+        {
+            break;
+        }
+        if (holder != loop)
+        {
+            // 别的 loop 公布以后可能又有变化，由它重新统计以后继续
+            scheduleMemoryCheck(holder);
+            break;
+        }
+        evictConnection(conns[next++], "server");
+    }
+    lc.largestConnection.store(next < conns.size() ? conns[next]->memoryBytes() : 0, std::memory_order_relaxed);
+
+    checkPausedInLoop(loop);
+}
+
+void TcpServer::evictConnection(const TcpConnectionPtr &conn, const char *scope)
+{
+    LOG_ERROR("TcpServer::checkMemoryInLoop [%s] - %s memory hard limit exceeded, close connection %s using %lu bytes \n",
+        name_.c_str(), scope, conn->name().c_str(), conn->memoryBytes());
+    conn->forceClose();
+}
+
+void TcpServer::checkPausedInLoop(EventLoop *loop)
+{
+    LoopConnections &lc = *loopConnections_.at(loop);
+    bool paused = lc.budget.overSoftLimit() || serverBudget_.overSoftLimit();
+    if (paused != lc.paused)
+    {
+        lc.paused = paused;
+        for (const TcpConnectionPtr &conn : lc.connections)
+        {
+            conn->setMemoryPaused(paused);
+        }
+        if (memoryPressureCallback_)
+        {
+            memoryPressureCallback_(loop, lc.budget.used(), paused);
+        }
+    }
+}
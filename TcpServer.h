@@ -11,12 +11,16 @@
 #include "Callbacks.h"
 #include "TcpConnection.h"
 #include "Buffer.h"
+#include "MemoryBudget.h"
+#include "SocketOptions.h"
+#include "TlsContext.h"
 
 #include <functional>
 #include <string>
 #include <memory>
 #include <atomic>
 #include <unordered_map>
+#include <unordered_set>
 
 // 面向用户的服务器编程使用的类
 class TcpServer : noncopyable
@@ -24,6 +28,9 @@ class TcpServer : noncopyable
 public:
     using ThreadInitCallback = std::function<void(EventLoop*)>;
     using ConnectionMap = std::unordered_map<std::string, TcpConnectionPtr>;
+    using ConnectionSet = std::unordered_set<TcpConnectionPtr>;
+    // 内存预算的用量越过软限制时回调，paused 表示该 loop 上的连接是否因此暂停了读取
+    using MemoryPressureCallback = std::function<void(EventLoop *loop, size_t loopBytes, bool paused)>;
 
     enum Option
     {
@@ -41,14 +48,62 @@ public:
     void setConnectionCallback(const ConnectionCallback &cb) { connectionCallback_ = cb; }
     void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
     void setWriteCompleteCallback(const WriteCompleteCallback &cb) { writeCompleteCallback_ = cb; }
+    void setMemoryPressureCallback(const MemoryPressureCallback &cb) { memoryPressureCallback_ = cb; }
+
+    // 内存预算，统计连接输入、输出缓冲区中的数据，必须在 start 之前设置，0 表示不限制。
+    // 每个 loop 或者整个服务器的用量超过软限制时，暂停读取相应 loop 上的所有连接并回调
+    // MemoryPressureCallback，降回软限制以下以后恢复；超过硬限制时从占用最多的连接开始断开。
+    void setLoopMemoryLimits(size_t softLimit, size_t hardLimit)
+    { loopSoftLimit_ = softLimit; loopHardLimit_ = hardLimit; }
+    void setServerMemoryLimits(size_t softLimit, size_t hardLimit)
+    { serverBudget_.setLimits(softLimit, hardLimit); }
+    size_t memoryUsage() const { return serverBudget_.used(); }
+
+    // 监听 socket 和接受的连接使用的 socket 选项，必须在 start 之前设置。
+    // 默认值保持原来的行为：backlog 1024，开启 SO_KEEPALIVE。
+    void setSocketOptions(const SocketOptions &options);
+    const SocketOptions& socketOptions() const { return socketOptions_; }
+
+    // 设置以后，所有新连接先完成 TLS 握手，握手成功才回调 ConnectionCallback，必须在 start 之前设置
+    void setTlsContext(const std::shared_ptr<TlsContext> &context) { tlsContext_ = context; }
 
     void setThreadNum(int numThreads);
     void start();
 
+    // 把同一份数据发送给所有连接，可以在任意线程调用，必须在 start 之后调用。
+    // 每个 loop 只投递一次，由 loop 线程遍历自己的连接；数据以引用的方式进入各个连接的发送队列，
+    // 内存只有一份，所有连接都发送完以后释放。
+    void broadcast(const SharedString &message);
+    void broadcast(const SharedStringList &messages);
+
 private:
     void newConnection(int sockfd, const InetAddress &peerAddr);
     void removeConnection(const TcpConnectionPtr &conn);
     void removeConnectionInLoop(const TcpConnectionPtr &conn);
+    void establishConnection(const TcpConnectionPtr &conn);
+    void destroyConnection(const TcpConnectionPtr &conn);
+    void broadcastInLoop(EventLoop *loop, const SharedStringList &messages);
+    void scheduleMemoryCheck(EventLoop *loop);
+    void checkMemoryInLoop(EventLoop *loop);
+    void evictConnection(const TcpConnectionPtr &conn, const char *scope);
+    // 按是否超过软限制暂停或恢复本 loop 上所有连接的读取
+    void checkPausedInLoop(EventLoop *loop);
+
+    // 一个 loop 上的连接以及它们的内存预算，只在对应的 loop 线程中访问
+    struct LoopConnections
+    {
+        explicit LoopConnections(MemoryBudget *serverBudget)
+            : budget(serverBudget), paused(false), checkScheduled(false), largestConnection(0), largestRound(0)
+        {}
+
+        ConnectionSet connections;
+        MemoryBudget budget;
+        bool paused;                        // 因为内存预算暂停了读取
+        std::atomic_bool checkScheduled;    // 已经投递了 checkMemoryInLoop
+        // 最近一次检查时本 loop 上最大的连接占用的字节数，其他 loop 读取，用于按全局从大到小断开
+        std::atomic<size_t> largestConnection;
+        std::atomic<uint64_t> largestRound;    // largestConnection 是哪一轮公布的，见 evictRound_
+    };
 
     EventLoop *loop_;    // baseLoop，用户定义的 loop
 
@@ -57,6 +112,20 @@ private:
 
     std::unique_ptr<Acceptor> acceptor_;              // 运行在 mainLoop，任务是监听新连接事件。
 
+    SocketOptions socketOptions_;
+    std::shared_ptr<TlsContext> tlsContext_;
+
+    MemoryBudget serverBudget_;
+    size_t loopSoftLimit_;
+    size_t loopHardLimit_;
+    MemoryPressureCallback memoryPressureCallback_;
+    // 服务器用量每次越过硬限制加一，开始新一轮按全局从大到小断开
+    std::atomic<uint64_t> evictRound_;
+
+    // 每个 loop 上已经建立的连接，map 本身在 start 以后不再修改。
+    // 声明在线程池之前，保证 subloop 线程退出以后才析构
+    std::unordered_map<EventLoop*, std::unique_ptr<LoopConnections>> loopConnections_;
+
     std::shared_ptr<EventLoopThreadPool> threadPool_; // 线程池，
 
     ConnectionCallback connectionCallback_;           // 有新连接时的回调
@@ -0,0 +1,52 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Timestamp.h"
+#include "Callbacks.h"
+#include "Channel.h"
+
+#include <set>
+#include <vector>
+
+class EventLoop;
+class Timer;
+class TimerId;
+
+/**
+ * 定时器队列，属于一个 EventLoop。所有定时器按到期时间排序，用一个 timerfd 设置最早的到期时间，
+ * timerfd 可读时在 loop 线程中执行所有到期的回调。
+ * addTimer 和 cancel 可以在任意线程调用，实际的修改都在 loop 线程中进行。
+ */
+class TimerQueue : noncopyable
+{
+public:
+    explicit TimerQueue(EventLoop *loop);
+    ~TimerQueue();
+
+    TimerId addTimer(TimerCallback cb, Timestamp when, double interval);
+    void cancel(TimerId timerId);
+
+private:
+    using Entry = std::pair<Timestamp, Timer*>;
+    using TimerList = std::set<Entry>;
+    using ActiveTimer = std::pair<Timer*, int64_t>;
+    using ActiveTimerSet = std::set<ActiveTimer>;
+
+    void addTimerInLoop(Timer *timer);
+    void cancelInLoop(TimerId timerId);
+    void handleRead();
+
+    std::vector<Entry> getExpired(Timestamp now);
+    void reset(const std::vector<Entry> &expired, Timestamp now);
+    // 插入定时器，返回最早到期时间是否改变
+    bool insert(Timer *timer);
+
+    EventLoop *loop_;
+    const int timerfd_;
+    Channel timerfdChannel_;
+    TimerList timers_;                  // 按到期时间排序
+
+    ActiveTimerSet activeTimers_;       // 和 timers_ 内容相同，按地址排序，用于取消
+    bool callingExpiredTimers_;
+    ActiveTimerSet cancelingTimers_;    // 回调执行期间被取消的周期定时器，不再重新加入
+};
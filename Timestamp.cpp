@@ -1,5 +1,6 @@
 #include "Timestamp.h"
 
+#include <sys/time.h>
 #include <time.h>
 
 Timestamp::Timestamp():microSecondsSinceEpoch_(0) {}
@@ -11,14 +12,17 @@ Timestamp::Timestamp(int64_t microSecondsSinceEpoch)
 // 获取当前时间
 Timestamp Timestamp::now()
 {
-    return Timestamp(time(NULL));
+    struct timeval tv;
+    gettimeofday(&tv, NULL);
+    return Timestamp(static_cast<int64_t>(tv.tv_sec) * kMicroSecondsPerSecond + tv.tv_usec);
 }
 
 // 以字符串形式输出当前时间
 std::string Timestamp::toString() const
 {
     char buf[128] = {0};
-    tm *tm_time = localtime(&microSecondsSinceEpoch_);
+    time_t seconds = static_cast<time_t>(microSecondsSinceEpoch_ / kMicroSecondsPerSecond);
+    tm *tm_time = localtime(&seconds);
     snprintf(buf, 128, "%4d/%02d/%02d %02d:%02d:%02d", 
         tm_time->tm_year + 1900,
         tm_time->tm_mon + 1,
@@ -27,4 +31,4 @@ std::string Timestamp::toString() const
         tm_time->tm_min,
         tm_time->tm_sec);
     return buf;
-}
\ No newline at end of file
+}
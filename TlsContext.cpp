@@ -0,0 +1,122 @@
+#include "TlsContext.h"
+#include "Logger.h"
+
+#ifdef MYMUDUO_HAS_OPENSSL
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#endif
+
+// 取出 OpenSSL 错误队列中最早的一条错误
+static std::string lastTlsError()
+{
+#ifdef MYMUDUO_HAS_OPENSSL
+    char buf[256];
+    ERR_error_string_n(ERR_get_error(), buf, sizeof buf);
+    ERR_clear_error();
+    return buf;
+#else
+    return "built without OpenSSL";
+#endif
+}
+
+TlsContext::TlsContext(void *ctx, bool isServer, bool verifyPeer)
+    : ctx_(ctx)
+    , isServer_(isServer)
+    , verifyPeer_(verifyPeer)
+    , ktls_(false)
+{
+    setKtls(true);
+}
+
+TlsContext::~TlsContext()
+{
+#ifdef MYMUDUO_HAS_OPENSSL
+    SSL_CTX_free(static_cast<SSL_CTX*>(ctx_));
+#endif
+}
+
+bool TlsContext::available()
+{
+#ifdef MYMUDUO_HAS_OPENSSL
+    return true;
+#else
+    return false;
+#endif
+}
+
+void TlsContext::setKtls(bool on)
+{
+    ktls_ = on;
+#if defined(MYMUDUO_HAS_OPENSSL) && defined(SSL_OP_ENABLE_KTLS)
+    if (on)
+    {
+        SSL_CTX_set_options(static_cast<SSL_CTX*>(ctx_), SSL_OP_ENABLE_KTLS);
+    }
+    else
+    {
+        SSL_CTX_clear_options(static_cast<SSL_CTX*>(ctx_), SSL_OP_ENABLE_KTLS);
+    }
+#endif
+}
+
+std::shared_ptr<TlsContext> TlsContext::newServerContext(const std::string &certFile, const std::string &keyFile)
+{
+#ifdef MYMUDUO_HAS_OPENSSL
+    SSL_CTX *ctx = SSL_CTX_new(TLS_server_method());
+    if (ctx == nullptr)
+    {
+        LOG_ERROR("TlsContext::newServerContext SSL_CTX_new error:%s \n", lastTlsError().c_str());
+        return std::shared_ptr<TlsContext>();
+    }
+    if (SSL_CTX_use_certificate_chain_file(ctx, certFile.c_str()) != 1
+        || SSL_CTX_use_PrivateKey_file(ctx, keyFile.c_str(), SSL_FILETYPE_PEM) != 1
+        || SSL_CTX_check_private_key(ctx) != 1)
+    {
+        LOG_ERROR("TlsContext::newServerContext load %s / %s error:%s \n",
+            certFile.c_str(), keyFile.c_str(), lastTlsError().c_str());
+        SSL_CTX_free(ctx);
+        return std::shared_ptr<TlsContext>();
+    }
+    // 非阻塞发送时允许部分写出，重试时发送队列中的数据地址可能变化
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    return std::shared_ptr<TlsContext>(new TlsContext(ctx, true, false));
+#else
+    LOG_ERROR("TlsContext::newServerContext %s \n", lastTlsError().c_str());
+    return std::shared_ptr<TlsContext>();
+#endif
+}
+
+std::shared_ptr<TlsContext> TlsContext::newClientContext(const std::string &caFile, bool verifyPeer)
+{
+#ifdef MYMUDUO_HAS_OPENSSL
+    SSL_CTX *ctx = SSL_CTX_new(TLS_client_method());
+    if (ctx == nullptr)
+    {
+        LOG_ERROR("TlsContext::newClientContext SSL_CTX_new error:%s \n", lastTlsError().c_str());
+        return std::shared_ptr<TlsContext>();
+    }
+    if (verifyPeer)
+    {
+        int ok = caFile.empty() ? SSL_CTX_set_default_verify_paths(ctx)
+                                : SSL_CTX_load_verify_locations(ctx, caFile.c_str(), nullptr);
+        if (ok != 1)
+        {
+            LOG_ERROR("TlsContext::newClientContext load %s error:%s \n",
+                caFile.empty() ? "default verify paths" : caFile.c_str(), lastTlsError().c_str());
+            SSL_CTX_free(ctx);
+            return std::shared_ptr<TlsContext>();
+        }
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_PEER, nullptr);
+    }
+    else
+    {
+        LOG_INFO("TlsContext::newClientContext peer verification disabled \n");
+        SSL_CTX_set_verify(ctx, SSL_VERIFY_NONE, nullptr);
+    }
+    SSL_CTX_set_mode(ctx, SSL_MODE_ENABLE_PARTIAL_WRITE | SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER);
+    return std::shared_ptr<TlsContext>(new TlsContext(ctx, false, verifyPeer));
+#else
+    LOG_ERROR("TlsContext::newClientContext %s \n", lastTlsError().c_str());
+    return std::shared_ptr<TlsContext>();
+#endif
+}
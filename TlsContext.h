@@ -0,0 +1,46 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <memory>
+#include <string>
+
+/**
+ * TLS 上下文，封装 OpenSSL 的 SSL_CTX，由使用同一套证书配置的所有连接共享。
+ * 编译时没有找到 OpenSSL（未定义 MYMUDUO_HAS_OPENSSL）时，创建函数总是返回空指针。
+ */
+class TlsContext : noncopyable
+{
+public:
+    ~TlsContext();
+
+    // 编译时是否带有 OpenSSL
+    static bool available();
+
+    // 服务端上下文：加载 PEM 格式的证书链和私钥，失败时记录日志并返回空指针
+    static std::shared_ptr<TlsContext> newServerContext(const std::string &certFile, const std::string &keyFile);
+    // 客户端上下文，默认校验服务端证书：caFile 为空时使用系统默认的 CA 证书路径。
+    // 校验时每个连接都要给出期望的服务端名字（见 TcpClient::setTlsContext），用于 SNI 和证书的主机名校验。
+    // verifyPeer 为 false 时不做任何校验，只应该用于测试，例如连接使用自签名证书的本地服务
+    static std::shared_ptr<TlsContext> newClientContext(const std::string &caFile = std::string(),
+                                                        bool verifyPeer = true);
+
+    bool isServer() const { return isServer_; }
+    bool verifyPeer() const { return verifyPeer_; }
+
+    // 握手完成后由内核负责加解密（kTLS），内核或者加密套件不支持时自动使用用户态的 SSL_read/SSL_write。
+    // 默认开启，只影响之后创建的连接。
+    void setKtls(bool on);
+    bool ktls() const { return ktls_; }
+
+    // OpenSSL 的 SSL_CTX*，避免在头文件中引入 OpenSSL
+    void* native() const { return ctx_; }
+
+private:
+    TlsContext(void *ctx, bool isServer, bool verifyPeer);
+
+    void *ctx_;
+    bool isServer_;
+    bool verifyPeer_;
+    bool ktls_;
+};
@@ -0,0 +1,236 @@
+#include "TlsSession.h"
+#include "TlsContext.h"
+#include "Buffer.h"
+#include "Logger.h"
+
+#include <errno.h>
+#include <arpa/inet.h>
+
+#ifdef MYMUDUO_HAS_OPENSSL
+#include <openssl/err.h>
+#include <openssl/ssl.h>
+#include <openssl/x509v3.h>
+#endif
+
+// 每次 SSL_read 至少预留的空间，一个 TLS 记录最多 16KB 明文
+static const size_t kTlsReadSize = 16*1024;
+
+TlsSession::TlsSession(const std::shared_ptr<TlsContext> &context, int fd, const std::string &serverName)
+    : context_(context)
+    , ssl_(nullptr)
+    , established_(false)
+    , ktlsSend_(false)
+    , ktlsRecv_(false)
+{
+#ifdef MYMUDUO_HAS_OPENSSL
+    SSL *ssl = SSL_new(static_cast<SSL_CTX*>(context_->native()));
+    if (ssl == nullptr || SSL_set_fd(ssl, fd) != 1)
+    {
+        LOG_ERROR("TlsSession::TlsSession SSL_new fd=%d error \n", fd);
+        SSL_free(ssl);
+        return;
+    }
+    if (context_->isServer())
+    {
+        SSL_set_accept_state(ssl);
+    }
+    else
+    {
+        if (!setServerName(ssl, serverName))
+        {
+            SSL_free(ssl);
+            return;
+        }
+        SSL_set_connect_state(ssl);
+    }
+    ssl_ = ssl;
+#else
+    (void)fd;
+    (void)serverName;
+#endif
+}
+
+#ifdef MYMUDUO_HAS_OPENSSL
+bool TlsSession::setServerName(void *session, const std::string &serverName)
+{
+    SSL *ssl = static_cast<SSL*>(session);
+    if (serverName.empty())
+    {
+        if (context_->verifyPeer())
+        {
+            // 只校验证书链而不校验名字，任何受信任的证书都能冒充服务端
+            LOG_ERROR("TlsSession::TlsSession peer verification requires a server name \n");
+            return false;
+        }
+        return true;
+    }
+    unsigned char addr[sizeof(in6_addr)];
+    bool isIp = ::inet_pton(AF_INET, serverName.c_str(), addr) == 1
+        || ::inet_pton(AF_INET6, serverName.c_str(), addr) == 1;
+    bool ok;
+    if (isIp)
+    {
+        // SNI 不允许使用 IP 地址，只校验证书中的 IP 地址
+        ok = !context_->verifyPeer() || X509_VERIFY_PARAM_set1_ip_asc(SSL_get0_param(ssl), serverName.c_str()) == 1;
+    }
+    else
+    {
+        ok = SSL_set_tlsext_host_name(ssl, serverName.c_str()) == 1
+            && (!context_->verifyPeer() || SSL_set1_host(ssl, serverName.c_str()) == 1);
+    }
+    if (!ok)
+    {
+        LOG_ERROR("TlsSession::TlsSession invalid server name %s \n", serverName.c_str());
+    }
+    return ok;
+}
+#endif
+
+TlsSession::~TlsSession()
+{
+#ifdef MYMUDUO_HAS_OPENSSL
+    SSL_free(static_cast<SSL*>(ssl_));
+#endif
+}
+
+TlsSession::Status TlsSession::handshake()
+{
+#ifdef MYMUDUO_HAS_OPENSSL
+    SSL *ssl = static_cast<SSL*>(ssl_);
+    int ret = SSL_do_handshake(ssl);
+    if (ret == 1)
+    {
+        established_ = true;
+        // OpenSSL 在握手过程中已经尝试安装 kTLS，这里只查询结果
+        ktlsSend_ = BIO_get_ktls_send(SSL_get_wbio(ssl)) != 0;
+        ktlsRecv_ = BIO_get_ktls_recv(SSL_get_rbio(ssl)) != 0;
+        return kDone;
+    }
+    switch (SSL_get_error(ssl, ret))
+    {
+    case SSL_ERROR_WANT_READ:
+        return kWantRead;
+    case SSL_ERROR_WANT_WRITE:
+        return kWantWrite;
+    default:
+        // 不能命名为 buf，LOG_ERROR 宏内部有同名的局部缓冲区
+        char errText[256];
+        ERR_error_string_n(ERR_get_error(), errText, sizeof errText);
+        ERR_clear_error();
+        long verifyResult = SSL_get_verify_result(ssl);
+        LOG_ERROR("TlsSession::handshake error:%s verify:%s errno:%d \n", errText,
+            verifyResult == X509_V_OK ? "ok" : X509_verify_cert_error_string(verifyResult), errno);
+        return kError;
+    }
+#else
+    return kError;
+#endif
+}
+
+ssize_t TlsSession::read(Buffer *buf, int *saveErrno)
+{
+#ifdef MYMUDUO_HAS_OPENSSL
+    SSL *ssl = static_cast<SSL*>(ssl_);
+    ssize_t total = 0;
+    // 解密后的数据可能留在 OpenSSL 内部，epoll 看不到，必须一直读到 WANT_READ
+    while (true)
+    {
+        buf->ensureWriteableBytes(kTlsReadSize);
+        int n = SSL_read(ssl, buf->beginWrite(), static_cast<int>(buf->writableBytes()));
+        if (n > 0)
+        {
+            buf->hasWritten(n);
+            total += n;
+            continue;
+        }
+        int err = SSL_get_error(ssl, n);
+        if (err == SSL_ERROR_WANT_READ || err == SSL_ERROR_WANT_WRITE)
+        {
+            if (total > 0)
+            {
+                return total;
+            }
+            *saveErrno = EAGAIN;
+            return -1;
+        }
+        bool eof = err == SSL_ERROR_ZERO_RETURN || (err == SSL_ERROR_SYSCALL && errno == 0);
+#ifdef SSL_R_UNEXPECTED_EOF_WHILE_READING
+        eof = eof || (err == SSL_ERROR_SSL && ERR_GET_REASON(ERR_peek_error()) == SSL_R_UNEXPECTED_EOF_WHILE_READING);
+#endif
+        if (eof)
+        {
+            // 对端发送了 close_notify，或者直接关闭了连接；先交付已经读到的数据
+            ERR_clear_error();
+            return total;
+        }
+        ERR_clear_error();
+        if (total > 0)
+        {
+            return total;
+        }
+        *saveErrno = err == SSL_ERROR_SYSCALL && errno != 0 ? errno : EPROTO;
+        return -1;
+    }
+#else
+    (void)buf;
+    *saveErrno = ENOTSUP;
+    return -1;
+#endif
+}
+
+ssize_t TlsSession::write(const void *data, size_t len, int *saveErrno)
+{
+#ifdef MYMUDUO_HAS_OPENSSL
+    SSL *ssl = static_cast<SSL*>(ssl_);
+    int n = SSL_write(ssl, data, static_cast<int>(len));
+    if (n > 0)
+    {
+        return n;
+    }
+    int err = SSL_get_error(ssl, n);
+    if (err == SSL_ERROR_WANT_WRITE || err == SSL_ERROR_WANT_READ)
+    {
+        *saveErrno = EAGAIN;
+    }
+    else
+    {
+        *saveErrno = err == SSL_ERROR_SYSCALL && errno != 0 ? errno : EPIPE;
+        ERR_clear_error();
+    }
+    return -1;
+#else
+    (void)data;
+    (void)len;
+    *saveErrno = ENOTSUP;
+    return -1;
+#endif
+}
+
+void TlsSession::shutdown()
+{
+#ifdef MYMUDUO_HAS_OPENSSL
+    if (established_)
+    {
+        SSL_shutdown(static_cast<SSL*>(ssl_));
+        ERR_clear_error();
+    }
+#endif
+}
+
+std::string TlsSession::protocol() const
+{
+#ifdef MYMUDUO_HAS_OPENSSL
+    return SSL_get_version(static_cast<SSL*>(ssl_));
+#else
+    return std::string();
+#endif
+}
+
+std::string TlsSession::cipher() const
+{
+#ifdef MYMUDUO_HAS_OPENSSL
+    return SSL_get_cipher_name(static_cast<SSL*>(ssl_));
+#else
+    return std::string();
+#endif
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+#include "noncopyable.h"
+
+#include <memory>
+#include <string>
+#include <sys/types.h>
+
+class Buffer;
+class TlsContext;
+
+/**
+ * 一个连接上的 TLS 会话，基于非阻塞 socket 完成握手和加解密。
+ * 握手完成后如果内核接管了发送方向（kTLS TX），调用方可以直接 write/writev/sendfile 明文，
+ * 由内核加密；否则必须通过 write 交给 SSL_write。接收方向统一使用 read，
+ * OpenSSL 在 kTLS RX 开启时会直接从内核读取明文。
+ */
+class TlsSession : noncopyable
+{
+public:
+    enum Status
+    {
+        kDone,
+        kWantRead,
+        kWantWrite,
+        kError,
+    };
+
+    // 客户端会话的 serverName 是期望的服务端名字：域名用于 SNI 和证书的主机名校验，IP 地址只做校验。
+    // 上下文要求校验服务端证书而 serverName 为空时创建失败（valid() 为 false）
+    TlsSession(const std::shared_ptr<TlsContext> &context, int fd,
+               const std::string &serverName = std::string());
+    ~TlsSession();
+
+    bool valid() const { return ssl_ != nullptr; }
+
+    // 推进握手，需要等待 socket 可读 / 可写时返回 kWantRead / kWantWrite
+    Status handshake();
+    bool established() const { return established_; }
+
+    // 读取并解密尽可能多的数据追加到 buf。返回读到的字节数；0 表示对端关闭；
+    // <0 时 *saveErrno 为 EAGAIN 表示需要等待下一次可读，其它值表示出错
+    ssize_t read(Buffer *buf, int *saveErrno);
+    // 加密发送，语义同 write(2)。没有写完的数据再次调用时，内容必须和上一次相同，长度可以更长
+    ssize_t write(const void *data, size_t len, int *saveErrno);
+    // 发送 close_notify，尽力而为
+    void shutdown();
+
+    bool ktlsSend() const { return ktlsSend_; }
+    bool ktlsRecv() const { return ktlsRecv_; }
+    std::string protocol() const;
+    std::string cipher() const;
+
+private:
+    // 客户端会话设置 SNI 和证书的名字校验，session 是 SSL*
+    bool setServerName(void *session, const std::string &serverName);
+
+    std::shared_ptr<TlsContext> context_;
+    void *ssl_;
+    bool established_;
+    bool ktlsSend_;
+    bool ktlsRecv_;
+};
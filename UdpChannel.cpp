@@ -0,0 +1,392 @@
+#include "UdpChannel.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+#include <algorithm>
+#include <errno.h>
+#include <string.h>
+#include <netinet/udp.h>
+
+namespace
+{
+
+// 一个 GSO 消息最多的分段数（内核的 UDP_MAX_SEGMENTS）和最大负载
+const size_t kMaxGsoSegments = 64;
+const size_t kMaxGsoBytes = 65507;
+// GRO 合并读取的数据最多 64KB
+const size_t kGroSlotSize = 65535;
+// 一次可读事件中最多调用 recvmmsg 的次数，避免一个 socket 长时间占用 loop
+const int kMaxBatchesPerEvent = 16;
+
+int createNonblocking()
+{
+    int sockfd = ::socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (sockfd < 0)
+    {
+        LOG_FATAL("%s:%s:%d udp socket create err:%d \n", __FILE__, __FUNCTION__, __LINE__, errno);
+    }
+    return sockfd;
+}
+
+} // namespace
+
+UdpChannel::UdpChannel(EventLoop *loop, const InetAddress &bindAddr, const UdpOptions &options, bool reusePort)
+    : loop_(loop)
+    , options_(options)
+    , socket_(createNonblocking())
+    , channel_(loop, socket_.fd())
+    , gso_(false)
+    , gro_(false)
+    , slotSize_(options.maxDatagramSize)
+    , firstPending_(0)
+    , inReadBatch_(false)
+    , flushScheduled_(false)
+    , stats_{0, 0, 0, 0, 0}
+{
+    socket_.setReuseAddr(true);
+    socket_.setReusePort(reusePort);
+    if (options_.recvBufferSize > 0)
+    {
+        socket_.setRecvBufferSize(options_.recvBufferSize);
+    }
+    if (options_.sendBufferSize > 0)
+    {
+        socket_.setSendBufferSize(options_.sendBufferSize);
+    }
+    // 每次发送单独指定分段大小，这里只用来检测内核是否支持
+    if (options_.gso)
+    {
+        gso_ = socket_.setUdpSegment(0);
+        if (!gso_)
+        {
+            LOG_ERROR("UdpChannel UDP_SEGMENT not supported:%d \n", errno);
+        }
+    }
+    if (options_.gro)
+    {
+        gro_ = socket_.setUdpGro(true);
+        if (gro_)
+        {
+            slotSize_ = std::max(slotSize_, kGroSlotSize);
+        }
+        else
+        {
+            LOG_ERROR("UdpChannel UDP_GRO not supported:%d \n", errno);
+        }
+    }
+    socket_.bindAddress(bindAddr);
+
+    const size_t batch = static_cast<size_t>(std::max(options_.batchSize, 1));
+    const size_t controlSize = CMSG_SPACE(sizeof(int));
+    recvSlab_.resize(batch * slotSize_);
+    recvIovecs_.resize(batch);
+    recvAddrs_.resize(batch);
+    recvControl_.resize(gro_ ? batch * controlSize : 0);
+    recvMsgs_.resize(batch);
+    for (size_t i = 0; i < batch; ++i)
+    {
+        recvIovecs_[i].iov_base = &recvSlab_[i * slotSize_];
+        recvIovecs_[i].iov_len = slotSize_;
+        ::memset(&recvMsgs_[i], 0, sizeof recvMsgs_[i]);
+        recvMsgs_[i].msg_hdr.msg_iov = &recvIovecs_[i];
+        recvMsgs_[i].msg_hdr.msg_iovlen = 1;
+    }
+
+    sendIovecs_.resize(batch);
+    sendControl_.resize(gso_ ? batch * CMSG_SPACE(sizeof(uint16_t)) : 0);
+    sendMsgs_.resize(batch);
+    sendGroups_.resize(batch);
+
+    channel_.setReadCallback(std::bind(&UdpChannel::handleRead, this, std::placeholders::_1));
+    channel_.setWriteCallback(std::bind(&UdpChannel::handleWrite, this));
+}
+
+UdpChannel::~UdpChannel()
+{
+    channel_.disableAll();
+    channel_.remove();
+}
+
+void UdpChannel::start()
+{
+    channel_.enableReading();
+}
+
+InetAddress UdpChannel::localAddress() const
+{
+    sockaddr_in addr;
+    socklen_t len = sizeof addr;
+    ::memset(&addr, 0, sizeof addr);
+    if (::getsockname(socket_.fd(), reinterpret_cast<sockaddr*>(&addr), &len) < 0)
+    {
+        LOG_ERROR("UdpChannel::localAddress getsockname error:%d \n", errno);
+    }
+    return InetAddress(addr);
+}
+
+void UdpChannel::send(const InetAddress &peer, StringPiece datagram)
+{
+    if (loop_->isInLoopThread())
+    {
+        if (pending_.size() - firstPending_ >= options_.maxPendingSends)
+        {
+            ++stats_.droppedDatagrams;
+            return;
+        }
+        PendingSend entry;
+        entry.peer = *peer.getSockAddr();
+        entry.offset = sendData_.size();
+        entry.length = datagram.size();
+        sendData_.append(datagram.data(), datagram.size());
+        pending_.push_back(entry);
+        // 回调一批数据报期间的发送在批次结束时统一发出，其他时候在本轮循环结束时发出
+        if (!inReadBatch_ && !flushScheduled_ && !channel_.isWriting())
+        {
+            flushScheduled_ = true;
+            loop_->runAtIterationEnd(std::bind(&UdpChannel::scheduledFlush, this));
+        }
+    }
+    else
+    {
+        loop_->runInLoop(std::bind(&UdpChannel::sendInLoop, this, peer, datagram.toString()));
+    }
+}
+
+void UdpChannel::sendInLoop(const InetAddress &peer, const std::string &datagram)
+{
+    send(peer, datagram);
+}
+
+void UdpChannel::handleRead(Timestamp receiveTime)
+{
+    const int batch = static_cast<int>(recvMsgs_.size());
+    const size_t controlSize = CMSG_SPACE(sizeof(int));
+    inReadBatch_ = true;
+    for (int round = 0; round < kMaxBatchesPerEvent; ++round)
+    {
+        // recvmmsg 会改写地址和控制消息的长度，每次调用之前重新设置
+        for (int i = 0; i < batch; ++i)
+        {
+            msghdr &hdr = recvMsgs_[i].msg_hdr;
+            hdr.msg_name = &recvAddrs_[i];
+            hdr.msg_namelen = sizeof(sockaddr_in);
+            hdr.msg_control = gro_ ? &recvControl_[i * controlSize] : nullptr;
+            hdr.msg_controllen = gro_ ? controlSize : 0;
+            hdr.msg_flags = 0;
+        }
+        int n = ::recvmmsg(socket_.fd(), &recvMsgs_[0], batch, MSG_DONTWAIT, nullptr);
+        if (n <= 0)
+        {
+            if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                LOG_ERROR("UdpChannel::handleRead recvmmsg error:%d \n", errno);
+            }
+            break;
+        }
+        ++stats_.receiveCalls;
+        for (int i = 0; i < n; ++i)
+        {
+            deliver(i, receiveTime);
+        }
+        flushSends();
+        if (n < batch)
+        {
+            break;
+        }
+    }
+    inReadBatch_ = false;
+}
+
+void UdpChannel::deliver(size_t slot, Timestamp receiveTime)
+{
+    const msghdr &hdr = recvMsgs_[slot].msg_hdr;
+    if (hdr.msg_flags & MSG_TRUNC)
+    {
+        ++stats_.droppedDatagrams;
+        return;
+    }
+    const size_t length = recvMsgs_[slot].msg_len;
+    size_t segmentSize = length;
+    if (gro_)
+    {
+        for (cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr); cmsg != nullptr; cmsg = CMSG_NXTHDR(const_cast<msghdr*>(&hdr), cmsg))
+        {
+            if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+            {
+                int size = 0;
+                ::memcpy(&size, CMSG_DATA(cmsg), sizeof size);
+                if (size > 0)
+                {
+                    segmentSize = static_cast<size_t>(size);
+                }
+            }
+        }
+    }
+
+    const char *data = &recvSlab_[slot * slotSize_];
+    const InetAddress peer(recvAddrs_[slot]);
+    size_t offset = 0;
+    do
+    {
+        const size_t size = std::min(segmentSize, length - offset);
+        ++stats_.receivedDatagrams;
+        if (messageCallback_)
+        {
+            messageCallback_(this, peer, StringPiece(data + offset, size), receiveTime);
+        }
+        offset += size;
+    } while (offset < length);
+}
+
+size_t UdpChannel::groupSize(size_t first) const
+{
+    const PendingSend &head = pending_[first];
+    if (!gso_ || head.length == 0)
+    {
+        return 1;
+    }
+    size_t count = 1;
+    size_t bytes = head.length;
+    for (size_t i = first + 1; i < pending_.size() && count < kMaxGsoSegments; ++i)
+    {
+        const PendingSend &next = pending_[i];
+        // 除最后一个分段以外大小必须相同，最后一个可以更短
+        if (next.length == 0 || next.length > head.length || bytes + next.length > kMaxGsoBytes
+            || next.peer.sin_addr.s_addr != head.peer.sin_addr.s_addr || next.peer.sin_port != head.peer.sin_port)
+        {
+            break;
+        }
+        ++count;
+        bytes += next.length;
+        if (next.length < head.length)
+        {
+            break;
+        }
+    }
+    return count;
+}
+
+void UdpChannel::flushSends()
+{
+    const size_t batch = sendMsgs_.size();
+    const size_t controlSize = CMSG_SPACE(sizeof(uint16_t));
+    // 此下标之前的数据报逐个发送，不再合并成 GSO 消息，见下面的 EINVAL
+    size_t ungroupedEnd = 0;
+    while (firstPending_ < pending_.size())
+    {
+        // 组装一批消息，连续的数据报在 sendData_ 中也是连续的，一个 GSO 消息只需要一个 iovec
+        size_t messages = 0;
+        size_t next = firstPending_;
+        while (messages < batch && next < pending_.size())
+        {
+            const size_t count = next < ungroupedEnd ? 1 : groupSize(next);
+            const PendingSend &head = pending_[next];
+            const PendingSend &last = pending_[next + count - 1];
+            mmsghdr &msg = sendMsgs_[messages];
+            ::memset(&msg, 0, sizeof msg);
+            sendIovecs_[messages].iov_base = &sendData_[head.offset];
+            sendIovecs_[messages].iov_len = last.offset + last.length - head.offset;
+            msg.msg_hdr.msg_name = const_cast<sockaddr_in*>(&head.peer);
+            msg.msg_hdr.msg_namelen = sizeof(sockaddr_in);
+            msg.msg_hdr.msg_iov = &sendIovecs_[messages];
+            msg.msg_hdr.msg_iovlen = 1;
+            if (count > 1)
+            {
+                msg.msg_hdr.msg_control = &sendControl_[messages * controlSize];
+                msg.msg_hdr.msg_controllen = controlSize;
+                cmsghdr *cmsg = CMSG_FIRSTHDR(&msg.msg_hdr);
+                cmsg->cmsg_level = SOL_UDP;
+                cmsg->cmsg_type = UDP_SEGMENT;
+                cmsg->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                const uint16_t segmentSize = static_cast<uint16_t>(head.length);
+                ::memcpy(CMSG_DATA(cmsg), &segmentSize, sizeof segmentSize);
+            }
+            sendGroups_[messages] = count;
+            ++messages;
+            next += count;
+        }
+
+        int n = ::sendmmsg(socket_.fd(), &sendMsgs_[0], static_cast<unsigned int>(messages), 0);
+        if (n < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                // 发送缓冲区满，保留剩余的数据报，可写以后继续
+                compactPending();
+                if (!channel_.isWriting())
+                {
+                    channel_.enableWriting();
+                }
+                return;
+            }
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EIO && sendGroups_[0] > 1)
+            {
+                // 网卡不支持 UDP 分段卸载（校验和）时返回 EIO，关闭 GSO 以后重新发送
+                LOG_ERROR("UdpChannel::flushSends GSO failed, disabled \n");
+                gso_ = false;
+                continue;
+            }
+            if ((errno == EINVAL || errno == EMSGSIZE) && sendGroups_[0] > 1)
+            {
+                // 分段大小超过路径 MTU 时内核拒绝整个 GSO 消息（视内核版本返回 EINVAL 或 EMSGSIZE），
+                // 这一组改为逐个发送，由 IP 层分片
+                LOG_DEBUG("UdpChannel::flushSends GSO segment %lu rejected, sending separately \n",
+                    static_cast<unsigned long>(pending_[firstPending_].length));
+                ungroupedEnd = firstPending_ + sendGroups_[0];
+                continue;
+            }
+            // 其他错误（例如对端不可达）只影响第一个消息，丢弃以后继续发送后面的消息
+            LOG_DEBUG("UdpChannel::flushSends sendmmsg error:%d \n", errno);
+            stats_.droppedDatagrams += sendGroups_[0];
+            firstPending_ += sendGroups_[0];
+            continue;
+        }
+        ++stats_.sendCalls;
+        for (int i = 0; i < n; ++i)
+        {
+            stats_.sentDatagrams += sendGroups_[i];
+            firstPending_ += sendGroups_[i];
+        }
+    }
+
+    pending_.clear();
+    sendData_.clear();
+    firstPending_ = 0;
+    if (channel_.isWriting())
+    {
+        channel_.disableWriting();
+    }
+}
+
+void UdpChannel::compactPending()
+{
+    // 持续 EAGAIN 时新的数据报不断追加在尾部，已经发出的前缀超过一半时再搬移，
+    // 每个数据报均摊只搬移常数次
+    if (firstPending_ == 0 || firstPending_ * 2 < pending_.size())
+    {
+        return;
+    }
+    const size_t sentBytes = pending_[firstPending_].offset;
+    sendData_.erase(0, sentBytes);
+    pending_.erase(pending_.begin(), pending_.begin() + firstPending_);
+    for (PendingSend &entry : pending_)
+    {
+        entry.offset -= sentBytes;
+    }
+    firstPending_ = 0;
+}
+
+void UdpChannel::scheduledFlush()
+{
+    flushScheduled_ = false;
+    flushSends();
+}
+
+void UdpChannel::handleWrite()
+{
+    flushSends();
+}
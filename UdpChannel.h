@@ -0,0 +1,137 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "Socket.h"
+#include "Channel.h"
+#include "InetAddress.h"
+#include "StringPiece.h"
+#include "Timestamp.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include <sys/socket.h>
+
+class EventLoop;
+class UdpChannel;
+
+// 收到一个数据报时的回调，datagram 指向接收缓冲区，只在回调期间有效
+using UdpMessageCallback = std::function<void (UdpChannel*,
+                                               const InetAddress &peer,
+                                               StringPiece datagram,
+                                               Timestamp receiveTime)>;
+
+/**
+ * UdpChannel 的选项，必须在创建之前确定。值为 0 的缓冲区大小表示使用系统默认值。
+ * GSO/GRO 需要 Linux 4.18 / 5.0 以上，内核不支持时自动关闭，不影响收发。
+ */
+struct UdpOptions
+{
+    UdpOptions()
+        : batchSize(64)
+        , maxDatagramSize(2048)
+        , maxPendingSends(4096)
+        , recvBufferSize(0)
+        , sendBufferSize(0)
+        , gso(false)
+        , gro(false)
+    {}
+
+    int batchSize;              // 一次 recvmmsg / sendmmsg 处理的最多消息数
+    size_t maxDatagramSize;     // 接收槽的大小，更长的数据报被截断，计入丢弃
+    size_t maxPendingSends;     // 等待发送的数据报上限（socket 发送缓冲区满时积压），超过以后丢弃新的数据报
+    int recvBufferSize;         // SO_RCVBUF
+    int sendBufferSize;         // SO_SNDBUF
+    bool gso;                   // UDP_SEGMENT：发往同一个对端、大小相同的连续数据报合并成一个消息，由内核分段
+    bool gro;                   // UDP_GRO：内核把同一个流的多个数据报合并成一次读取，接收槽扩大到 64KB
+};
+
+/**
+ * 一个 UDP socket 以及它在 EventLoop 上的 Channel，除 send 以外所有函数都在 loop 线程中调用。
+ * 接收：可读时用 recvmmsg 一次读取一批数据报到预先分配的接收槽（一整块连续内存）中，逐个回调，
+ * 开启 GRO 时把合并读取的数据按分段大小拆开回调。
+ * 发送：send 只把数据报追加到发送队列，回调处理完一批数据报以后（或者本轮循环结束时）用 sendmmsg
+ * 一次发出；开启 GSO 时发往同一个对端、大小相同的连续数据报合并成一个消息。
+ * 发送缓冲区满时保留剩余的数据报，等待可写以后继续发送。
+ */
+class UdpChannel : noncopyable
+{
+public:
+    struct Stats
+    {
+        uint64_t receivedDatagrams;    // 回调的数据报个数（GRO 合并的按分段计）
+        uint64_t receiveCalls;         // 返回了数据的 recvmmsg 调用次数
+        uint64_t sentDatagrams;
+        uint64_t sendCalls;            // sendmmsg 调用次数
+        uint64_t droppedDatagrams;     // 被截断的接收、发送队列满或者发送出错而丢弃的数据报
+    };
+
+    // reusePort 为 true 时设置 SO_REUSEPORT，多个 socket 绑定同一个端口，由内核按四元组分配数据报
+    UdpChannel(EventLoop *loop, const InetAddress &bindAddr, const UdpOptions &options, bool reusePort);
+    ~UdpChannel();
+
+    void setMessageCallback(const UdpMessageCallback &cb) { messageCallback_ = cb; }
+
+    // 开始接收，在 loop 线程中调用
+    void start();
+
+    // 可以在任意线程调用，其他线程调用时拷贝数据并投递到 loop 线程。
+    // 通常在 MessageCallback 中调用，数据先追加到发送队列，和同一批其他回复一起发出
+    void send(const InetAddress &peer, StringPiece datagram);
+
+    EventLoop* getLoop() const { return loop_; }
+    InetAddress localAddress() const;
+    bool gsoEnabled() const { return gso_; }
+    bool groEnabled() const { return gro_; }
+    const Stats& stats() const { return stats_; }
+
+private:
+    // 等待发送的数据报，数据在 sendData_ 中连续存放
+    struct PendingSend
+    {
+        sockaddr_in peer;
+        size_t offset;
+        size_t length;
+    };
+
+    void sendInLoop(const InetAddress &peer, const std::string &datagram);
+    void handleRead(Timestamp receiveTime);
+    void handleWrite();
+    void deliver(size_t slot, Timestamp receiveTime);
+    void flushSends();
+    // 丢弃 pending_ 和 sendData_ 中已经发出的前缀
+    void compactPending();
+    void scheduledFlush();
+    // 从 pending_[first] 开始，取出能合并成一个 GSO 消息的数据报个数
+    size_t groupSize(size_t first) const;
+
+    EventLoop *loop_;
+    const UdpOptions options_;
+    Socket socket_;
+    Channel channel_;
+    bool gso_;
+    bool gro_;
+    UdpMessageCallback messageCallback_;
+
+    // 接收：slotSize_ 字节一个槽，recvMsgs_[i] 指向第 i 个槽
+    size_t slotSize_;
+    std::vector<char> recvSlab_;
+    std::vector<iovec> recvIovecs_;
+    std::vector<sockaddr_in> recvAddrs_;
+    std::vector<char> recvControl_;
+    std::vector<mmsghdr> recvMsgs_;
+
+    // 发送
+    std::string sendData_;
+    std::vector<PendingSend> pending_;
+    size_t firstPending_;              // pending_ 中第一个还没有发出的数据报
+    std::vector<iovec> sendIovecs_;
+    std::vector<char> sendControl_;
+    std::vector<mmsghdr> sendMsgs_;
+    std::vector<size_t> sendGroups_;   // sendMsgs_[i] 包含的数据报个数
+    bool inReadBatch_;                 // 正在回调接收到的一批数据报，结束时统一发送
+    bool flushScheduled_;
+
+    Stats stats_;
+};
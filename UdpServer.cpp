@@ -0,0 +1,65 @@
+#include "UdpServer.h"
+#include "EventLoop.h"
+#include "Logger.h"
+
+UdpServer::UdpServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &nameArg)
+    : loop_(loop)
+    , listenAddr_(listenAddr)
+    , ipPort_(listenAddr.toIpPort())
+    , name_(nameArg)
+    , threadPool_(new EventLoopThreadPool(loop, nameArg))
+    , started_(0)
+{
+    if (loop == nullptr)
+    {
+        LOG_FATAL("%s:%s:%d mainLoop is null! \n", __FILE__, __FUNCTION__, __LINE__);
+    }
+}
+
+UdpServer::~UdpServer()
+{
+    // Channel 只能在自己的 loop 线程中移除。subloop 线程在退出之前会执行完已经投递的函数，
+    // 之后线程池析构时等待它们退出；baseLoop 上的 UdpChannel 在这里直接销毁
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (auto &item : channels_)
+    {
+        UdpChannel *channel = item.second.release();
+        item.first->runInLoop([channel]() { delete channel; });
+    }
+    channels_.clear();
+}
+
+void UdpServer::start()
+{
+    if (started_++ == 0)
+    {
+        LOG_INFO("UdpServer[%s] starts on %s \n", name_.c_str(), ipPort_.c_str());
+        threadPool_->start(std::bind(&UdpServer::initLoop, this, std::placeholders::_1));
+    }
+}
+
+void UdpServer::initLoop(EventLoop *loop)
+{
+    UdpChannel *channel = new UdpChannel(loop, listenAddr_, options_, true);
+    channel->setMessageCallback(messageCallback_);
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        channels_[loop].reset(channel);
+    }
+    if (threadInitCallback_)
+    {
+        threadInitCallback_(loop);
+    }
+    channel->start();
+}
+
+std::vector<UdpChannel*> UdpServer::channels() const
+{
+    std::vector<UdpChannel*> channels;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto &item : channels_)
+    {
+        channels.push_back(item.second.get());
+    }
+    return channels;
+}
@@ -0,0 +1,63 @@
+#pragma once
+
+/**
+ * UDP 服务器：每个 subloop 一个绑定在同一个地址上的 UdpChannel（SO_REUSEPORT），
+ * 由内核按四元组把数据报分配到各个 socket，同一个对端的数据报总是由同一个 loop 处理。
+ * 没有 subloop 时只在 baseLoop 上创建一个 UdpChannel。
+ */
+#include "noncopyable.h"
+#include "UdpChannel.h"
+#include "InetAddress.h"
+#include "EventLoopThreadPool.h"
+
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+class EventLoop;
+
+class UdpServer : noncopyable
+{
+public:
+    using ThreadInitCallback = std::function<void(EventLoop*)>;
+
+    UdpServer(EventLoop *loop, const InetAddress &listenAddr, const std::string &nameArg);
+    // 必须在 baseLoop 线程中析构
+    ~UdpServer();
+
+    // 以下设置必须在 start 之前完成。多个 subloop 时监听地址的端口不能是 0
+    void setThreadNum(int numThreads) { threadPool_->setThreadNum(numThreads); }
+    void setOptions(const UdpOptions &options) { options_ = options; }
+    void setMessageCallback(const UdpMessageCallback &cb) { messageCallback_ = cb; }
+    void setThreadInitCallback(const ThreadInitCallback &cb) { threadInitCallback_ = cb; }
+
+    void start();
+
+    const std::string& name() const { return name_; }
+    const std::string& ipPort() const { return ipPort_; }
+
+    // 各个 loop 上的 UdpChannel，start 之后有效。统计数据只能在对应的 loop 线程中读取
+    std::vector<UdpChannel*> channels() const;
+
+private:
+    void initLoop(EventLoop *loop);
+
+    EventLoop *loop_;    // baseLoop
+    const InetAddress listenAddr_;
+    const std::string ipPort_;
+    const std::string name_;
+    UdpOptions options_;
+    UdpMessageCallback messageCallback_;
+    ThreadInitCallback threadInitCallback_;
+
+    // 在各个 loop 线程中创建，map 本身在 start 以后不再修改
+    mutable std::mutex mutex_;
+    std::unordered_map<EventLoop*, std::unique_ptr<UdpChannel>> channels_;
+
+    std::unique_ptr<EventLoopThreadPool> threadPool_;
+    std::atomic_int started_;
+};
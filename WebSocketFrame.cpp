@@ -0,0 +1,166 @@
+#include "WebSocketFrame.h"
+#include "WebSocketMask.h"
+#include "Buffer.h"
+
+#include <string.h>
+#include <string>
+
+namespace
+{
+
+// 把帧头写进 header，返回帧头长度（不含掩码键）
+size_t formatHeader(char *header, WebSocketFrame::Opcode opcode, size_t payloadLength, bool fin, bool masked)
+{
+    header[0] = static_cast<char>((fin ? 0x80 : 0x00) | opcode);
+    const char maskBit = masked ? static_cast<char>(0x80) : 0;
+    if (payloadLength < 126)
+    {
+        header[1] = static_cast<char>(maskBit | payloadLength);
+        return 2;
+    }
+    if (payloadLength <= 0xFFFF)
+    {
+        header[1] = static_cast<char>(maskBit | 126);
+        header[2] = static_cast<char>(payloadLength >> 8);
+        header[3] = static_cast<char>(payloadLength);
+        return 4;
+    }
+    header[1] = static_cast<char>(maskBit | 127);
+    uint64_t n = payloadLength;
+    for (int i = 9; i >= 2; --i)
+    {
+        header[i] = static_cast<char>(n & 0xFF);
+        n >>= 8;
+    }
+    return 10;
+}
+
+bool validOpcode(int opcode)
+{
+    switch (opcode)
+    {
+    case WebSocketFrame::kContinuation:
+    case WebSocketFrame::kText:
+    case WebSocketFrame::kBinary:
+    case WebSocketFrame::kClose:
+    case WebSocketFrame::kPing:
+    case WebSocketFrame::kPong:
+        return true;
+    default:
+        return false;
+    }
+}
+
+} // namespace
+
+WebSocketFrame::ParseResult WebSocketFrame::parse(char *data, size_t len, bool expectMasked,
+                                                  size_t maxPayload, WebSocketFrame *frame)
+{
+    if (len < 2)
+    {
+        return kNeedMore;
+    }
+    const unsigned char b0 = static_cast<unsigned char>(data[0]);
+    const unsigned char b1 = static_cast<unsigned char>(data[1]);
+    const int opcode = b0 & 0x0F;
+    const bool masked = (b1 & 0x80) != 0;
+    if ((b0 & 0x70) != 0 || !validOpcode(opcode) || masked != expectMasked)
+    {
+        return kProtocolError;
+    }
+
+    size_t headerLength = 2;
+    uint64_t payloadLength = b1 & 0x7F;
+    if (payloadLength == 126)
+    {
+        if (len < 4)
+        {
+            return kNeedMore;
+        }
+        payloadLength = (static_cast<uint64_t>(static_cast<unsigned char>(data[2])) << 8)
+            | static_cast<unsigned char>(data[3]);
+        headerLength = 4;
+    }
+    else if (payloadLength == 127)
+    {
+        if (len < 10)
+        {
+            return kNeedMore;
+        }
+        payloadLength = 0;
+        for (int i = 2; i < 10; ++i)
+        {
+            payloadLength = (payloadLength << 8) | static_cast<unsigned char>(data[i]);
+        }
+        // 最高位必须为 0
+        if (payloadLength >> 63)
+        {
+            return kProtocolError;
+        }
+        headerLength = 10;
+    }
+
+    const bool fin = (b0 & 0x80) != 0;
+    if ((opcode & 0x8) != 0 && (!fin || payloadLength > kMaxControlPayload))
+    {
+        return kProtocolError;
+    }
+    if (payloadLength > maxPayload)
+    {
+        return kTooLarge;
+    }
+
+    uint32_t maskKey = 0;
+    if (masked)
+    {
+        if (len < headerLength + 4)
+        {
+            return kNeedMore;
+        }
+        ::memcpy(&maskKey, data + headerLength, sizeof maskKey);
+        headerLength += 4;
+    }
+    if (len - headerLength < payloadLength)
+    {
+        return kNeedMore;
+    }
+
+    char *payload = data + headerLength;
+    if (masked)
+    {
+        WebSocketMask::apply(payload, payloadLength, maskKey);
+    }
+    frame->fin = fin;
+    frame->opcode = static_cast<Opcode>(opcode);
+    frame->payload = StringPiece(payload, payloadLength);
+    frame->length = headerLength + payloadLength;
+    return kGotFrame;
+}
+
+void WebSocketFrame::append(Buffer *output, Opcode opcode, StringPiece payload, bool fin)
+{
+    char header[kMaxHeaderBytes];
+    output->append(header, formatHeader(header, opcode, payload.size(), fin, false));
+    output->append(payload.data(), payload.size());
+}
+
+void WebSocketFrame::appendMasked(Buffer *output, Opcode opcode, StringPiece payload, uint32_t maskKey, bool fin)
+{
+    char header[kMaxHeaderBytes];
+    size_t n = formatHeader(header, opcode, payload.size(), fin, true);
+    ::memcpy(header + n, &maskKey, sizeof maskKey);
+    output->append(header, n + sizeof maskKey);
+    output->append(payload.data(), payload.size());
+    WebSocketMask::apply(output->mutablePeek() + output->readableBytes() - payload.size(), payload.size(), maskKey);
+}
+
+SharedString WebSocketFrame::encode(Opcode opcode, StringPiece payload)
+{
+    char header[kMaxHeaderBytes];
+    size_t n = formatHeader(header, opcode, payload.size(), true, false);
+    std::string frame;
+    frame.reserve(n + payload.size());
+    frame.append(header, n);
+    frame.append(payload.data(), payload.size());
+    return std::make_shared<const std::string>(std::move(frame));
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include "Callbacks.h"
+#include "StringPiece.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+class Buffer;
+
+/**
+ * WebSocket（RFC 6455）帧的解析和编码，不支持扩展（RSV 位必须为 0）。
+ * 解析不保存状态：每次从数据开头解析一个完整的帧，负载在原地解掩码，payload 是指向输入数据的视图，
+ * 不拷贝。帧没有收全时返回 kNeedMore，下次收到更多数据后从头再解析（帧头最多 14 字节）。
+ * 分片消息的重组由上层负责。
+ */
+struct WebSocketFrame
+{
+    enum Opcode
+    {
+        kContinuation = 0x0,
+        kText = 0x1,
+        kBinary = 0x2,
+        kClose = 0x8,
+        kPing = 0x9,
+        kPong = 0xA,
+    };
+
+    enum ParseResult
+    {
+        kNeedMore,
+        kGotFrame,
+        kProtocolError,     // 格式错误，应以 1002 关闭连接
+        kTooLarge,          // 负载超过上限，应以 1009 关闭连接
+    };
+
+    static const size_t kMaxHeaderBytes = 14;
+    // 控制帧的负载不能超过 125 字节，也不能分片
+    static const size_t kMaxControlPayload = 125;
+
+    bool fin;
+    Opcode opcode;
+    StringPiece payload;    // 已经解掩码
+    size_t length;          // 整个帧（头部 + 负载）的长度
+
+    bool isControl() const { return (opcode & 0x8) != 0; }
+
+    // 从 data 开头解析一个帧。expectMasked：服务端要求客户端的帧带掩码，客户端要求服务端的帧不带掩码。
+    // 负载长度超过 maxPayload 时不等数据收全，直接返回 kTooLarge
+    static ParseResult parse(char *data, size_t len, bool expectMasked, size_t maxPayload, WebSocketFrame *frame);
+
+    // 编码一个不带掩码的帧追加到 output（服务端发送）
+    static void append(Buffer *output, Opcode opcode, StringPiece payload, bool fin = true);
+    // 编码一个带掩码的帧追加到 output（客户端发送），负载在 output 中原地掩码，不修改 payload
+    static void appendMasked(Buffer *output, Opcode opcode, StringPiece payload, uint32_t maskKey, bool fin = true);
+    // 编码成一段不可变的字节，用于把同一条消息推送给多个连接
+    static SharedString encode(Opcode opcode, StringPiece payload);
+};
@@ -0,0 +1,131 @@
+#include "WebSocketMask.h"
+
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MYMUDUO_MASK_X86 1
+#include <immintrin.h>
+#endif
+
+namespace
+{
+
+using MaskFunc = void (*)(char*, size_t, uint32_t);
+
+// 处理不足一个向量的尾部，key 已经按 data 的起点对齐
+void maskTail(char *data, size_t len, uint32_t key)
+{
+    unsigned char k[4];
+    ::memcpy(k, &key, sizeof k);
+    for (size_t i = 0; i < len; ++i)
+    {
+        data[i] = static_cast<char>(data[i] ^ k[i & 3]);
+    }
+}
+
+/********************************** 标量实现 **********************************/
+
+void maskScalar(char *data, size_t len, uint32_t key)
+{
+    const uint64_t key64 = (static_cast<uint64_t>(key) << 32) | key;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8)
+    {
+        uint64_t v;
+        ::memcpy(&v, data + i, sizeof v);
+        v ^= key64;
+        ::memcpy(data + i, &v, sizeof v);
+    }
+    maskTail(data + i, len - i, key);
+}
+
+#ifdef MYMUDUO_MASK_X86
+
+/********************************** SSE2 实现 **********************************/
+
+void maskSse2(char *data, size_t len, uint32_t key)
+{
+    const __m128i k = _mm_set1_epi32(static_cast<int>(key));
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64)
+    {
+        __m128i *p = reinterpret_cast<__m128i*>(data + i);
+        __m128i v0 = _mm_xor_si128(_mm_loadu_si128(p), k);
+        __m128i v1 = _mm_xor_si128(_mm_loadu_si128(p + 1), k);
+        __m128i v2 = _mm_xor_si128(_mm_loadu_si128(p + 2), k);
+        __m128i v3 = _mm_xor_si128(_mm_loadu_si128(p + 3), k);
+        _mm_storeu_si128(p, v0);
+        _mm_storeu_si128(p + 1, v1);
+        _mm_storeu_si128(p + 2, v2);
+        _mm_storeu_si128(p + 3, v3);
+    }
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i *p = reinterpret_cast<__m128i*>(data + i);
+        _mm_storeu_si128(p, _mm_xor_si128(_mm_loadu_si128(p), k));
+    }
+    // 每次前进的长度都是 4 的倍数，key 不需要旋转
+    maskScalar(data + i, len - i, key);
+}
+
+/********************************** AVX2 实现 **********************************/
+
+__attribute__((target("avx2")))
+void maskAvx2(char *data, size_t len, uint32_t key)
+{
+    const __m256i k = _mm256_set1_epi32(static_cast<int>(key));
+    size_t i = 0;
+    for (; i + 128 <= len; i += 128)
+    {
+        __m256i *p = reinterpret_cast<__m256i*>(data + i);
+        __m256i v0 = _mm256_xor_si256(_mm256_loadu_si256(p), k);
+        __m256i v1 = _mm256_xor_si256(_mm256_loadu_si256(p + 1), k);
+        __m256i v2 = _mm256_xor_si256(_mm256_loadu_si256(p + 2), k);
+        __m256i v3 = _mm256_xor_si256(_mm256_loadu_si256(p + 3), k);
+        _mm256_storeu_si256(p, v0);
+        _mm256_storeu_si256(p + 1, v1);
+        _mm256_storeu_si256(p + 2, v2);
+        _mm256_storeu_si256(p + 3, v3);
+    }
+    for (; i + 32 <= len; i += 32)
+    {
+        __m256i *p = reinterpret_cast<__m256i*>(data + i);
+        _mm256_storeu_si256(p, _mm256_xor_si256(_mm256_loadu_si256(p), k));
+    }
+    maskScalar(data + i, len - i, key);
+}
+
+#endif // MYMUDUO_MASK_X86
+
+MaskFunc maskFor(BufferSearch::Impl impl)
+{
+#ifdef MYMUDUO_MASK_X86
+    if (impl == BufferSearch::kAvx2 && BufferSearch::supported(BufferSearch::kAvx2))
+    {
+        return maskAvx2;
+    }
+    if (impl != BufferSearch::kScalar && BufferSearch::supported(BufferSearch::kSse2))
+    {
+        return maskSse2;
+    }
+#endif
+    return maskScalar;
+}
+
+} // namespace
+
+namespace WebSocketMask
+{
+
+void apply(char *data, size_t len, uint32_t key)
+{
+    static const MaskFunc func = maskFor(BufferSearch::currentImpl());
+    func(data, len, key);
+}
+
+void apply(BufferSearch::Impl impl, char *data, size_t len, uint32_t key)
+{
+    maskFor(impl)(data, len, key);
+}
+
+} // namespace WebSocketMask
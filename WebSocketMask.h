@@ -0,0 +1,19 @@
+#pragma once
+
+#include "BufferSearch.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * WebSocket 负载的掩码运算：data[i] ^= key[i % 4]，掩码和解掩码是同一个运算，原地修改。
+ * key 是帧头中按网络字节序出现的 4 个字节，按内存顺序存放在 uint32_t 中（直接 memcpy 得到）。
+ * 和 BufferSearch 一样，x86 平台在运行时选择 AVX2 / SSE2 实现，其它平台使用按 8 字节处理的标量实现。
+ */
+namespace WebSocketMask
+{
+    void apply(char *data, size_t len, uint32_t key);
+
+    // 指定实现的版本，供基准测试对比使用，实现的取值和检测复用 BufferSearch
+    void apply(BufferSearch::Impl impl, char *data, size_t len, uint32_t key);
+}
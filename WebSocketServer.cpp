@@ -0,0 +1,493 @@
+#include "WebSocketServer.h"
+#include "HttpResponse.h"
+#include "EventLoop.h"
+#include "OutputBatch.h"
+#include "Logger.h"
+
+#include <string.h>
+#include <algorithm>
+#include <vector>
+
+namespace
+{
+
+const char kWebSocketGuid[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+// 分片消息的拼接缓冲区在消息结束后最多保留的容量
+const size_t kMaxRetainedFragmentCapacity = 64 * 1024;
+
+inline uint32_t rotateLeft(uint32_t x, int n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+// 握手只需要对几十个字节做一次 SHA-1，用一个简单的实现，不依赖 OpenSSL
+void sha1(const char *data, size_t len, unsigned char digest[20])
+{
+    uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+
+    // 补位：0x80、若干个 0、64 位的消息比特长度，总长度是 64 的倍数
+    std::string message(data, len);
+    message.push_back(static_cast<char>(0x80));
+    while (message.size() % 64 != 56)
+    {
+        message.push_back('\0');
+    }
+    const uint64_t bits = static_cast<uint64_t>(len) * 8;
+    for (int i = 7; i >= 0; --i)
+    {
+        message.push_back(static_cast<char>(bits >> (i * 8)));
+    }
+
+    for (size_t chunk = 0; chunk < message.size(); chunk += 64)
+    {
+        const unsigned char *p = reinterpret_cast<const unsigned char*>(message.data() + chunk);
+        uint32_t w[80];
+        for (int i = 0; i < 16; ++i)
+        {
+            w[i] = (static_cast<uint32_t>(p[i * 4]) << 24) | (static_cast<uint32_t>(p[i * 4 + 1]) << 16)
+                | (static_cast<uint32_t>(p[i * 4 + 2]) << 8) | p[i * 4 + 3];
+        }
+        for (int i = 16; i < 80; ++i)
+        {
+            w[i] = rotateLeft(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int i = 0; i < 80; ++i)
+        {
+            uint32_t f, k;
+            if (i < 20)
+            {
+                f = (b & c) | (~b & d);
+                k = 0x5A827999;
+            }
+            else if (i < 40)
+            {
+                f = b ^ c ^ d;
+                k = 0x6ED9EBA1;
+            }
+            else if (i < 60)
+            {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8F1BBCDC;
+            }
+            else
+            {
+                f = b ^ c ^ d;
+                k = 0xCA62C1D6;
+            }
+            uint32_t temp = rotateLeft(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotateLeft(b, 30);
+            b = a;
+            a = temp;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    for (int i = 0; i < 5; ++i)
+    {
+        digest[i * 4] = static_cast<unsigned char>(h[i] >> 24);
+        digest[i * 4 + 1] = static_cast<unsigned char>(h[i] >> 16);
+        digest[i * 4 + 2] = static_cast<unsigned char>(h[i] >> 8);
+        digest[i * 4 + 3] = static_cast<unsigned char>(h[i]);
+    }
+}
+
+std::string base64Encode(const unsigned char *data, size_t len)
+{
+    static const char kAlphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string result;
+    result.reserve((len + 2) / 3 * 4);
+    for (size_t i = 0; i < len; i += 3)
+    {
+        uint32_t n = static_cast<uint32_t>(data[i]) << 16;
+        if (i + 1 < len) n |= static_cast<uint32_t>(data[i + 1]) << 8;
+        if (i + 2 < len) n |= data[i + 2];
+        result.push_back(kAlphabet[(n >> 18) & 0x3F]);
+        result.push_back(kAlphabet[(n >> 12) & 0x3F]);
+        result.push_back(i + 1 < len ? kAlphabet[(n >> 6) & 0x3F] : '=');
+        result.push_back(i + 2 < len ? kAlphabet[n & 0x3F] : '=');
+    }
+    return result;
+}
+
+// 逗号分隔的头部值中是否有 token（不区分大小写），例如 "Connection: keep-alive, Upgrade"
+bool containsToken(StringPiece value, const char *token)
+{
+    const char *p = value.begin();
+    const char *end = value.end();
+    while (p < end)
+    {
+        const char *comma = static_cast<const char*>(::memchr(p, ',', end - p));
+        const char *itemEnd = comma != nullptr ? comma : end;
+        while (p < itemEnd && (*p == ' ' || *p == '\t'))
+        {
+            ++p;
+        }
+        const char *q = itemEnd;
+        while (q > p && (q[-1] == ' ' || q[-1] == '\t'))
+        {
+            --q;
+        }
+        if (StringPiece(p, q - p).equalsIgnoreCase(token))
+        {
+            return true;
+        }
+        p = itemEnd + 1;
+    }
+    return false;
+}
+
+void sendHttpError(const TcpConnectionPtr &conn, int statusCode)
+{
+    HttpResponse response(true);
+    response.setStatusCode(statusCode);
+    if (statusCode == HttpResponse::k400BadRequest)
+    {
+        response.addHeader("Sec-WebSocket-Version", "13");
+    }
+    response.appendToBuffer(conn->outputBuffer());
+}
+
+} // namespace
+
+WebSocketServer::WebSocketServer(EventLoop *loop,
+                                const InetAddress &listenAddr,
+                                const std::string &name,
+                                TcpServer::Option option)
+    : loop_(loop)
+    , server_(loop, listenAddr, name, option)
+    , pingInterval_(kDefaultPingIntervalSeconds)
+    , pongTimeout_(kDefaultPongTimeoutSeconds)
+    , maxMessageBytes_(kDefaultMaxMessageBytes)
+    , pingFrame_(WebSocketFrame::encode(WebSocketFrame::kPing, StringPiece()))
+{
+    server_.setConnectionCallback(std::bind(&WebSocketServer::onConnection, this, std::placeholders::_1));
+    server_.setMessageCallback(std::bind(&WebSocketServer::onMessage, this,
+        std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    server_.setThreadInitcallback(std::bind(&WebSocketServer::initLoop, this, std::placeholders::_1));
+}
+
+// 子 loop 的定时器随线程退出一起销毁；只有 baseLoop 的定时器需要在这里取消
+WebSocketServer::~WebSocketServer()
+{
+    std::lock_guard<std::mutex> lock(loopStatesMutex_);
+    auto it = loopStates_.find(loop_);
+    if (it != loopStates_.end() && it->second->pingTimer.valid())
+    {
+        loop_->cancel(it->second->pingTimer);
+    }
+}
+
+void WebSocketServer::initLoop(EventLoop *loop)
+{
+    LoopState *state = new LoopState;
+    if (pingInterval_ > 0)
+    {
+        state->pingTimer = loop->runEvery(pingInterval_, std::bind(&WebSocketServer::onPingTimer, this, state));
+    }
+    {
+        std::lock_guard<std::mutex> lock(loopStatesMutex_);
+        loopStates_[loop].reset(state);
+    }
+    if (threadInitCallback_)
+    {
+        threadInitCallback_(loop);
+    }
+}
+
+std::string WebSocketServer::acceptKey(StringPiece key)
+{
+    std::string input(key.data(), key.size());
+    input.append(kWebSocketGuid);
+    unsigned char digest[20];
+    sha1(input.data(), input.size(), digest);
+    return base64Encode(digest, sizeof digest);
+}
+
+WebSocketServer::Session* WebSocketServer::getSession(const TcpConnectionPtr &conn)
+{
+    return static_cast<Session*>(conn->getContext().get());
+}
+
+void WebSocketServer::onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        LoopState *state = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(loopStatesMutex_);
+            state = loopStates_.find(conn->getLoop())->second.get();
+        }
+        std::shared_ptr<Session> session = std::make_shared<Session>(state);
+        session->lastReceived = Timestamp::now();
+        conn->setContext(session);
+        return;
+    }
+
+    Session *session = getSession(conn);
+    if (session != nullptr && session->loopState->connections.erase(conn) > 0 && closeCallback_)
+    {
+        closeCallback_(conn);
+    }
+}
+
+bool WebSocketServer::handshake(const TcpConnectionPtr &conn, Session *session, const HttpRequest &request)
+{
+    StringPiece key = request.getHeader("Sec-WebSocket-Key");
+    if (request.method() != HttpRequest::kGet
+        || request.version() != HttpRequest::kHttp11
+        || !containsToken(request.getHeader("Upgrade"), "websocket")
+        || !containsToken(request.getHeader("Connection"), "upgrade")
+        || request.getHeader("Sec-WebSocket-Version") != "13"
+        || key.size() != 24)
+    {
+        sendHttpError(conn, HttpResponse::k400BadRequest);
+        return false;
+    }
+    if (handshakeCallback_ && !handshakeCallback_(request))
+    {
+        sendHttpError(conn, HttpResponse::k403Forbidden);
+        return false;
+    }
+
+    HttpResponse response(false);
+    response.setStatusCode(HttpResponse::k101SwitchingProtocols);
+    response.addHeader("Upgrade", "websocket");
+    response.addHeader("Connection", "Upgrade");
+    response.addHeader("Sec-WebSocket-Accept", acceptKey(key));
+    response.appendToBuffer(conn->outputBuffer());
+
+    session->state = Session::kOpen;
+    session->loopState->connections.insert(conn);
+    if (openCallback_)
+    {
+        openCallback_(conn, request);
+    }
+    return true;
+}
+
+// 一次遍历解析 buf 中所有完整的帧，回调中发送的帧都写进 outputBuffer，最后统一移动读下标并发送
+void WebSocketServer::onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime)
+{
+    Session *session = getSession(conn);
+    session->lastReceived = receiveTime;
+
+    if (session->state == Session::kHandshake)
+    {
+        HttpContext::ParseResult result = session->handshake.parse(buf->peek(), buf->readableBytes(), receiveTime);
+        if (result == HttpContext::kNeedMore)
+        {
+            return;
+        }
+        if (result != HttpContext::kGotRequest || !handshake(conn, session, session->handshake.request()))
+        {
+            if (result != HttpContext::kGotRequest)
+            {
+                sendHttpError(conn, HttpResponse::k400BadRequest);
+            }
+            session->state = Session::kClosing;
+            buf->retrieveAll();
+            conn->flushOutputBuffer();
+            conn->shutdown();
+            return;
+        }
+        buf->retrieve(session->handshake.requestLength());
+        session->handshake.reset();
+    }
+    if (session->state != Session::kOpen)
+    {
+        buf->retrieveAll();
+        return;
+    }
+
+    char *data = buf->mutablePeek();
+    const size_t readable = buf->readableBytes();
+    size_t consumed = 0;
+    // 消息回调里发送的帧先编码进 outputBuffer，这一批帧全部处理完以后统一发送
+    OutputBatch batch(conn);
+    while (consumed < readable && session->state == Session::kOpen)
+    {
+        WebSocketFrame frame;
+        WebSocketFrame::ParseResult result = WebSocketFrame::parse(data + consumed, readable - consumed,
+            true, maxMessageBytes_, &frame);
+        if (result == WebSocketFrame::kNeedMore)
+        {
+            break;
+        }
+        if (result != WebSocketFrame::kGotFrame)
+        {
+            int code = result == WebSocketFrame::kTooLarge ? kMessageTooBig : kProtocolError;
+            LOG_ERROR("WebSocketServer::onMessage [%s] invalid frame, closing with %d \n", conn->name().c_str(), code);
+            closeInLoop(conn, code, std::string());
+            break;
+        }
+        consumed += frame.length;
+        handleFrame(conn, session, frame, receiveTime);
+    }
+
+    if (session->state != Session::kOpen)
+    {
+        buf->retrieveAll();
+        return;
+    }
+    buf->retrieve(consumed);
+}
+
+void WebSocketServer::handleFrame(const TcpConnectionPtr &conn, Session *session,
+                                  const WebSocketFrame &frame, Timestamp receiveTime)
+{
+    switch (frame.opcode)
+    {
+    case WebSocketFrame::kPing:
+        sendFrame(conn, WebSocketFrame::kPong, frame.payload);
+        return;
+    case WebSocketFrame::kPong:
+        return;
+    case WebSocketFrame::kClose:
+    {
+        // 回复对方的状态码，没有状态码时回复一个空的 close 帧
+        if (frame.payload.size() == 1)
+        {
+            closeInLoop(conn, kProtocolError, std::string());
+            return;
+        }
+        int code = 0;
+        if (frame.payload.size() >= 2)
+        {
+            code = (static_cast<unsigned char>(frame.payload[0]) << 8) | static_cast<unsigned char>(frame.payload[1]);
+        }
+        closeInLoop(conn, code, std::string());
+        return;
+    }
+    case WebSocketFrame::kText:
+    case WebSocketFrame::kBinary:
+        if (session->fragmented)
+        {
+            closeInLoop(conn, kProtocolError, std::string());
+            return;
+        }
+        if (frame.fin)
+        {
+            if (messageCallback_)
+            {
+                messageCallback_(conn, frame.payload, frame.opcode == WebSocketFrame::kBinary, receiveTime);
+            }
+            return;
+        }
+        session->fragmented = true;
+        session->fragmentOpcode = frame.opcode;
+        session->fragments.assign(frame.payload.data(), frame.payload.size());
+        return;
+    case WebSocketFrame::kContinuation:
+        if (!session->fragmented)
+        {
+            closeInLoop(conn, kProtocolError, std::string());
+            return;
+        }
+        if (frame.payload.size() > maxMessageBytes_ - session->fragments.size())
+        {
+            closeInLoop(conn, kMessageTooBig, std::string());
+            return;
+        }
+        session->fragments.append(frame.payload.data(), frame.payload.size());
+        if (frame.fin)
+        {
+            session->fragmented = false;
+            if (messageCallback_)
+            {
+                messageCallback_(conn, session->fragments, session->fragmentOpcode == WebSocketFrame::kBinary, receiveTime);
+            }
+            if (session->fragments.capacity() > kMaxRetainedFragmentCapacity)
+            {
+                std::string().swap(session->fragments);
+            }
+            session->fragments.clear();
+        }
+        return;
+    }
+}
+
+// 一个 loop 上所有连接共用一个定时器，收到任何数据都说明连接还活着，只给安静的连接发送 ping
+void WebSocketServer::onPingTimer(LoopState *state)
+{
+    Timestamp now = Timestamp::now();
+    std::vector<TcpConnectionPtr> expired;
+    for (const TcpConnectionPtr &conn : state->connections)
+    {
+        double idle = timeDifference(now, getSession(conn)->lastReceived);
+        if (idle >= pongTimeout_)
+        {
+            expired.push_back(conn);
+        }
+        else if (idle >= pingInterval_)
+        {
+            conn->send(pingFrame_);
+        }
+    }
+    for (const TcpConnectionPtr &conn : expired)
+    {
+        LOG_INFO("WebSocketServer::onPingTimer [%s] no pong, closing \n", conn->name().c_str());
+        conn->forceClose();
+    }
+}
+
+void WebSocketServer::sendText(const TcpConnectionPtr &conn, StringPiece payload)
+{
+    sendFrame(conn, WebSocketFrame::kText, payload);
+}
+
+void WebSocketServer::sendBinary(const TcpConnectionPtr &conn, StringPiece payload)
+{
+    sendFrame(conn, WebSocketFrame::kBinary, payload);
+}
+
+void WebSocketServer::sendFrame(const TcpConnectionPtr &conn, WebSocketFrame::Opcode opcode, StringPiece payload)
+{
+    if (!conn->getLoop()->isInLoopThread())
+    {
+        conn->send(WebSocketFrame::encode(opcode, payload));
+        return;
+    }
+    if (!conn->connected())
+    {
+        return;
+    }
+    WebSocketFrame::append(conn->outputBuffer(), opcode, payload);
+    OutputBatch::flush(conn);
+}
+
+void WebSocketServer::close(const TcpConnectionPtr &conn, int code, const std::string &reason)
+{
+    conn->getLoop()->runInLoop(std::bind(&WebSocketServer::closeInLoop, conn, code, reason));
+}
+
+// code 为 0 表示不带状态码。close 帧和之前写进 outputBuffer 的数据一起发送以后再关闭写端
+void WebSocketServer::closeInLoop(const TcpConnectionPtr &conn, int code, const std::string &reason)
+{
+    Session *session = getSession(conn);
+    if (session == nullptr || session->state != Session::kOpen || !conn->connected())
+    {
+        return;
+    }
+    session->state = Session::kClosing;
+    char payload[WebSocketFrame::kMaxControlPayload];
+    size_t len = 0;
+    if (code != 0)
+    {
+        payload[0] = static_cast<char>(code >> 8);
+        payload[1] = static_cast<char>(code);
+        len = 2 + std::min(reason.size(), sizeof payload - 2);
+        ::memcpy(payload + 2, reason.data(), len - 2);
+    }
+    WebSocketFrame::append(conn->outputBuffer(), WebSocketFrame::kClose, StringPiece(payload, len));
+    // 分发期间留给批次结束时发送，shutdown 等待这些数据发送以后才关闭写端
+    OutputBatch::flush(conn);
+    conn->shutdown();
+}
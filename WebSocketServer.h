@@ -0,0 +1,152 @@
+#pragma once
+
+#include "noncopyable.h"
+#include "TcpServer.h"
+#include "TimerId.h"
+#include "HttpContext.h"
+#include "HttpRequest.h"
+#include "StringPiece.h"
+#include "WebSocketFrame.h"
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+
+/**
+ * 基于 TcpServer 的 WebSocket（RFC 6455）服务器。
+ * 连接先用 HttpContext 解析升级请求，握手成功后在同一个 inputBuffer 上逐帧解析：负载原地解掩码，
+ * 未分片的消息以指向 inputBuffer 的视图回调，不拷贝；分片的消息在连接上拼接完整以后回调。
+ * 一次 onMessage 中回调产生的帧（包括自动回复的 pong）都写进 outputBuffer，最后统一发送一次。
+ *
+ * 心跳由每个 loop 一个的定时器驱动：每隔 pingInterval 检查该 loop 上的连接，超过 pingInterval
+ * 没有收到任何数据的连接发送 ping，超过 pongTimeout 的连接被关闭。
+ * 推送同一条消息给很多连接时，用 WebSocketFrame::encode 编码一次，再对每个连接 send 这段共享的字节。
+ * 不支持扩展和子协议协商，不校验文本消息的 UTF-8 编码。必须在 loop 线程中析构。
+ */
+class WebSocketServer : noncopyable
+{
+public:
+    enum CloseCode
+    {
+        kNormalClosure = 1000,
+        kGoingAway = 1001,
+        kProtocolError = 1002,
+        kMessageTooBig = 1009,
+    };
+
+    // 返回 false 拒绝升级，回复 403
+    using HandshakeCallback = std::function<bool (const HttpRequest&)>;
+    using OpenCallback = std::function<void (const TcpConnectionPtr&, const HttpRequest&)>;
+    // payload 只在回调期间有效
+    using MessageCallback = std::function<void (const TcpConnectionPtr&, StringPiece payload, bool binary, Timestamp)>;
+    using CloseCallback = std::function<void (const TcpConnectionPtr&)>;
+
+    static const size_t kDefaultMaxMessageBytes = 8 * 1024 * 1024;
+    static const int kDefaultPingIntervalSeconds = 30;
+    static const int kDefaultPongTimeoutSeconds = 60;
+
+    WebSocketServer(EventLoop *loop,
+                    const InetAddress &listenAddr,
+                    const std::string &name,
+                    TcpServer::Option option = TcpServer::kNoReusePort);
+    ~WebSocketServer();
+
+    EventLoop* getLoop() const { return loop_; }
+    // 用于设置 socket 选项、TLS 等，必须在 start 之前。线程初始化回调使用 setThreadInitCallback
+    TcpServer* tcpServer() { return &server_; }
+
+    // 以下回调都在连接所在的 loop 线程中调用
+    void setHandshakeCallback(const HandshakeCallback &cb) { handshakeCallback_ = cb; }
+    void setOpenCallback(const OpenCallback &cb) { openCallback_ = cb; }
+    void setMessageCallback(const MessageCallback &cb) { messageCallback_ = cb; }
+    // 握手成功的连接断开时回调
+    void setCloseCallback(const CloseCallback &cb) { closeCallback_ = cb; }
+
+    void setThreadNum(int numThreads) { server_.setThreadNum(numThreads); }
+    void setThreadInitCallback(const TcpServer::ThreadInitCallback &cb) { threadInitCallback_ = cb; }
+    // 单位秒，必须在 start 之前设置。interval 为 0 时关闭心跳
+    void setPingInterval(double interval, double pongTimeout)
+    { pingInterval_ = interval; pongTimeout_ = pongTimeout; }
+    // 单个消息（分片拼接以后）的长度上限，超过时以 1009 关闭连接
+    void setMaxMessageBytes(size_t maxBytes) { maxMessageBytes_ = maxBytes; }
+
+    void start() { server_.start(); }
+
+    // 以下函数可以在任意线程调用。在 loop 线程中调用时帧直接编码进 outputBuffer，
+    // 如果正处于这个连接的消息回调中，留到回调全部结束以后统一发送
+    static void sendText(const TcpConnectionPtr &conn, StringPiece payload);
+    static void sendBinary(const TcpConnectionPtr &conn, StringPiece payload);
+    // 发送 close 帧并关闭写端，reason 最多 123 字节
+    static void close(const TcpConnectionPtr &conn, int code = kNormalClosure, const std::string &reason = std::string());
+
+    // Sec-WebSocket-Accept = base64(SHA1(key + GUID))
+    static std::string acceptKey(StringPiece key);
+
+private:
+    struct LoopState;
+
+    struct Session
+    {
+        enum State
+        {
+            kHandshake,
+            kOpen,
+            kClosing,       // 已经发送 close 帧或者握手失败，之后收到的数据都丢弃
+        };
+
+        explicit Session(LoopState *state)
+            : handshake(HttpContext::kDefaultMaxHeaderBytes, 0)
+            , state(kHandshake)
+            , fragmented(false)
+            , fragmentOpcode(WebSocketFrame::kText)
+            , loopState(state)
+        {}
+
+        HttpContext handshake;
+        State state;
+        Timestamp lastReceived;
+        bool fragmented;        // 正在接收一个分片的消息
+        WebSocketFrame::Opcode fragmentOpcode;
+        std::string fragments;
+        LoopState *loopState;
+    };
+
+    // 每个 loop 一份，只在该 loop 线程中访问
+    struct LoopState
+    {
+        std::unordered_set<TcpConnectionPtr> connections;   // 握手成功、还没有断开的连接
+        TimerId pingTimer;
+    };
+
+    using LoopStateMap = std::unordered_map<EventLoop*, std::unique_ptr<LoopState>>;
+
+    void initLoop(EventLoop *loop);
+    void onConnection(const TcpConnectionPtr &conn);
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp receiveTime);
+    // 处理升级请求并写好响应，返回是否升级成功
+    bool handshake(const TcpConnectionPtr &conn, Session *session, const HttpRequest &request);
+    void handleFrame(const TcpConnectionPtr &conn, Session *session, const WebSocketFrame &frame, Timestamp receiveTime);
+    void onPingTimer(LoopState *state);
+
+    static Session* getSession(const TcpConnectionPtr &conn);
+    static void sendFrame(const TcpConnectionPtr &conn, WebSocketFrame::Opcode opcode, StringPiece payload);
+    static void closeInLoop(const TcpConnectionPtr &conn, int code, const std::string &reason);
+
+    EventLoop *loop_;
+    // 在 loop 线程初始化时创建，start 以后不再修改。声明在 server_ 之前，保证 loop 线程全部退出以后才销毁
+    std::mutex loopStatesMutex_;
+    LoopStateMap loopStates_;
+    TcpServer server_;
+    HandshakeCallback handshakeCallback_;
+    OpenCallback openCallback_;
+    MessageCallback messageCallback_;
+    CloseCallback closeCallback_;
+    TcpServer::ThreadInitCallback threadInitCallback_;
+    double pingInterval_;
+    double pongTimeout_;
+    size_t maxMessageBytes_;
+    SharedString pingFrame_;    // 所有连接共用的空 ping 帧
+};
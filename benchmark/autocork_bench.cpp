@@ -0,0 +1,153 @@
+/**
+ * 发送合并（auto-cork）基准测试（loopback）：客户端一次写出 depth 个流水线请求，
+ * 服务端在 MessageCallback 中对每个请求单独 send 一个小响应。
+ *   off: 每次 send 立即 write，一个响应一次系统调用
+ *   on:  TcpConnection::setAutoCork(true)，本轮循环的响应在末尾用一次 writev 发出
+ * 输出每个请求的系统调用次数以及每秒处理的请求数。
+ *
+ * 用法: autocork_bench [port] [requests_per_run]
+ */
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace
+{
+
+const size_t kRequestSize = 16;
+const size_t kResponseSize = 48;
+
+int g_requestsPerRun = 200000;
+std::atomic_bool g_autoCork(false);
+std::atomic<uint64_t> g_writeCalls(0);
+std::atomic_bool g_statsReady(false);
+
+void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    static const std::string response(kResponseSize, 'p');
+    while (buf->readableBytes() >= kRequestSize)
+    {
+        buf->retrieve(kRequestSize);
+        conn->send(response);
+    }
+}
+
+void onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        conn->setTcpNoDelay(true);
+        conn->setAutoCork(g_autoCork);
+    }
+    else
+    {
+        g_writeCalls = conn->sendStats().writeCalls;
+        g_statsReady = true;
+    }
+}
+
+bool readAll(int fd, char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = ::read(fd, data, len);
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+void runClient(uint16_t port, bool autoCork, int depth)
+{
+    g_autoCork = autoCork;
+    g_statsReady = false;
+
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+
+    std::string requests(kRequestSize * depth, 'q');
+    std::string responses(kResponseSize * depth, '\0');
+    int rounds = g_requestsPerRun / depth;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < rounds; ++i)
+    {
+        if (::write(fd, requests.data(), requests.size()) != static_cast<ssize_t>(requests.size())
+            || !readAll(fd, &responses[0], responses.size()))
+        {
+            fprintf(stderr, "connection broken\n");
+            exit(1);
+        }
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ::close(fd);
+
+    while (!g_statsReady)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    int totalRequests = rounds * depth;
+    printf("autocork=%-3s depth=%-3d %6.3f syscalls/req %10.0f req/s\n",
+        autoCork ? "on" : "off", depth,
+        static_cast<double>(g_writeCalls) / totalRequests, totalRequests / sec);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 屏蔽库内部输出到 std::cout 的日志，只保留 printf 输出的测试结果
+    std::cout.setstate(std::ios_base::badbit);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    uint16_t port = static_cast<uint16_t>(argc > 1 ? atoi(argv[1]) : 9988);
+    if (argc > 2)
+    {
+        g_requestsPerRun = atoi(argv[2]);
+    }
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "AutoCorkBench");
+    server.setConnectionCallback(onConnection);
+    server.setMessageCallback(onMessage);
+    server.start();
+
+    std::thread client([&loop, port]() {
+        const int depths[] = { 1, 4, 16, 64 };
+        for (int depth : depths)
+        {
+            runClient(port, false, depth);
+            runClient(port, true, depth);
+        }
+        loop.quit();
+    });
+
+    loop.loop();
+    client.join();
+    return 0;
+}
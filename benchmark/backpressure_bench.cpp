@@ -0,0 +1,198 @@
+/**
+ * 读背压基准测试（loopback）：客户端 => 代理 => 后端，后端是一个慢速读者
+ *   none:         代理把收到的数据直接 send 给后端，来不及发送的数据堆积在代理的发送队列中
+ *   backpressure: TcpConnection::setReadBackpressure，后端的发送队列过长时暂停读取客户端
+ * 输出代理发送队列的峰值以及进程的峰值 RSS（先运行 backpressure，RSS 峰值只增不减）。
+ *
+ * 用法: backpressure_bench [port] [total_mb]
+ */
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+
+namespace
+{
+
+const size_t kHighMark = 1024 * 1024;
+const size_t kLowMark = 256 * 1024;
+
+// 以下状态只在 loop 线程中访问，peak 在连接断开以后由客户端线程读取
+TcpConnectionPtr g_backend;
+std::map<TcpConnection*, std::weak_ptr<TcpConnection>> g_peers;
+std::atomic<size_t> g_peakQueued(0);
+
+void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    auto it = g_peers.find(conn.get());
+    if (it != g_peers.end())
+    {
+        TcpConnectionPtr peer = it->second.lock();
+        if (peer)
+        {
+            peer->send(buf);
+            if (peer->outputBytes() > g_peakQueued)
+            {
+                g_peakQueued = peer->outputBytes();
+            }
+        }
+        buf->retrieveAll();
+        return;
+    }
+
+    char kind = buf->readInt8();
+    if (kind == 'B')
+    {
+        g_backend = conn;
+        conn->send(std::string("k"));
+        return;
+    }
+    TcpConnectionPtr backend = g_backend;
+    g_backend.reset();
+    g_peers[conn.get()] = backend;
+    g_peers[backend.get()] = conn;
+    if (kind == 'b')
+    {
+        conn->setReadBackpressure(kHighMark, kLowMark, backend);
+        backend->setReadBackpressure(kHighMark, kLowMark, conn);
+    }
+    backend->send(buf);
+}
+
+void onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        return;
+    }
+    auto it = g_peers.find(conn.get());
+    if (it != g_peers.end())
+    {
+        TcpConnectionPtr peer = it->second.lock();
+        g_peers.erase(it);
+        if (peer)
+        {
+            g_peers.erase(peer.get());
+            peer->shutdown();
+        }
+    }
+}
+
+long peakRssKb()
+{
+    rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+int connectTo(uint16_t port)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+void runOne(uint16_t port, bool backpressure, size_t total)
+{
+    g_peakQueued = 0;
+    int backend = connectTo(port);
+    char ack;
+    if (::write(backend, "B", 1) != 1 || ::read(backend, &ack, 1) != 1)
+    {
+        fprintf(stderr, "backend handshake failed\n");
+        exit(1);
+    }
+    int client = connectTo(port);
+
+    auto start = std::chrono::steady_clock::now();
+    // 慢速读者：每毫秒读取 64KB
+    std::thread sink([backend, total]() {
+        std::string buf(64 * 1024, '\0');
+        size_t received = 0;
+        while (received < total)
+        {
+            ssize_t n = ::read(backend, &buf[0], buf.size());
+            if (n <= 0)
+            {
+                fprintf(stderr, "connection broken\n");
+                exit(1);
+            }
+            received += n;
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+    });
+
+    std::string chunk(256 * 1024, 'r');
+    chunk[0] = backpressure ? 'b' : 'n';
+    size_t sent = 0;
+    while (sent < total + 1)
+    {
+        ssize_t n = ::write(client, chunk.data(), std::min(chunk.size(), total + 1 - sent));
+        if (n <= 0)
+        {
+            perror("write");
+            exit(1);
+        }
+        sent += n;
+        chunk[0] = 'r';
+    }
+    sink.join();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ::close(client);
+    ::close(backend);
+
+    printf("%-12s total=%zuMB %6.2f s  peak queued=%8.1f KB  peak rss=%8ld KB\n",
+        backpressure ? "backpressure" : "none", total >> 20, sec,
+        g_peakQueued / 1024.0, peakRssKb());
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 屏蔽库内部输出到 std::cout 的日志，只保留 printf 输出的测试结果
+    std::cout.setstate(std::ios_base::badbit);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    uint16_t port = static_cast<uint16_t>(argc > 1 ? atoi(argv[1]) : 9990);
+    size_t total = static_cast<size_t>(argc > 2 ? atoi(argv[2]) : 128) << 20;
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "BackpressureBench");
+    server.setConnectionCallback(onConnection);
+    server.setMessageCallback(onMessage);
+    server.start();
+
+    std::thread client([&loop, port, total]() {
+        runOne(port, true, total);
+        runOne(port, false, total);
+        loop.quit();
+    });
+
+    loop.loop();
+    client.join();
+    return 0;
+}
@@ -0,0 +1,204 @@
+/**
+ * 广播基准测试（loopback）：把同一条消息推送给分布在多个 sub loop 上的大量订阅连接
+ *   copy:   对每个连接调用 send(const std::string&)，每个连接各自拷贝一份消息
+ *   shared: TcpServer::broadcast(SharedString)，每个 loop 投递一次，所有连接引用同一份内存
+ * 客户端连接使用很小的接收缓冲区，模拟来不及读取的订阅者；用一个 epoll 线程接收全部数据。
+ * 输出从开始广播到所有连接收完的时间（订阅者在广播 100ms 后才开始读取），以及期间进程 RSS 相对开始时的峰值增量。
+ *
+ * 用法: broadcast_bench [port] [connections] [message_kb] [messages]
+ */
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+std::mutex g_mutex;
+std::vector<TcpConnectionPtr> g_connections;   // 由 g_mutex 保护
+
+void onConnection(const TcpConnectionPtr &conn)
+{
+    std::unique_lock<std::mutex> lock(g_mutex);
+    if (conn->connected())
+    {
+        g_connections.push_back(conn);
+    }
+}
+
+size_t connectionCount()
+{
+    std::unique_lock<std::mutex> lock(g_mutex);
+    return g_connections.size();
+}
+
+// 当前进程的常驻内存，单位 KB
+long currentRssKb()
+{
+    long pages = 0;
+    long resident = 0;
+    FILE *fp = ::fopen("/proc/self/statm", "r");
+    if (fp != nullptr)
+    {
+        if (::fscanf(fp, "%ld %ld", &pages, &resident) != 2)
+        {
+            resident = 0;
+        }
+        ::fclose(fp);
+    }
+    return resident * (::sysconf(_SC_PAGESIZE) / 1024);
+}
+
+int connectTo(uint16_t port)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    int rcvbuf = 4096;
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof rcvbuf);
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    ::fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+void runOne(TcpServer *server, int epfd, size_t messageSize, int messages, bool shared)
+{
+    std::vector<TcpConnectionPtr> conns;
+    {
+        std::unique_lock<std::mutex> lock(g_mutex);
+        conns = g_connections;
+    }
+    const size_t expected = conns.size() * messageSize * messages;
+    const std::string message(messageSize, 'b');
+
+    long baseRss = currentRssKb();
+    long peakRss = baseRss;
+    auto start = std::chrono::steady_clock::now();
+    for (int m = 0; m < messages; ++m)
+    {
+        if (shared)
+        {
+            server->broadcast(std::make_shared<const std::string>(message));
+        }
+        else
+        {
+            for (const TcpConnectionPtr &conn : conns)
+            {
+                conn->send(message);
+            }
+        }
+    }
+
+    // 等各个 loop 把消息放入发送队列，订阅者再开始读取
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    peakRss = std::max(peakRss, currentRssKb());
+
+    size_t received = 0;
+    char buf[64 * 1024];
+    epoll_event events[256];
+    auto lastSample = start;
+    while (received < expected)
+    {
+        int n = ::epoll_wait(epfd, events, 256, 1000);
+        for (int i = 0; i < n; ++i)
+        {
+            ssize_t nread;
+            while ((nread = ::read(events[i].data.fd, buf, sizeof buf)) > 0)
+            {
+                received += nread;
+            }
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (now - lastSample > std::chrono::milliseconds(5))
+        {
+            lastSample = now;
+            peakRss = std::max(peakRss, currentRssKb());
+        }
+    }
+    double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    printf("%-6s connections=%zu message=%zuKB x %d %9.1f ms  peak rss +%8.1f MB\n",
+        shared ? "shared" : "copy", conns.size(), messageSize / 1024, messages,
+        ms, (peakRss - baseRss) / 1024.0);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 屏蔽库内部输出到 std::cout 的日志，只保留 printf 输出的测试结果
+    std::cout.setstate(std::ios_base::badbit);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    uint16_t port = static_cast<uint16_t>(argc > 1 ? atoi(argv[1]) : 9991);
+    int connections = argc > 2 ? atoi(argv[2]) : 1000;
+    size_t messageSize = static_cast<size_t>(argc > 3 ? atoi(argv[3]) : 256) * 1024;
+    int messages = argc > 4 ? atoi(argv[4]) : 4;
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "BroadcastBench");
+    server.setThreadNum(4);
+    server.setConnectionCallback(onConnection);
+    server.setMessageCallback([](const TcpConnectionPtr&, Buffer *buf, Timestamp) { buf->retrieveAll(); });
+    server.start();
+
+    std::thread client([&]() {
+        int epfd = ::epoll_create1(EPOLL_CLOEXEC);
+        std::vector<int> fds;
+        for (int i = 0; i < connections; ++i)
+        {
+            int fd = connectTo(port);
+            epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            ::epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+            fds.push_back(fd);
+        }
+        while (connectionCount() < fds.size())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        // 先运行 shared，避免 copy 模式释放后留在分配器中的内存影响 RSS 的基线
+        runOne(&server, epfd, messageSize, messages, true);
+        runOne(&server, epfd, messageSize, messages, false);
+
+        {
+            std::unique_lock<std::mutex> lock(g_mutex);
+            g_connections.clear();
+        }
+        for (int fd : fds)
+        {
+            ::close(fd);
+        }
+        ::close(epfd);
+        loop.quit();
+    });
+
+    loop.loop();
+    client.join();
+    return 0;
+}
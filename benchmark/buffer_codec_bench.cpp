@@ -0,0 +1,133 @@
+/**
+ * 长度头 + 消息体 小帧的编解码基准测试
+ * encode: 先在 std::string 中拼好长度头和消息体再 append，对比先 append 消息体再 prependInt32
+ * decode: 把消息体拷贝成 std::string 取出，对比直接用 peekInt32 / peek() 就地访问
+ */
+#include "Buffer.h"
+
+#include <arpa/inet.h>
+#include <stdio.h>
+#include <string.h>
+#include <chrono>
+#include <string>
+
+namespace
+{
+
+const int kMessages = 1000000;
+const size_t kBodySizes[] = { 16, 64, 256, 1024 };
+
+// 防止编译器把基准测试的结果优化掉
+volatile size_t g_sink = 0;
+
+double elapsedNs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+}
+
+// 旧做法：先把长度头写进临时 string，再拼接消息体
+double encodeByCopy(const std::string &body)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kMessages; ++i)
+    {
+        Buffer out;
+        std::string frame;
+        int32_t be32 = htonl(static_cast<uint32_t>(body.size()));
+        frame.append(reinterpret_cast<const char*>(&be32), sizeof be32);
+        frame.append(body);
+        out.append(frame.data(), frame.size());
+        g_sink += out.readableBytes();
+    }
+    return elapsedNs(start) / kMessages;
+}
+
+// 新做法：直接序列化消息体，再把长度头放进 cheap prepend 区域
+double encodeByPrepend(const std::string &body)
+{
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kMessages; ++i)
+    {
+        Buffer out;
+        out.append(body.data(), body.size());
+        out.prependInt32(static_cast<int32_t>(body.size()));
+        g_sink += out.readableBytes();
+    }
+    return elapsedNs(start) / kMessages;
+}
+
+void fillFrames(Buffer *buf, const std::string &body, int count)
+{
+    for (int i = 0; i < count; ++i)
+    {
+        buf->appendInt32(static_cast<int32_t>(body.size()));
+        buf->append(body.data(), body.size());
+    }
+}
+
+double decodeByCopy(const std::string &body)
+{
+    const int kBatch = 1000;
+    double total = 0;
+    for (int round = 0; round < kMessages / kBatch; ++round)
+    {
+        Buffer in;
+        fillFrames(&in, body, kBatch);
+        auto start = std::chrono::steady_clock::now();
+        while (in.readableBytes() >= sizeof(int32_t))
+        {
+            int32_t be32 = 0;
+            ::memcpy(&be32, in.peek(), sizeof be32);
+            size_t len = ntohl(be32);
+            if (in.readableBytes() < sizeof(int32_t) + len)
+            {
+                break;
+            }
+            in.retrieve(sizeof(int32_t));
+            std::string msg = in.retrieveAsString(len);
+            g_sink += msg.size();
+        }
+        total += elapsedNs(start);
+    }
+    return total / kMessages;
+}
+
+double decodeInPlace(const std::string &body)
+{
+    const int kBatch = 1000;
+    double total = 0;
+    for (int round = 0; round < kMessages / kBatch; ++round)
+    {
+        Buffer in;
+        fillFrames(&in, body, kBatch);
+        auto start = std::chrono::steady_clock::now();
+        while (in.readableBytes() >= sizeof(int32_t))
+        {
+            size_t len = static_cast<size_t>(in.peekInt32());
+            if (in.readableBytes() < sizeof(int32_t) + len)
+            {
+                break;
+            }
+            g_sink += static_cast<unsigned char>(in.peek()[sizeof(int32_t)]) + len;
+            in.retrieve(sizeof(int32_t) + len);
+        }
+        total += elapsedNs(start);
+    }
+    return total / kMessages;
+}
+
+} // namespace
+
+int main()
+{
+    for (size_t bodySize : kBodySizes)
+    {
+        std::string body(bodySize, 'x');
+        printf("body=%-5zu encode copy %7.1f ns/msg  prepend %7.1f ns/msg  "
+               "decode copy %7.1f ns/msg  in-place %7.1f ns/msg\n",
+            bodySize,
+            encodeByCopy(body), encodeByPrepend(body),
+            decodeByCopy(body), decodeInPlace(body));
+    }
+    return 0;
+}
@@ -0,0 +1,165 @@
+/**
+ * Buffer 查找内核的微基准测试
+ * 对每种行长度构造约 8MB 的文本，分别用标量 / SSE2 / AVX2 内核逐行查找分隔符，
+ * 输出每行耗时和扫描带宽。
+ */
+#include "Buffer.h"
+#include "BufferSearch.h"
+
+#include <stdio.h>
+#include <chrono>
+#include <string>
+#include <vector>
+
+namespace
+{
+
+const size_t kTotalBytes = 8 * 1024 * 1024;
+const size_t kLineLengths[] = { 8, 32, 128, 512, 2048, 8192, 65536 };
+
+enum Kernel
+{
+    kFindCRLF,
+    kFindEOL,
+    kFindByte,
+    kFindAny,
+};
+
+const char* kernelName(Kernel k)
+{
+    switch (k)
+    {
+    case kFindCRLF: return "findCRLF";
+    case kFindEOL:  return "findEOL";
+    case kFindByte: return "findByte";
+    default:        return "findAny";
+    }
+}
+
+// 构造每行长度为 lineLen（含 "\r\n"）的文本，行内容不含任何被查找的字符
+std::string makeLines(size_t lineLen)
+{
+    std::string line(lineLen - 2, 'a');
+    line += "\r\n";
+    std::string text;
+    text.reserve(kTotalBytes + lineLen);
+    while (text.size() < kTotalBytes)
+    {
+        text += line;
+    }
+    return text;
+}
+
+const char* runKernel(Kernel k, BufferSearch::Impl impl, const char *begin, const char *end)
+{
+    switch (k)
+    {
+    case kFindCRLF: return BufferSearch::findCRLF(impl, begin, end);
+    case kFindEOL:  return BufferSearch::findByte(impl, begin, end, '\n');
+    case kFindByte: return BufferSearch::findByte(impl, begin, end, '\r');
+    default:        return BufferSearch::findAny(impl, begin, end, "\r\n:;");
+    }
+}
+
+// 逐行扫描整段文本，返回找到的行数
+size_t scanAll(Kernel k, BufferSearch::Impl impl, const std::string &text)
+{
+    const char *p = text.data();
+    const char *end = p + text.size();
+    size_t lines = 0;
+    while (p < end)
+    {
+        const char *hit = runKernel(k, impl, p, end);
+        if (hit == nullptr)
+        {
+            break;
+        }
+        ++lines;
+        p = hit + 1;
+    }
+    return lines;
+}
+
+void bench(Kernel k, BufferSearch::Impl impl, size_t lineLen, const std::string &text)
+{
+    const int kRounds = 20;
+    size_t lines = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < kRounds; ++i)
+    {
+        lines += scanAll(k, impl, text);
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    double bytes = static_cast<double>(text.size()) * kRounds;
+    printf("%-9s %-7s line=%-6zu %10.2f ns/line %8.2f GB/s\n",
+        kernelName(k), BufferSearch::implName(impl), lineLen,
+        lines ? ns / lines : 0.0, bytes / ns);
+}
+
+// 模拟按块到达的报文：每次 readFd 追加一小块，使用 offset 只扫描新到的数据
+void benchIncremental(size_t lineLen)
+{
+    const size_t kChunk = 1460;
+    std::string text = makeLines(lineLen);
+
+    auto start = std::chrono::steady_clock::now();
+    Buffer buf;
+    size_t scanned = 0;
+    size_t lines = 0;
+    for (size_t pos = 0; pos < text.size(); pos += kChunk)
+    {
+        buf.append(text.data() + pos, std::min(kChunk, text.size() - pos));
+        const char *crlf;
+        while ((crlf = buf.findCRLF(scanned)) != nullptr)
+        {
+            buf.retrieveUntil(crlf + 2);
+            scanned = 0;
+            ++lines;
+        }
+        // 最后一个字节可能是 '\r'，需要留到下一块到达后再判断
+        scanned = buf.readableBytes() > 0 ? buf.readableBytes() - 1 : 0;
+    }
+    auto end = std::chrono::steady_clock::now();
+
+    double ns = std::chrono::duration<double, std::nano>(end - start).count();
+    printf("Buffer::findCRLF(offset) %-7s line=%-6zu %10.2f ns/line %8.2f GB/s\n",
+        BufferSearch::implName(BufferSearch::currentImpl()), lineLen,
+        lines ? ns / lines : 0.0, text.size() / ns);
+}
+
+} // namespace
+
+int main()
+{
+    std::vector<BufferSearch::Impl> impls;
+    const BufferSearch::Impl all[] = { BufferSearch::kScalar, BufferSearch::kSse2, BufferSearch::kAvx2 };
+    for (BufferSearch::Impl impl : all)
+    {
+        if (BufferSearch::supported(impl))
+        {
+            impls.push_back(impl);
+        }
+    }
+
+    printf("dispatch: %s\n", BufferSearch::implName(BufferSearch::currentImpl()));
+    const Kernel kernels[] = { kFindCRLF, kFindEOL, kFindByte, kFindAny };
+    for (size_t lineLen : kLineLengths)
+    {
+        std::string text = makeLines(lineLen);
+        for (Kernel k : kernels)
+        {
+            for (BufferSearch::Impl impl : impls)
+            {
+                bench(k, impl, lineLen, text);
+            }
+        }
+    }
+
+    for (size_t lineLen : kLineLengths)
+    {
+        benchIncremental(lineLen);
+    }
+    return 0;
+}
@@ -0,0 +1,181 @@
+/**
+ * LengthHeaderCodec 流水线小帧吞吐量基准测试（loopback）
+ * 客户端线程使用阻塞 socket，每次 write 一批 depth 个帧，再读回全部回显后发送下一批。
+ * 服务端分别使用两种方式回显：
+ *   naive: 在 MessageCallback 里逐帧 retrieveAsString，再逐帧 conn->send
+ *   codec: LengthHeaderCodec 一次解析所有帧，回复编码进 outputBuffer 后统一发送
+ *
+ * 用法: codec_bench [port] [frames_per_run]
+ */
+#include "TcpServer.h"
+#include "LengthHeaderCodec.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <thread>
+
+namespace
+{
+
+int g_framesPerRun = 10000;
+
+std::atomic_bool g_useCodec(false);
+
+void onFrame(LengthHeaderCodec *codec, const TcpConnectionPtr &conn, const char *data, size_t len, Timestamp)
+{
+    codec->send(conn, data, len);
+}
+
+// 旧的写法：每一帧都拷贝成 string 再单独发送
+void onNaiveMessage(const TcpConnectionPtr &conn, Buffer *buf)
+{
+    while (buf->readableBytes() >= LengthHeaderCodec::kHeaderLen)
+    {
+        const size_t len = static_cast<uint32_t>(buf->peekInt32());
+        if (buf->readableBytes() < LengthHeaderCodec::kHeaderLen + len)
+        {
+            break;
+        }
+        buf->retrieve(LengthHeaderCodec::kHeaderLen);
+        std::string body = buf->retrieveAsString(len);
+        std::string frame;
+        int32_t be32 = htonl(static_cast<uint32_t>(len));
+        frame.append(reinterpret_cast<const char*>(&be32), sizeof be32);
+        frame.append(body);
+        conn->send(frame);
+    }
+}
+
+bool writeAll(int fd, const char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = ::write(fd, data, len);
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+bool readAll(int fd, char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = ::read(fd, data, len);
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+void runClient(uint16_t port, size_t frameSize, int depth, bool useCodec)
+{
+    g_useCodec = useCodec;
+
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+
+    Buffer frame;
+    frame.appendInt32(static_cast<int32_t>(frameSize));
+    frame.append(std::string(frameSize, 'x').data(), frameSize);
+    std::string batch;
+    for (int i = 0; i < depth; ++i)
+    {
+        batch.append(frame.peek(), frame.readableBytes());
+    }
+    std::string reply(batch.size(), '\0');
+
+    auto start = std::chrono::steady_clock::now();
+    for (int sent = 0; sent < g_framesPerRun; sent += depth)
+    {
+        if (!writeAll(fd, batch.data(), batch.size()) || !readAll(fd, &reply[0], reply.size()))
+        {
+            fprintf(stderr, "connection broken\n");
+            exit(1);
+        }
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ::close(fd);
+
+    printf("%-5s frame=%-5zu depth=%-4d %10.0f frames/s %8.1f MB/s\n",
+        useCodec ? "codec" : "naive", frameSize, depth,
+        g_framesPerRun / sec, g_framesPerRun * (frameSize + 4) / sec / 1e6);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 屏蔽库内部输出到 std::cout 的日志，只保留 printf 输出的测试结果
+    std::cout.setstate(std::ios_base::badbit);
+
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+    uint16_t port = static_cast<uint16_t>(argc > 1 ? atoi(argv[1]) : 9981);
+    if (argc > 2)
+    {
+        g_framesPerRun = atoi(argv[2]);
+    }
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "CodecBench");
+    LengthHeaderCodec codec(std::bind(&onFrame, &codec, std::placeholders::_1,
+        std::placeholders::_2, std::placeholders::_3, std::placeholders::_4));
+    server.setConnectionCallback([](const TcpConnectionPtr&) {});
+    server.setMessageCallback([&codec](const TcpConnectionPtr &conn, Buffer *buf, Timestamp t) {
+        if (g_useCodec)
+        {
+            codec.onMessage(conn, buf, t);
+        }
+        else
+        {
+            onNaiveMessage(conn, buf);
+        }
+    });
+    server.start();
+
+    std::thread client([&loop, port]() {
+        const size_t sizes[] = { 16, 64, 256 };
+        const int depths[] = { 1, 16, 128 };
+        for (size_t size : sizes)
+        {
+            for (int depth : depths)
+            {
+                runClient(port, size, depth, false);
+                runClient(port, size, depth, true);
+            }
+        }
+        loop.quit();
+    });
+
+    loop.loop();
+    client.join();
+    return 0;
+}
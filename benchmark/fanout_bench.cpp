@@ -0,0 +1,195 @@
+/**
+ * 跨线程发送基准测试（loopback）：若干工作线程把消息推送给分布在多个 sub loop 上的大量连接
+ *   shared: 旧的做法，每次发送拷贝进 shared_ptr<string>，单独 queueInLoop 一个函数
+ *   move:   TcpConnection::send(std::string&&)，接管数据，同一线程发往同一个 loop 的发送合并为一批
+ * 客户端用一个 epoll 线程接收所有连接的数据，输出每秒送达的消息数。
+ *
+ * 用法: fanout_bench [port] [connections] [workers] [rounds]
+ */
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const size_t kMessageSize = 64;
+
+std::mutex g_mutex;
+std::vector<TcpConnectionPtr> g_connections;   // 由 g_mutex 保护
+
+void onConnection(const TcpConnectionPtr &conn)
+{
+    std::unique_lock<std::mutex> lock(g_mutex);
+    if (conn->connected())
+    {
+        g_connections.push_back(conn);
+    }
+}
+
+size_t connectionCount()
+{
+    std::unique_lock<std::mutex> lock(g_mutex);
+    return g_connections.size();
+}
+
+int connectTo(uint16_t port)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    ::fcntl(fd, F_SETFL, O_NONBLOCK);
+    return fd;
+}
+
+// 工作线程：对自己负责的连接逐轮推送消息
+void produce(const std::vector<TcpConnectionPtr> &conns, size_t begin, size_t end, int rounds, bool move)
+{
+    const std::string message(kMessageSize, 'm');
+    for (int r = 0; r < rounds; ++r)
+    {
+        for (size_t i = begin; i < end; ++i)
+        {
+            const TcpConnectionPtr &conn = conns[i];
+            if (move)
+            {
+                conn->send(std::string(message));
+            }
+            else
+            {
+                std::shared_ptr<std::string> copy = std::make_shared<std::string>(message);
+                conn->getLoop()->queueInLoop([conn, copy]() { conn->send(*copy); });
+            }
+        }
+    }
+}
+
+void runOne(int epfd, int workers, int rounds, bool move)
+{
+    std::vector<TcpConnectionPtr> conns;
+    {
+        std::unique_lock<std::mutex> lock(g_mutex);
+        conns = g_connections;
+    }
+    const size_t expected = conns.size() * rounds * kMessageSize;
+
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> threads;
+    size_t per = (conns.size() + workers - 1) / workers;
+    for (int w = 0; w < workers; ++w)
+    {
+        size_t begin = std::min(conns.size(), w * per);
+        size_t end = std::min(conns.size(), begin + per);
+        threads.emplace_back(produce, std::cref(conns), begin, end, rounds, move);
+    }
+
+    size_t received = 0;
+    char buf[64 * 1024];
+    epoll_event events[256];
+    while (received < expected)
+    {
+        int n = ::epoll_wait(epfd, events, 256, 1000);
+        for (int i = 0; i < n; ++i)
+        {
+            ssize_t nread;
+            while ((nread = ::read(events[i].data.fd, buf, sizeof buf)) > 0)
+            {
+                received += nread;
+            }
+        }
+    }
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t messages = conns.size() * rounds;
+    printf("%-6s connections=%zu workers=%d %10.0f msg/s\n",
+        move ? "move" : "shared", conns.size(), workers, messages / sec);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 屏蔽库内部输出到 std::cout 的日志，只保留 printf 输出的测试结果
+    std::cout.setstate(std::ios_base::badbit);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    uint16_t port = static_cast<uint16_t>(argc > 1 ? atoi(argv[1]) : 9989);
+    int connections = argc > 2 ? atoi(argv[2]) : 2000;
+    int workers = argc > 3 ? atoi(argv[3]) : 4;
+    int rounds = argc > 4 ? atoi(argv[4]) : 50;
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "FanoutBench");
+    server.setThreadNum(4);
+    server.setConnectionCallback(onConnection);
+    server.setMessageCallback([](const TcpConnectionPtr&, Buffer *buf, Timestamp) { buf->retrieveAll(); });
+    server.start();
+
+    std::thread client([&]() {
+        int epfd = ::epoll_create1(EPOLL_CLOEXEC);
+        std::vector<int> fds;
+        for (int i = 0; i < connections; ++i)
+        {
+            int fd = connectTo(port);
+            epoll_event ev;
+            ev.events = EPOLLIN;
+            ev.data.fd = fd;
+            ::epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev);
+            fds.push_back(fd);
+        }
+        while (connectionCount() < fds.size())
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+
+        for (int i = 0; i < 2; ++i)
+        {
+            runOne(epfd, workers, rounds, false);
+            runOne(epfd, workers, rounds, true);
+        }
+
+        {
+            std::unique_lock<std::mutex> lock(g_mutex);
+            g_connections.clear();
+        }
+        for (int fd : fds)
+        {
+            ::close(fd);
+        }
+        ::close(epfd);
+        loop.quit();
+    });
+
+    loop.loop();
+    client.join();
+    return 0;
+}
@@ -0,0 +1,349 @@
+/**
+ * HttpServer 基准测试（loopback，类似 wrk）：客户端连接由 TcpClient 建立，平均分配到若干个客户端 loop 线程，
+ * 每个连接保持 depth 个未完成的 GET 请求（depth > 1 即流水线），收到一个响应就补发一个。
+ * 服务端对每个请求返回 body 字节的响应：/plaintext 每次由回调重新生成，/cached 使用 HttpResponseCache
+ * 缓存的序列化字节。对每个路径和 depth 输出每秒请求数和请求延迟分位数。
+ *
+ * 用法: http_bench [-c 连接数] [-d 每项秒数] [-p depth,...] [-b 响应体大小] [-C 客户端线程数] [-S 服务端线程数]
+ */
+#include "HttpServer.h"
+#include "TcpClient.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Buffer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <deque>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const uint16_t kPort = 10021;
+
+using Clock = std::chrono::steady_clock;
+
+struct Result
+{
+    uint64_t responses;
+    uint64_t errors;                // 状态码不是 200 的响应
+    std::vector<double> latencies;  // 单位微秒
+};
+
+// 从 data 开头解析一个完整的响应，返回它的长度，不完整时返回 0；只支持 Content-Length
+size_t parseResponse(const char *data, size_t len, bool *ok)
+{
+    const char *end = data + len;
+    const char *headerEnd = BufferSearch::findCRLF(data, end);
+    if (headerEnd == nullptr)
+    {
+        return 0;
+    }
+    *ok = headerEnd - data >= 12 && ::memcmp(data + 9, "200", 3) == 0;
+    size_t contentLength = 0;
+    const char *line = headerEnd + 2;
+    while (true)
+    {
+        const char *crlf = BufferSearch::findCRLF(line, end);
+        if (crlf == nullptr)
+        {
+            return 0;
+        }
+        if (crlf == line)
+        {
+            const size_t total = (crlf + 2 - data) + contentLength;
+            return total <= len ? total : 0;
+        }
+        const char kField[] = "Content-Length:";
+        if (static_cast<size_t>(crlf - line) > sizeof kField - 1 && ::strncasecmp(line, kField, sizeof kField - 1) == 0)
+        {
+            contentLength = static_cast<size_t>(::atol(line + sizeof kField - 1));
+        }
+        line = crlf + 2;
+    }
+}
+
+// 一个客户端连接，除构造函数外所有函数都在 loop 线程中调用
+class Session : noncopyable
+{
+public:
+    Session(EventLoop *loop, const std::string &path, size_t depth, std::atomic_int *connected)
+        : depth_(depth)
+        , connected_(connected)
+        , running_(false)
+        , client_(loop, InetAddress(kPort, "127.0.0.1"), "HttpBench")
+        , request_(std::make_shared<const std::string>("GET " + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n"))
+        , result_{0, 0, {}}
+    {
+        SocketOptions options;
+        options.tcpNoDelay = true;
+        client_.setSocketOptions(options);
+        client_.setConnectionCallback(std::bind(&Session::onConnection, this, std::placeholders::_1));
+        client_.setMessageCallback(std::bind(&Session::onMessage, this,
+            std::placeholders::_1, std::placeholders::_2));
+        client_.connect();
+    }
+
+    void start()
+    {
+        running_ = true;
+        TcpConnectionPtr conn = client_.connection();
+        if (!conn)
+        {
+            return;
+        }
+        SharedStringList requests(depth_, request_);
+        auto now = Clock::now();
+        sent_.assign(depth_, now);
+        conn->send(requests);
+    }
+
+    // 停止发送并关闭连接，连接断开以后才能析构
+    Result stop()
+    {
+        running_ = false;
+        client_.disconnect();
+        TcpConnectionPtr conn = client_.connection();
+        if (conn)
+        {
+            conn->forceClose();
+        }
+        return std::move(result_);
+    }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            ++*connected_;
+        }
+        else
+        {
+            --*connected_;
+        }
+    }
+
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf)
+    {
+        size_t len;
+        bool ok = false;
+        while ((len = parseResponse(buf->peek(), buf->readableBytes(), &ok)) > 0)
+        {
+            buf->retrieve(len);
+            auto now = Clock::now();
+            if (sent_.empty())
+            {
+                continue;
+            }
+            ++result_.responses;
+            result_.errors += ok ? 0 : 1;
+            result_.latencies.push_back(std::chrono::duration<double, std::micro>(now - sent_.front()).count());
+            sent_.pop_front();
+            if (running_)
+            {
+                sent_.push_back(now);
+                conn->send(request_);
+            }
+        }
+    }
+
+    const size_t depth_;
+    std::atomic_int *connected_;
+    bool running_;
+    TcpClient client_;
+    SharedString request_;
+    std::deque<Clock::time_point> sent_;    // 未完成请求的发送时间，按发送顺序
+    Result result_;
+};
+
+struct Config
+{
+    int connections = 64;
+    double seconds = 2.0;
+    std::vector<size_t> depths = { 1, 16 };
+    size_t bodySize = 13;
+    int clientThreads = 2;
+    int serverThreads = 2;
+};
+
+template <typename F>
+void runAndWait(EventLoop *loop, F f)
+{
+    std::promise<void> done;
+    loop->runInLoop([&f, &done]() {
+        f();
+        done.set_value();
+    });
+    done.get_future().get();
+}
+
+void runDepth(const std::vector<EventLoop*> &loops, const Config &config, const std::string &path, size_t depth)
+{
+    const int n = config.connections;
+    auto loopOf = [&loops](int i) { return loops[i % loops.size()]; };
+    std::atomic_int connected(0);
+    std::vector<std::unique_ptr<Session>> sessions(n);
+    for (int i = 0; i < n; ++i)
+    {
+        runAndWait(loopOf(i), [&, i]() { sessions[i].reset(new Session(loopOf(i), path, depth, &connected)); });
+    }
+    while (connected < n)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    auto start = Clock::now();
+    for (int i = 0; i < n; ++i)
+    {
+        loopOf(i)->runInLoop(std::bind(&Session::start, sessions[i].get()));
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(config.seconds));
+    std::vector<Result> results(n);
+    for (int i = 0; i < n; ++i)
+    {
+        runAndWait(loopOf(i), [&, i]() { results[i] = sessions[i]->stop(); });
+    }
+    double sec = std::chrono::duration<double>(Clock::now() - start).count();
+    while (connected > 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    for (int i = 0; i < n; ++i)
+    {
+        runAndWait(loopOf(i), [&, i]() { sessions[i].reset(); });
+    }
+
+    std::vector<double> all;
+    uint64_t responses = 0;
+    uint64_t errors = 0;
+    for (Result &r : results)
+    {
+        responses += r.responses;
+        errors += r.errors;
+        all.insert(all.end(), r.latencies.begin(), r.latencies.end());
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile = [&all](double p) {
+        return all.empty() ? 0.0 : all[std::min(all.size() - 1, static_cast<size_t>(all.size() * p))];
+    };
+    printf("%-10s depth=%-3zu %10.0f req/s  p50=%8.1fus p90=%8.1fus p99=%8.1fus p99.9=%8.1fus  non-200=%lu\n",
+        path.c_str(), depth, responses / sec, percentile(0.5), percentile(0.9), percentile(0.99), percentile(0.999),
+        static_cast<unsigned long>(errors));
+}
+
+std::vector<size_t> parseList(const char *arg)
+{
+    std::vector<size_t> values;
+    std::string list(arg);
+    size_t pos = 0;
+    while (pos <= list.size())
+    {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos)
+        {
+            comma = list.size();
+        }
+        size_t value = static_cast<size_t>(atol(list.substr(pos, comma - pos).c_str()));
+        if (value > 0)
+        {
+            values.push_back(value);
+        }
+        pos = comma + 1;
+    }
+    return values;
+}
+
+void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-c connections] [-d seconds] [-p depth,...] [-b body_size]"
+        " [-C client_threads] [-S server_threads]\n", prog);
+    exit(1);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 屏蔽库内部输出到 std::cout 的日志，只保留 printf 输出的测试结果
+    std::cout.setstate(std::ios_base::badbit);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    Config config;
+    int opt;
+    while ((opt = ::getopt(argc, argv, "c:d:p:b:C:S:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c': config.connections = atoi(optarg); break;
+        case 'd': config.seconds = atof(optarg); break;
+        case 'p': config.depths = parseList(optarg); break;
+        case 'b': config.bodySize = static_cast<size_t>(atol(optarg)); break;
+        case 'C': config.clientThreads = atoi(optarg); break;
+        case 'S': config.serverThreads = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (config.connections <= 0 || config.seconds <= 0 || config.depths.empty()
+        || config.clientThreads <= 0 || config.serverThreads < 0)
+    {
+        usage(argv[0]);
+    }
+
+    EventLoop loop;
+    HttpServer server(&loop, InetAddress(kPort, "127.0.0.1"), "HttpBench");
+    server.setThreadNum(config.serverThreads);
+    const std::string body(config.bodySize, 'x');
+    server.setHttpCallback([&body](const HttpRequest &request, HttpResponse *response) {
+        if (request.path() == "/plaintext" || request.path() == "/cached")
+        {
+            response->setContentType("text/plain");
+            response->setBody(body);
+            if (request.path() == "/cached")
+            {
+                response->setCacheable(0);
+            }
+        }
+        else
+        {
+            response->setStatusCode(HttpResponse::k404NotFound);
+        }
+    });
+    server.start();
+
+    std::thread driver([&loop, &config]() {
+        printf("%d connections, %d client threads, %d server threads, %zu byte body, %.1f seconds per run\n",
+            config.connections, config.clientThreads, config.serverThreads, config.bodySize, config.seconds);
+        {
+            std::vector<std::unique_ptr<EventLoopThread>> threads;
+            std::vector<EventLoop*> loops;
+            for (int i = 0; i < config.clientThreads; ++i)
+            {
+                threads.emplace_back(new EventLoopThread(EventLoopThread::ThreadInitCallback(), "client"));
+                loops.push_back(threads.back()->startLoop());
+            }
+            for (size_t depth : config.depths)
+            {
+                runDepth(loops, config, "/plaintext", depth);
+                runDepth(loops, config, "/cached", depth);
+            }
+        }
+        loop.quit();
+    });
+
+    loop.loop();
+    driver.join();
+    return 0;
+}
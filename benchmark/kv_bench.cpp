@@ -0,0 +1,335 @@
+/**
+ * example/KvServer（Redis 协议、每个 loop 一个分片）的基准测试（loopback，类似 redis-benchmark -P）：
+ * 依次用不同的 sub loop 个数启动服务器，客户端连接平均分配到若干个客户端 loop 线程，
+ * 每个连接保持 pipeline 个未完成的命令，SET 和 GET 交替、键在 keyspace 中随机选择，收到一个回复就补发一个。
+ * 对每个 loop 个数输出每秒命令数和其中走跨 loop 路由的比例（按分片数估算）。
+ *
+ * 用法: kv_bench [-c 连接数] [-d 每项秒数] [-l loop 个数,...] [-P pipeline] [-k keyspace] [-v 值大小] [-C 客户端线程数]
+ */
+#include "../example/KvServer.h"
+#include <mymuduo/TcpClient.h>
+#include <mymuduo/EventLoopThread.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const uint16_t kBasePort = 10051;
+
+using Clock = std::chrono::steady_clock;
+
+struct Result
+{
+    uint64_t replies;
+    uint64_t errors;    // 错误回复和不符合预期的回复类型
+};
+
+// 一个客户端连接，除构造函数外所有函数都在 loop 线程中调用
+class Session : noncopyable
+{
+public:
+    Session(EventLoop *loop, uint16_t port, size_t pipeline, size_t keyspace, size_t valueSize,
+            uint32_t seed, std::atomic_int *connected)
+        : pipeline_(pipeline)
+        , keyspace_(keyspace)
+        , connected_(connected)
+        , running_(false)
+        , client_(loop, InetAddress(port, "127.0.0.1"), "KvBench")
+        , value_(valueSize, 'v')
+        , random_(seed | 1)
+        , nextIsSet_(true)
+        , result_{0, 0}
+    {
+        SocketOptions options;
+        options.tcpNoDelay = true;
+        client_.setSocketOptions(options);
+        client_.setConnectionCallback(std::bind(&Session::onConnection, this, std::placeholders::_1));
+        client_.setMessageCallback(std::bind(&Session::onMessage, this,
+            std::placeholders::_1, std::placeholders::_2));
+        client_.connect();
+    }
+
+    void start()
+    {
+        running_ = true;
+        TcpConnectionPtr conn = client_.connection();
+        if (!conn)
+        {
+            return;
+        }
+        for (size_t i = 0; i < pipeline_; ++i)
+        {
+            sendCommand(conn);
+        }
+        conn->flushOutputBuffer();
+    }
+
+    // 停止发送并关闭连接，连接断开以后才能析构
+    Result stop()
+    {
+        running_ = false;
+        client_.disconnect();
+        TcpConnectionPtr conn = client_.connection();
+        if (conn)
+        {
+            conn->forceClose();
+        }
+        return result_;
+    }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            ++*connected_;
+        }
+        else
+        {
+            --*connected_;
+        }
+    }
+
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf)
+    {
+        const char *data = buf->peek();
+        const size_t readable = buf->readableBytes();
+        size_t consumed = 0;
+        while (consumed < readable)
+        {
+            RespCodec::Reply reply;
+            RespCodec::ParseResult result = RespCodec::parseReply(data + consumed, readable - consumed, &reply);
+            if (result != RespCodec::kGotMessage)
+            {
+                break;
+            }
+            consumed += reply.length;
+            ++result_.replies;
+            if (reply.type != RespCodec::kSimpleString && reply.type != RespCodec::kBulkString
+                && reply.type != RespCodec::kNullBulkString)
+            {
+                ++result_.errors;
+            }
+            if (running_)
+            {
+                sendCommand(conn);
+            }
+        }
+        buf->retrieve(consumed);
+        conn->flushOutputBuffer();
+    }
+
+    void sendCommand(const TcpConnectionPtr &conn)
+    {
+        // xorshift32
+        random_ ^= random_ << 13;
+        random_ ^= random_ >> 17;
+        random_ ^= random_ << 5;
+        char key[32];
+        int keyLen = snprintf(key, sizeof key, "key:%010zu", static_cast<size_t>(random_ % keyspace_));
+        args_.clear();
+        if (nextIsSet_)
+        {
+            args_.push_back("SET");
+            args_.push_back(StringPiece(key, keyLen));
+            args_.push_back(value_);
+        }
+        else
+        {
+            args_.push_back("GET");
+            args_.push_back(StringPiece(key, keyLen));
+        }
+        nextIsSet_ = !nextIsSet_;
+        RespCodec::appendCommand(conn->outputBuffer(), args_);
+    }
+
+    const size_t pipeline_;
+    const size_t keyspace_;
+    std::atomic_int *connected_;
+    bool running_;
+    TcpClient client_;
+    std::string value_;
+    uint32_t random_;
+    bool nextIsSet_;
+    std::vector<StringPiece> args_;
+    Result result_;
+};
+
+struct Config
+{
+    int connections = 50;
+    double seconds = 2.0;
+    std::vector<int> loops = { 1, 4, 8 };
+    size_t pipeline = 16;
+    size_t keyspace = 100000;
+    size_t valueSize = 32;
+    int clientThreads = 2;
+};
+
+template <typename F>
+void runAndWait(EventLoop *loop, F f)
+{
+    std::promise<void> done;
+    loop->runInLoop([&f, &done]() {
+        f();
+        done.set_value();
+    });
+    done.get_future().get();
+}
+
+void runLoops(EventLoop *serverLoop, const std::vector<EventLoop*> &loops, const Config &config,
+              int numLoops, uint16_t port)
+{
+    std::unique_ptr<KvServer> server;
+    runAndWait(serverLoop, [&]() {
+        server.reset(new KvServer(serverLoop, InetAddress(port, "127.0.0.1"), "KvBench", numLoops));
+        server->start();
+    });
+
+    const int n = config.connections;
+    auto loopOf = [&loops](int i) { return loops[i % loops.size()]; };
+    std::atomic_int connected(0);
+    std::vector<std::unique_ptr<Session>> sessions(n);
+    for (int i = 0; i < n; ++i)
+    {
+        runAndWait(loopOf(i), [&, i]() {
+            sessions[i].reset(new Session(loopOf(i), port, config.pipeline, config.keyspace, config.valueSize,
+                static_cast<uint32_t>(i * 2654435761u), &connected));
+        });
+    }
+    while (connected < n)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    auto start = Clock::now();
+    for (int i = 0; i < n; ++i)
+    {
+        loopOf(i)->runInLoop(std::bind(&Session::start, sessions[i].get()));
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(config.seconds));
+    std::vector<Result> results(n);
+    for (int i = 0; i < n; ++i)
+    {
+        runAndWait(loopOf(i), [&, i]() { results[i] = sessions[i]->stop(); });
+    }
+    double sec = std::chrono::duration<double>(Clock::now() - start).count();
+    while (connected > 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    for (int i = 0; i < n; ++i)
+    {
+        runAndWait(loopOf(i), [&, i]() { sessions[i].reset(); });
+    }
+    // 等服务端处理完连接断开和还在路上的跨 loop 回复，再在 baseLoop 中销毁服务器
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    runAndWait(serverLoop, [&]() { server.reset(); });
+
+    uint64_t replies = 0;
+    uint64_t errors = 0;
+    for (const Result &r : results)
+    {
+        replies += r.replies;
+        errors += r.errors;
+    }
+    const int shards = numLoops > 0 ? numLoops : 1;
+    printf("loops=%-2d %10.0f ops/s  cross-loop=%3.0f%%  errors=%lu\n", numLoops, replies / sec,
+        100.0 * (shards - 1) / shards, static_cast<unsigned long>(errors));
+}
+
+std::vector<int> parseList(const char *arg)
+{
+    std::vector<int> values;
+    std::string list(arg);
+    size_t pos = 0;
+    while (pos <= list.size())
+    {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos)
+        {
+            comma = list.size();
+        }
+        int value = atoi(list.substr(pos, comma - pos).c_str());
+        if (value > 0)
+        {
+            values.push_back(value);
+        }
+        pos = comma + 1;
+    }
+    return values;
+}
+
+void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-c connections] [-d seconds] [-l loops,...] [-P pipeline] [-k keyspace]"
+        " [-v value_size] [-C client_threads]\n", prog);
+    exit(1);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 屏蔽库内部输出到 std::cout 的日志，只保留 printf 输出的测试结果
+    std::cout.setstate(std::ios_base::badbit);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    Config config;
+    int opt;
+    while ((opt = ::getopt(argc, argv, "c:d:l:P:k:v:C:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c': config.connections = atoi(optarg); break;
+        case 'd': config.seconds = atof(optarg); break;
+        case 'l': config.loops = parseList(optarg); break;
+        case 'P': config.pipeline = static_cast<size_t>(atol(optarg)); break;
+        case 'k': config.keyspace = static_cast<size_t>(atol(optarg)); break;
+        case 'v': config.valueSize = static_cast<size_t>(atol(optarg)); break;
+        case 'C': config.clientThreads = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (config.connections <= 0 || config.seconds <= 0 || config.loops.empty() || config.pipeline == 0
+        || config.keyspace == 0 || config.clientThreads <= 0)
+    {
+        usage(argv[0]);
+    }
+
+    EventLoop loop;
+    std::thread driver([&loop, &config]() {
+        printf("%d connections, pipeline %zu, %d client threads, keyspace %zu, %zu byte values, %.1f seconds per run\n",
+            config.connections, config.pipeline, config.clientThreads, config.keyspace, config.valueSize,
+            config.seconds);
+        {
+            std::vector<std::unique_ptr<EventLoopThread>> threads;
+            std::vector<EventLoop*> loops;
+            for (int i = 0; i < config.clientThreads; ++i)
+            {
+                threads.emplace_back(new EventLoopThread(EventLoopThread::ThreadInitCallback(), "client"));
+                loops.push_back(threads.back()->startLoop());
+            }
+            for (size_t i = 0; i < config.loops.size(); ++i)
+            {
+                runLoops(&loop, loops, config, config.loops[i], static_cast<uint16_t>(kBasePort + i));
+            }
+        }
+        loop.quit();
+    });
+
+    loop.loop();
+    driver.join();
+    return 0;
+}
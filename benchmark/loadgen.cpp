@@ -0,0 +1,437 @@
+/**
+ * 负载生成器（loopback）：服务端和客户端都运行在本库的 EventLoop 上，客户端连接由 TcpClient 建立，
+ * 平均分配到若干个客户端 loop 线程。
+ *   pingpong: 每个连接发送 size 字节，服务端原样返回，收齐以后立即发送下一个，
+ *             对每个消息大小输出消息数/秒、吞吐量和往返延迟分位数
+ *   connrate: 每个连接建立以后客户端立即关闭，TcpClient 随即重新连接，
+ *             输出每秒建立的连接数和从关闭到下一个连接建立的延迟分位数
+ *   bulk:     客户端在上一块数据写完以后继续发送 chunk 字节，服务端丢弃，输出服务端收到数据的吞吐量
+ *
+ * 用法: loadgen [-m all|pingpong|connrate|bulk] [-c 连接数] [-s 消息大小,...] [-b chunk 大小]
+ *               [-d 每项秒数] [-C 客户端线程数] [-S 服务端线程数]
+ */
+#include "TcpServer.h"
+#include "TcpClient.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Buffer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const uint16_t kEchoPort = 10011;
+const uint16_t kSinkPort = 10012;
+
+enum Mode { kPingPong, kConnRate, kBulk };
+
+std::atomic<uint64_t> g_sinkBytes(0);
+
+void onEchoMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    conn->send(buf);
+}
+
+void onSinkMessage(const TcpConnectionPtr &, Buffer *buf, Timestamp)
+{
+    g_sinkBytes += buf->readableBytes();
+    buf->retrieveAll();
+}
+
+void onServerConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        conn->setTcpNoDelay(true);
+    }
+}
+
+struct Result
+{
+    uint64_t count;                 // pingpong：完成的往返数；connrate：建立的连接数
+    std::vector<double> latencies;  // 单位微秒
+};
+
+// 一个客户端连接，除构造函数外所有函数都在 loop 线程中调用
+class Session : noncopyable
+{
+public:
+    Session(EventLoop *loop, Mode mode, size_t size, std::atomic_int *connected)
+        : mode_(mode)
+        , size_(size)
+        , connected_(connected)
+        , running_(false)
+        , client_(loop, InetAddress(mode == kBulk ? kSinkPort : kEchoPort), "LoadGen")
+        , result_{0, {}}
+    {
+        SocketOptions options;
+        options.tcpNoDelay = true;
+        client_.setSocketOptions(options);
+        client_.setConnectionCallback(std::bind(&Session::onConnection, this, std::placeholders::_1));
+        client_.setMessageCallback(std::bind(&Session::onMessage, this,
+            std::placeholders::_1, std::placeholders::_2));
+        client_.setWriteCompleteCallback(std::bind(&Session::onWriteComplete, this, std::placeholders::_1));
+        if (mode_ == kConnRate)
+        {
+            client_.enableRetry();
+        }
+        else
+        {
+            payload_ = std::make_shared<const std::string>(size_, 'x');
+            client_.connect();
+        }
+    }
+
+    void start()
+    {
+        running_ = true;
+        if (mode_ == kConnRate)
+        {
+            sentAt_ = std::chrono::steady_clock::now();
+            client_.connect();
+            return;
+        }
+        TcpConnectionPtr conn = client_.connection();
+        if (conn)
+        {
+            sentAt_ = std::chrono::steady_clock::now();
+            conn->send(payload_);
+        }
+    }
+
+    // 停止发送并关闭连接，连接断开以后才能析构（之前排队的回调还会用到本对象）
+    Result stop()
+    {
+        running_ = false;
+        client_.disconnect();
+        client_.stop();
+        TcpConnectionPtr conn = client_.connection();
+        if (conn)
+        {
+            conn->forceClose();
+        }
+        return std::move(result_);
+    }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            ++*connected_;
+        }
+        else
+        {
+            --*connected_;
+        }
+        if (mode_ != kConnRate || !running_)
+        {
+            return;
+        }
+        auto now = std::chrono::steady_clock::now();
+        if (conn->connected())
+        {
+            record(now);
+            conn->forceClose();
+        }
+        else
+        {
+            // TcpClient 在这个回调之后立即重新连接
+            sentAt_ = now;
+        }
+    }
+
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf)
+    {
+        if (mode_ != kPingPong)
+        {
+            buf->retrieveAll();
+            return;
+        }
+        while (buf->readableBytes() >= size_)
+        {
+            buf->retrieve(size_);
+            auto now = std::chrono::steady_clock::now();
+            record(now);
+            if (running_)
+            {
+                sentAt_ = now;
+                conn->send(payload_);
+            }
+        }
+    }
+
+    void onWriteComplete(const TcpConnectionPtr &conn)
+    {
+        if (mode_ == kBulk && running_)
+        {
+            conn->send(payload_);
+        }
+    }
+
+    void record(std::chrono::steady_clock::time_point now)
+    {
+        ++result_.count;
+        result_.latencies.push_back(std::chrono::duration<double, std::micro>(now - sentAt_).count());
+    }
+
+    const Mode mode_;
+    const size_t size_;
+    std::atomic_int *connected_;        // 所有连接共享的已建立连接数
+    bool running_;
+    TcpClient client_;
+    SharedString payload_;
+    std::chrono::steady_clock::time_point sentAt_;
+    Result result_;
+};
+
+struct Config
+{
+    int connections = 64;
+    std::vector<size_t> sizes = { 16, 1024, 16 * 1024 };
+    size_t chunk = 64 * 1024;
+    double seconds = 2.0;
+    int clientThreads = 2;
+    int serverThreads = 2;
+};
+
+// 在 loop 线程中执行 f 并等待它完成
+template <typename F>
+void runAndWait(EventLoop *loop, F f)
+{
+    std::promise<void> done;
+    loop->runInLoop([&f, &done]() {
+        f();
+        done.set_value();
+    });
+    done.get_future().get();
+}
+
+class LoadGenerator
+{
+public:
+    explicit LoadGenerator(const Config &config)
+        : config_(config)
+    {
+        for (int i = 0; i < config_.clientThreads; ++i)
+        {
+            threads_.emplace_back(new EventLoopThread(EventLoopThread::ThreadInitCallback(), "client"));
+            loops_.push_back(threads_.back()->startLoop());
+        }
+    }
+
+    // 返回测量的秒数，results 按连接顺序保存每个连接的结果
+    double run(Mode mode, size_t size, std::vector<Result> *results)
+    {
+        const int n = config_.connections;
+        std::atomic_int connected(0);
+        std::vector<std::unique_ptr<Session>> sessions(n);
+        for (int i = 0; i < n; ++i)
+        {
+            runAndWait(loopOf(i), [&, i]() {
+                sessions[i].reset(new Session(loopOf(i), mode, size, &connected));
+            });
+        }
+        while (mode != kConnRate && connected < n)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        for (int i = 0; i < n; ++i)
+        {
+            loopOf(i)->runInLoop(std::bind(&Session::start, sessions[i].get()));
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(config_.seconds));
+        results->resize(n);
+        for (int i = 0; i < n; ++i)
+        {
+            runAndWait(loopOf(i), [&, i]() { (*results)[i] = sessions[i]->stop(); });
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        // 等所有连接断开，TcpClient 必须在自己的 loop 线程中析构
+        while (connected > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        for (int i = 0; i < n; ++i)
+        {
+            runAndWait(loopOf(i), [&, i]() { sessions[i].reset(); });
+        }
+        return elapsed;
+    }
+
+private:
+    EventLoop* loopOf(int i) const { return loops_[i % loops_.size()]; }
+
+    const Config config_;
+    std::vector<std::unique_ptr<EventLoopThread>> threads_;
+    std::vector<EventLoop*> loops_;
+};
+
+void printLatency(std::vector<Result> &results)
+{
+    std::vector<double> all;
+    for (Result &r : results)
+    {
+        all.insert(all.end(), r.latencies.begin(), r.latencies.end());
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile = [&all](double p) {
+        return all.empty() ? 0.0 : all[std::min(all.size() - 1, static_cast<size_t>(all.size() * p))];
+    };
+    printf("  p50=%8.1fus p90=%8.1fus p99=%8.1fus p99.9=%8.1fus max=%9.1fus\n",
+        percentile(0.5), percentile(0.9), percentile(0.99), percentile(0.999), all.empty() ? 0.0 : all.back());
+}
+
+uint64_t totalCount(const std::vector<Result> &results)
+{
+    uint64_t total = 0;
+    for (const Result &r : results)
+    {
+        total += r.count;
+    }
+    return total;
+}
+
+void runPingPong(LoadGenerator *gen, const Config &config)
+{
+    for (size_t size : config.sizes)
+    {
+        std::vector<Result> results;
+        double sec = gen->run(kPingPong, size, &results);
+        uint64_t count = totalCount(results);
+        printf("pingpong size=%-7zu %10.0f msg/s %9.1f MB/s",
+            size, count / sec, count * size * 2 / sec / (1024 * 1024));
+        printLatency(results);
+    }
+}
+
+void runConnRate(LoadGenerator *gen)
+{
+    std::vector<Result> results;
+    double sec = gen->run(kConnRate, 0, &results);
+    printf("connrate              %10.0f conn/s          ", totalCount(results) / sec);
+    printLatency(results);
+}
+
+void runBulk(LoadGenerator *gen, const Config &config)
+{
+    uint64_t before = g_sinkBytes;
+    std::vector<Result> results;
+    double sec = gen->run(kBulk, config.chunk, &results);
+    printf("bulk     chunk=%-6zu %10.1f MB/s\n", config.chunk, (g_sinkBytes - before) / sec / (1024 * 1024));
+}
+
+std::vector<size_t> parseSizes(const char *arg)
+{
+    std::vector<size_t> sizes;
+    std::string list(arg);
+    size_t pos = 0;
+    while (pos <= list.size())
+    {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos)
+        {
+            comma = list.size();
+        }
+        size_t size = static_cast<size_t>(atol(list.substr(pos, comma - pos).c_str()));
+        if (size > 0)
+        {
+            sizes.push_back(size);
+        }
+        pos = comma + 1;
+    }
+    return sizes;
+}
+
+void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-m all|pingpong|connrate|bulk] [-c connections] [-s size,...] [-b chunk]"
+        " [-d seconds] [-C client_threads] [-S server_threads]\n", prog);
+    exit(1);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 屏蔽库内部输出到 std::cout 的日志，只保留 printf 输出的测试结果
+    std::cout.setstate(std::ios_base::badbit);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    Config config;
+    std::string mode = "all";
+    int opt;
+    while ((opt = ::getopt(argc, argv, "m:c:s:b:d:C:S:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'm': mode = optarg; break;
+        case 'c': config.connections = atoi(optarg); break;
+        case 's': config.sizes = parseSizes(optarg); break;
+        case 'b': config.chunk = static_cast<size_t>(atol(optarg)); break;
+        case 'd': config.seconds = atof(optarg); break;
+        case 'C': config.clientThreads = atoi(optarg); break;
+        case 'S': config.serverThreads = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (config.connections <= 0 || config.clientThreads <= 0 || config.serverThreads < 0
+        || config.sizes.empty() || config.chunk == 0 || config.seconds <= 0
+        || (mode != "all" && mode != "pingpong" && mode != "connrate" && mode != "bulk"))
+    {
+        usage(argv[0]);
+    }
+
+    EventLoop loop;
+    TcpServer echoServer(&loop, InetAddress(kEchoPort, "127.0.0.1"), "EchoServer");
+    TcpServer sinkServer(&loop, InetAddress(kSinkPort, "127.0.0.1"), "SinkServer");
+    echoServer.setThreadNum(config.serverThreads);
+    sinkServer.setThreadNum(config.serverThreads);
+    echoServer.setConnectionCallback(onServerConnection);
+    sinkServer.setConnectionCallback(onServerConnection);
+    echoServer.setMessageCallback(onEchoMessage);
+    sinkServer.setMessageCallback(onSinkMessage);
+    echoServer.start();
+    sinkServer.start();
+
+    std::thread driver([&loop, &config, &mode]() {
+        printf("%d connections, %d client threads, %d server threads, %.1f seconds per run\n",
+            config.connections, config.clientThreads, config.serverThreads, config.seconds);
+        {
+            LoadGenerator gen(config);
+            if (mode == "all" || mode == "pingpong")
+            {
+                runPingPong(&gen, config);
+            }
+            if (mode == "all" || mode == "connrate")
+            {
+                runConnRate(&gen);
+            }
+            if (mode == "all" || mode == "bulk")
+            {
+                runBulk(&gen, config);
+            }
+        }
+        loop.quit();
+    });
+
+    loop.loop();
+    driver.join();
+    return 0;
+}
@@ -0,0 +1,372 @@
+/**
+ * 热点基础组件的微基准测试（Google Benchmark）
+ *   Buffer:      append/retrieve、makeSpace 扩容与前移、readFd 从 socketpair 读取
+ *   EventLoop:   queueInLoop / runInLoopBatched 从其他线程提交函数的吞吐量
+ *   Channel:     handleEvent 分发一个可读事件的开销（有无 tie）
+ *   EPollPoller: updateChannel 注册/注销（EPOLL_CTL_ADD/DEL）和修改（EPOLL_CTL_MOD）的开销
+ *   Timestamp::now 以及 LOG_INFO 宏
+ *   HTTP:        每次序列化响应和命中 HttpResponseCache 的开销，缓存的响应拷贝进 Buffer 和作为引用段发送的对比
+ * 库内部的日志写到 std::cout，测量期间把 std::cout 换成丢弃输出的 streambuf，测试结果不受影响。
+ *
+ * 用法: micro_bench [--benchmark_filter=...] [--benchmark_out=result.json --benchmark_out_format=json]
+ * 构建目录中的 micro_bench_json 目标运行全部测试，结果连同当前提交号写入 micro_bench.json。
+ */
+#include "Buffer.h"
+#include "Channel.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "HttpResponse.h"
+#include "HttpResponseCache.h"
+#include "Logger.h"
+#include "OutputQueue.h"
+#include "Timestamp.h"
+
+#include <benchmark/benchmark.h>
+
+#include <fcntl.h>
+#include <stdint.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <iostream>
+#include <memory>
+#include <streambuf>
+#include <string>
+#include <thread>
+
+namespace
+{
+
+// 丢弃所有输出，格式化的开销仍然保留
+class NullStreamBuf : public std::streambuf
+{
+protected:
+    int overflow(int c) override { return traits_type::not_eof(c); }
+    std::streamsize xsputn(const char *, std::streamsize n) override { return n; }
+};
+
+// 在作用域内屏蔽 std::cout
+class QuietCout
+{
+public:
+    QuietCout() : saved_(std::cout.rdbuf(&null_)) {}
+    ~QuietCout() { std::cout.rdbuf(saved_); }
+
+private:
+    NullStreamBuf null_;
+    std::streambuf *saved_;
+};
+
+void BM_BufferAppendRetrieve(benchmark::State &state)
+{
+    const std::string data(static_cast<size_t>(state.range(0)), 'x');
+    Buffer buf;
+    for (auto _ : state)
+    {
+        buf.append(data.data(), data.size());
+        benchmark::DoNotOptimize(buf.peek());
+        buf.retrieve(data.size());
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+}
+BENCHMARK(BM_BufferAppendRetrieve)->Arg(16)->Arg(256)->Arg(4096)->Arg(65536);
+
+// 从初始大小开始以 512 字节为单位追加到 range(0) 字节，每次空间不够都要 resize
+void BM_BufferMakeSpaceGrow(benchmark::State &state)
+{
+    const size_t total = static_cast<size_t>(state.range(0));
+    const std::string chunk(512, 'x');
+    for (auto _ : state)
+    {
+        Buffer buf;
+        for (size_t n = 0; n < total; n += chunk.size())
+        {
+            buf.append(chunk.data(), chunk.size());
+        }
+        benchmark::DoNotOptimize(buf.peek());
+    }
+    state.SetBytesProcessed(state.iterations() * total);
+}
+BENCHMARK(BM_BufferMakeSpaceGrow)->Arg(4096)->Arg(65536)->Arg(1 << 20);
+
+// 前面已经读走的空间足够时，makeSpace 把剩余的 range(0) 字节可读数据移到开头，不分配内存
+void BM_BufferMakeSpaceCompact(benchmark::State &state)
+{
+    const size_t kept = static_cast<size_t>(state.range(0));
+    const size_t capacity = Buffer::kInitialSize * 8;
+    const std::string fill(capacity - kept, 'x');
+    const std::string tail(kept, 'y');
+    const std::string more(capacity - kept, 'z');
+    Buffer buf(capacity);
+    for (auto _ : state)
+    {
+        buf.append(fill.data(), fill.size());
+        buf.append(tail.data(), tail.size());
+        buf.retrieve(fill.size());
+        // 可写空间为 0，需要把 tail 前移
+        buf.append(more.data(), more.size());
+        benchmark::DoNotOptimize(buf.peek());
+        buf.retrieveAll();
+    }
+    state.SetBytesProcessed(state.iterations() * kept);
+}
+BENCHMARK(BM_BufferMakeSpaceCompact)->Arg(64)->Arg(1024)->Arg(4096);
+
+// 每次向 socketpair 的一端写 range(0) 字节，再用 readFd 从另一端读入
+void BM_BufferReadFd(benchmark::State &state)
+{
+    const std::string data(static_cast<size_t>(state.range(0)), 'x');
+    int fds[2];
+    if (::socketpair(AF_UNIX, SOCK_STREAM, 0, fds) < 0)
+    {
+        state.SkipWithError("socketpair failed");
+        return;
+    }
+    int bufSize = 1024 * 1024;
+    ::setsockopt(fds[0], SOL_SOCKET, SO_RCVBUF, &bufSize, sizeof bufSize);
+    ::setsockopt(fds[1], SOL_SOCKET, SO_SNDBUF, &bufSize, sizeof bufSize);
+
+    Buffer buf;
+    int savedErrno = 0;
+    for (auto _ : state)
+    {
+        if (::write(fds[1], data.data(), data.size()) != static_cast<ssize_t>(data.size()))
+        {
+            state.SkipWithError("write failed");
+            break;
+        }
+        size_t got = 0;
+        while (got < data.size())
+        {
+            ssize_t n = buf.readFd(fds[0], &savedErrno);
+            if (n <= 0)
+            {
+                state.SkipWithError("readFd failed");
+                break;
+            }
+            got += n;
+        }
+        buf.retrieveAll();
+    }
+    state.SetBytesProcessed(state.iterations() * data.size());
+    ::close(fds[0]);
+    ::close(fds[1]);
+}
+BENCHMARK(BM_BufferReadFd)->Arg(64)->Arg(4096)->Arg(65536);
+
+// 当前线程向另一个 loop 线程提交空函数，计时包括等待全部执行完
+template <bool kBatched>
+void BM_QueueInLoop(benchmark::State &state)
+{
+    QuietCout quiet;
+    EventLoopThread thread;
+    EventLoop *loop = thread.startLoop();
+    std::atomic<int64_t> done(0);
+    int64_t queued = 0;
+    for (auto _ : state)
+    {
+        auto cb = [&done]() { done.store(done.load(std::memory_order_relaxed) + 1, std::memory_order_release); };
+        if (kBatched)
+        {
+            loop->runInLoopBatched(cb);
+        }
+        else
+        {
+            loop->queueInLoop(cb);
+        }
+        ++queued;
+    }
+    while (done.load(std::memory_order_acquire) < queued)
+    {
+        std::this_thread::yield();
+    }
+    state.SetItemsProcessed(queued);
+}
+BENCHMARK_TEMPLATE(BM_QueueInLoop, false)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_QueueInLoop, true)->UseRealTime();
+
+// 不经过 epoll，直接对一个可读事件调用 handleEvent，range(0) 为 1 时先 tie 到一个对象
+void BM_ChannelHandleEvent(benchmark::State &state)
+{
+    QuietCout quiet;
+    EventLoop loop;
+    int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    Channel channel(&loop, fd);
+    int64_t calls = 0;
+    channel.setReadCallback([&calls](Timestamp) { ++calls; });
+    std::shared_ptr<int> owner = std::make_shared<int>(0);
+    if (state.range(0) != 0)
+    {
+        channel.tie(owner);
+    }
+    channel.set_revents(EPOLLIN);
+    Timestamp now = Timestamp::now();
+    for (auto _ : state)
+    {
+        channel.handleEvent(now);
+    }
+    benchmark::DoNotOptimize(calls);
+    state.SetItemsProcessed(state.iterations());
+    ::close(fd);
+}
+BENCHMARK(BM_ChannelHandleEvent)->ArgName("tied")->Arg(0)->Arg(1);
+
+// 反复开启和关闭读事件：关闭全部事件时 EPollPoller 从 epoll 中删除 fd，再开启时重新添加
+void BM_UpdateChannelAddDel(benchmark::State &state)
+{
+    QuietCout quiet;
+    EventLoop loop;
+    int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    Channel channel(&loop, fd);
+    for (auto _ : state)
+    {
+        channel.enableReading();
+        channel.disableReading();
+    }
+    channel.remove();
+    state.SetItemsProcessed(state.iterations() * 2);
+    ::close(fd);
+}
+BENCHMARK(BM_UpdateChannelAddDel);
+
+// 读事件保持开启，反复开启和关闭写事件，对应 EPOLL_CTL_MOD
+void BM_UpdateChannelMod(benchmark::State &state)
+{
+    QuietCout quiet;
+    EventLoop loop;
+    int fd = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    Channel channel(&loop, fd);
+    channel.enableReading();
+    for (auto _ : state)
+    {
+        channel.enableWriting();
+        channel.disableWriting();
+    }
+    channel.disableAll();
+    channel.remove();
+    state.SetItemsProcessed(state.iterations() * 2);
+    ::close(fd);
+}
+BENCHMARK(BM_UpdateChannelMod);
+
+void BM_TimestampNow(benchmark::State &state)
+{
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(Timestamp::now());
+    }
+}
+BENCHMARK(BM_TimestampNow);
+
+void BM_TimestampToString(benchmark::State &state)
+{
+    Timestamp now = Timestamp::now();
+    for (auto _ : state)
+    {
+        benchmark::DoNotOptimize(now.toString());
+    }
+}
+BENCHMARK(BM_TimestampToString);
+
+// 格式化、加时间戳并写入 std::cout（丢弃），不包括终端或文件的 I/O
+void BM_LogInfo(benchmark::State &state)
+{
+    QuietCout quiet;
+    int64_t i = 0;
+    for (auto _ : state)
+    {
+        LOG_INFO("%s fd=%d bytes=%ld \n", "TcpConnection::handleRead", 42, static_cast<long>(i++));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+BENCHMARK(BM_LogInfo);
+
+// 每个请求由回调重新生成响应并序列化，参数是响应体大小
+void BM_HttpResponseRender(benchmark::State &state)
+{
+    const std::string body(static_cast<size_t>(state.range(0)), 'x');
+    HttpResponseCache cache;
+    const Timestamp now = Timestamp::now();
+    Buffer buf;
+    for (auto _ : state)
+    {
+        HttpResponse response(false);
+        response.setContentType("text/plain");
+        response.setBody(body);
+        response.appendToBuffer(&buf, false, cache.date(now));
+        buf.retrieveAll();
+    }
+}
+BENCHMARK(BM_HttpResponseRender)->Arg(13)->Arg(4096);
+
+// 命中缓存，把序列化好的字节拷贝进 Buffer
+void BM_HttpResponseCacheHit(benchmark::State &state)
+{
+    HttpResponseCache cache;
+    const Timestamp now = Timestamp::now();
+    HttpResponse response(false);
+    response.setContentType("text/plain");
+    response.setBody(std::string(static_cast<size_t>(state.range(0)), 'x'));
+    response.setCacheable(0);
+    cache.put("/cached", response, now);
+    Buffer buf;
+    for (auto _ : state)
+    {
+        SharedString wire = cache.get("/cached", now);
+        buf.append(wire->data(), wire->size());
+        buf.retrieveAll();
+    }
+}
+BENCHMARK(BM_HttpResponseCacheHit)->Arg(13)->Arg(4096);
+
+// 16 个流水线请求命中同一个缓存响应，排进发送队列后一次 writev 写到 /dev/null。
+// kShared 为 false 时拷贝进 Buffer 合并成一段，为 true 时每个响应是一个引用段
+template <bool kShared>
+void BM_HttpCachedOutput(benchmark::State &state)
+{
+    const int kPipeline = 16;
+    int fd = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+    HttpResponse response(false);
+    response.setBody(std::string(static_cast<size_t>(state.range(0)), 'x'));
+    HttpResponseCache cache;
+    const Timestamp now = Timestamp::now();
+    cache.put("/cached", response, now);
+    SharedString wire = cache.get("/cached", now);
+
+    Buffer buf;
+    OutputQueue queue(&buf);
+    int savedErrno = 0;
+    for (auto _ : state)
+    {
+        for (int i = 0; i < kPipeline; ++i)
+        {
+            if (kShared)
+            {
+                queue.appendShared(wire, wire->data(), wire->size());
+            }
+            else
+            {
+                buf.append(wire->data(), wire->size());
+            }
+        }
+        queue.syncBuffer();
+        while (!queue.empty())
+        {
+            if (queue.writeFd(fd, &savedErrno) < 0)
+            {
+                state.SkipWithError("writev failed");
+                break;
+            }
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * kPipeline);
+    ::close(fd);
+}
+BENCHMARK_TEMPLATE(BM_HttpCachedOutput, false)->Arg(13)->Arg(512)->Arg(4096);
+BENCHMARK_TEMPLATE(BM_HttpCachedOutput, true)->Arg(13)->Arg(512)->Arg(4096);
+
+} // namespace
+
+BENCHMARK_MAIN();
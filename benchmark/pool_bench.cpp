@@ -0,0 +1,300 @@
+/**
+ * 上游连接池基准测试（loopback）：客户端 => 代理 => 后端
+ * 代理有 2 个 subLoop，每个 loop 有自己的 ConnectionPool，请求只在本 loop 的后端连接上转发，不跨线程。
+ *   per-request: 每个请求新建一条后端连接，响应以后关闭（maxIdle = 0），相当于不使用连接池
+ *   pooled:      启动时预热 minIdle 条连接，请求完成后连接放回池中复用
+ *   pipelined:   每个 loop 最多 2 条后端连接，每条连接上同时有最多 32 个请求
+ * 协议是按行分隔的请求/响应。客户端开 C 个连接，每个连接收到响应以后才发下一个请求，
+ * 输出吞吐量、代理转发的延迟分位数以及每个模式新建的后端连接数。
+ *
+ * 用法: pool_bench [clients] [seconds]
+ */
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+#include "ConnectionPool.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const uint16_t kBackendPort = 10001;
+const size_t kResponseLen = 64;
+
+// 一行是一个完整的响应
+size_t frameLine(const char *data, size_t len)
+{
+    const void *eol = ::memchr(data, '\n', len);
+    return eol == nullptr ? 0 : static_cast<const char*>(eol) - data + 1;
+}
+
+void onBackendMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    static const SharedString response = std::make_shared<const std::string>(
+        std::string(kResponseLen - 1, 'v') + "\n");
+    const char *eol;
+    while ((eol = buf->findEOL()) != nullptr)
+    {
+        buf->retrieveUntil(eol + 1);
+        conn->send(response);
+    }
+}
+
+// 把客户端的每一行请求通过本 loop 的连接池转发给后端
+class Proxy
+{
+public:
+    Proxy(EventLoop *loop, uint16_t port, const std::string &name, const ConnectionPool::Options &options)
+        : server_(loop, InetAddress(port), name)
+        , backend_(kBackendPort)
+        , options_(options)
+        , clients_(0)
+    {
+        server_.setThreadNum(2);
+        server_.setThreadInitcallback(std::bind(&Proxy::initLoop, this, std::placeholders::_1));
+        server_.setConnectionCallback([this](const TcpConnectionPtr &conn) {
+            if (conn->connected())
+            {
+                conn->setTcpNoDelay(true);
+                ++clients_;
+            }
+            else
+            {
+                --clients_;
+            }
+        });
+        server_.setMessageCallback(std::bind(&Proxy::onMessage, this,
+            std::placeholders::_1, std::placeholders::_2));
+        server_.start();
+    }
+
+    // 等客户端连接全部断开，再在各自的 loop 线程中销毁连接池，返回所有 loop 新建的后端连接数之和
+    uint64_t stop()
+    {
+        while (clients_ > 0)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        uint64_t opened = 0;
+        for (auto &entry : pools_)
+        {
+            std::promise<uint64_t> done;
+            ConnectionPool *pool = entry.second.get();
+            entry.first->runInLoop([this, pool, &entry, &done]() {
+                uint64_t n = pool->stats(backend_).opened;
+                entry.second.reset();
+                done.set_value(n);
+            });
+            opened += done.get_future().get();
+        }
+        return opened;
+    }
+
+private:
+    void initLoop(EventLoop *loop)
+    {
+        std::unique_ptr<ConnectionPool> pool(new ConnectionPool(loop, "pool"));
+        pool->addBackend(backend_, frameLine, options_);
+        std::unique_lock<std::mutex> lock(mutex_);
+        pools_[loop] = std::move(pool);
+    }
+
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf)
+    {
+        // pools_ 在 start 返回之前已经建好，之后只读
+        ConnectionPool *pool = pools_.at(conn->getLoop()).get();
+        const char *eol;
+        while ((eol = buf->findEOL()) != nullptr)
+        {
+            std::string request(buf->peek(), eol + 1);
+            buf->retrieveUntil(eol + 1);
+            std::weak_ptr<TcpConnection> weak(conn);
+            pool->request(backend_, std::move(request), [weak](bool ok, const char *data, size_t len) {
+                TcpConnectionPtr client = weak.lock();
+                if (client)
+                {
+                    client->send(ok ? std::string(data, len) : std::string("ERROR\n"));
+                }
+            });
+        }
+    }
+
+    TcpServer server_;
+    InetAddress backend_;
+    ConnectionPool::Options options_;
+    std::atomic_int clients_;
+    std::mutex mutex_;
+    std::map<EventLoop*, std::unique_ptr<ConnectionPool>> pools_;
+};
+
+// 一个客户端连接：顺序发送请求，记录每个请求的往返时间（微秒）
+void runClient(uint16_t port, double seconds, std::vector<double> *latencies, uint64_t *errors)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    int one = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof one);
+
+    const char request[] = "GET key\n";
+    char buf[256];
+    auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double>(seconds);
+    while (std::chrono::steady_clock::now() < deadline)
+    {
+        auto start = std::chrono::steady_clock::now();
+        if (::write(fd, request, sizeof request - 1) != static_cast<ssize_t>(sizeof request - 1))
+        {
+            perror("write");
+            exit(1);
+        }
+        size_t got = 0;
+        while (got == 0 || buf[got - 1] != '\n')
+        {
+            ssize_t n = ::read(fd, buf + got, sizeof buf - got);
+            if (n <= 0)
+            {
+                fprintf(stderr, "connection broken\n");
+                exit(1);
+            }
+            got += n;
+        }
+        if (got != kResponseLen)
+        {
+            ++*errors;
+        }
+        latencies->push_back(std::chrono::duration<double, std::micro>(
+            std::chrono::steady_clock::now() - start).count());
+    }
+    ::close(fd);
+}
+
+void runMode(EventLoop *loop, const char *mode, uint16_t port, const ConnectionPool::Options &options,
+    int clients, double seconds)
+{
+    std::unique_ptr<Proxy> proxy;
+    {
+        // Proxy 的 TcpServer 必须在主 loop 线程中创建和销毁
+        std::promise<void> created;
+        loop->runInLoop([&]() {
+            proxy.reset(new Proxy(loop, port, mode, options));
+            created.set_value();
+        });
+        created.get_future().get();
+    }
+    // 等待预热的连接建立
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    std::vector<std::vector<double>> latencies(clients);
+    std::vector<uint64_t> errors(clients, 0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < clients; ++i)
+    {
+        threads.emplace_back(runClient, port, seconds, &latencies[i], &errors[i]);
+    }
+    for (std::thread &t : threads)
+    {
+        t.join();
+    }
+
+    uint64_t opened = proxy->stop();
+    {
+        std::promise<void> destroyed;
+        loop->runInLoop([&]() {
+            proxy.reset();
+            destroyed.set_value();
+        });
+        destroyed.get_future().get();
+    }
+
+    std::vector<double> all;
+    uint64_t totalErrors = 0;
+    for (int i = 0; i < clients; ++i)
+    {
+        all.insert(all.end(), latencies[i].begin(), latencies[i].end());
+        totalErrors += errors[i];
+    }
+    std::sort(all.begin(), all.end());
+    auto percentile = [&all](double p) {
+        return all.empty() ? 0.0 : all[std::min(all.size() - 1, static_cast<size_t>(all.size() * p))];
+    };
+    printf("%-12s %9.0f req/s  p50=%7.1fus p90=%7.1fus p99=%8.1fus  backend conns=%-6lu errors=%lu\n",
+        mode, all.size() / seconds, percentile(0.5), percentile(0.9), percentile(0.99),
+        static_cast<unsigned long>(opened), static_cast<unsigned long>(totalErrors));
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 屏蔽库内部输出到 std::cout 的日志，只保留 printf 输出的测试结果
+    std::cout.setstate(std::ios_base::badbit);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    int clients = argc > 1 ? atoi(argv[1]) : 16;
+    double seconds = argc > 2 ? atof(argv[2]) : 1.0;
+
+    EventLoop loop;
+    TcpServer backend(&loop, InetAddress(kBackendPort), "Backend");
+    backend.setConnectionCallback([](const TcpConnectionPtr &conn) {
+        if (conn->connected())
+        {
+            conn->setTcpNoDelay(true);
+        }
+    });
+    backend.setMessageCallback(onBackendMessage);
+    backend.start();
+
+    std::thread driver([&loop, clients, seconds]() {
+        printf("%d clients, %.1f seconds per mode\n", clients, seconds);
+
+        ConnectionPool::Options perRequest;
+        perRequest.maxIdle = 0;
+        perRequest.maxConnections = 1024;
+        runMode(&loop, "per-request", 10002, perRequest, clients, seconds);
+
+        ConnectionPool::Options pooled;
+        pooled.minIdle = 8;
+        pooled.maxIdle = 64;
+        pooled.maxConnections = 64;
+        runMode(&loop, "pooled", 10003, pooled, clients, seconds);
+
+        ConnectionPool::Options pipelined;
+        pipelined.minIdle = 2;
+        pipelined.maxConnections = 2;
+        pipelined.maxInFlight = 32;
+        runMode(&loop, "pipelined", 10004, pipelined, clients, seconds);
+
+        loop.quit();
+    });
+
+    loop.loop();
+    driver.join();
+    return 0;
+}
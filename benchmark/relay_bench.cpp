@@ -0,0 +1,199 @@
+/**
+ * TCP 转发（代理）基准测试（loopback）：客户端 => 代理 => 后端，代理的两个连接在同一个 EventLoop 中
+ *   copy:   在 MessageCallback 中把 inputBuffer 的数据 send 给对端，数据在用户态拷贝
+ *   splice: TcpConnection::relayTo，数据经管道 splice 转发，不经过用户态
+ * 后端也作为客户端连到代理上，先发送 'B' 表明身份；客户端随后发送 'c' 或 's' 选择转发方式。
+ * 输出吞吐量以及每 GB 消耗的进程 CPU 时间（包括两端测试线程）。
+ *
+ * 用法: relay_bench [port] [total_mb]
+ */
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <string>
+#include <thread>
+
+namespace
+{
+
+// 以下状态只在 loop 线程中访问
+TcpConnectionPtr g_backend;
+std::map<TcpConnection*, std::weak_ptr<TcpConnection>> g_copyPeers;
+
+void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    auto it = g_copyPeers.find(conn.get());
+    if (it != g_copyPeers.end())
+    {
+        TcpConnectionPtr peer = it->second.lock();
+        if (peer)
+        {
+            peer->send(buf);
+        }
+        buf->retrieveAll();
+        return;
+    }
+
+    char kind = buf->readInt8();
+    if (kind == 'B')
+    {
+        g_backend = conn;
+        conn->send(std::string("k"));
+        return;
+    }
+    TcpConnectionPtr backend = g_backend;
+    g_backend.reset();
+    if (kind == 's')
+    {
+        conn->relayTo(backend);
+        backend->relayTo(conn);
+    }
+    else
+    {
+        g_copyPeers[conn.get()] = backend;
+        g_copyPeers[backend.get()] = conn;
+        backend->send(buf);
+    }
+}
+
+void onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        conn->setTcpNoDelay(true);
+        return;
+    }
+    // 一端断开以后关闭另一端
+    auto it = g_copyPeers.find(conn.get());
+    if (it != g_copyPeers.end())
+    {
+        TcpConnectionPtr peer = it->second.lock();
+        g_copyPeers.erase(it);
+        if (peer)
+        {
+            g_copyPeers.erase(peer.get());
+            peer->shutdown();
+        }
+    }
+}
+
+double cpuSeconds()
+{
+    rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+        + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+int connectTo(uint16_t port)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+void runOne(uint16_t port, bool splice, size_t total)
+{
+    int backend = connectTo(port);
+    char ack;
+    if (::write(backend, "B", 1) != 1 || ::read(backend, &ack, 1) != 1)
+    {
+        fprintf(stderr, "backend handshake failed\n");
+        exit(1);
+    }
+    int client = connectTo(port);
+
+    double cpuStart = cpuSeconds();
+    auto start = std::chrono::steady_clock::now();
+    std::thread sink([backend, total]() {
+        std::string buf(256 * 1024, '\0');
+        size_t received = 0;
+        while (received < total)
+        {
+            ssize_t n = ::read(backend, &buf[0], buf.size());
+            if (n <= 0)
+            {
+                fprintf(stderr, "connection broken\n");
+                exit(1);
+            }
+            received += n;
+        }
+    });
+
+    std::string chunk(256 * 1024, 'r');
+    chunk[0] = splice ? 's' : 'c';
+    size_t sent = 0;
+    while (sent < total + 1)
+    {
+        size_t len = std::min(chunk.size(), total + 1 - sent);
+        ssize_t n = ::write(client, chunk.data(), len);
+        if (n <= 0)
+        {
+            perror("write");
+            exit(1);
+        }
+        sent += n;
+        chunk[0] = 'r';
+    }
+    sink.join();
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double cpu = cpuSeconds() - cpuStart;
+    ::close(client);
+    ::close(backend);
+
+    double gb = static_cast<double>(total) / (1024.0 * 1024 * 1024);
+    printf("%-6s total=%zuMB %8.1f MB/s %8.3f cpu-sec/GB\n",
+        splice ? "splice" : "copy", total >> 20, gb * 1024 / sec, cpu / gb);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 屏蔽库内部输出到 std::cout 的日志，只保留 printf 输出的测试结果
+    std::cout.setstate(std::ios_base::badbit);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    uint16_t port = static_cast<uint16_t>(argc > 1 ? atoi(argv[1]) : 9987);
+    size_t total = static_cast<size_t>(argc > 2 ? atoi(argv[2]) : 1024) << 20;
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "RelayBench");
+    server.setConnectionCallback(onConnection);
+    server.setMessageCallback(onMessage);
+    server.start();
+
+    std::thread client([&loop, port, total]() {
+        for (int i = 0; i < 2; ++i)
+        {
+            runOne(port, false, total);
+            runOne(port, true, total);
+        }
+        loop.quit();
+    });
+
+    loop.loop();
+    client.join();
+    return 0;
+}
@@ -0,0 +1,380 @@
+/**
+ * RpcServer / RpcClient 的吞吐和延迟：服务端注册两个回显方法，一个在 IO loop 中直接处理（inline），
+ * 一个投递到计算线程池处理（compute）。每个连接保持 depth 个未完成的调用，一个调用完成立即发起下一个，
+ * 对每种方法和深度输出调用次数/秒和调用延迟分位数。depth 为 1 时相当于 ping-pong，
+ * depth 较大时同一条连接上的请求和响应成批收发。
+ * 测试之前用 future 接口检查回显、未注册的方法和超时，并检查在其他 loop 中发起的调用回调回到那个 loop。
+ *
+ * 用法: rpc_bench [-c 连接数] [-q 深度,...] [-s 负载大小] [-d 每项秒数]
+ *                 [-C 客户端线程数] [-S 服务端线程数] [-W 计算线程数]
+ */
+#include "RpcServer.h"
+#include "RpcClient.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const uint16_t kPort = 10081;
+
+// 服务端方法号
+const uint16_t kEchoInline = 1;
+const uint16_t kEchoCompute = 2;
+const uint16_t kNeverReply = 3;
+
+using Clock = std::chrono::steady_clock;
+
+struct Result
+{
+    uint64_t count;
+    uint64_t errors;
+    std::vector<double> latencies;  // 单位微秒
+};
+
+// 一个客户端连接，除构造函数外所有函数都在 loop 线程中调用
+class Session : noncopyable
+{
+public:
+    Session(EventLoop *loop, const InetAddress &serverAddr, uint16_t method, size_t size, int depth,
+            std::atomic_int *connected)
+        : method_(method)
+        , depth_(depth)
+        , connected_(connected)
+        , running_(false)
+        , client_(loop, serverAddr, "RpcBench")
+        , payload_(size, 'x')
+        , result_{0, 0, {}}
+    {
+        SocketOptions options;
+        options.tcpNoDelay = true;
+        client_.tcpClient()->setSocketOptions(options);
+        client_.setConnectionCallback(std::bind(&Session::onConnection, this, std::placeholders::_1));
+        client_.connect();
+    }
+
+    void start()
+    {
+        running_ = true;
+        for (int i = 0; i < depth_; ++i)
+        {
+            sendRequest();
+        }
+    }
+
+    // 停止发送并关闭连接，连接断开以后才能析构
+    Result stop()
+    {
+        running_ = false;
+        client_.disconnect();
+        TcpConnectionPtr conn = client_.tcpClient()->connection();
+        if (conn)
+        {
+            conn->forceClose();
+        }
+        return std::move(result_);
+    }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            ++*connected_;
+        }
+        else
+        {
+            --*connected_;
+        }
+    }
+
+    void onResponse(Clock::time_point sentAt, RpcCodec::Status status, StringPiece payload)
+    {
+        if (!running_)
+        {
+            return;
+        }
+        if (status == RpcCodec::kOk && payload.size() == payload_.size())
+        {
+            ++result_.count;
+            result_.latencies.push_back(std::chrono::duration<double, std::micro>(Clock::now() - sentAt).count());
+        }
+        else
+        {
+            ++result_.errors;
+        }
+        sendRequest();
+    }
+
+    void sendRequest()
+    {
+        client_.call(method_, payload_, 0, std::bind(&Session::onResponse, this, Clock::now(),
+            std::placeholders::_1, std::placeholders::_2));
+    }
+
+    const uint16_t method_;
+    const int depth_;
+    std::atomic_int *connected_;
+    bool running_;
+    RpcClient client_;
+    std::string payload_;
+    Result result_;
+};
+
+struct Config
+{
+    int connections = 4;
+    std::vector<size_t> depths = { 1, 100 };
+    size_t size = 64;
+    double seconds = 2.0;
+    int clientThreads = 1;
+    int serverThreads = 1;
+    int computeThreads = 1;
+};
+
+template <typename F>
+void runAndWait(EventLoop *loop, F f)
+{
+    std::promise<void> done;
+    loop->runInLoop([&f, &done]() {
+        f();
+        done.set_value();
+    });
+    done.get_future().get();
+}
+
+double percentile(std::vector<double> &values, double p)
+{
+    if (values.empty())
+    {
+        return 0.0;
+    }
+    size_t index = static_cast<size_t>(p * (values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+void waitConnected(const std::atomic_int &connected, int n)
+{
+    while (connected != n)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+}
+
+// 用 future 接口检查基本语义，返回是否全部通过
+bool runChecks(EventLoop *loop, const InetAddress &serverAddr)
+{
+    std::atomic_int connected(0);
+    std::unique_ptr<RpcClient> client;
+    runAndWait(loop, [&]() {
+        client.reset(new RpcClient(loop, serverAddr, "RpcCheck"));
+        client->setConnectionCallback([&connected](const TcpConnectionPtr &conn) {
+            conn->connected() ? ++connected : --connected;
+        });
+        client->connect();
+    });
+    waitConnected(connected, 1);
+
+    bool ok = true;
+    auto check = [&ok](const char *name, bool passed) {
+        printf("check %-28s %s\n", name, passed ? "ok" : "FAILED");
+        ok = ok && passed;
+    };
+
+    RpcClient::Result echo = client->call(kEchoInline, "hello", 1.0).get();
+    check("inline echo", echo.status == RpcCodec::kOk && echo.payload == "hello");
+    RpcClient::Result compute = client->call(kEchoCompute, "world", 1.0).get();
+    check("compute echo", compute.status == RpcCodec::kOk && compute.payload == "world");
+    RpcClient::Result missing = client->call(99, "", 1.0).get();
+    check("unknown method", missing.status == RpcCodec::kNoSuchMethod);
+    auto start = Clock::now();
+    RpcClient::Result timeout = client->call(kNeverReply, "", 0.05).get();
+    double waited = std::chrono::duration<double>(Clock::now() - start).count();
+    check("timeout", timeout.status == RpcCodec::kTimeout && waited >= 0.05 && waited < 0.5);
+    // 超时的调用之后，同一条连接上的调用不受影响
+    RpcClient::Result after = client->call(kEchoInline, "again", 1.0).get();
+    check("call after timeout", after.status == RpcCodec::kOk && after.payload == "again");
+    // 在另一个 loop 中发起的调用，回调回到这个 loop 执行
+    {
+        EventLoopThread callerThread(EventLoopThread::ThreadInitCallback(), "caller");
+        EventLoop *callerLoop = callerThread.startLoop();
+        std::promise<bool> inCaller;
+        callerLoop->runInLoop([&]() {
+            client->call(kEchoInline, "caller", 1.0, [&](RpcCodec::Status status, StringPiece payload) {
+                inCaller.set_value(callerLoop->isInLoopThread() && status == RpcCodec::kOk
+                    && payload == StringPiece("caller"));
+            });
+        });
+        check("callback on caller's loop", inCaller.get_future().get());
+    }
+
+    runAndWait(loop, [&]() { client->disconnect(); });
+    waitConnected(connected, 0);
+    runAndWait(loop, [&]() { client.reset(); });
+    return ok;
+}
+
+void runCalls(const std::vector<EventLoop*> &loops, const Config &config, const char *name,
+              const InetAddress &serverAddr, uint16_t method, int depth)
+{
+    const int n = config.connections;
+    auto loopOf = [&loops](int i) { return loops[i % loops.size()]; };
+    std::atomic_int connected(0);
+    std::vector<std::unique_ptr<Session>> sessions(n);
+    for (int i = 0; i < n; ++i)
+    {
+        runAndWait(loopOf(i), [&, i]() {
+            sessions[i].reset(new Session(loopOf(i), serverAddr, method, config.size, depth, &connected));
+        });
+    }
+    waitConnected(connected, n);
+
+    auto start = Clock::now();
+    for (int i = 0; i < n; ++i)
+    {
+        loopOf(i)->runInLoop(std::bind(&Session::start, sessions[i].get()));
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(config.seconds));
+    std::vector<Result> results(n);
+    for (int i = 0; i < n; ++i)
+    {
+        runAndWait(loopOf(i), [&, i]() { results[i] = sessions[i]->stop(); });
+    }
+    double sec = std::chrono::duration<double>(Clock::now() - start).count();
+    waitConnected(connected, 0);
+    for (int i = 0; i < n; ++i)
+    {
+        runAndWait(loopOf(i), [&, i]() { sessions[i].reset(); });
+    }
+
+    uint64_t count = 0;
+    uint64_t errors = 0;
+    std::vector<double> latencies;
+    for (Result &r : results)
+    {
+        count += r.count;
+        errors += r.errors;
+        latencies.insert(latencies.end(), r.latencies.begin(), r.latencies.end());
+    }
+    printf("%-8s depth=%-4d %9.0f calls/s  p50=%7.1fus  p99=%7.1fus  errors=%lu\n", name, depth, count / sec,
+        percentile(latencies, 0.5), percentile(latencies, 0.99), static_cast<unsigned long>(errors));
+}
+
+std::vector<size_t> parseList(const char *arg)
+{
+    std::vector<size_t> values;
+    std::string list(arg);
+    size_t pos = 0;
+    while (pos <= list.size())
+    {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos)
+        {
+            comma = list.size();
+        }
+        size_t value = static_cast<size_t>(atol(list.substr(pos, comma - pos).c_str()));
+        if (value > 0)
+        {
+            values.push_back(value);
+        }
+        pos = comma + 1;
+    }
+    return values;
+}
+
+void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-c connections] [-q depth,...] [-s size] [-d seconds]"
+        " [-C client_threads] [-S server_threads] [-W compute_threads]\n", prog);
+    exit(1);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 屏蔽库内部输出到 std::cout 的日志，只保留 printf 输出的测试结果
+    std::cout.setstate(std::ios_base::badbit);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    Config config;
+    int opt;
+    while ((opt = ::getopt(argc, argv, "c:q:s:d:C:S:W:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c': config.connections = atoi(optarg); break;
+        case 'q': config.depths = parseList(optarg); break;
+        case 's': config.size = static_cast<size_t>(atol(optarg)); break;
+        case 'd': config.seconds = atof(optarg); break;
+        case 'C': config.clientThreads = atoi(optarg); break;
+        case 'S': config.serverThreads = atoi(optarg); break;
+        case 'W': config.computeThreads = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (config.connections <= 0 || config.depths.empty() || config.seconds <= 0
+        || config.clientThreads <= 0 || config.serverThreads < 0 || config.computeThreads < 0)
+    {
+        usage(argv[0]);
+    }
+
+    const InetAddress serverAddr(kPort, "127.0.0.1");
+
+    EventLoop loop;
+    RpcServer server(&loop, serverAddr, "RpcBench");
+    SocketOptions options;
+    options.tcpNoDelay = true;
+    server.tcpServer()->setSocketOptions(options);
+    server.setThreadNum(config.serverThreads);
+    server.setComputeThreadNum(config.computeThreads);
+    auto echo = [](StringPiece request, const RpcServer::Reply &reply) { reply.ok(request); };
+    server.registerMethod(kEchoInline, echo, RpcServer::kInline);
+    server.registerMethod(kEchoCompute, echo, RpcServer::kCompute);
+    server.registerMethod(kNeverReply, [](StringPiece, const RpcServer::Reply&) {});
+    server.start();
+
+    int status = 0;
+    std::thread driver([&]() {
+        printf("%d connections, %zu byte payload, %d client threads, %d server threads, %d compute threads,"
+            " %.1f seconds per run\n", config.connections, config.size, config.clientThreads,
+            config.serverThreads, config.computeThreads, config.seconds);
+        {
+            std::vector<std::unique_ptr<EventLoopThread>> threads;
+            std::vector<EventLoop*> loops;
+            for (int i = 0; i < config.clientThreads; ++i)
+            {
+                threads.emplace_back(new EventLoopThread(EventLoopThread::ThreadInitCallback(), "client"));
+                loops.push_back(threads.back()->startLoop());
+            }
+            if (!runChecks(loops.front(), serverAddr))
+            {
+                status = 1;
+            }
+            for (size_t depth : config.depths)
+            {
+                runCalls(loops, config, "inline", serverAddr, kEchoInline, static_cast<int>(depth));
+                runCalls(loops, config, "compute", serverAddr, kEchoCompute, static_cast<int>(depth));
+            }
+        }
+        loop.quit();
+    });
+
+    loop.loop();
+    driver.join();
+    return status;
+}
@@ -0,0 +1,192 @@
+/**
+ * 发送队列基准测试（loopback）：每个响应由 私有的响应头 + 响应体 + 所有响应共享的结尾 组成
+ *   flatten: 拼接成一个 std::string 再 send，无法立即写出的部分再拷贝进 outputBuffer_
+ *   gather:  以 SharedStringList 交给发送队列，用 writev 直接从各段内存发送
+ * 输出每个响应的系统调用次数、拷贝字节数以及吞吐量。
+ *
+ * 用法: send_queue_bench [port] [responses_per_run]
+ */
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace
+{
+
+const size_t kHeaderSize = 128;
+const size_t kTrailerSize = 1024;
+const int kDepth = 8;              // 客户端一次发出的请求数
+
+int g_responsesPerRun = 2000;
+
+std::atomic_bool g_gather(false);
+SharedString g_body;
+SharedString g_trailer;
+
+// 以下统计只在 loop 线程中访问，客户端在 loop 线程更新完以后读取
+uint64_t g_userCopiedBytes = 0;
+std::atomic<uint64_t> g_writeCalls(0);
+std::atomic<uint64_t> g_copiedBytes(0);
+std::atomic_bool g_statsReady(false);
+
+std::string makeHeader(int seq)
+{
+    char buf[kHeaderSize];
+    ::memset(buf, ' ', sizeof buf);
+    int n = snprintf(buf, sizeof buf, "seq=%d len=%zu", seq, g_body->size());
+    buf[n] = ' ';
+    buf[kHeaderSize - 1] = '\n';
+    return std::string(buf, sizeof buf);
+}
+
+void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    static int seq = 0;
+    while (buf->readableBytes() > 0)
+    {
+        buf->retrieve(1);
+        std::string header = makeHeader(seq++);
+        if (g_gather)
+        {
+            SharedStringList parts;
+            parts.push_back(std::make_shared<const std::string>(std::move(header)));
+            parts.push_back(g_body);
+            parts.push_back(g_trailer);
+            conn->send(parts);
+        }
+        else
+        {
+            std::string response;
+            response.reserve(header.size() + g_body->size() + g_trailer->size());
+            response += header;
+            response += *g_body;
+            response += *g_trailer;
+            g_userCopiedBytes += response.size();
+            conn->send(response);
+        }
+    }
+}
+
+void onConnection(const TcpConnectionPtr &conn)
+{
+    if (!conn->connected())
+    {
+        TcpConnection::SendStats stats = conn->sendStats();
+        g_writeCalls = stats.writeCalls;
+        g_copiedBytes = stats.copiedBytes + g_userCopiedBytes;
+        g_userCopiedBytes = 0;
+        g_statsReady = true;
+    }
+}
+
+bool readAll(int fd, char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = ::read(fd, data, len);
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+void runClient(uint16_t port, bool gather)
+{
+    g_gather = gather;
+    g_statsReady = false;
+
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+
+    const size_t responseSize = kHeaderSize + g_body->size() + kTrailerSize;
+    std::string requests(kDepth, 'r');
+    std::string responses(responseSize * kDepth, '\0');
+
+    auto start = std::chrono::steady_clock::now();
+    for (int done = 0; done < g_responsesPerRun; done += kDepth)
+    {
+        if (::write(fd, requests.data(), requests.size()) != static_cast<ssize_t>(requests.size())
+            || !readAll(fd, &responses[0], responses.size()))
+        {
+            fprintf(stderr, "connection broken\n");
+            exit(1);
+        }
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ::close(fd);
+
+    while (!g_statsReady)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    printf("%-7s body=%-7zu %8.2f syscalls/resp %10.0f copied bytes/resp %8.1f MB/s\n",
+        gather ? "gather" : "flatten", g_body->size(),
+        static_cast<double>(g_writeCalls) / g_responsesPerRun,
+        static_cast<double>(g_copiedBytes) / g_responsesPerRun,
+        responseSize * g_responsesPerRun / sec / 1e6);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 屏蔽库内部输出到 std::cout 的日志，只保留 printf 输出的测试结果
+    std::cout.setstate(std::ios_base::badbit);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    uint16_t port = static_cast<uint16_t>(argc > 1 ? atoi(argv[1]) : 9982);
+    if (argc > 2)
+    {
+        g_responsesPerRun = atoi(argv[2]);
+    }
+
+    g_trailer = std::make_shared<const std::string>(kTrailerSize, 't');
+
+    EventLoop loop;
+    TcpServer server(&loop, InetAddress(port), "SendQueueBench");
+    server.setConnectionCallback(onConnection);
+    server.setMessageCallback(onMessage);
+    server.start();
+
+    std::thread client([&loop, port]() {
+        const size_t bodySizes[] = { 64 * 1024, 512 * 1024, 2 * 1024 * 1024 };
+        for (size_t bodySize : bodySizes)
+        {
+            g_body = std::make_shared<const std::string>(bodySize, 'b');
+            runClient(port, false);
+            runClient(port, true);
+        }
+        loop.quit();
+    });
+
+    loop.loop();
+    client.join();
+    return 0;
+}
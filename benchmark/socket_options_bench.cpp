@@ -0,0 +1,174 @@
+/**
+ * socket 选项预设的基准测试（loopback），对每种预设启动一个服务端：
+ *   default:         SocketOptions()
+ *   low-latency:     SocketOptions::lowLatency()
+ *   bulk-throughput: SocketOptions::bulkThroughput()
+ * 请求响应：客户端发送 1 字节请求，服务端分两次 send 响应头和响应体，输出平均往返时间；
+ * Nagle 算法和客户端的延迟确认叠加时，第二次 send 会被推迟。
+ * 大块数据：服务端连续发送 256MB，输出吞吐量。
+ *
+ * 用法: socket_options_bench [port] [round_trips]
+ */
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const size_t kHeaderSize = 16;
+const size_t kBodySize = 48;
+const size_t kBulkChunk = 1024 * 1024;
+const int kBulkChunks = 256;
+
+SharedString g_header;
+SharedString g_body;
+SharedString g_chunk;
+
+void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    while (buf->readableBytes() > 0)
+    {
+        char kind = buf->readInt8();
+        if (kind == 'r')
+        {
+            conn->send(*g_header);
+            conn->send(*g_body);
+        }
+        else
+        {
+            for (int i = 0; i < kBulkChunks; ++i)
+            {
+                conn->send(g_chunk);
+            }
+        }
+    }
+}
+
+int connectTo(uint16_t port)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+    return fd;
+}
+
+bool readAll(int fd, char *data, size_t len)
+{
+    while (len > 0)
+    {
+        ssize_t n = ::read(fd, data, len);
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        len -= n;
+    }
+    return true;
+}
+
+void runPreset(const char *name, uint16_t port, int roundTrips)
+{
+    int fd = connectTo(port);
+    char response[kHeaderSize + kBodySize];
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < roundTrips; ++i)
+    {
+        if (::write(fd, "r", 1) != 1 || !readAll(fd, response, sizeof response))
+        {
+            fprintf(stderr, "connection broken\n");
+            exit(1);
+        }
+    }
+    double rttUs = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count() / roundTrips;
+
+    std::vector<char> buf(256 * 1024);
+    size_t total = kBulkChunk * kBulkChunks;
+    start = std::chrono::steady_clock::now();
+    if (::write(fd, "b", 1) != 1)
+    {
+        perror("write");
+        exit(1);
+    }
+    size_t received = 0;
+    while (received < total)
+    {
+        ssize_t n = ::read(fd, buf.data(), buf.size());
+        if (n <= 0)
+        {
+            fprintf(stderr, "connection broken\n");
+            exit(1);
+        }
+        received += n;
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ::close(fd);
+
+    printf("%-16s request/response %10.1f us/rtt   bulk %8.1f MB/s\n",
+        name, rttUs, total / sec / (1024 * 1024));
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 屏蔽库内部输出到 std::cout 的日志，只保留 printf 输出的测试结果
+    std::cout.setstate(std::ios_base::badbit);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    uint16_t port = static_cast<uint16_t>(argc > 1 ? atoi(argv[1]) : 9992);
+    int roundTrips = argc > 2 ? atoi(argv[2]) : 50;
+
+    g_header = std::make_shared<const std::string>(kHeaderSize, 'h');
+    g_body = std::make_shared<const std::string>(kBodySize, 'b');
+    g_chunk = std::make_shared<const std::string>(kBulkChunk, 'c');
+
+    const char *names[] = { "default", "low-latency", "bulk-throughput" };
+    SocketOptions presets[] = { SocketOptions(), SocketOptions::lowLatency(), SocketOptions::bulkThroughput() };
+
+    EventLoop loop;
+    std::vector<std::unique_ptr<TcpServer>> servers;
+    for (int i = 0; i < 3; ++i)
+    {
+        servers.emplace_back(new TcpServer(&loop, InetAddress(static_cast<uint16_t>(port + i)), names[i]));
+        servers.back()->setSocketOptions(presets[i]);
+        servers.back()->setConnectionCallback([](const TcpConnectionPtr&) {});
+        servers.back()->setMessageCallback(onMessage);
+        servers.back()->start();
+    }
+
+    std::thread client([&]() {
+        for (int i = 0; i < 3; ++i)
+        {
+            runPreset(names[i], static_cast<uint16_t>(port + i), roundTrips);
+        }
+        loop.quit();
+    });
+
+    loop.loop();
+    client.join();
+    return 0;
+}
@@ -0,0 +1,304 @@
+/**
+ * TLS 吞吐量基准测试（loopback，自签名证书）
+ *   plain:  不加密，作为基准
+ *   user:   握手后用 SSL_write 在用户态加密，文件段先 pread 到用户态
+ *   ktls:   握手后尝试把加密交给内核（kTLS），成功时发送仍然走 writev / sendfile
+ * 每种模式分别测试内存数据（SharedString）和文件（sendFile）两种响应，客户端收完一个响应后请求下一个。
+ * 内核没有加载 tls 模块或者加密套件不支持时 kTLS 不会生效，输出的 ktls 列如实报告是否生效。
+ *
+ * 用法: tls_bench [size_kb] [total_mb]
+ */
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+#include "TlsContext.h"
+#include "TlsSession.h"
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <openssl/err.h>
+#include <openssl/pem.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace
+{
+
+const size_t kRequestLen = 5;
+
+SharedString g_payload;
+int g_fileFd = -1;
+std::atomic_int g_serverKtls(-1);   // 最近一个连接握手后服务端发送方向是否使用 kTLS
+
+// 生成 EC P-256 自签名证书，写入 certFile / keyFile
+bool makeCertificate(const std::string &certFile, const std::string &keyFile)
+{
+    EVP_PKEY *key = nullptr;
+    EVP_PKEY_CTX *pctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+    if (pctx == nullptr
+        || EVP_PKEY_keygen_init(pctx) <= 0
+        || EVP_PKEY_CTX_set_ec_paramgen_curve_nid(pctx, NID_X9_62_prime256v1) <= 0
+        || EVP_PKEY_keygen(pctx, &key) <= 0)
+    {
+        EVP_PKEY_CTX_free(pctx);
+        return false;
+    }
+    EVP_PKEY_CTX_free(pctx);
+
+    X509 *cert = X509_new();
+    ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+    X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+    X509_gmtime_adj(X509_getm_notAfter(cert), 24 * 3600);
+    X509_set_pubkey(cert, key);
+    X509_NAME *name = X509_get_subject_name(cert);
+    X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+        reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+    X509_set_issuer_name(cert, name);
+    bool ok = X509_sign(cert, key, EVP_sha256()) > 0;
+
+    FILE *fp = ok ? ::fopen(certFile.c_str(), "w") : nullptr;
+    ok = fp != nullptr && PEM_write_X509(fp, cert) == 1;
+    if (fp != nullptr)
+    {
+        ::fclose(fp);
+    }
+    fp = ok ? ::fopen(keyFile.c_str(), "w") : nullptr;
+    ok = fp != nullptr && PEM_write_PrivateKey(fp, key, nullptr, nullptr, 0, nullptr, nullptr) == 1;
+    if (fp != nullptr)
+    {
+        ::fclose(fp);
+    }
+    X509_free(cert);
+    EVP_PKEY_free(key);
+    return ok;
+}
+
+void onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected() && conn->tls() != nullptr)
+    {
+        g_serverKtls = conn->tls()->ktlsSend() ? 1 : 0;
+    }
+}
+
+// 请求: 1 字节类型（'m' 内存 / 'f' 文件）+ 4 字节长度
+void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    while (buf->readableBytes() >= kRequestLen)
+    {
+        bool file = buf->readInt8() == 'f';
+        size_t size = static_cast<uint32_t>(buf->readInt32());
+        if (file)
+        {
+            conn->sendFile(g_fileFd, 0, size);
+        }
+        else
+        {
+            conn->send(g_payload);
+        }
+    }
+}
+
+double cpuSeconds()
+{
+    rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+        + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+// 阻塞的客户端连接，ctx 为空时不加密
+class Client
+{
+public:
+    Client(uint16_t port, SSL_CTX *ctx)
+        : fd_(::socket(AF_INET, SOCK_STREAM, 0))
+        , ssl_(nullptr)
+    {
+        sockaddr_in addr;
+        ::memset(&addr, 0, sizeof addr);
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        if (::connect(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0)
+        {
+            perror("connect");
+            exit(1);
+        }
+        if (ctx != nullptr)
+        {
+            ssl_ = SSL_new(ctx);
+            SSL_set_fd(ssl_, fd_);
+            if (SSL_connect(ssl_) != 1)
+            {
+                ERR_print_errors_fp(stderr);
+                exit(1);
+            }
+        }
+    }
+
+    ~Client()
+    {
+        if (ssl_ != nullptr)
+        {
+            SSL_shutdown(ssl_);
+            SSL_free(ssl_);
+        }
+        ::close(fd_);
+    }
+
+    bool ktlsRecv() const { return ssl_ != nullptr && BIO_get_ktls_recv(SSL_get_rbio(ssl_)) != 0; }
+
+    void writeAll(const char *data, size_t len)
+    {
+        ssize_t n = ssl_ != nullptr ? SSL_write(ssl_, data, static_cast<int>(len)) : ::write(fd_, data, len);
+        if (n != static_cast<ssize_t>(len))
+        {
+            fprintf(stderr, "write failed\n");
+            exit(1);
+        }
+    }
+
+    void readAll(char *buf, size_t bufSize, size_t len)
+    {
+        while (len > 0)
+        {
+            size_t want = len < bufSize ? len : bufSize;
+            ssize_t n = ssl_ != nullptr ? SSL_read(ssl_, buf, static_cast<int>(want)) : ::read(fd_, buf, want);
+            if (n <= 0)
+            {
+                fprintf(stderr, "connection broken\n");
+                exit(1);
+            }
+            len -= n;
+        }
+    }
+
+private:
+    int fd_;
+    SSL *ssl_;
+};
+
+void runOne(const char *mode, uint16_t port, SSL_CTX *ctx, bool file, size_t size, size_t totalBytes)
+{
+    g_serverKtls = -1;
+    Client client(port, ctx);
+
+    Buffer request;
+    request.appendInt8(file ? 'f' : 'm');
+    request.appendInt32(static_cast<int32_t>(size));
+
+    std::string buf(256 * 1024, '\0');
+    const size_t rounds = totalBytes / size + 1;
+    double cpuStart = cpuSeconds();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; ++i)
+    {
+        client.writeAll(request.peek(), request.readableBytes());
+        client.readAll(&buf[0], buf.size(), size);
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double cpu = cpuSeconds() - cpuStart;
+
+    const char *ktls = "-";
+    if (ctx != nullptr)
+    {
+        ktls = g_serverKtls == 1 ? (client.ktlsRecv() ? "tx+rx" : "tx") : "no";
+    }
+    double gb = static_cast<double>(size) * rounds / (1024.0 * 1024 * 1024);
+    printf("%-6s %-7s %9.1f MB/s %8.3f cpu-sec/GB  ktls=%s\n",
+        mode, file ? "file" : "memory", gb * 1024 / sec, cpu / gb, ktls);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 屏蔽库内部输出到 std::cout 的日志，只保留 printf 输出的测试结果
+    std::cout.setstate(std::ios_base::badbit);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    size_t size = static_cast<size_t>(argc > 1 ? atoi(argv[1]) : 256) * 1024;
+    size_t totalBytes = static_cast<size_t>(argc > 2 ? atoi(argv[2]) : 256) * 1024 * 1024;
+
+    std::string prefix = "/tmp/tls_bench_" + std::to_string(::getpid());
+    std::string certFile = prefix + ".crt";
+    std::string keyFile = prefix + ".key";
+    std::string dataFile = prefix + ".dat";
+    if (!makeCertificate(certFile, keyFile))
+    {
+        fprintf(stderr, "failed to create certificate\n");
+        return 1;
+    }
+
+    g_payload = std::make_shared<const std::string>(size, 't');
+    g_fileFd = ::open(dataFile.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+    if (g_fileFd < 0 || ::write(g_fileFd, g_payload->data(), size) != static_cast<ssize_t>(size))
+    {
+        perror("data file");
+        return 1;
+    }
+
+    std::shared_ptr<TlsContext> userContext = TlsContext::newServerContext(certFile, keyFile);
+    std::shared_ptr<TlsContext> ktlsContext = TlsContext::newServerContext(certFile, keyFile);
+    if (!userContext || !ktlsContext)
+    {
+        fprintf(stderr, "failed to create TLS context\n");
+        return 1;
+    }
+    userContext->setKtls(false);
+
+    EventLoop loop;
+    TcpServer plainServer(&loop, InetAddress(9995, "127.0.0.1"), "PlainBench");
+    TcpServer userServer(&loop, InetAddress(9996, "127.0.0.1"), "TlsUserBench");
+    TcpServer ktlsServer(&loop, InetAddress(9997, "127.0.0.1"), "TlsKernelBench");
+    userServer.setTlsContext(userContext);
+    ktlsServer.setTlsContext(ktlsContext);
+    TcpServer *servers[] = { &plainServer, &userServer, &ktlsServer };
+    for (TcpServer *server : servers)
+    {
+        server->setConnectionCallback(onConnection);
+        server->setMessageCallback(onMessage);
+        server->start();
+    }
+
+    std::thread client([&loop, size, totalBytes]() {
+        SSL_CTX *userCtx = SSL_CTX_new(TLS_client_method());
+        SSL_CTX *ktlsCtx = SSL_CTX_new(TLS_client_method());
+#ifdef SSL_OP_ENABLE_KTLS
+        SSL_CTX_set_options(ktlsCtx, SSL_OP_ENABLE_KTLS);
+#endif
+        printf("response size=%zu KB, %zu MB per run\n", size / 1024, totalBytes / (1024 * 1024));
+        for (int file = 0; file < 2; ++file)
+        {
+            runOne("plain", 9995, nullptr, file != 0, size, totalBytes);
+            runOne("user", 9996, userCtx, file != 0, size, totalBytes);
+            runOne("ktls", 9997, ktlsCtx, file != 0, size, totalBytes);
+        }
+        SSL_CTX_free(userCtx);
+        SSL_CTX_free(ktlsCtx);
+        loop.quit();
+    });
+
+    loop.loop();
+    client.join();
+
+    ::close(g_fileFd);
+    ::unlink(dataFile.c_str());
+    ::unlink(certFile.c_str());
+    ::unlink(keyFile.c_str());
+    return 0;
+}
@@ -0,0 +1,278 @@
+/**
+ * UdpServer 基准测试（loopback）：服务端原样回复收到的数据报。
+ * 客户端 socket 也是 UdpChannel，平均分配到若干个客户端 loop 线程，每个 socket 保持 window 个未回复的数据报，
+ * 收到一个回复就补发一个；丢包导致一段时间没有收到回复时重新补满窗口。
+ * 依次测试几种配置：不批量（每次系统调用一个数据报）、recvmmsg/sendmmsg 批量、批量加 GSO/GRO，
+ * 输出每秒回复的数据报个数，以及服务端平均每次 recvmmsg / sendmmsg 处理的数据报个数。
+ *
+ * 用法: udp_bench [-c socket 数] [-d 每项秒数] [-w window] [-s 数据报大小] [-b batch] [-C 客户端线程数] [-S 服务端线程数]
+ */
+#include "UdpServer.h"
+#include "UdpChannel.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "TimerId.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const uint16_t kBasePort = 10061;
+
+using Clock = std::chrono::steady_clock;
+
+// 一个客户端 socket，除构造函数外所有函数都在 loop 线程中调用
+class Session : noncopyable
+{
+public:
+    Session(EventLoop *loop, const InetAddress &server, const UdpOptions &options, size_t size, size_t window)
+        : loop_(loop)
+        , server_(server)
+        , window_(window)
+        , running_(false)
+        , channel_(loop, InetAddress(0, "127.0.0.1"), options, false)
+        , payload_(size, 'x')
+        , replies_(0)
+        , lastReplies_(0)
+    {
+        channel_.setMessageCallback(std::bind(&Session::onMessage, this, std::placeholders::_1));
+        channel_.start();
+    }
+
+    void start()
+    {
+        running_ = true;
+        fill();
+        refillTimer_ = loop_->runEvery(0.05, std::bind(&Session::checkStalled, this));
+    }
+
+    uint64_t stop()
+    {
+        running_ = false;
+        loop_->cancel(refillTimer_);
+        return replies_;
+    }
+
+private:
+    void onMessage(UdpChannel *channel)
+    {
+        ++replies_;
+        if (running_)
+        {
+            channel->send(server_, payload_);
+        }
+    }
+
+    void fill()
+    {
+        for (size_t i = 0; i < window_; ++i)
+        {
+            channel_.send(server_, payload_);
+        }
+    }
+
+    // 丢包会让窗口逐渐变小，一个周期内没有收到回复时重新补满
+    void checkStalled()
+    {
+        if (running_ && replies_ == lastReplies_)
+        {
+            fill();
+        }
+        lastReplies_ = replies_;
+    }
+
+    EventLoop *loop_;
+    const InetAddress server_;
+    const size_t window_;
+    bool running_;
+    UdpChannel channel_;
+    std::string payload_;
+    uint64_t replies_;
+    uint64_t lastReplies_;
+    TimerId refillTimer_;
+};
+
+struct Config
+{
+    int sockets = 8;
+    double seconds = 2.0;
+    size_t window = 32;
+    size_t size = 64;
+    int batch = 64;
+    int clientThreads = 1;
+    int serverThreads = 1;
+};
+
+struct Variant
+{
+    const char *name;
+    int batch;
+    bool offload;    // GSO 和 GRO
+};
+
+template <typename F>
+void runAndWait(EventLoop *loop, F f)
+{
+    std::promise<void> done;
+    loop->runInLoop([&f, &done]() {
+        f();
+        done.set_value();
+    });
+    done.get_future().get();
+}
+
+void runVariant(EventLoop *serverLoop, const std::vector<EventLoop*> &loops, const Config &config,
+                const Variant &variant, uint16_t port)
+{
+    UdpOptions options;
+    options.batchSize = variant.batch;
+    options.gso = variant.offload;
+    options.gro = variant.offload;
+    options.recvBufferSize = 4 * 1024 * 1024;
+    options.sendBufferSize = 4 * 1024 * 1024;
+
+    const InetAddress serverAddr(port, "127.0.0.1");
+    std::unique_ptr<UdpServer> server;
+    runAndWait(serverLoop, [&]() {
+        server.reset(new UdpServer(serverLoop, serverAddr, "UdpBench"));
+        server->setThreadNum(config.serverThreads);
+        server->setOptions(options);
+        server->setMessageCallback([](UdpChannel *channel, const InetAddress &peer, StringPiece datagram, Timestamp) {
+            channel->send(peer, datagram);
+        });
+        server->start();
+    });
+
+    const int n = config.sockets;
+    auto loopOf = [&loops](int i) { return loops[i % loops.size()]; };
+    std::vector<std::unique_ptr<Session>> sessions(n);
+    for (int i = 0; i < n; ++i)
+    {
+        runAndWait(loopOf(i), [&, i]() {
+            sessions[i].reset(new Session(loopOf(i), serverAddr, options, config.size, config.window));
+        });
+    }
+
+    auto start = Clock::now();
+    for (int i = 0; i < n; ++i)
+    {
+        loopOf(i)->runInLoop(std::bind(&Session::start, sessions[i].get()));
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(config.seconds));
+    uint64_t replies = 0;
+    for (int i = 0; i < n; ++i)
+    {
+        runAndWait(loopOf(i), [&, i]() { replies += sessions[i]->stop(); });
+    }
+    double sec = std::chrono::duration<double>(Clock::now() - start).count();
+
+    UdpChannel::Stats total = {0, 0, 0, 0, 0};
+    bool gso = false;
+    bool gro = false;
+    for (UdpChannel *channel : server->channels())
+    {
+        runAndWait(channel->getLoop(), [&]() {
+            const UdpChannel::Stats &stats = channel->stats();
+            total.receivedDatagrams += stats.receivedDatagrams;
+            total.receiveCalls += stats.receiveCalls;
+            total.sentDatagrams += stats.sentDatagrams;
+            total.sendCalls += stats.sendCalls;
+            total.droppedDatagrams += stats.droppedDatagrams;
+            gso = channel->gsoEnabled();
+            gro = channel->groEnabled();
+        });
+    }
+
+    for (int i = 0; i < n; ++i)
+    {
+        runAndWait(loopOf(i), [&, i]() { sessions[i].reset(); });
+    }
+    runAndWait(serverLoop, [&]() { server.reset(); });
+
+    printf("%-12s %10.0f pps  datagrams/recv=%5.1f  datagrams/send=%5.1f  dropped=%lu%s\n",
+        variant.name, replies / sec,
+        total.receiveCalls ? static_cast<double>(total.receivedDatagrams) / total.receiveCalls : 0.0,
+        total.sendCalls ? static_cast<double>(total.sentDatagrams) / total.sendCalls : 0.0,
+        static_cast<unsigned long>(total.droppedDatagrams),
+        variant.offload && !(gso && gro) ? "  (GSO/GRO unsupported)" : "");
+}
+
+void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-c sockets] [-d seconds] [-w window] [-s size] [-b batch]"
+        " [-C client_threads] [-S server_threads]\n", prog);
+    exit(1);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 屏蔽库内部输出到 std::cout 的日志，只保留 printf 输出的测试结果
+    std::cout.setstate(std::ios_base::badbit);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    Config config;
+    int opt;
+    while ((opt = ::getopt(argc, argv, "c:d:w:s:b:C:S:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c': config.sockets = atoi(optarg); break;
+        case 'd': config.seconds = atof(optarg); break;
+        case 'w': config.window = static_cast<size_t>(atol(optarg)); break;
+        case 's': config.size = static_cast<size_t>(atol(optarg)); break;
+        case 'b': config.batch = atoi(optarg); break;
+        case 'C': config.clientThreads = atoi(optarg); break;
+        case 'S': config.serverThreads = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (config.sockets <= 0 || config.seconds <= 0 || config.window == 0 || config.size == 0
+        || config.size > 1472 || config.batch <= 0 || config.clientThreads <= 0 || config.serverThreads < 0)
+    {
+        usage(argv[0]);
+    }
+
+    const Variant variants[] = {
+        { "single", 1, false },
+        { "batch", config.batch, false },
+        { "batch+gso", config.batch, true },
+    };
+
+    EventLoop loop;
+    std::thread driver([&]() {
+        printf("%d sockets, window %zu, %zu byte datagrams, batch %d, %d client threads, %d server threads,"
+            " %.1f seconds per run\n", config.sockets, config.window, config.size, config.batch,
+            config.clientThreads, config.serverThreads, config.seconds);
+        {
+            std::vector<std::unique_ptr<EventLoopThread>> threads;
+            std::vector<EventLoop*> loops;
+            for (int i = 0; i < config.clientThreads; ++i)
+            {
+                threads.emplace_back(new EventLoopThread(EventLoopThread::ThreadInitCallback(), "client"));
+                loops.push_back(threads.back()->startLoop());
+            }
+            for (size_t i = 0; i < sizeof variants / sizeof variants[0]; ++i)
+            {
+                runVariant(&loop, loops, config, variants[i], static_cast<uint16_t>(kBasePort + i));
+            }
+        }
+        loop.quit();
+    });
+
+    loop.loop();
+    driver.join();
+    return 0;
+}
@@ -0,0 +1,346 @@
+/**
+ * AF_UNIX 和 loopback TCP 的 ping-pong 延迟对比：同一套 TcpServer / TcpClient / TcpConnection，
+ * 只是监听地址不同。每个连接发送 size 字节，服务端原样返回，收齐以后立即发送下一个，
+ * 对每种传输和消息大小输出往返次数/秒和往返延迟分位数。
+ * 最后测试 AF_UNIX 上附带描述符（SCM_RIGHTS）的 ping-pong：每个请求携带一个描述符，服务端取出、检查并关闭。
+ *
+ * 用法: unix_bench [-c 连接数] [-s 消息大小,...] [-d 每项秒数] [-p unix 路径] [-C 客户端线程数] [-S 服务端线程数]
+ */
+#include "TcpServer.h"
+#include "TcpClient.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Buffer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const uint16_t kTcpPort = 10071;
+
+using Clock = std::chrono::steady_clock;
+
+// 服务端收到、检查通过和检查失败的描述符个数
+std::atomic<uint64_t> g_fdsReceived(0);
+std::atomic<uint64_t> g_fdsInvalid(0);
+
+void onEchoMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    if (conn->localAddress().isUnix())
+    {
+        for (int fd : conn->takeReceivedFds())
+        {
+            struct stat st;
+            ++(::fstat(fd, &st) == 0 ? g_fdsReceived : g_fdsInvalid);
+            ::close(fd);
+        }
+    }
+    conn->send(buf);
+}
+
+struct Result
+{
+    uint64_t count;
+    std::vector<double> latencies;  // 单位微秒
+};
+
+// 一个客户端连接，除构造函数外所有函数都在 loop 线程中调用
+class Session : noncopyable
+{
+public:
+    Session(EventLoop *loop, const InetAddress &serverAddr, size_t size, int passFd, std::atomic_int *connected)
+        : size_(size)
+        , passFd_(passFd)
+        , connected_(connected)
+        , running_(false)
+        , client_(loop, serverAddr, "UnixBench")
+        , payload_(size, 'x')
+        , result_{0, {}}
+    {
+        SocketOptions options;
+        options.tcpNoDelay = true;
+        client_.setSocketOptions(options);
+        client_.setConnectionCallback(std::bind(&Session::onConnection, this, std::placeholders::_1));
+        client_.setMessageCallback(std::bind(&Session::onMessage, this,
+            std::placeholders::_1, std::placeholders::_2));
+        client_.connect();
+    }
+
+    void start()
+    {
+        running_ = true;
+        TcpConnectionPtr conn = client_.connection();
+        if (conn)
+        {
+            sendRequest(conn);
+        }
+    }
+
+    // 停止发送并关闭连接，连接断开以后才能析构
+    Result stop()
+    {
+        running_ = false;
+        client_.disconnect();
+        TcpConnectionPtr conn = client_.connection();
+        if (conn)
+        {
+            conn->forceClose();
+        }
+        return std::move(result_);
+    }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            ++*connected_;
+        }
+        else
+        {
+            --*connected_;
+        }
+    }
+
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf)
+    {
+        while (buf->readableBytes() >= size_)
+        {
+            buf->retrieve(size_);
+            auto now = Clock::now();
+            ++result_.count;
+            result_.latencies.push_back(std::chrono::duration<double, std::micro>(now - sentAt_).count());
+            if (running_)
+            {
+                sendRequest(conn);
+            }
+        }
+    }
+
+    void sendRequest(const TcpConnectionPtr &conn)
+    {
+        sentAt_ = Clock::now();
+        if (passFd_ >= 0)
+        {
+            conn->sendFds(std::vector<int>(1, passFd_), payload_);
+        }
+        else
+        {
+            conn->send(payload_);
+        }
+    }
+
+    const size_t size_;
+    const int passFd_;                  // 每个请求附带的描述符，-1 表示不附带
+    std::atomic_int *connected_;
+    bool running_;
+    TcpClient client_;
+    std::string payload_;
+    Clock::time_point sentAt_;
+    Result result_;
+};
+
+struct Config
+{
+    int connections = 1;
+    std::vector<size_t> sizes = { 64, 4096 };
+    double seconds = 2.0;
+    std::string unixPath = "@mymuduo-unix-bench";
+    int clientThreads = 1;
+    int serverThreads = 1;
+};
+
+template <typename F>
+void runAndWait(EventLoop *loop, F f)
+{
+    std::promise<void> done;
+    loop->runInLoop([&f, &done]() {
+        f();
+        done.set_value();
+    });
+    done.get_future().get();
+}
+
+double percentile(std::vector<double> &values, double p)
+{
+    if (values.empty())
+    {
+        return 0.0;
+    }
+    size_t index = static_cast<size_t>(p * (values.size() - 1));
+    std::nth_element(values.begin(), values.begin() + index, values.end());
+    return values[index];
+}
+
+void runPingPong(const std::vector<EventLoop*> &loops, const Config &config, const char *name,
+                 const InetAddress &serverAddr, size_t size, int passFd)
+{
+    const int n = config.connections;
+    auto loopOf = [&loops](int i) { return loops[i % loops.size()]; };
+    std::atomic_int connected(0);
+    std::vector<std::unique_ptr<Session>> sessions(n);
+    for (int i = 0; i < n; ++i)
+    {
+        runAndWait(loopOf(i), [&, i]() {
+            sessions[i].reset(new Session(loopOf(i), serverAddr, size, passFd, &connected));
+        });
+    }
+    while (connected < n)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    auto start = Clock::now();
+    for (int i = 0; i < n; ++i)
+    {
+        loopOf(i)->runInLoop(std::bind(&Session::start, sessions[i].get()));
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(config.seconds));
+    std::vector<Result> results(n);
+    for (int i = 0; i < n; ++i)
+    {
+        runAndWait(loopOf(i), [&, i]() { results[i] = sessions[i]->stop(); });
+    }
+    double sec = std::chrono::duration<double>(Clock::now() - start).count();
+    while (connected > 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    for (int i = 0; i < n; ++i)
+    {
+        runAndWait(loopOf(i), [&, i]() { sessions[i].reset(); });
+    }
+
+    uint64_t count = 0;
+    std::vector<double> latencies;
+    for (Result &r : results)
+    {
+        count += r.count;
+        latencies.insert(latencies.end(), r.latencies.begin(), r.latencies.end());
+    }
+    printf("%-8s %6zu bytes  %9.0f rtt/s  p50=%6.1fus  p99=%6.1fus  p999=%7.1fus\n", name, size, count / sec,
+        percentile(latencies, 0.5), percentile(latencies, 0.99), percentile(latencies, 0.999));
+}
+
+std::vector<size_t> parseList(const char *arg)
+{
+    std::vector<size_t> values;
+    std::string list(arg);
+    size_t pos = 0;
+    while (pos <= list.size())
+    {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos)
+        {
+            comma = list.size();
+        }
+        size_t value = static_cast<size_t>(atol(list.substr(pos, comma - pos).c_str()));
+        if (value > 0)
+        {
+            values.push_back(value);
+        }
+        pos = comma + 1;
+    }
+    return values;
+}
+
+void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-c connections] [-s size,...] [-d seconds] [-p unix_path]"
+        " [-C client_threads] [-S server_threads]\n", prog);
+    exit(1);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 屏蔽库内部输出到 std::cout 的日志，只保留 printf 输出的测试结果
+    std::cout.setstate(std::ios_base::badbit);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    Config config;
+    int opt;
+    while ((opt = ::getopt(argc, argv, "c:s:d:p:C:S:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c': config.connections = atoi(optarg); break;
+        case 's': config.sizes = parseList(optarg); break;
+        case 'd': config.seconds = atof(optarg); break;
+        case 'p': config.unixPath = optarg; break;
+        case 'C': config.clientThreads = atoi(optarg); break;
+        case 'S': config.serverThreads = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (config.connections <= 0 || config.sizes.empty() || config.seconds <= 0 || config.unixPath.empty()
+        || config.clientThreads <= 0 || config.serverThreads < 0)
+    {
+        usage(argv[0]);
+    }
+
+    const InetAddress tcpAddr(kTcpPort, "127.0.0.1");
+    const InetAddress unixAddr(InetAddress::fromUnixPath(config.unixPath));
+
+    EventLoop loop;
+    TcpServer tcpServer(&loop, tcpAddr, "TcpEcho");
+    TcpServer unixServer(&loop, unixAddr, "UnixEcho");
+    SocketOptions options;
+    options.tcpNoDelay = true;
+    for (TcpServer *server : { &tcpServer, &unixServer })
+    {
+        server->setSocketOptions(options);
+        server->setThreadNum(config.serverThreads);
+        server->setConnectionCallback([](const TcpConnectionPtr&) {});
+        server->setMessageCallback(onEchoMessage);
+        server->start();
+    }
+
+    std::thread driver([&]() {
+        printf("%d connections, %d client threads, %d server threads, %.1f seconds per run, unix path %s\n",
+            config.connections, config.clientThreads, config.serverThreads, config.seconds,
+            config.unixPath.c_str());
+        {
+            std::vector<std::unique_ptr<EventLoopThread>> threads;
+            std::vector<EventLoop*> loops;
+            for (int i = 0; i < config.clientThreads; ++i)
+            {
+                threads.emplace_back(new EventLoopThread(EventLoopThread::ThreadInitCallback(), "client"));
+                loops.push_back(threads.back()->startLoop());
+            }
+            for (size_t size : config.sizes)
+            {
+                runPingPong(loops, config, "tcp", tcpAddr, size, -1);
+                runPingPong(loops, config, "unix", unixAddr, size, -1);
+            }
+            int pipefd[2];
+            if (::pipe(pipefd) == 0)
+            {
+                runPingPong(loops, config, "unix+fd", unixAddr, config.sizes.front(), pipefd[0]);
+                ::close(pipefd[0]);
+                ::close(pipefd[1]);
+                printf("server received %lu fds, %lu invalid\n",
+                    static_cast<unsigned long>(g_fdsReceived.load()), static_cast<unsigned long>(g_fdsInvalid.load()));
+            }
+        }
+        loop.quit();
+    });
+
+    loop.loop();
+    driver.join();
+    return 0;
+}
@@ -0,0 +1,372 @@
+/**
+ * WebSocketServer 基准测试（loopback）：
+ *   mask  各个掩码实现（scalar / sse2 / avx2）原地掩码的吞吐量，并和标量实现的结果比对
+ *   echo  客户端连接由 TcpClient 建立并完成握手，平均分配到若干个客户端 loop 线程。每个连接保持 depth 个
+ *         未完成的二进制消息（客户端按协议带掩码发送），服务端原样回复，收到一个回复就补发一个。
+ *         对每个消息大小输出每秒帧数（单向）和负载带宽
+ *
+ * 用法: websocket_bench [-c 连接数] [-d 每项秒数] [-s 消息大小,...] [-p depth] [-C 客户端线程数] [-S 服务端线程数]
+ */
+#include "WebSocketServer.h"
+#include "WebSocketFrame.h"
+#include "WebSocketMask.h"
+#include "TcpClient.h"
+#include "EventLoop.h"
+#include "EventLoopThread.h"
+#include "Buffer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <future>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace
+{
+
+const uint16_t kPort = 10041;
+
+using Clock = std::chrono::steady_clock;
+
+void benchMask(size_t size)
+{
+    const uint32_t key = 0x9A3C5E71;
+    std::string reference(size, '\0');
+    for (size_t i = 0; i < size; ++i)
+    {
+        reference[i] = static_cast<char>(i * 131 + 7);
+    }
+    std::string expected = reference;
+    WebSocketMask::apply(BufferSearch::kScalar, &expected[0] + 1, size - 1, key);
+
+    const BufferSearch::Impl impls[] = { BufferSearch::kScalar, BufferSearch::kSse2, BufferSearch::kAvx2 };
+    for (BufferSearch::Impl impl : impls)
+    {
+        if (!BufferSearch::supported(impl))
+        {
+            continue;
+        }
+        // 从第 1 个字节开始，覆盖不对齐的情况
+        std::string data = reference;
+        WebSocketMask::apply(impl, &data[0] + 1, size - 1, key);
+        const bool ok = data == expected;
+
+        const size_t kTotalBytes = 1UL << 30;
+        const size_t rounds = std::max<size_t>(1, kTotalBytes / size);
+        auto start = Clock::now();
+        for (size_t i = 0; i < rounds; ++i)
+        {
+            WebSocketMask::apply(impl, &data[0], size, key);
+        }
+        double sec = std::chrono::duration<double>(Clock::now() - start).count();
+        printf("mask %-6s %7zu bytes  %7.2f GB/s%s\n", BufferSearch::implName(impl), size,
+            static_cast<double>(rounds) * size / sec / 1e9, ok ? "" : "  MISMATCH");
+    }
+}
+
+struct Result
+{
+    uint64_t frames;
+    uint64_t bytes;
+};
+
+// 一个客户端连接，除构造函数外所有函数都在 loop 线程中调用
+class Session : noncopyable
+{
+public:
+    Session(EventLoop *loop, size_t size, size_t depth, std::atomic_int *upgraded)
+        : depth_(depth)
+        , upgraded_(upgraded)
+        , counted_(false)
+        , running_(false)
+        , client_(loop, InetAddress(kPort, "127.0.0.1"), "WebSocketBench")
+        , payload_(size, 'x')
+        , result_{0, 0}
+    {
+        SocketOptions options;
+        options.tcpNoDelay = true;
+        client_.setSocketOptions(options);
+        client_.setConnectionCallback(std::bind(&Session::onConnection, this, std::placeholders::_1));
+        client_.setMessageCallback(std::bind(&Session::onMessage, this,
+            std::placeholders::_1, std::placeholders::_2));
+        client_.connect();
+    }
+
+    void start()
+    {
+        running_ = true;
+        TcpConnectionPtr conn = client_.connection();
+        if (!conn)
+        {
+            return;
+        }
+        for (size_t i = 0; i < depth_; ++i)
+        {
+            sendMessage(conn);
+        }
+        conn->flushOutputBuffer();
+    }
+
+    // 停止发送并关闭连接，连接断开以后才能析构
+    Result stop()
+    {
+        running_ = false;
+        client_.disconnect();
+        TcpConnectionPtr conn = client_.connection();
+        if (conn)
+        {
+            conn->forceClose();
+        }
+        return result_;
+    }
+
+private:
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            conn->send("GET /echo HTTP/1.1\r\nHost: localhost\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                "Sec-WebSocket-Key: dGhlIHNhbXBsZSBub25jZQ==\r\nSec-WebSocket-Version: 13\r\n\r\n");
+        }
+        else if (counted_)
+        {
+            --*upgraded_;
+        }
+    }
+
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf)
+    {
+        if (!counted_)
+        {
+            const char *end = static_cast<const char*>(::memmem(buf->peek(), buf->readableBytes(), "\r\n\r\n", 4));
+            if (end == nullptr)
+            {
+                return;
+            }
+            if (::memcmp(buf->peek(), "HTTP/1.1 101", 12) != 0)
+            {
+                printf("handshake failed\n");
+                conn->forceClose();
+                return;
+            }
+            buf->retrieveUntil(end + 4);
+            counted_ = true;
+            ++*upgraded_;
+        }
+
+        char *data = buf->mutablePeek();
+        const size_t readable = buf->readableBytes();
+        size_t consumed = 0;
+        while (consumed < readable)
+        {
+            WebSocketFrame frame;
+            WebSocketFrame::ParseResult result = WebSocketFrame::parse(data + consumed, readable - consumed,
+                false, payload_.size(), &frame);
+            if (result != WebSocketFrame::kGotFrame)
+            {
+                break;
+            }
+            consumed += frame.length;
+            ++result_.frames;
+            result_.bytes += frame.payload.size();
+            if (running_)
+            {
+                sendMessage(conn);
+            }
+        }
+        buf->retrieve(consumed);
+        conn->flushOutputBuffer();
+    }
+
+    void sendMessage(const TcpConnectionPtr &conn)
+    {
+        WebSocketFrame::appendMasked(conn->outputBuffer(), WebSocketFrame::kBinary, payload_, nextKey_++);
+    }
+
+    const size_t depth_;
+    std::atomic_int *upgraded_;
+    bool counted_;
+    bool running_;
+    TcpClient client_;
+    std::string payload_;
+    uint32_t nextKey_ = 0x12345678;
+    Result result_;
+};
+
+struct Config
+{
+    int connections = 32;
+    double seconds = 2.0;
+    std::vector<size_t> sizes = { 64, 65536 };
+    size_t depth = 8;
+    int clientThreads = 2;
+    int serverThreads = 2;
+};
+
+template <typename F>
+void runAndWait(EventLoop *loop, F f)
+{
+    std::promise<void> done;
+    loop->runInLoop([&f, &done]() {
+        f();
+        done.set_value();
+    });
+    done.get_future().get();
+}
+
+void runEcho(const std::vector<EventLoop*> &loops, const Config &config, size_t size)
+{
+    const int n = config.connections;
+    auto loopOf = [&loops](int i) { return loops[i % loops.size()]; };
+    std::atomic_int upgraded(0);
+    std::vector<std::unique_ptr<Session>> sessions(n);
+    for (int i = 0; i < n; ++i)
+    {
+        runAndWait(loopOf(i), [&, i]() { sessions[i].reset(new Session(loopOf(i), size, config.depth, &upgraded)); });
+    }
+    while (upgraded < n)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+
+    auto start = Clock::now();
+    for (int i = 0; i < n; ++i)
+    {
+        loopOf(i)->runInLoop(std::bind(&Session::start, sessions[i].get()));
+    }
+    std::this_thread::sleep_for(std::chrono::duration<double>(config.seconds));
+    std::vector<Result> results(n);
+    for (int i = 0; i < n; ++i)
+    {
+        runAndWait(loopOf(i), [&, i]() { results[i] = sessions[i]->stop(); });
+    }
+    double sec = std::chrono::duration<double>(Clock::now() - start).count();
+    while (upgraded > 0)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    for (int i = 0; i < n; ++i)
+    {
+        runAndWait(loopOf(i), [&, i]() { sessions[i].reset(); });
+    }
+
+    uint64_t frames = 0;
+    uint64_t bytes = 0;
+    for (const Result &r : results)
+    {
+        frames += r.frames;
+        bytes += r.bytes;
+    }
+    printf("echo %7zu bytes  %10.0f frames/s  %8.1f MB/s\n", size, frames / sec, bytes / sec / 1e6);
+}
+
+std::vector<size_t> parseList(const char *arg)
+{
+    std::vector<size_t> values;
+    std::string list(arg);
+    size_t pos = 0;
+    while (pos <= list.size())
+    {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos)
+        {
+            comma = list.size();
+        }
+        size_t value = static_cast<size_t>(atol(list.substr(pos, comma - pos).c_str()));
+        if (value > 0)
+        {
+            values.push_back(value);
+        }
+        pos = comma + 1;
+    }
+    return values;
+}
+
+void usage(const char *prog)
+{
+    fprintf(stderr, "usage: %s [-c connections] [-d seconds] [-s size,...] [-p depth]"
+        " [-C client_threads] [-S server_threads]\n", prog);
+    exit(1);
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 屏蔽库内部输出到 std::cout 的日志，只保留 printf 输出的测试结果
+    std::cout.setstate(std::ios_base::badbit);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    Config config;
+    int opt;
+    while ((opt = ::getopt(argc, argv, "c:d:s:p:C:S:")) != -1)
+    {
+        switch (opt)
+        {
+        case 'c': config.connections = atoi(optarg); break;
+        case 'd': config.seconds = atof(optarg); break;
+        case 's': config.sizes = parseList(optarg); break;
+        case 'p': config.depth = static_cast<size_t>(atol(optarg)); break;
+        case 'C': config.clientThreads = atoi(optarg); break;
+        case 'S': config.serverThreads = atoi(optarg); break;
+        default: usage(argv[0]);
+        }
+    }
+    if (config.connections <= 0 || config.seconds <= 0 || config.sizes.empty() || config.depth == 0
+        || config.clientThreads <= 0 || config.serverThreads < 0)
+    {
+        usage(argv[0]);
+    }
+
+    printf("mask dispatch: %s\n", BufferSearch::implName(BufferSearch::currentImpl()));
+    for (size_t size : config.sizes)
+    {
+        benchMask(size);
+    }
+
+    EventLoop loop;
+    WebSocketServer server(&loop, InetAddress(kPort, "127.0.0.1"), "WebSocketBench");
+    server.setThreadNum(config.serverThreads);
+    server.setMessageCallback([](const TcpConnectionPtr &conn, StringPiece payload, bool binary, Timestamp) {
+        if (binary)
+        {
+            WebSocketServer::sendBinary(conn, payload);
+        }
+        else
+        {
+            WebSocketServer::sendText(conn, payload);
+        }
+    });
+    server.start();
+
+    std::thread driver([&loop, &config]() {
+        printf("%d connections, depth %zu, %d client threads, %d server threads, %.1f seconds per run\n",
+            config.connections, config.depth, config.clientThreads, config.serverThreads, config.seconds);
+        {
+            std::vector<std::unique_ptr<EventLoopThread>> threads;
+            std::vector<EventLoop*> loops;
+            for (int i = 0; i < config.clientThreads; ++i)
+            {
+                threads.emplace_back(new EventLoopThread(EventLoopThread::ThreadInitCallback(), "client"));
+                loops.push_back(threads.back()->startLoop());
+            }
+            for (size_t size : config.sizes)
+            {
+                runEcho(loops, config, size);
+            }
+        }
+        loop.quit();
+    });
+
+    loop.loop();
+    driver.join();
+    return 0;
+}
@@ -0,0 +1,188 @@
+/**
+ * MSG_ZEROCOPY 基准测试：对不同大小的响应分别用拷贝发送和零拷贝发送，找出两者的分界点。
+ * 客户端发送 1 字节模式（'c' 拷贝 / 'z' 零拷贝）+ 4 字节响应长度，服务端用 SharedString 回复。
+ *
+ * 用法:
+ *   zerocopy_bench                       服务端和客户端在同一进程，走 loopback
+ *   zerocopy_bench server <port>         只运行服务端，例如在 veth 对端的 network namespace 中
+ *   zerocopy_bench client <ip> <port>    只运行客户端
+ * 注意 loopback 上内核总是退化为拷贝（输出中 fallbacks 计数），veth 跨 namespace 才能体现零拷贝的收益。
+ */
+#include "TcpServer.h"
+#include "EventLoop.h"
+#include "Buffer.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <chrono>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <string>
+#include <thread>
+
+namespace
+{
+
+const size_t kRequestLen = 5;
+const size_t kTotalBytesPerRun = 256 * 1024 * 1024;   // 每组测试传输 256MB
+
+// 只在服务端 loop 线程中访问
+std::map<size_t, SharedString> g_payloads;
+
+SharedString payload(size_t size)
+{
+    SharedString &p = g_payloads[size];
+    if (!p)
+    {
+        p = std::make_shared<const std::string>(size, 'z');
+    }
+    return p;
+}
+
+void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+{
+    while (buf->readableBytes() >= kRequestLen)
+    {
+        bool zeroCopy = buf->readInt8() == 'z';
+        size_t size = static_cast<uint32_t>(buf->readInt32());
+        conn->setZeroCopy(zeroCopy, 0);
+        conn->send(payload(size));
+    }
+}
+
+void onConnection(const TcpConnectionPtr &conn)
+{
+    if (conn->connected())
+    {
+        conn->setTcpNoDelay(true);
+    }
+    else
+    {
+        TcpConnection::SendStats stats = conn->sendStats();
+        fprintf(stderr, "server: zerocopy bytes=%lu fallbacks=%lu writes=%lu\n",
+            static_cast<unsigned long>(stats.zeroCopyBytes),
+            static_cast<unsigned long>(stats.zeroCopyFallbacks),
+            static_cast<unsigned long>(stats.writeCalls));
+    }
+}
+
+double cpuSeconds()
+{
+    rusage usage;
+    ::getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_utime.tv_sec + usage.ru_utime.tv_usec / 1e6
+        + usage.ru_stime.tv_sec + usage.ru_stime.tv_usec / 1e6;
+}
+
+void runOne(const char *ip, uint16_t port, size_t size, bool zeroCopy)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    sockaddr_in addr;
+    ::memset(&addr, 0, sizeof addr);
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = ::inet_addr(ip);
+    if (::connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof addr) < 0)
+    {
+        perror("connect");
+        exit(1);
+    }
+
+    // 一次发出多个请求，保证服务端发送队列中总有数据
+    const int kDepth = 4;
+    Buffer request;
+    for (int i = 0; i < kDepth; ++i)
+    {
+        request.appendInt8(zeroCopy ? 'z' : 'c');
+        request.appendInt32(static_cast<int32_t>(size));
+    }
+
+    std::string buf(256 * 1024, '\0');
+    const size_t rounds = kTotalBytesPerRun / (size * kDepth) + 1;
+    double cpuStart = cpuSeconds();
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < rounds; ++i)
+    {
+        if (::write(fd, request.peek(), request.readableBytes()) != static_cast<ssize_t>(request.readableBytes()))
+        {
+            perror("write");
+            exit(1);
+        }
+        size_t left = size * kDepth;
+        while (left > 0)
+        {
+            ssize_t n = ::read(fd, &buf[0], std::min(left, buf.size()));
+            if (n <= 0)
+            {
+                fprintf(stderr, "connection broken\n");
+                exit(1);
+            }
+            left -= n;
+        }
+    }
+    double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    double cpu = cpuSeconds() - cpuStart;
+    ::close(fd);
+
+    double gb = static_cast<double>(size) * kDepth * rounds / (1024.0 * 1024 * 1024);
+    printf("%-8s size=%-9zu %9.1f MB/s %8.3f cpu-sec/GB\n",
+        zeroCopy ? "zerocopy" : "copy", size, gb * 1024 / sec, cpu / gb);
+}
+
+void runClient(const char *ip, uint16_t port)
+{
+    const size_t sizes[] = { 4 << 10, 16 << 10, 64 << 10, 256 << 10, 1 << 20, 4 << 20, 16 << 20 };
+    for (size_t size : sizes)
+    {
+        runOne(ip, port, size, false);
+        runOne(ip, port, size, true);
+    }
+}
+
+} // namespace
+
+int main(int argc, char *argv[])
+{
+    // 屏蔽库内部输出到 std::cout 的日志，只保留 printf 输出的测试结果
+    std::cout.setstate(std::ios_base::badbit);
+    setvbuf(stdout, nullptr, _IOLBF, 0);
+
+    if (argc > 3 && strcmp(argv[1], "client") == 0)
+    {
+        runClient(argv[2], static_cast<uint16_t>(atoi(argv[3])));
+        return 0;
+    }
+
+    bool serverOnly = argc > 1 && strcmp(argv[1], "server") == 0;
+    uint16_t port = static_cast<uint16_t>(serverOnly && argc > 2 ? atoi(argv[2]) : 9986);
+
+    EventLoop loop;
+    // 单独运行服务端时监听所有地址，便于从 veth 对端访问
+    TcpServer server(&loop, InetAddress(port, serverOnly ? "0.0.0.0" : "127.0.0.1"), "ZeroCopyBench");
+    server.setConnectionCallback(onConnection);
+    server.setMessageCallback(onMessage);
+    server.start();
+
+    std::thread client;
+    if (!serverOnly)
+    {
+        client = std::thread([&loop, port]() {
+            runClient("127.0.0.1", port);
+            loop.quit();
+        });
+    }
+
+    loop.loop();
+    if (client.joinable())
+    {
+        client.join();
+    }
+    return 0;
+}
@@ -0,0 +1,500 @@
+#pragma once
+
+#include <mymuduo/TcpServer.h>
+#include <mymuduo/EventLoop.h>
+#include <mymuduo/Buffer.h>
+#include <mymuduo/RespCodec.h>
+#include <mymuduo/Logger.h>
+
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include <stdint.h>
+
+/**
+ * 说 Redis 协议的内存 KV 服务器示例，支持 PING、ECHO、GET、SET、DEL、COMMAND。
+ *
+ * 每个 sub loop 拥有一个分片（开放寻址的哈希表），键的哈希值决定它属于哪个分片，分片只在所属的
+ * loop 线程中访问，不需要锁。连接上的命令如果属于连接所在 loop 的分片就直接执行；否则按目标分片分组，
+ * 一次 onMessage 里发往同一个分片的命令只用一次 queueInLoop 投递过去，执行完再一次投递回来。
+ * 流水线命令的回复必须按顺序发送：远程命令返回之前，后面的命令的回复暂存在连接的待发送队列里。
+ */
+class KvServer
+{
+public:
+    KvServer(EventLoop *loop, const InetAddress &addr, const std::string &name, int numLoops)
+        : server_(loop, addr, name)
+    {
+        server_.setThreadNum(numLoops);
+        server_.setThreadInitcallback(std::bind(&KvServer::initLoop, this, std::placeholders::_1));
+        server_.setConnectionCallback(std::bind(&KvServer::onConnection, this, std::placeholders::_1));
+        server_.setMessageCallback(std::bind(&KvServer::onMessage, this,
+            std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+    }
+
+    void start() { server_.start(); }
+
+private:
+    /********************************** 分片 **********************************/
+
+    // 线性探测的开放寻址哈希表，容量是 2 的幂，删除留下墓碑，装载（含墓碑）超过 70% 时重建
+    class Table
+    {
+    public:
+        Table() : slots_(kInitialCapacity), size_(0), used_(0) {}
+
+        const std::string* get(StringPiece key, uint64_t hash) const
+        {
+            size_t i = find(key, hash);
+            return i == kNotFound ? nullptr : &slots_[i].value;
+        }
+
+        void set(StringPiece key, uint64_t hash, StringPiece value)
+        {
+            if ((used_ + 1) * 10 > slots_.size() * 7)
+            {
+                rehash(size_ * 2 >= slots_.size() / 2 ? slots_.size() * 2 : slots_.size());
+            }
+            hash = slotHash(hash);
+            const size_t mask = slots_.size() - 1;
+            size_t tombstone = kNotFound;
+            for (size_t i = hash & mask; ; i = (i + 1) & mask)
+            {
+                Slot &slot = slots_[i];
+                if (slot.hash == kEmpty)
+                {
+                    Slot &target = tombstone != kNotFound ? slots_[tombstone] : slot;
+                    if (tombstone == kNotFound)
+                    {
+                        ++used_;
+                    }
+                    target.hash = hash;
+                    target.key.assign(key.data(), key.size());
+                    target.value.assign(value.data(), value.size());
+                    ++size_;
+                    return;
+                }
+                if (slot.hash == kTombstone)
+                {
+                    if (tombstone == kNotFound)
+                    {
+                        tombstone = i;
+                    }
+                }
+                else if (slot.hash == hash && StringPiece(slot.key) == key)
+                {
+                    slot.value.assign(value.data(), value.size());
+                    return;
+                }
+            }
+        }
+
+        bool erase(StringPiece key, uint64_t hash)
+        {
+            size_t i = find(key, hash);
+            if (i == kNotFound)
+            {
+                return false;
+            }
+            slots_[i].hash = kTombstone;
+            std::string().swap(slots_[i].key);
+            std::string().swap(slots_[i].value);
+            --size_;
+            return true;
+        }
+
+        size_t size() const { return size_; }
+
+    private:
+        static const size_t kInitialCapacity = 1024;
+        static const size_t kNotFound = static_cast<size_t>(-1);
+        // 槽位里的哈希值 0 表示空，1 表示墓碑，真实的哈希值映射到 2 以上
+        static const uint64_t kEmpty = 0;
+        static const uint64_t kTombstone = 1;
+
+        struct Slot
+        {
+            Slot() : hash(kEmpty) {}
+            uint64_t hash;
+            std::string key;
+            std::string value;
+        };
+
+        static uint64_t slotHash(uint64_t hash) { return hash < 2 ? hash + 2 : hash; }
+
+        size_t find(StringPiece key, uint64_t hash) const
+        {
+            hash = slotHash(hash);
+            const size_t mask = slots_.size() - 1;
+            for (size_t i = hash & mask; ; i = (i + 1) & mask)
+            {
+                const Slot &slot = slots_[i];
+                if (slot.hash == kEmpty)
+                {
+                    return kNotFound;
+                }
+                if (slot.hash == hash && StringPiece(slot.key) == key)
+                {
+                    return i;
+                }
+            }
+        }
+
+        void rehash(size_t capacity)
+        {
+            std::vector<Slot> old(capacity);
+            old.swap(slots_);
+            used_ = size_;
+            const size_t mask = slots_.size() - 1;
+            for (Slot &slot : old)
+            {
+                if (slot.hash == kEmpty || slot.hash == kTombstone)
+                {
+                    continue;
+                }
+                size_t i = slot.hash & mask;
+                while (slots_[i].hash != kEmpty)
+                {
+                    i = (i + 1) & mask;
+                }
+                slots_[i].hash = slot.hash;
+                slots_[i].key.swap(slot.key);
+                slots_[i].value.swap(slot.value);
+            }
+        }
+
+        std::vector<Slot> slots_;
+        size_t size_;       // 有效的键
+        size_t used_;       // 有效的键加墓碑
+    };
+
+    struct Shard
+    {
+        explicit Shard(EventLoop *l) : loop(l) {}
+        EventLoop *loop;
+        Table table;
+        Buffer scratch;     // 前面还有未返回的远程命令时，本地回复先编码在这里，见 queueLocal
+    };
+
+    /********************************** 命令 **********************************/
+
+    enum CommandType
+    {
+        kGet,
+        kSet,
+        kDel,
+    };
+
+    // 发往其他分片执行的命令，键和值需要拷贝
+    struct Op
+    {
+        CommandType type;
+        uint64_t hash;
+        uint64_t seq;           // 在连接待发送队列中的序号
+        std::string key;
+        std::string value;
+    };
+
+    // 同一次 onMessage 中发往同一个分片的命令，回复编码进 replies，offsets[i] 是第 i 个回复的结束位置
+    struct Batch
+    {
+        size_t shard;
+        std::vector<Op> ops;
+        Buffer replies;
+        std::vector<size_t> offsets;
+    };
+    using BatchPtr = std::shared_ptr<Batch>;
+
+    // 一个回复在待发送队列中的位置：本地回复存在 local 中，远程回复引用 batch 中的一段
+    struct Pending
+    {
+        Pending() : ready(false), begin(0), end(0) {}
+        bool ready;
+        std::string local;
+        BatchPtr batch;
+        size_t begin;
+        size_t end;
+    };
+
+    struct Session
+    {
+        explicit Session(size_t homeShard) : home(homeShard), firstSeq(0) {}
+        size_t home;                    // 连接所在 loop 的分片
+        std::deque<Pending> pending;    // 等待远程命令返回、还不能发送的回复
+        uint64_t firstSeq;              // pending.front() 的序号
+        std::vector<StringPiece> args;  // 复用的参数数组
+    };
+
+    static uint64_t hashKey(StringPiece key)
+    {
+        // FNV-1a
+        uint64_t h = 14695981039346656037ULL;
+        for (char c : key)
+        {
+            h ^= static_cast<unsigned char>(c);
+            h *= 1099511628211ULL;
+        }
+        return h;
+    }
+
+    size_t shardOf(uint64_t hash) const { return static_cast<size_t>(hash >> 32) % shards_.size(); }
+
+    void initLoop(EventLoop *loop)
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        shardIndex_[loop] = shards_.size();
+        shards_.emplace_back(new Shard(loop));
+    }
+
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            conn->setContext(std::make_shared<Session>(shardIndex_[conn->getLoop()]));
+        }
+    }
+
+    static Session* getSession(const TcpConnectionPtr &conn)
+    {
+        return static_cast<Session*>(conn->getContext().get());
+    }
+
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp)
+    {
+        Session *session = getSession(conn);
+        std::vector<BatchPtr> batches(shards_.size());
+        const char *data = buf->peek();
+        const size_t readable = buf->readableBytes();
+        size_t consumed = 0;
+        while (consumed < readable)
+        {
+            size_t length = 0;
+            RespCodec::ParseResult result = RespCodec::parseCommand(data + consumed, readable - consumed,
+                &session->args, &length);
+            if (result == RespCodec::kNeedMore)
+            {
+                break;
+            }
+            if (result == RespCodec::kProtocolError)
+            {
+                LOG_ERROR("KvServer [%s] protocol error \n", conn->name().c_str());
+                RespCodec::appendError(conn->outputBuffer(), "ERR Protocol error");
+                consumed = readable;
+                conn->flushOutputBuffer();
+                conn->shutdown();
+                break;
+            }
+            consumed += length;
+            if (!session->args.empty())
+            {
+                dispatch(conn, session, session->args, &batches);
+            }
+        }
+        buf->retrieve(consumed);
+
+        for (BatchPtr &batch : batches)
+        {
+            if (batch)
+            {
+                shards_[batch->shard]->loop->queueInLoop(std::bind(&KvServer::executeBatch, this, conn, batch));
+            }
+        }
+        conn->flushOutputBuffer();
+    }
+
+    void dispatch(const TcpConnectionPtr &conn, Session *session, const std::vector<StringPiece> &args,
+                  std::vector<BatchPtr> *batches)
+    {
+        const StringPiece &name = args[0];
+        CommandType type;
+        if (name.equalsIgnoreCase("GET") && args.size() == 2)
+        {
+            type = kGet;
+        }
+        else if (name.equalsIgnoreCase("SET") && args.size() == 3)
+        {
+            type = kSet;
+        }
+        else if (name.equalsIgnoreCase("DEL") && args.size() == 2)
+        {
+            type = kDel;
+        }
+        else
+        {
+            // 不涉及键的命令总在本地回复
+            Buffer *output = localOutput(conn, session);
+            executeOther(output, args);
+            queueLocal(session, output);
+            return;
+        }
+
+        const uint64_t hash = hashKey(args[1]);
+        const size_t shard = shardOf(hash);
+        if (shard == session->home)
+        {
+            Buffer *output = localOutput(conn, session);
+            execute(&shards_[shard]->table, output, type, args[1], hash, type == kSet ? args[2] : StringPiece());
+            queueLocal(session, output);
+            return;
+        }
+
+        BatchPtr &batch = (*batches)[shard];
+        if (!batch)
+        {
+            batch = std::make_shared<Batch>();
+            batch->shard = shard;
+        }
+        Op op;
+        op.type = type;
+        op.hash = hash;
+        op.seq = session->firstSeq + session->pending.size();
+        op.key.assign(args[1].data(), args[1].size());
+        if (type == kSet)
+        {
+            op.value.assign(args[2].data(), args[2].size());
+        }
+        batch->ops.push_back(std::move(op));
+        session->pending.push_back(Pending());
+    }
+
+    // 前面没有未返回的远程命令时，本地回复直接编码进 outputBuffer
+    Buffer* localOutput(const TcpConnectionPtr &conn, Session *session)
+    {
+        return session->pending.empty() ? conn->outputBuffer() : &shards_[session->home]->scratch;
+    }
+
+    // 本地回复编码在 scratch 中时，移到待发送队列排队
+    void queueLocal(Session *session, Buffer *output)
+    {
+        Buffer *scratch = &shards_[session->home]->scratch;
+        if (output != scratch)
+        {
+            return;
+        }
+        Pending pending;
+        pending.ready = true;
+        pending.local = scratch->retrieveAllAsString();
+        session->pending.push_back(std::move(pending));
+    }
+
+    static void execute(Table *table, Buffer *output, CommandType type, StringPiece key, uint64_t hash, StringPiece value)
+    {
+        switch (type)
+        {
+        case kGet:
+        {
+            const std::string *found = table->get(key, hash);
+            if (found != nullptr)
+            {
+                RespCodec::appendBulkString(output, *found);
+            }
+            else
+            {
+                RespCodec::appendNullBulkString(output);
+            }
+            break;
+        }
+        case kSet:
+            table->set(key, hash, value);
+            RespCodec::appendSimpleString(output, "OK");
+            break;
+        case kDel:
+            RespCodec::appendInteger(output, table->erase(key, hash) ? 1 : 0);
+            break;
+        }
+    }
+
+    static void executeOther(Buffer *output, const std::vector<StringPiece> &args)
+    {
+        const StringPiece &name = args[0];
+        if (name.equalsIgnoreCase("PING"))
+        {
+            if (args.size() > 1)
+            {
+                RespCodec::appendBulkString(output, args[1]);
+            }
+            else
+            {
+                RespCodec::appendSimpleString(output, "PONG");
+            }
+        }
+        else if (name.equalsIgnoreCase("ECHO") && args.size() == 2)
+        {
+            RespCodec::appendBulkString(output, args[1]);
+        }
+        else if (name.equalsIgnoreCase("COMMAND"))
+        {
+            // redis-cli 启动时查询命令表，回复空数组即可
+            RespCodec::appendArrayHeader(output, 0);
+        }
+        else if (name.equalsIgnoreCase("GET") || name.equalsIgnoreCase("SET") || name.equalsIgnoreCase("DEL"))
+        {
+            RespCodec::appendError(output, "ERR wrong number of arguments");
+        }
+        else
+        {
+            RespCodec::appendError(output, "ERR unknown command");
+        }
+    }
+
+    // 在分片所在的 loop 中执行，完成后把整批回复投递回连接所在的 loop
+    void executeBatch(const TcpConnectionPtr &conn, const BatchPtr &batch)
+    {
+        Table *table = &shards_[batch->shard]->table;
+        batch->offsets.reserve(batch->ops.size());
+        for (const Op &op : batch->ops)
+        {
+            execute(table, &batch->replies, op.type, op.key, op.hash, op.value);
+            batch->offsets.push_back(batch->replies.readableBytes());
+        }
+        conn->getLoop()->queueInLoop(std::bind(&KvServer::completeBatch, conn, batch));
+    }
+
+    static void completeBatch(const TcpConnectionPtr &conn, const BatchPtr &batch)
+    {
+        if (!conn->connected())
+        {
+            return;
+        }
+        Session *session = getSession(conn);
+        size_t begin = 0;
+        for (size_t i = 0; i < batch->ops.size(); ++i)
+        {
+            Pending &pending = session->pending[batch->ops[i].seq - session->firstSeq];
+            pending.ready = true;
+            pending.batch = batch;
+            pending.begin = begin;
+            pending.end = batch->offsets[i];
+            begin = pending.end;
+        }
+
+        // 按顺序发送队首已经就绪的回复
+        Buffer *output = conn->outputBuffer();
+        while (!session->pending.empty() && session->pending.front().ready)
+        {
+            const Pending &pending = session->pending.front();
+            if (pending.batch)
+            {
+                output->append(pending.batch->replies.peek() + pending.begin, pending.end - pending.begin);
+            }
+            else
+            {
+                output->append(pending.local.data(), pending.local.size());
+            }
+            session->pending.pop_front();
+            ++session->firstSeq;
+        }
+        conn->flushOutputBuffer();
+    }
+
+    // 在 start 时由各个 loop 线程依次填入，之后只读
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<Shard>> shards_;
+    std::unordered_map<EventLoop*, size_t> shardIndex_;
+    TcpServer server_;
+};
@@ -0,0 +1,17 @@
+#include "KvServer.h"
+
+#include <stdlib.h>
+
+// 用法: kvserver [端口] [sub loop 个数]，可以用 redis-cli / redis-benchmark 测试
+int main(int argc, char *argv[])
+{
+    uint16_t port = argc > 1 ? static_cast<uint16_t>(atoi(argv[1])) : 6379;
+    int numLoops = argc > 2 ? atoi(argv[2]) : 4;
+
+    EventLoop loop;
+    InetAddress addr(port);
+    KvServer server(&loop, addr, "KvServer", numLoops);
+    server.start();
+    loop.loop();
+    return 0;
+}
@@ -0,0 +1,66 @@
+#include <mymuduo/TcpClient.h>
+#include <mymuduo/EventLoop.h>
+#include <mymuduo/Logger.h>
+
+#include <string>
+#include <functional>
+
+// testserver 回显一次就关闭连接，客户端开启重连，收到 3 次回显以后退出。
+// 先启动客户端再启动 testserver，可以看到连接失败以后的退避重试。
+class EchoClient
+{
+public:
+    EchoClient(EventLoop *loop, const InetAddress &addr, const std::string &name)
+        : client_(loop, addr, name), loop_(loop), replies_(0)
+    {
+        client_.setConnectionCallback(std::bind(&EchoClient::onConnection, this, std::placeholders::_1));
+        client_.setMessageCallback(std::bind(&EchoClient::onMessage, this, std::placeholders::_1, std::placeholders::_2, std::placeholders::_3));
+        // 连接断开以后重新连接；连接失败时从 0.5 秒开始退避，最长 4 秒
+        client_.enableRetry();
+        client_.setRetryDelay(0.5, 4.0);
+        client_.setConnectTimeout(3.0);
+    }
+
+    void connect()
+    {
+        client_.connect();
+    }
+private:
+    void onConnection(const TcpConnectionPtr &conn)
+    {
+        if (conn->connected())
+        {
+            LOG_INFO("Connection UP : %s", conn->peerAddress().toIpPort().c_str());
+            conn->send("hello mymuduo\n");
+        }
+        else
+        {
+            LOG_INFO("Connection DOWN : %s", conn->peerAddress().toIpPort().c_str());
+        }
+    }
+
+    void onMessage(const TcpConnectionPtr &conn, Buffer *buf, Timestamp time)
+    {
+        std::string msg = buf->retrieveAllAsString();
+        LOG_INFO("reply %d : %s", replies_ + 1, msg.c_str());
+        if (++replies_ == 3)
+        {
+            client_.disconnect();
+            loop_->runAfter(0.1, std::bind(&EventLoop::quit, loop_));
+        }
+    }
+
+    TcpClient client_;
+    EventLoop *loop_;
+    int replies_;
+};
+
+int main()
+{
+    EventLoop loop;
+    InetAddress addr(8000);
+    EchoClient client(&loop, addr, "EchoClient");
+    client.connect();
+    loop.loop();
+    return 0;
+}